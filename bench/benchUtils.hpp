@@ -0,0 +1,76 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Micro-benchmarks
+ * @file: bench/benchUtils.hpp
+ *
+ *******************************************************************************/
+#pragma once
+#ifndef STYXE_BENCH_BENCHUTILS_HPP
+#define STYXE_BENCH_BENCHUTILS_HPP
+
+#include <styxe/9p2000.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+
+namespace styxe {
+namespace bench {
+
+/// Message size used by benchmarks: large enough for a typical 64k iounit of modern clients.
+constexpr size_type kBenchMessageSize = 64*1024 + 24;
+
+/// Payload sizes of read/write messages: small config files, a page, typical iounit, large iounit.
+#define STYXE_BENCH_PAYLOAD_SIZES ->Arg(64)->Arg(4096)->Arg(8*1024)->Arg(64*1024)
+
+
+/// Message buffer and parser shared by benchmarks.
+struct BenchContext {
+	BenchContext()
+		: _storage(kBenchMessageSize)
+		, _payloadStorage(kBenchMessageSize, 0xA5)
+	{}
+
+	/// @return Writer to encode messages into.
+	Solace::ByteWriter writer() {
+		return Solace::ByteWriter{Solace::wrapMemory(_storage.data(), _storage.size())};
+	}
+
+	/// @return Payload data of a given size.
+	Solace::MemoryView payload(size_t size) const {
+		return Solace::wrapMemory(_payloadStorage.data(), size);
+	}
+
+	/// Parser configured for the benchmark message size.
+	Parser							parser{kBenchMessageSize};
+
+private:
+	std::vector<Solace::byte>		_storage;
+	std::vector<Solace::byte>		_payloadStorage;
+};
+
+
+/// Report throughput counters of a benchmark that processes one message per iteration.
+inline void reportMessages(benchmark::State& state, size_t bytesPerMessage) {
+	state.SetItemsProcessed(state.iterations());
+	state.SetBytesProcessed(state.iterations() * bytesPerMessage);
+}
+
+}  // namespace bench
+}  // namespace styxe
+#endif  // STYXE_BENCH_BENCHUTILS_HPP
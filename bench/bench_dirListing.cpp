@@ -0,0 +1,203 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Micro-benchmarks
+ * @file: bench/bench_dirListing.cpp
+ *
+ * Encoding and decoding of directory listings
+ *******************************************************************************/
+#include "benchUtils.hpp"
+
+#include <styxe/dirListingReader.hpp>
+#include <styxe/dirListingSnapshot.hpp>
+#include <styxe/encoder.hpp>
+
+#include <string>
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+using namespace styxe::bench;
+
+
+namespace {
+
+/// Directory with entries of realistic, varying name length.
+struct Directory {
+	explicit Directory(size_t nEntries) {
+		names.reserve(nEntries);
+		entries.reserve(nEntries);
+
+		for (size_t i = 0; i < nEntries; ++i) {
+			names.emplace_back("entry-" + std::to_string(i) + std::string(i % 24, 'x') + ".o");
+		}
+
+		for (size_t i = 0; i < nEntries; ++i) {
+			Stat stat{0, 1, 2, {0, 1, i}, 0644, 1553, 1554, 4096 + i,
+					StringView{names[i].data(), static_cast<StringView::size_type>(names[i].size())},
+					StringLiteral{"builder"}, StringLiteral{"farm"}, StringLiteral{"builder"}};
+			stat.size = DirListingWriter::sizeStat(stat);
+			entries.push_back(stat);
+		}
+	}
+
+	std::vector<std::string>	names;
+	std::vector<Stat>			entries;
+};
+
+/// Typical iounit clients request directory in.
+constexpr size_type kReadCount = 8*1024;
+
+
+/// List the whole directory with a sequence of reads, each re-scanning the directory from the start.
+void BM_DirListingWriter_Scan(benchmark::State& state) {
+	Directory dir(state.range(0));
+	BenchContext context;
+
+	for (auto _ : state) {
+		uint64 offset = 0;
+		while (true) {
+			auto writer = context.writer();
+			DirListingWriter listing{writer, kReadCount, offset};
+			for (auto const& entry : dir.entries) {
+				if (!listing.encode(entry))
+					break;
+			}
+
+			if (listing.bytesEncoded() == 0)
+				break;
+			offset += listing.bytesEncoded();
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * dir.entries.size());
+}
+BENCHMARK(BM_DirListingWriter_Scan)->Arg(100)->Arg(1000)->Arg(10000);
+
+
+/// List the whole directory with a sequence of reads, each resuming from the cursor of the previous one.
+void BM_DirListingWriter_Resume(benchmark::State& state) {
+	Directory dir(state.range(0));
+	BenchContext context;
+
+	for (auto _ : state) {
+		DirListingCursor cursor;
+		uint64 offset = 0;
+		while (true) {
+			auto writer = context.writer();
+			DirListingWriter listing{writer, kReadCount, offset, cursor};
+			for (auto i = listing.firstEntryIndex(); i < dir.entries.size(); ++i) {
+				if (!listing.encode(dir.entries[i]))
+					break;
+			}
+
+			if (listing.bytesEncoded() == 0)
+				break;
+			offset += listing.bytesEncoded();
+			cursor = listing.cursor();
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * dir.entries.size());
+}
+BENCHMARK(BM_DirListingWriter_Resume)->Arg(100)->Arg(1000)->Arg(10000)->Arg(100000);
+
+
+/// List the whole directory with a sequence of reads, copying entries from a pre-encoded snapshot.
+void BM_DirListingSnapshot_Read(benchmark::State& state) {
+	Directory dir(state.range(0));
+	BenchContext context;
+
+	std::vector<byte> storage(dir.entries.size() * 128);
+	std::vector<uint32> index(dir.entries.size());
+	DirListingSnapshot snapshot{wrapMemory(storage.data(), storage.size()),
+				arrayView(index.data(), static_cast<uint32>(index.size()))};
+	for (auto const& entry : dir.entries) {
+		snapshot.add(entry);
+	}
+
+	for (auto _ : state) {
+		uint64 offset = 0;
+		while (true) {
+			auto writer = context.writer();
+			auto const data = snapshot.read(offset, kReadCount);
+			if (data.empty())
+				break;
+
+			writer.write(data);
+			offset += data.size();
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * dir.entries.size());
+}
+BENCHMARK(BM_DirListingSnapshot_Read)->Arg(100)->Arg(1000)->Arg(10000)->Arg(100000);
+
+
+/// Decode names of all the entries in a single directory read.
+void BM_DirListingReader_Names(benchmark::State& state) {
+	Directory dir(state.range(0));
+	BenchContext context;
+
+	auto writer = context.writer();
+	DirListingWriter listing{writer, kBenchMessageSize, 0};
+	for (auto const& entry : dir.entries) {
+		if (!listing.encode(entry))
+			break;
+	}
+	writer.flip();
+	auto const data = writer.viewRemaining();
+
+	for (auto _ : state) {
+		size_t totalLength = 0;
+		for (auto entry : DirListingReader{data}) {
+			totalLength += entry.name().size();
+		}
+		benchmark::DoNotOptimize(totalLength);
+	}
+
+	state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_DirListingReader_Names)->Arg(100)->Arg(1000);
+
+
+/// Decode all entries of a single directory read.
+void BM_DirListingReader_Decode(benchmark::State& state) {
+	Directory dir(state.range(0));
+	BenchContext context;
+
+	auto writer = context.writer();
+	DirListingWriter listing{writer, kBenchMessageSize, 0};
+	for (auto const& entry : dir.entries) {
+		if (!listing.encode(entry))
+			break;
+	}
+	writer.flip();
+	auto const data = writer.viewRemaining();
+
+	for (auto _ : state) {
+		for (auto entry : DirListingReader{data}) {
+			auto stat = entry.decode();
+			benchmark::DoNotOptimize(stat);
+		}
+	}
+
+	state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_DirListingReader_Decode)->Arg(100)->Arg(1000);
+
+}  // namespace
@@ -0,0 +1,200 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Micro-benchmarks
+ * @file: bench/bench_parser.cpp
+ *
+ * Parsing of request and response messages
+ *******************************************************************************/
+#include "benchUtils.hpp"
+
+#include <styxe/requestWriter.hpp>
+#include <styxe/responseWriter.hpp>
+
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+using namespace styxe::bench;
+
+
+namespace {
+
+Qid const kQid{0, 12, 81723};
+
+
+/// Parse a single request message, previously encoded by a given writer function, into a variant.
+template<typename Build>
+void BM_ParseRequest(benchmark::State& state, Build build) {
+	BenchContext context;
+	auto writer = context.writer();
+	build(writer, context, static_cast<size_type>(state.range(0)));
+	auto const frame = writer.viewRemaining();
+
+	for (auto _ : state) {
+		ByteReader reader{frame};
+		auto header = context.parser.parseMessageHeader(reader);
+		auto message = context.parser.parseRequest(header.unwrap(), reader);
+		benchmark::DoNotOptimize(message);
+	}
+
+	reportMessages(state, frame.size());
+}
+
+
+/// Parse a single request message, passing it to a handler instead of a variant.
+template<typename Build>
+void BM_VisitRequest(benchmark::State& state, Build build) {
+	BenchContext context;
+	auto writer = context.writer();
+	build(writer, context, static_cast<size_type>(state.range(0)));
+	auto const frame = writer.viewRemaining();
+
+	for (auto _ : state) {
+		ByteReader reader{frame};
+		auto header = context.parser.parseMessageHeader(reader);
+		auto result = context.parser.parseRequest(header.unwrap(), reader, [](auto& msg) {
+			benchmark::DoNotOptimize(msg);
+		});
+		benchmark::DoNotOptimize(result);
+	}
+
+	reportMessages(state, frame.size());
+}
+
+
+/// Parse a single response message, previously encoded by a given writer function, into a variant.
+template<typename Build>
+void BM_ParseResponse(benchmark::State& state, Build build) {
+	BenchContext context;
+	auto writer = context.writer();
+	build(writer, context, static_cast<size_type>(state.range(0)));
+	auto const frame = writer.viewRemaining();
+
+	for (auto _ : state) {
+		ByteReader reader{frame};
+		auto header = context.parser.parseMessageHeader(reader);
+		auto message = context.parser.parseResponse(header.unwrap(), reader);
+		benchmark::DoNotOptimize(message);
+	}
+
+	reportMessages(state, frame.size());
+}
+
+
+/// Parse a stream of pipelined requests.
+void BM_ParsePipelinedRequests(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const nMessages = state.range(0);
+	for (int64_t i = 0; i < nMessages; ++i) {
+		RequestWriter{writer, static_cast<Tag>(i)}.read(42, i * 4096, 4096).build();
+		writer.position(writer.limit());
+		writer.limit(writer.capacity());
+	}
+	writer.flip();
+	auto const stream = writer.viewRemaining();
+
+	for (auto _ : state) {
+		ByteReader reader{stream};
+		auto result = context.parser.parseRequests(reader, [](MessageHeader const&, RequestMessage&& msg) {
+			benchmark::DoNotOptimize(msg);
+		});
+		benchmark::DoNotOptimize(result);
+	}
+
+	state.SetItemsProcessed(state.iterations() * nMessages);
+	state.SetBytesProcessed(state.iterations() * stream.size());
+}
+BENCHMARK(BM_ParsePipelinedRequests)->Arg(16)->Arg(256);
+
+
+auto const buildVersionRequest = [](ByteWriter& w, BenchContext&, size_type) {
+	RequestWriter{w, 1}.version(Parser::PROTOCOL_VERSION, kBenchMessageSize).build();
+};
+auto const buildOpenRequest = [](ByteWriter& w, BenchContext&, size_type) {
+	RequestWriter{w, 1}.open(42, OpenMode::READ).build();
+};
+auto const buildClunkRequest = [](ByteWriter& w, BenchContext&, size_type) {
+	RequestWriter{w, 1}.clunk(42).build();
+};
+auto const buildReadRequest = [](ByteWriter& w, BenchContext&, size_type count) {
+	RequestWriter{w, 1}.read(42, 4096, count).build();
+};
+auto const buildWriteRequest = [](ByteWriter& w, BenchContext& context, size_type count) {
+	RequestWriter{w, 1}.write(42, 4096).data(context.payload(count)).build();
+};
+auto const buildWalkRequest = [](ByteWriter& w, BenchContext&, size_type depth) {
+	auto walk = RequestWriter{w, 1}.walk(42, 43);
+	for (size_type i = 0; i < depth; ++i) {
+		walk.path("component");
+	}
+	walk.done().build();
+};
+
+BENCHMARK_CAPTURE(BM_ParseRequest, version, buildVersionRequest)->Arg(0);
+BENCHMARK_CAPTURE(BM_ParseRequest, open, buildOpenRequest)->Arg(0);
+BENCHMARK_CAPTURE(BM_ParseRequest, clunk, buildClunkRequest)->Arg(0);
+BENCHMARK_CAPTURE(BM_ParseRequest, read, buildReadRequest)->Arg(4096);
+BENCHMARK_CAPTURE(BM_ParseRequest, write, buildWriteRequest) STYXE_BENCH_PAYLOAD_SIZES;
+BENCHMARK_CAPTURE(BM_ParseRequest, walk, buildWalkRequest)->Arg(1)->Arg(4)->Arg(16);
+
+BENCHMARK_CAPTURE(BM_VisitRequest, clunk, buildClunkRequest)->Arg(0);
+BENCHMARK_CAPTURE(BM_VisitRequest, read, buildReadRequest)->Arg(4096);
+BENCHMARK_CAPTURE(BM_VisitRequest, write, buildWriteRequest)->Arg(4096);
+BENCHMARK_CAPTURE(BM_VisitRequest, walk, buildWalkRequest)->Arg(4);
+
+
+auto const buildVersionResponse = [](ByteWriter& w, BenchContext&, size_type) {
+	ResponseWriter{w, 1}.version(Parser::PROTOCOL_VERSION, kBenchMessageSize).build();
+};
+auto const buildOpenResponse = [](ByteWriter& w, BenchContext&, size_type) {
+	ResponseWriter{w, 1}.open(kQid, 8192).build();
+};
+auto const buildClunkResponse = [](ByteWriter& w, BenchContext&, size_type) {
+	ResponseWriter{w, 1}.clunk().build();
+};
+auto const buildErrorResponse = [](ByteWriter& w, BenchContext&, size_type) {
+	ResponseWriter{w, 1}.error("No such file or directory").build();
+};
+auto const buildReadResponse = [](ByteWriter& w, BenchContext& context, size_type count) {
+	ResponseWriter{w, 1}.read(context.payload(count)).build();
+};
+auto const buildWriteResponse = [](ByteWriter& w, BenchContext&, size_type) {
+	ResponseWriter{w, 1}.write(4096).build();
+};
+auto const buildWalkResponse = [](ByteWriter& w, BenchContext&, size_type depth) {
+	std::vector<Qid> qids(depth, kQid);
+	ResponseWriter{w, 1}.walk(arrayView(qids.data(), static_cast<uint32>(qids.size()))).build();
+};
+auto const buildStatResponse = [](ByteWriter& w, BenchContext&, size_type) {
+	Stat stat{0, 1, 2, kQid, 0644, 1553, 1554, 4096,
+			StringLiteral{"file.txt"}, StringLiteral{"user"}, StringLiteral{"group"}, StringLiteral{"user"}};
+	stat.size = DirListingWriter::sizeStat(stat);
+	ResponseWriter{w, 1}.stat(stat).build();
+};
+
+BENCHMARK_CAPTURE(BM_ParseResponse, version, buildVersionResponse)->Arg(0);
+BENCHMARK_CAPTURE(BM_ParseResponse, open, buildOpenResponse)->Arg(0);
+BENCHMARK_CAPTURE(BM_ParseResponse, clunk, buildClunkResponse)->Arg(0);
+BENCHMARK_CAPTURE(BM_ParseResponse, error, buildErrorResponse)->Arg(0);
+BENCHMARK_CAPTURE(BM_ParseResponse, read, buildReadResponse) STYXE_BENCH_PAYLOAD_SIZES;
+BENCHMARK_CAPTURE(BM_ParseResponse, write, buildWriteResponse)->Arg(0);
+BENCHMARK_CAPTURE(BM_ParseResponse, walk, buildWalkResponse)->Arg(1)->Arg(4)->Arg(16);
+BENCHMARK_CAPTURE(BM_ParseResponse, stat, buildStatResponse)->Arg(0);
+
+}  // namespace
@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * libstyxe Micro-benchmarks
+ * @file: bench/bench_trace.cpp
+ *
+ * Replay of a recorded trace and the overhead of trace recording
+ * Set STYXE_BENCH_TRACE environment variable to a trace file to replay a real session
+ * instead of the synthetic one.
+ *******************************************************************************/
+#include "benchUtils.hpp"
+
+#include <styxe/requestWriter.hpp>
+#include <styxe/responseWriter.hpp>
+#include <styxe/trace.hpp>
+
+#include <cstdlib>  // getenv
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+using namespace styxe::bench;
+
+
+namespace {
+
+void appendTo(void* context, MemoryView data) {
+	auto& trace = *static_cast<std::vector<byte>*>(context);
+	auto const bytes = data.dataAs<byte const>();
+	trace.insert(trace.end(), bytes, bytes + data.size());
+}
+
+
+/// Record a synthetic session: a file is opened, read in 4k chunks, and closed.
+std::vector<byte> recordSession(BenchContext& context) {
+	std::vector<byte> trace;
+	std::vector<byte> traceBuffer(kBenchMessageSize);
+	TraceWriter recorder{wrapMemory(traceBuffer.data(), traceBuffer.size()), appendTo, &trace};
+	auto const previousHook = setTraceHook(recorder.hook());
+
+	Qid const qid{0, 12, 81723};
+	auto writer = context.writer();
+	auto const record = [&writer](TypedWriter message) {
+		message.build();
+		writer.clear();
+	};
+
+	record(RequestWriter{writer, 1}.version(Parser::PROTOCOL_VERSION, kBenchMessageSize));
+	record(ResponseWriter{writer, 1}.version(Parser::PROTOCOL_VERSION, kBenchMessageSize));
+	record(RequestWriter{writer, 1}.attach(1, Parser::NOFID, StringLiteral{"user"}, StringLiteral{""}));
+	record(ResponseWriter{writer, 1}.attach(qid));
+	record(RequestWriter{writer, 1}.walk(1, 2).path("var").path("log").path("messages").done());
+	Qid walked[] = {qid, qid, qid};
+	record(ResponseWriter{writer, 1}.walk(arrayView(walked, 3)));
+	record(RequestWriter{writer, 1}.open(2, OpenMode::READ));
+	record(ResponseWriter{writer, 1}.open(qid, 8192));
+	for (Tag tag = 0; tag < 256; ++tag) {
+		record(RequestWriter{writer, tag}.read(2, tag * 4096, 4096));
+		record(ResponseWriter{writer, tag}.read(context.payload(4096)));
+	}
+	record(RequestWriter{writer, 1}.clunk(2));
+	record(ResponseWriter{writer, 1}.clunk());
+
+	setTraceHook(previousHook);
+	recorder.flush();
+
+	return trace;
+}
+
+
+std::vector<byte> loadTrace(BenchContext& context) {
+	if (auto const path = std::getenv("STYXE_BENCH_TRACE")) {
+		std::ifstream input{path, std::ios::binary};
+		return std::vector<byte>{std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+	}
+
+	return recordSession(context);
+}
+
+
+/// Decode all the frames of a trace, as a peer receiving them would.
+void BM_ReplayTrace(benchmark::State& state) {
+	BenchContext context;
+	auto const trace = loadTrace(context);
+	TraceReader const reader{wrapMemory(trace.data(), trace.size())};
+	if (!reader.validate(context.parser)) {
+		state.SkipWithError("Ill-formed trace");
+		return;
+	}
+
+	size_t frames = 0;
+	size_t bytes = 0;
+	for (auto _ : state) {
+		for (auto record : reader) {
+			ByteReader frame{record.frame};
+			auto header = context.parser.parseMessageHeader(frame);
+			auto const& h = header.unwrap();
+			auto result = ((static_cast<byte>(h.type) % 2) == 0)
+					? context.parser.parseRequest(h, frame, [](auto& msg) { benchmark::DoNotOptimize(msg); })
+					: context.parser.parseResponse(h, frame, [](auto& msg) { benchmark::DoNotOptimize(msg); });
+			benchmark::DoNotOptimize(result);
+
+			frames += 1;
+			bytes += record.frame.size();
+		}
+	}
+
+	state.SetItemsProcessed(frames);
+	state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_ReplayTrace);
+
+
+/// Cost of encoding a message with and without a trace hook recording it.
+void BM_WriteRequest_Traced(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+
+	std::vector<byte> traceBuffer(1024 * 1024);
+	TraceWriter recorder{wrapMemory(traceBuffer.data(), traceBuffer.size()), [](void*, MemoryView) {}, nullptr};
+	auto const previousHook = setTraceHook(state.range(0) ? recorder.hook() : TraceHook{});
+
+	for (auto _ : state) {
+		writer.clear();
+		RequestWriter{writer, 1}.read(42, 4096, 4096).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	setTraceHook(previousHook);
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteRequest_Traced)->Arg(0)->Arg(1);
+
+}  // namespace
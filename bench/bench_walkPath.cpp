@@ -0,0 +1,148 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Micro-benchmarks
+ * @file: bench/bench_walkPath.cpp
+ *
+ * Decoding and traversal of walk path
+ *******************************************************************************/
+#include "benchUtils.hpp"
+
+#include <styxe/requestWriter.hpp>
+#include <styxe/decoder.hpp>
+
+
+using namespace Solace;
+using namespace styxe;
+using namespace styxe::bench;
+
+
+namespace {
+
+StringView const kPathSegments[] = {"usr", "local", "share", "documentation", "libstyxe", "examples", "a", "README.md"};
+
+
+/// Encode a walk path of a given depth, return a view of the encoded path.
+MemoryView encodeWalkPath(ByteWriter& writer, int64_t depth) {
+	auto walk = RequestWriter{writer, 1}.walk(42, 43);
+	for (int64_t i = 0; i < depth; ++i) {
+		walk.path(kPathSegments[i % 8]);
+	}
+	walk.done().build();
+
+	// Skip message header, fid and newfid
+	return writer.viewRemaining().slice(headerSize() + 2*sizeof(Fid), writer.limit());
+}
+
+
+void BM_DecodeWalkPath(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const encodedPath = encodeWalkPath(writer, state.range(0));
+
+	for (auto _ : state) {
+		ByteReader reader{encodedPath};
+		Decoder decoder{reader};
+		WalkPath path;
+		auto result = decoder >> path;
+		benchmark::DoNotOptimize(result);
+		benchmark::DoNotOptimize(path);
+	}
+
+	reportMessages(state, encodedPath.size());
+}
+BENCHMARK(BM_DecodeWalkPath)->Arg(1)->Arg(4)->Arg(16);
+
+
+void BM_TraverseWalkPath(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const encodedPath = encodeWalkPath(writer, state.range(0));
+
+	for (auto _ : state) {
+		ByteReader reader{encodedPath};
+		Decoder decoder{reader};
+		WalkPath path;
+		decoder >> path;
+
+		size_t totalLength = 0;
+		for (auto segment : path) {
+			totalLength += segment.size();
+		}
+		benchmark::DoNotOptimize(totalLength);
+	}
+
+	reportMessages(state, encodedPath.size());
+}
+BENCHMARK(BM_TraverseWalkPath)->Arg(1)->Arg(4)->Arg(16);
+
+
+void BM_DecodeIndexedWalkPath(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const encodedPath = encodeWalkPath(writer, state.range(0));
+
+	for (auto _ : state) {
+		ByteReader reader{encodedPath};
+		Decoder decoder{reader};
+		IndexedWalkPath path;
+		auto result = decoder >> path;
+		benchmark::DoNotOptimize(result);
+		benchmark::DoNotOptimize(path);
+	}
+
+	reportMessages(state, encodedPath.size());
+}
+BENCHMARK(BM_DecodeIndexedWalkPath)->Arg(1)->Arg(4)->Arg(16);
+
+
+void BM_LastSegmentWalkPath(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const encodedPath = encodeWalkPath(writer, state.range(0));
+	ByteReader reader{encodedPath};
+	Decoder decoder{reader};
+	WalkPath path;
+	decoder >> path;
+
+	for (auto _ : state) {
+		StringView last;
+		for (auto segment : path) {
+			last = segment;
+		}
+		benchmark::DoNotOptimize(last);
+	}
+}
+BENCHMARK(BM_LastSegmentWalkPath)->Arg(1)->Arg(4)->Arg(16);
+
+
+void BM_LastSegmentIndexedWalkPath(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const encodedPath = encodeWalkPath(writer, state.range(0));
+	ByteReader reader{encodedPath};
+	Decoder decoder{reader};
+	IndexedWalkPath path;
+	decoder >> path;
+
+	for (auto _ : state) {
+		auto last = path[path.size() - 1];
+		benchmark::DoNotOptimize(last);
+	}
+}
+BENCHMARK(BM_LastSegmentIndexedWalkPath)->Arg(1)->Arg(4)->Arg(16);
+
+}  // namespace
@@ -0,0 +1,327 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Micro-benchmarks
+ * @file: bench/bench_writer.cpp
+ *
+ * Encoding of request and response messages
+ *******************************************************************************/
+#include "benchUtils.hpp"
+
+#include <styxe/requestWriter.hpp>
+#include <styxe/responseWriter.hpp>
+#include <styxe/messageBatch.hpp>
+#include <styxe/errorTable.hpp>
+#include <styxe/qidCache.hpp>
+
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+using namespace styxe::bench;
+
+
+namespace {
+
+Qid const kQid{0, 12, 81723};
+
+
+void BM_WriteRequest_Version(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+
+	for (auto _ : state) {
+		writer.clear();
+		RequestWriter{writer, 1}.version(Parser::PROTOCOL_VERSION, kBenchMessageSize).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteRequest_Version);
+
+
+void BM_WriteRequest_Open(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+
+	for (auto _ : state) {
+		writer.clear();
+		RequestWriter{writer, 1}.open(42, OpenMode::READ).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteRequest_Open);
+
+
+void BM_WriteRequest_Clunk(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+
+	for (auto _ : state) {
+		writer.clear();
+		RequestWriter{writer, 1}.clunk(42).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteRequest_Clunk);
+
+
+void BM_WriteRequest_Read(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+
+	for (auto _ : state) {
+		writer.clear();
+		RequestWriter{writer, 1}.read(42, 4096, static_cast<size_type>(state.range(0))).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteRequest_Read) STYXE_BENCH_PAYLOAD_SIZES;
+
+
+/// Pipeline a number of read requests into a single buffer.
+void BM_WriteRequestBatch_Read(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const nMessages = static_cast<Tag>(state.range(0));
+
+	for (auto _ : state) {
+		writer.clear();
+		MessageBatch batch{writer, kBenchMessageSize};
+		for (Tag tag = 0; tag < nMessages; ++tag) {
+			batch.add(batch.request(tag).read(42, tag * 4096, 4096));
+		}
+		benchmark::DoNotOptimize(batch.seal().limit());
+	}
+
+	state.SetItemsProcessed(state.iterations() * nMessages);
+	state.SetBytesProcessed(state.iterations() * writer.limit());
+}
+BENCHMARK(BM_WriteRequestBatch_Read)->Arg(16)->Arg(64);
+
+
+void BM_WriteRequest_Write(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const data = context.payload(state.range(0));
+
+	for (auto _ : state) {
+		writer.clear();
+		RequestWriter{writer, 1}.write(42, 4096).data(data).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteRequest_Write) STYXE_BENCH_PAYLOAD_SIZES;
+
+
+void BM_WriteRequest_Walk(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const depth = state.range(0);
+
+	for (auto _ : state) {
+		writer.clear();
+		auto walk = RequestWriter{writer, 1}.walk(42, 43);
+		for (int64_t i = 0; i < depth; ++i) {
+			walk.path("component");
+		}
+		walk.done().build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteRequest_Walk)->Arg(1)->Arg(4)->Arg(16);
+
+
+void BM_WriteResponse_Read(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const data = context.payload(state.range(0));
+
+	for (auto _ : state) {
+		writer.clear();
+		ResponseWriter{writer, 1}.read(data).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteResponse_Read) STYXE_BENCH_PAYLOAD_SIZES;
+
+
+void BM_WriteResponse_ReadOutOfLine(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const data = context.payload(state.range(0));
+
+	for (auto _ : state) {
+		writer.clear();
+		auto segments = ResponseWriter{writer, 1}.read().build(data);
+		benchmark::DoNotOptimize(segments);
+	}
+
+	reportMessages(state, headerSize() + sizeof(size_type) + data.size());
+}
+BENCHMARK(BM_WriteResponse_ReadOutOfLine) STYXE_BENCH_PAYLOAD_SIZES;
+
+
+void BM_WriteResponse_Write(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+
+	for (auto _ : state) {
+		writer.clear();
+		ResponseWriter{writer, 1}.write(4096).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteResponse_Write);
+
+
+void BM_WriteResponse_Open(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+
+	for (auto _ : state) {
+		writer.clear();
+		ResponseWriter{writer, 1}.open(kQid, 8192).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteResponse_Open);
+
+
+void BM_WriteResponse_Walk(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	std::vector<Qid> qids(state.range(0), kQid);
+
+	for (auto _ : state) {
+		writer.clear();
+		ResponseWriter{writer, 1}.walk(arrayView(qids.data(), static_cast<uint32>(qids.size()))).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteResponse_Walk)->Arg(1)->Arg(4)->Arg(16);
+
+
+void BM_WriteResponse_Error(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+
+	for (auto _ : state) {
+		writer.clear();
+		ResponseWriter{writer, 1}.error("No such file or directory").build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteResponse_Error);
+
+
+void BM_WriteResponse_ErrorFromError(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const error = makeError(2, "No such file or directory");
+
+	for (auto _ : state) {
+		writer.clear();
+		ResponseWriter{writer, 1}.error(error).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteResponse_ErrorFromError);
+
+
+void BM_WriteResponse_ErrorInterned(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	ErrorTable<64> errors;
+	errors.add(2, "No such file or directory");
+
+	for (auto _ : state) {
+		writer.clear();
+		ResponseWriter{writer, 1}.error(errors.find(2)).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteResponse_ErrorInterned);
+
+
+Stat makeStat() {
+	Stat stat{0, 1, 2, kQid, 0644, 11, 12, 1024,
+			StringLiteral{"README.md"}, StringLiteral{"user"}, StringLiteral{"group"}, StringLiteral{"user"}};
+	stat.size = DirListingWriter::sizeStat(stat);
+
+	return stat;
+}
+
+
+void BM_WriteResponse_Stat(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	auto const stat = makeStat();
+
+	for (auto _ : state) {
+		writer.clear();
+		ResponseWriter{writer, 1}.stat(stat).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteResponse_Stat);
+
+
+void BM_WriteResponse_StatCached(benchmark::State& state) {
+	BenchContext context;
+	auto writer = context.writer();
+	StatCache<64> cache;
+	cache.insert(makeStat());
+
+	for (auto _ : state) {
+		writer.clear();
+		ResponseWriter{writer, 1}.stat(cache.find(kQid)).build();
+		benchmark::DoNotOptimize(writer.limit());
+	}
+
+	reportMessages(state, writer.limit());
+}
+BENCHMARK(BM_WriteResponse_StatCached);
+
+}  // namespace
@@ -21,11 +21,22 @@
 #include <solace/output_utils.hpp>
 
 
+#include <algorithm>
 #include <iostream>
-#include <fstream>
 #include <iomanip>
-
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
 #include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 
 using namespace Solace;
@@ -125,199 +136,524 @@ std::ostream& operator<< (std::ostream& ostr, MessageHeader const& header) {
 
 
 struct VisitRequest {
+    std::ostream& out;
 
     void operator()(Request::Version const& req) {
-        std::cout << ": " << req.msize << ' ' << quote(req.version) <<std::endl;
+        out << ": " << req.msize << ' ' << quote(req.version) << '\n';
     }
 
     void operator()(Request::Auth const& req) {
-        std::cout << ": " << req.afid << ' ' << quote(req.uname) << ' ' << quote(req.aname) << std::endl;
+        out << ": " << req.afid << ' ' << quote(req.uname) << ' ' << quote(req.aname) << '\n';
     }
 
     void operator()(Request::Attach const& req) {
-        std::cout << ": " << req.fid << ' ' << req.afid << ' ' << quote(req.uname) << ' ' << quote(req.aname) << std::endl;
+        out << ": " << req.fid << ' ' << req.afid << ' ' << quote(req.uname) << ' ' << quote(req.aname) << '\n';
     }
 
     void operator()(Request::Clunk const& req) {
-        std::cout << ": " << req.fid << std::endl;
+        out << ": " << req.fid << '\n';
     }
 
     void operator()(Request::Flush const& req) {
-        std::cout << ": " << req.oldtag << std::endl;
+        out << ": " << req.oldtag << '\n';
     }
 
     void operator()(Request::Open const& req) {
-        std::cout << ": " << req.fid << ' ' << req.mode << std::endl;
+        out << ": " << req.fid << ' ' << req.mode << '\n';
     }
 
     void operator()(Request::Create const& req) {
-        std::cout << ": " << req.fid << ' ' << quote(req.name) << ' ' << req.perm << ' ' << req.mode << std::endl;
+        out << ": " << req.fid << ' ' << quote(req.name) << ' ' << req.perm << ' ' << req.mode << '\n';
     }
 
 
     void operator()(Request::Read const& req) {
-        std::cout << ": " << req.fid << ' ' << req.offset << ' ' << req.count << std::endl;
+        out << ": " << req.fid << ' ' << req.offset << ' ' << req.count << '\n';
     }
 
     void operator()(Request::Write const& req) {
-        std::cout << ": " << req.fid << ' '
+        out << ": " << req.fid << ' '
                   << req.offset << ' '
                   << req.data.size()
                   << " DATA[" << req.data << ']'
-                  << std::endl;
+                  << '\n';
     }
 
     void operator()(Request::Remove const& req) {
-        std::cout << ": " << req.fid << std::endl;
+        out << ": " << req.fid << '\n';
     }
 
     void operator()(Request::StatRequest const& req) {
-        std::cout << ": " << req.fid << std::endl;
+        out << ": " << req.fid << '\n';
     }
 
     void operator()(Request::WStat const& req) {
-        std::cout << ": " << req.fid << ' ' << req.stat << std::endl;
+        out << ": " << req.fid << ' ' << req.stat << '\n';
     }
 
     void operator()(Request::Walk const& req) {
-        std::cout << ": "
+        out << ": "
                   << req.fid << ' '
                   << req.newfid << ' '
 				  << req.path.size() << ' ' << '['
 				  << req.path;
 
-        std::cout << ']' << std::endl;
+        out << ']' << '\n';
     }
 
     void operator()(Request_9P2000E::Session const& req) {
-        std::cout << ": " << wrapMemory(req.key) << std::endl;
+        out << ": " << wrapMemory(req.key) << '\n';
     }
 
     void operator()(Request_9P2000E::SRead const& req) {
-        std::cout << ": " << req.fid << ' '
+        out << ": " << req.fid << ' '
 				  << '\'' << req.path << '\''
-				  << std::endl;
+				  << '\n';
     }
 
     void operator()(Request_9P2000E::SWrite const& req) {
-        std::cout << ": " << req.fid << ' '
+        out << ": " << req.fid << ' '
 				  << '\'' << req.path << '\''
                   << " DATA[" << req.data << "]"
-                  << std::endl;
+                  << '\n';
+    }
+
+    void operator()(Request_9P2000E::SBatch const& req) {
+        out << ": " << req.fid << ' '
+				  << req.entries.size() << " [";
+
+		ShortBatchEntries::size_type i = 0;
+		for (auto const& entry : req.entries) {
+			out << entry.op << ' ' << '\'' << entry.path << '\'';
+			if (entry.op == ShortBatchOp::Write)
+				out << " DATA[" << entry.data << "]";
+			if (++i != req.entries.size())
+				out << ", ";
+		}
+
+        out << ']' << '\n';
     }
 };
 
 
 struct VisitResponse {
+    std::ostream& out;
 
     void operator()(Response::Version const& resp) {
-        std::cout << ": " << resp.msize << ' ' << quote(resp.version) <<std::endl;
+        out << ": " << resp.msize << ' ' << quote(resp.version) << '\n';
     }
     void operator()(Response::Auth const& resp) {
-        std::cout << ": " << resp.qid << std::endl;
+        out << ": " << resp.qid << '\n';
     }
 
     void operator()(Response::Attach const& resp) {
-        std::cout << ": " << resp.qid << std::endl;
+        out << ": " << resp.qid << '\n';
     }
 
     void operator()(Response::Error const& resp) {
-        std::cout << ": " << quote(resp.ename) <<std::endl;
+        out << ": " << quote(resp.ename) << '\n';
     }
 
     void operator()(Response::Flush const& /*res*/) {
-        std::cout << std::endl;
+        out << '\n';
     }
 
     void operator()(Response::Walk const& resp) {
-		std::cout << ": " << resp.nqids
+		out << ": " << resp.qids.size()
                   << " [";
 
-		const auto nqids = resp.nqids;
-		size_t i = 0;
-		for (auto const& qid : resp.qids) {
-			std::cout << qid;
+		const auto nqids = resp.qids.size();
+		for (decltype(resp.qids.size()) i = 0; i < nqids; ++i) {
+			out << resp.qids[i];
 			if (i + 1 != nqids)
-			std::cout << ", ";
+			out << ", ";
 		}
-         std::cout << ']' << std::endl;
+         out << ']' << '\n';
     }
 
     void operator()(Response::Open const& resp) {
-        std::cout << ": " << resp.qid << " " << resp.iounit << std::endl;
+        out << ": " << resp.qid << " " << resp.iounit << '\n';
     }
 
     void operator()(Response::Create const& resp) {
-        std::cout << ": " << resp.qid << " " << resp.iounit << std::endl;
+        out << ": " << resp.qid << " " << resp.iounit << '\n';
     }
 
 
     void operator()(Response::Read const& resp) {
-        std::cout << ": " << resp.data.size()
+        out << ": " << resp.data.size()
                   << " DATA[" << resp.data << ']'
-                  << std::endl;
+                  << '\n';
     }
     void operator()(Response::Write const& resp) {
-        std::cout << ": " << resp.count
-                  << std::endl;
+        out << ": " << resp.count
+                  << '\n';
     }
 
-    void operator()(Response::Clunk& /*res*/) { std::cout << std::endl; }
-    void operator()(Response::Remove& /*res*/) { std::cout << std::endl; }
+    void operator()(Response::Clunk& /*res*/) { out << '\n'; }
+    void operator()(Response::Remove& /*res*/) { out << '\n'; }
 
     void operator()(Response::Stat const& stat) {
-        std::cout << ": " << stat.data << std::endl;
+        out << ": " << stat.data << '\n';
+    }
+
+    void operator()(Response::WStat& /*res*/) { out << '\n'; }
+    void operator()(Response_9P2000E::Session& /*res*/) { out << '\n'; }
+
+    void operator()(Response_9P2000E::SBatch const& resp) {
+        out << ": " << resp.results.size() << " [";
+
+		ShortBatchResults::size_type i = 0;
+		for (auto const& result : resp.results) {
+			out << result.status;
+			switch (result.status) {
+			case ShortBatchStatus::Data:    out << " DATA[" << result.data << "]"; break;
+			case ShortBatchStatus::Written: out << ' ' << result.count; break;
+			case ShortBatchStatus::Failed:  out << ' ' << quote(result.ename); break;
+			}
+			if (++i != resp.results.size())
+				out << ", ";
+		}
+
+        out << ']' << '\n';
+    }
+};
+
+
+/// Capture of 9P traffic: any number of messages written back to back.
+struct Capture {
+
+    ~Capture() {
+        if (_mapped) munmap(_mapped, _mappedSize);
     }
 
-    void operator()(Response::WStat& /*res*/) { std::cout << std::endl; }
-    void operator()(Response_9P2000E::Session& /*res*/) { std::cout << std::endl; }
+    /// Map a capture file into memory. Captures are read in place and never copied.
+    bool map(char const* path) {
+        int const fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat info;
+        bool const ok = (fstat(fd, &info) == 0);
+        if (ok && info.st_size > 0) {
+            _mappedSize = static_cast<size_t>(info.st_size);
+            _mapped = mmap(nullptr, _mappedSize, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            if (_mapped == MAP_FAILED) {
+                _mapped = nullptr;
+            } else {
+                madvise(_mapped, _mappedSize, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+
+        return ok && (_mapped != nullptr || _mappedSize == 0);
+    }
+
+    /// Read a whole stream, such as stdin, that can not be mapped.
+    bool read(std::istream& in) {
+        _data.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+        return !in.bad();
+    }
+
+    MemoryView view() const noexcept {
+        return _mapped
+                ? wrapMemory(static_cast<void const*>(_mapped), _mappedSize)
+                : wrapMemory(_data.data(), _data.size());
+    }
+
+private:
+    void*               _mapped{nullptr};
+    size_t              _mappedSize{0};
+    std::vector<char>   _data;
 };
 
 
-void readAndPrintMessage(std::istream& in, MemoryResource& buffer, Parser& proc) {
+/**
+ * Build an index of frames of a capture in one pass over message headers.
+ * @param parser Parser to validate message headers with.
+ * @param capture Data of the capture.
+ * @param onFrame Called with a header and an offset of each complete frame.
+ * @return Number of bytes of the capture occupied by complete frames.
+ */
+template<typename F>
+MemoryView::size_type
+indexFrames(Parser const& parser, MemoryView capture, F&& onFrame) {
+    MemoryView::size_type offset = 0;
+    while (offset < capture.size()) {
+        auto reader = ByteReader{capture.slice(offset, offset + headerSize())};
+        auto maybeHeader = parser.parseMessageHeader(reader);
+        if (!maybeHeader) {
+            std::cerr << "Error parsing message header at offset " << offset << ": "
+                      << maybeHeader.getError().toString() << std::endl;
+            break;
+        }
+
+        auto const& header = *maybeHeader;
+        if (header.messageSize > capture.size() - offset) {
+            std::cerr << "Truncated frame at offset " << offset << ": "
+                      << header.messageSize << " bytes expected, "
+                      << (capture.size() - offset) << " available" << std::endl;
+            break;
+        }
+
+        onFrame(header, offset);
+        offset += header.messageSize;
+    }
+
+    return offset;
+}
+
+
+/// Decode and print an indexed frame at the given offset of the capture.
+void decodeFrame(Parser const& parser, MemoryView capture, MemoryView::size_type offset, std::ostream& out) {
+    auto reader = ByteReader{capture.slice(offset, offset + headerSize())};
+    auto maybeHeader = parser.parseMessageHeader(reader);
+    if (!maybeHeader) {
+        return;
+    }
+
+    auto const& header = *maybeHeader;
+    out << header;
 
-    // Message header is fixed size - so it is safe to attempt to read it.
-    in.read(buffer.view().dataAs<char>(), headerSize());
+    reader = ByteReader{capture.slice(offset + headerSize(), offset + header.messageSize)};
+    bool const isRequest = (static_cast<byte>(header.type) % 2) == 0;
+    auto result = isRequest
+            ? parser.parseRequest(header, reader, VisitRequest{out})
+            : parser.parseResponse(header, reader, VisitResponse{out});
+    if (!result) {
+        out << ": error parsing message: " << result.getError().toString() << '\n';
+    }
+}
 
-    auto reader = ByteReader{buffer};
-    reader.limit(in.gcount());
 
-    proc.parseMessageHeader(reader)
-            .then([&](MessageHeader&& header) {
-                std::cout << header;
+/**
+ * Decode indexed frames of a capture.
+ * Frames are split into ranges decoded by a number of threads, the output of each range is printed in the order of
+ * frames in the capture.
+ */
+void decodeFrames(Parser const& parser, MemoryView capture, std::vector<MemoryView::size_type> const& frames,
+                  unsigned jobs) {
+    if (jobs <= 1) {
+        for (auto offset : frames) {
+            decodeFrame(parser, capture, offset, std::cout);
+        }
+        return;
+    }
 
-                in.read(buffer.view().dataAs<char>(), header.payloadSize());
-                reader.rewind()
-                        .limit(in.gcount());
+    // Number of frames in a range decoded by one thread. Ranges are decoded in rounds of `jobs` ranges,
+    // so that not more than a round worth of output is buffered.
+    constexpr size_t kFramesPerRange = 8192;
+    std::vector<std::ostringstream> outputs(jobs);
+    for (size_t first = 0; first < frames.size(); first += jobs * kFramesPerRange) {
+        std::vector<std::thread> workers;
+        for (unsigned j = 0; j < jobs; ++j) {
+            auto const begin = std::min(frames.size(), first + j * kFramesPerRange);
+            auto const end = std::min(frames.size(), begin + kFramesPerRange);
+            if (begin == end) {
+                break;
+            }
 
-                bool const isRequest = (static_cast<byte>(header.type) % 2) == 0;
-                if (isRequest) {
-                    proc.parseRequest(header, reader)
-                            .then([](RequestMessage&& reqMsg) { std::visit(VisitRequest{}, reqMsg); });
-                } else {
-                    proc.parseResponse(header, reader)
-                            .then([](ResponseMessage&& resp) { std::visit(VisitResponse{}, resp); });
+            outputs[j].str({});
+            workers.emplace_back([&parser, capture, &frames, &output = outputs[j], begin, end]() {
+                for (auto i = begin; i < end; ++i) {
+                    decodeFrame(parser, capture, frames[i], output);
                 }
-            })
-            .orElse([](Error&& err) {
-                std::cerr << "Error parsing message header: " << err.toString() << std::endl;
             });
+        }
+
+        for (size_t j = 0; j < workers.size(); ++j) {
+            workers[j].join();
+            std::cout << outputs[j].str();
+        }
+    }
 }
 
 
+/// Get index of a power of two histogram bucket of a value: bucket N counts values in range [2^(N-1), 2^N).
+unsigned bucketOf(uint64 value) noexcept {
+    unsigned bucket = 0;
+    while (value) {
+        value >>= 1;
+        bucket += 1;
+    }
+
+    return bucket;
+}
+
+
+/// Power of two histogram of values.
+struct Histogram {
+    static constexpr unsigned kBuckets = 65;
+
+    void add(uint64 value) noexcept {
+        count += 1;
+        total += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        buckets[bucketOf(value)] += 1;
+    }
+
+    friend std::ostream& operator<< (std::ostream& ostr, Histogram const& h) {
+        for (unsigned i = 0; i < kBuckets; ++i) {
+            if (h.buckets[i] == 0) continue;
+
+            uint64 const low = (i == 0) ? 0 : (uint64{1} << (i - 1));
+            uint64 const high = (i == 0) ? 0 : (low * 2 - 1);
+            ostr << "  [" << low << ", " << high << "]: " << h.buckets[i];
+        }
+
+        return ostr;
+    }
+
+    uint64 count{0};
+    uint64 total{0};
+    uint64 min{std::numeric_limits<uint64>::max()};
+    uint64 max{0};
+    uint64 buckets[kBuckets]{};
+};
+
+
+/**
+ * Statistics of a capture computed from message headers alone.
+ * Captures carry no timestamps, so tag latency is measured as a number of frames between a request and a response
+ * with the same tag.
+ */
+struct CaptureStats {
+    static constexpr uint64 kNoFrame = std::numeric_limits<uint64>::max();
+
+    struct Pending {
+        uint64      frame{kNoFrame};
+        MessageType type{MessageType::TVersion};
+    };
+
+    /// Start a new session: requests still in flight at the end of a capture are not answered.
+    void beginCapture() {
+        for (auto& pending : _pending) {
+            if (pending.frame != kNoFrame) {
+                unanswered += 1;
+                pending.frame = kNoFrame;
+            }
+        }
+    }
+
+    void add(MessageHeader const& header) {
+        auto const frame = frames++;
+        auto const typeIndex = static_cast<byte>(header.type);
+        bytes += header.messageSize;
+        sizes[typeIndex].add(header.messageSize);
+
+        auto& pending = _pending[header.tag];
+        bool const isRequest = (typeIndex % 2) == 0;
+        if (isRequest) {
+            if (pending.frame != kNoFrame) {
+                reusedTags += 1;
+            }
+            pending.frame = frame;
+            pending.type = header.type;
+        } else if (pending.frame != kNoFrame) {
+            latency[static_cast<byte>(pending.type)].add(frame - pending.frame);
+            pending.frame = kNoFrame;
+        } else {
+            unmatched += 1;
+        }
+    }
+
+    void print(std::ostream& out) const {
+        out << "Frames: " << frames << ", bytes: " << bytes << '\n';
+
+        out << "\nMessages:\n"
+            << std::left << std::setw(12) << "type" << std::right
+            << std::setw(12) << "count"
+            << std::setw(16) << "bytes"
+            << std::setw(10) << "min"
+            << std::setw(10) << "avg"
+            << std::setw(10) << "max" << '\n';
+        forEachType(sizes, [&out](MessageType type, Histogram const& h) {
+            out << std::left << std::setw(12) << typeName(type) << std::right
+                << std::setw(12) << h.count
+                << std::setw(16) << h.total
+                << std::setw(10) << h.min
+                << std::setw(10) << h.total / h.count
+                << std::setw(10) << h.max << '\n';
+        });
+
+        out << "\nMessage size histogram (bytes):\n";
+        forEachType(sizes, [&out](MessageType type, Histogram const& h) {
+            out << std::left << std::setw(12) << typeName(type) << std::right << h << '\n';
+        });
+
+        out << "\nTag latency (frames between request and response):\n"
+            << std::left << std::setw(12) << "request" << std::right
+            << std::setw(12) << "count"
+            << std::setw(10) << "min"
+            << std::setw(10) << "avg"
+            << std::setw(10) << "max" << '\n';
+        forEachType(latency, [&out](MessageType type, Histogram const& h) {
+            out << std::left << std::setw(12) << typeName(type) << std::right
+                << std::setw(12) << h.count
+                << std::setw(10) << h.min
+                << std::setw(10) << h.total / h.count
+                << std::setw(10) << h.max << '\n';
+        });
+
+        out << "\nTag latency histogram (frames):\n";
+        forEachType(latency, [&out](MessageType type, Histogram const& h) {
+            out << std::left << std::setw(12) << typeName(type) << std::right << h << '\n';
+        });
+
+        out << "\nResponses without a request: " << unmatched
+            << "\nRequests without a response: " << unanswered
+            << "\nTags reused while in flight: " << reusedTags
+            << '\n';
+    }
+
+    uint64      frames{0};
+    uint64      bytes{0};
+    uint64      unmatched{0};
+    uint64      unanswered{0};
+    uint64      reusedTags{0};
+    Histogram   sizes[256];
+    Histogram   latency[256];
+
+private:
+    template<typename F>
+    static void forEachType(Histogram const (&histograms)[256], F&& f) {
+        for (unsigned i = 0; i < 256; ++i) {
+            if (histograms[i].count) {
+                f(static_cast<MessageType>(i), histograms[i]);
+            }
+        }
+    }
+
+    static std::string typeName(MessageType type) {
+        std::ostringstream name;
+        name << type;
+        return name.str();
+    }
+
+    Pending     _pending[std::numeric_limits<Tag>::max() + 1];
+};
+
+
 /// Print app usage
 int usage(const char* progname) {
     std::cout << "Usage: " << progname
               << "[-m <size>] "
               << "[-p <version>] "
+              << "[-j <jobs>] "
+              << "[-s] "
               << "[-h] "
               << " [FILE]..."
               << std::endl;
 
-    std::cout << "Read 9P2000 message and display it\n\n"
+    std::cout << "Read 9P2000 messages and display them\n\n"
+              << "Each file is a capture of any number of messages written back to back.\n\n"
               << "Options: \n"
               << " -m <size> - Use maximum buffer size for messages [Default: " << kMaxMesssageSize << "]\n"
               << " -p <version> - Use specific protocol version [Default: " << Parser::PROTOCOL_VERSION << "]\n"
+              << " -j, --jobs <jobs> - Number of threads to decode messages with [Default: number of CPUs]\n"
+              << " -s, --stats - Display statistics of the captures instead of messages\n"
               << " -h - Display help and exit\n"
               << std::endl;
 
@@ -325,14 +661,23 @@ int usage(const char* progname) {
 }
 
 /**
- * A simple example of decoding a 9P message from a file / stdin and printing it in a human readable format.
+ * Decoding of 9P messages from capture files / stdin and printing them in a human readable format.
  */
 int main(int argc, char* const* argv) {
     size_type maxMessageSize = kMaxMesssageSize;
     StringView requiredVersion = Parser::PROTOCOL_VERSION;
+    unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+    bool statsOnly = false;
+
+    static option const longOptions[] = {
+        {"jobs", required_argument, nullptr, 'j'},
+        {"stats", no_argument, nullptr, 's'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
 
     int c;
-    while ((c = getopt(argc, argv, "m:p:h")) != -1)
+    while ((c = getopt_long(argc, argv, "m:p:j:sh", longOptions, nullptr)) != -1)
         switch (c) {
         case 'm': {
             int requestedSize = atoi(optarg);
@@ -345,35 +690,68 @@ int main(int argc, char* const* argv) {
         case 'p':
             requiredVersion = StringView{optarg};
             break;
+        case 'j': {
+            int requestedJobs = atoi(optarg);
+            if (requestedJobs <= 0) {
+                fprintf(stderr, "Option -%c requires positive interger value.\n", c);
+                return EXIT_FAILURE;
+            }
+            jobs = static_cast<unsigned>(requestedJobs);
+        } break;
+        case 's':
+            statsOnly = true;
+            break;
         case 'h':
             return usage(argv[0]);
         default:
             return EXIT_FAILURE;
     }
 
-    Parser proc{maxMessageSize, requiredVersion};
-    MemoryManager memManager{proc.maxPossibleMessageSize()};
-	auto memoryResource = memManager.allocate(proc.maxPossibleMessageSize());
+    Parser const proc{maxMessageSize, requiredVersion};
+    auto stats = std::make_unique<CaptureStats>();
+    std::vector<MemoryView::size_type> frames;
 
-	if (!memoryResource) {
-		std::cerr << "Feiled to allocate memory for a buffer: " << memoryResource.getError();
-		return EXIT_FAILURE;
-	}
+    auto processCapture = [&](Capture const& capture) {
+        auto const data = capture.view();
+        if (statsOnly) {
+            stats->beginCapture();
+            indexFrames(proc, data, [&stats](MessageHeader const& header, MemoryView::size_type) {
+                stats->add(header);
+            });
+        } else {
+            frames.clear();
+            indexFrames(proc, data, [&frames](MessageHeader const&, MemoryView::size_type offset) {
+                frames.push_back(offset);
+            });
+            decodeFrames(proc, data, frames, jobs);
+        }
+    };
 
-	auto& buffer = memoryResource.unwrap();
     if (optind < argc) {
         for (int i = optind; i < argc; ++i) {
-            std::ifstream input(argv[i]);
-            if (!input) {
+            Capture capture;
+            if (!capture.map(argv[i])) {
                 std::cerr << "Failed to open file: " << std::quoted(argv[i]) << std::endl;
                 return EXIT_FAILURE;
             }
 
-            readAndPrintMessage(input, buffer, proc);
+            processCapture(capture);
         }
     } else {
-        readAndPrintMessage(std::cin, buffer, proc);
+        Capture capture;
+        if (!capture.read(std::cin)) {
+            std::cerr << "Failed to read stdin" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        processCapture(capture);
+    }
+
+    if (statsOnly) {
+        stats->beginCapture();
+        stats->print(std::cout);
     }
+    std::cout.flush();
 
     return EXIT_SUCCESS;
 }
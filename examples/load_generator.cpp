@@ -0,0 +1,412 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe example: 9P load generator
+ *
+ * A client to benchmark 9P servers, such as uring_server.cpp, end to end.
+ * Each connection keeps a pipeline of requests in flight: responses are re-assembled with FrameAssembler
+ * and each response received is replaced with a new request, written into a MessageBatch
+ * to be sent with a single call once all the responses of a chunk are handled.
+ * Throughput and latency percentiles are reported when the run is over.
+ *******************************************************************************/
+#include <styxe/styxe.hpp>
+
+#include <solace/output_utils.hpp>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+
+using Clock = std::chrono::steady_clock;
+
+
+namespace {
+
+enum class Workload {
+	Read,   //!< Sequential reads of a file.
+	Stat,   //!< Stat of a file: a metadata only round trip.
+};
+
+
+struct Options {
+	std::string	host{"localhost"};
+	std::string	port{"5640"};
+	size_type	msize{64 * 1024};
+	size_type	readSize{4096};
+	unsigned	connections{1};
+	unsigned	depth{16};
+	unsigned	seconds{10};
+	Workload	workload{Workload::Read};
+};
+
+
+/// Results of a run of one connection.
+struct RunStats {
+	uint64					requests{0};
+	uint64					errors{0};
+	uint64					bytes{0};
+	std::vector<uint32>		latencies;  //!< Round trip time of each request in nanoseconds.
+	std::string				failure;
+};
+
+
+constexpr Fid kRootFid = 0;
+constexpr Fid kFileFid = 1;
+
+
+struct Client {
+
+	Client(Options const& options, RunStats& stats)
+		: _options{options}
+		, _stats{stats}
+		, _parser{options.msize}
+		, _out(static_cast<size_t>(options.msize) * options.depth)
+		, _in(4 * static_cast<size_t>(options.msize))
+		, _staging(options.msize)
+		, _assembler{_parser, wrapMemory(_staging.data(), _staging.size())}
+		, _sentAt(options.depth)
+	{}
+
+	~Client() {
+		if (_fd >= 0) close(_fd);
+	}
+
+	bool connectTo() {
+		addrinfo hints;
+		std::memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+
+		addrinfo* addresses = nullptr;
+		if (getaddrinfo(_options.host.c_str(), _options.port.c_str(), &hints, &addresses) != 0) {
+			return fail("Failed to resolve " + _options.host);
+		}
+
+		for (auto address = addresses; address && _fd < 0; address = address->ai_next) {
+			_fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+			if (_fd >= 0 && connect(_fd, address->ai_addr, address->ai_addrlen) < 0) {
+				close(_fd);
+				_fd = -1;
+			}
+		}
+		freeaddrinfo(addresses);
+
+		if (_fd < 0) {
+			return fail("Failed to connect to " + _options.host + ":" + _options.port);
+		}
+
+		int const noDelay = 1;
+		setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+		return true;
+	}
+
+	/// Negotiate the session, attach and open a file to work with.
+	bool setup() {
+		bool ok = call([&](RequestWriter& writer) { return writer.version(Parser::PROTOCOL_VERSION, _options.msize); },
+					   [&](ResponseMessage& response) {
+			auto version = std::get_if<Response::Version>(&response);
+			if (version) {
+				_parser.maxNegotiatedMessageSize(version->msize);
+				_parser.setNegotiatedVersion(version->version);
+			}
+			return version != nullptr;
+		});
+
+		ok = ok && call([](RequestWriter& writer) { return writer.attach(kRootFid, Parser::NOFID, "bench", ""); },
+						isA<Response::Attach>);
+		ok = ok && call([](RequestWriter& writer) { return writer.walk(kRootFid, kFileFid).path("file0").done(); },
+						isA<Response::Walk>);
+		ok = ok && call([](RequestWriter& writer) { return writer.open(kFileFid, OpenMode::READ); },
+						isA<Response::Open>);
+
+		return ok || fail("Session setup failed");
+	}
+
+	/// Keep the pipeline full until the deadline, then wait for all the responses in flight.
+	bool run(Clock::time_point deadline) {
+		unsigned inFlight = 0;
+		beginBatch();
+		for (Tag tag = 0; tag < _options.depth; ++tag) {
+			addRequest(tag);
+			inFlight += 1;
+		}
+		if (!sendBatch()) {
+			return false;
+		}
+
+		bool running = true;
+		while (inFlight > 0) {
+			auto const received = recv(_fd, _in.data(), _in.size(), 0);
+			if (received <= 0) {
+				return fail("Connection closed");
+			}
+
+			auto const now = Clock::now();
+			running = running && (now < deadline);
+			beginBatch();
+
+			auto result = _assembler.feed(wrapMemory(_in.data(), static_cast<size_t>(received)),
+										  [&](MessageHeader const& header, ByteReader& payload) {
+				auto response = _parser.parseResponse(header, payload);
+				onResponse(header.tag, response, now);
+				inFlight -= 1;
+
+				if (running) {
+					addRequest(header.tag);
+					inFlight += 1;
+				}
+			});
+
+			if (!result) {
+				return fail("Ill-formed response");
+			}
+
+			if (!sendBatch()) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+private:
+
+	template<typename T>
+	static bool isA(ResponseMessage& response) { return std::holds_alternative<T>(response); }
+
+	bool fail(std::string message) {
+		if (_stats.failure.empty()) {
+			_stats.failure = std::move(message);
+		}
+		return false;
+	}
+
+	bool sendAll(MemoryView data) {
+		auto bytes = data.dataAs<byte const>();
+		auto remaining = data.size();
+		while (remaining > 0) {
+			auto const sent = send(_fd, bytes, remaining, MSG_NOSIGNAL);
+			if (sent <= 0) {
+				return fail("Send failed");
+			}
+
+			bytes += sent;
+			remaining -= static_cast<size_t>(sent);
+		}
+
+		return true;
+	}
+
+	/// Make a synchronous call, used during the session setup.
+	template<typename Request, typename Check>
+	bool call(Request&& request, Check&& check) {
+		ByteWriter writer{wrapMemory(_out.data(), _out.size())};
+		RequestWriter requestWriter{writer, 1};
+		request(requestWriter).build();
+		if (!sendAll(writer.viewRemaining())) {
+			return false;
+		}
+
+		bool done = false;
+		bool ok = false;
+		while (!done) {
+			auto const received = recv(_fd, _in.data(), _in.size(), 0);
+			if (received <= 0) {
+				return fail("Connection closed");
+			}
+
+			auto result = _assembler.feed(wrapMemory(_in.data(), static_cast<size_t>(received)),
+										  [&](MessageHeader const& header, ByteReader& payload) {
+				auto response = _parser.parseResponse(header, payload);
+				done = true;
+				ok = response.isOk() && check(*response);
+			});
+			if (!result) {
+				return fail("Ill-formed response");
+			}
+		}
+
+		return ok;
+	}
+
+	void beginBatch() {
+		_batch.reset();
+		_writer.emplace(wrapMemory(_out.data(), _out.size()));
+		_batch.emplace(*_writer, _parser.maxNegotiatedMessageSize());
+	}
+
+	bool sendBatch() {
+		if (_batch->empty()) {
+			return true;
+		}
+
+		return sendAll(_batch->seal().viewRemaining());
+	}
+
+	void addRequest(Tag tag) {
+		_sentAt[tag] = Clock::now();
+		switch (_options.workload) {
+		case Workload::Read:
+			_batch->add(_batch->request(tag).read(kFileFid, _offset, _options.readSize));
+			_offset += _options.readSize;
+			break;
+		case Workload::Stat:
+			_batch->add(_batch->request(tag).stat(kFileFid));
+			break;
+		}
+	}
+
+	void onResponse(Tag tag, Result<ResponseMessage, Error>& response, Clock::time_point now) {
+		_stats.requests += 1;
+		_stats.latencies.push_back(static_cast<uint32>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(now - _sentAt[tag]).count()));
+
+		if (!response || std::holds_alternative<Response::Error>(*response)) {
+			_stats.errors += 1;
+		} else if (auto read = std::get_if<Response::Read>(&*response)) {
+			_stats.bytes += read->data.size();
+			if (read->data.empty()) {
+				_offset = 0;  // End of file: start over
+			}
+		}
+	}
+
+	Options const&		_options;
+	RunStats&			_stats;
+	int					_fd{-1};
+	Parser				_parser;
+	std::vector<byte>	_out;
+	std::vector<byte>	_in;
+	std::vector<byte>	_staging;
+	FrameAssembler		_assembler;
+	std::optional<ByteWriter>	_writer;
+	std::optional<MessageBatch>	_batch;
+	std::vector<Clock::time_point>	_sentAt;
+	uint64				_offset{0};
+};
+
+
+double percentile(std::vector<uint32> const& sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+
+	auto const index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+	return sorted[index] / 1000.0;
+}
+
+
+void usage(char const* progname) {
+	std::cerr << "Usage: " << progname
+			  << " [-H host] [-p port] [-m msize] [-c connections] [-d depth] [-t seconds] [-s read-size] [-w read|stat]"
+			  << std::endl;
+}
+
+}  // namespace
+
+
+int main(int argc, char* const* argv) {
+	Options options;
+
+	int c;
+	while ((c = getopt(argc, argv, "H:p:m:c:d:t:s:w:h")) != -1) {
+		switch (c) {
+		case 'H': options.host = optarg; break;
+		case 'p': options.port = optarg; break;
+		case 'm': options.msize = static_cast<size_type>(std::stoul(optarg)); break;
+		case 'c': options.connections = static_cast<unsigned>(std::stoul(optarg)); break;
+		case 'd': options.depth = static_cast<unsigned>(std::stoul(optarg)); break;
+		case 't': options.seconds = static_cast<unsigned>(std::stoul(optarg)); break;
+		case 's': options.readSize = static_cast<size_type>(std::stoul(optarg)); break;
+		case 'w':
+			if (std::strcmp(optarg, "read") == 0) {
+				options.workload = Workload::Read;
+			} else if (std::strcmp(optarg, "stat") == 0) {
+				options.workload = Workload::Stat;
+			} else {
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (options.connections == 0 || options.depth == 0 || options.depth >= Parser::NO_TAG) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<RunStats> stats(options.connections);
+	std::vector<std::thread> workers;
+	auto const started = Clock::now();
+	auto const deadline = started + std::chrono::seconds(options.seconds);
+	for (unsigned i = 0; i < options.connections; ++i) {
+		workers.emplace_back([&options, &stats, deadline, i]() {
+			Client client{options, stats[i]};
+			client.connectTo() && client.setup() && client.run(deadline);
+		});
+	}
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	auto const elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+
+	RunStats total;
+	for (auto& run : stats) {
+		if (!run.failure.empty()) {
+			std::cerr << "Connection failed: " << run.failure << std::endl;
+		}
+
+		total.requests += run.requests;
+		total.errors += run.errors;
+		total.bytes += run.bytes;
+		total.latencies.insert(total.latencies.end(), run.latencies.begin(), run.latencies.end());
+	}
+	std::sort(total.latencies.begin(), total.latencies.end());
+
+	std::cout << std::fixed << std::setprecision(1)
+			  << "requests: " << total.requests << " (" << total.errors << " errors) in " << elapsed << "s" << std::endl
+			  << "throughput: " << static_cast<double>(total.requests) / elapsed << " req/s, "
+			  << static_cast<double>(total.bytes) / elapsed / (1024 * 1024) << " MiB/s" << std::endl
+			  << "latency (us): p50 " << percentile(total.latencies, 0.5)
+			  << ", p90 " << percentile(total.latencies, 0.9)
+			  << ", p99 " << percentile(total.latencies, 0.99)
+			  << ", max " << percentile(total.latencies, 1.0) << std::endl;
+
+	return (total.requests > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,355 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe example: replay of a recorded 9P trace
+ *
+ * Feeds frames of a trace, see trace.hpp, back through the Parser: requests are decoded,
+ * responses are decoded and encoded again with the ResponseWriter. Re-encoded responses are compared to
+ * the recorded frames, so that a replay against a new version of the library checks that it is wire compatible.
+ * Frames are replayed as fast as possible or at the pacing of the original session.
+ * Session state, such as negotiated version and message size, is tracked from the version messages of the trace.
+ *******************************************************************************/
+#include <styxe/styxe.hpp>
+
+#include <solace/output_utils.hpp>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <variant>
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+
+using Clock = std::chrono::steady_clock;
+
+
+namespace {
+
+/// Read only memory mapping of a trace file.
+struct MappedFile {
+
+	~MappedFile() {
+		if (_data) munmap(_data, _size);
+	}
+
+	bool map(char const* path) {
+		int const fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0) {
+			_size = static_cast<size_t>(info.st_size);
+			_data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+			if (_data == MAP_FAILED) {
+				_data = nullptr;
+			}
+		}
+		close(fd);
+
+		return (_data != nullptr);
+	}
+
+	MemoryView view() const noexcept { return wrapMemory(static_cast<void const*>(_data), _size); }
+
+private:
+	void*	_data{nullptr};
+	size_t	_size{0};
+};
+
+
+struct ReplayStats {
+	uint64	frames{0};
+	uint64	bytes{0};
+	uint64	requests{0};
+	uint64	responses{0};
+	uint64	errors{0};			//!< Frames that failed to decode.
+	uint64	mismatches{0};		//!< Responses encoded differently from the recorded frame.
+								//!< Compressed data is compared decompressed.
+	uint64	maxLagNanos{0};		//!< Maximum delay of a frame behind the original pacing.
+};
+
+
+/// Encode a decoded response again with the ResponseWriter.
+struct EncodeResponse {
+	ResponseWriter		writer;
+	MessageType			type;
+
+	TypedWriter operator()(Response::Version const& resp) { return writer.version(resp.version, resp.msize); }
+	TypedWriter operator()(Response::Auth const& resp) { return writer.auth(resp.qid); }
+	TypedWriter operator()(Response::Attach const& resp) { return writer.attach(resp.qid); }
+	TypedWriter operator()(Response::Error const& resp) { return writer.error(resp.ename); }
+	TypedWriter operator()(Response::Flush const&) { return writer.flush(); }
+
+	TypedWriter operator()(Response::Walk const& resp) {
+		Qid qids[IndexedWalkPath::kMaxSegments];
+		QidList::size_type count = 0;
+		for (auto qid : resp.qids) {
+			if (count == IndexedWalkPath::kMaxSegments) break;
+			qids[count++] = qid;
+		}
+
+		return writer.walk(ArrayView<Qid>{qids, count});
+	}
+
+	TypedWriter operator()(Response::Open const& resp) { return writer.open(resp.qid, resp.iounit); }
+	TypedWriter operator()(Response::Create const& resp) { return writer.create(resp.qid, resp.iounit); }
+
+	TypedWriter operator()(Response::Read const& resp) {
+		return (type == MessageType::RSRead)
+				? writer.shortRead(resp.data)
+				: writer.read(resp.data);
+	}
+
+	TypedWriter operator()(Response::Write const& resp) {
+		return (type == MessageType::RSWrite)
+				? writer.shortWrite(resp.count)
+				: writer.write(resp.count);
+	}
+
+	TypedWriter operator()(Response::Clunk const&) { return writer.clunk(); }
+	TypedWriter operator()(Response::Remove const&) { return writer.remove(); }
+	TypedWriter operator()(Response::Stat const& resp) { return writer.stat(resp.data); }
+	TypedWriter operator()(Response::WStat const&) { return writer.wstat(); }
+	TypedWriter operator()(Response_9P2000E::Session const&) { return writer.session(); }
+
+	TypedWriter operator()(Response_9P2000E::SBatch const& resp) {
+		auto batch = writer.shortBatch();
+		for (auto const& result : resp.results) {
+			switch (result.status) {
+			case ShortBatchStatus::Data:	batch.data(result.data); break;
+			case ShortBatchStatus::Written:	batch.written(result.count); break;
+			case ShortBatchStatus::Failed:	batch.error(result.ename); break;
+			}
+		}
+
+		return batch.done();
+	}
+};
+
+
+/// Replay all the frames of a trace once.
+struct Replay {
+
+	Replay(size_type maxMessageSize, StringView version)
+		: _maxMessageSize{maxMessageSize}
+		, _version{version}
+		, _encodeBuffer(maxMessageSize)
+		, _decompressBuffer(maxMessageSize)
+		, _redecompressBuffer(maxMessageSize)
+	{}
+
+	void run(TraceReader const& trace, bool paced, ReplayStats& stats) {
+		// Each replay starts a new session.
+		Parser parser{_maxMessageSize, _version};
+		auto const started = Clock::now();
+
+		for (auto record : trace) {
+			if (paced) {
+				auto const due = started + std::chrono::nanoseconds{record.timestamp};
+				auto const now = Clock::now();
+				if (now < due) {
+					std::this_thread::sleep_until(due);
+				} else {
+					auto const lag = std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count();
+					stats.maxLagNanos = std::max(stats.maxLagNanos, static_cast<uint64>(lag));
+				}
+			}
+
+			stats.frames += 1;
+			stats.bytes += record.frame.size();
+			replayFrame(parser, record.frame, stats);
+		}
+	}
+
+private:
+	void replayFrame(Parser& parser, MemoryView frame, ReplayStats& stats) {
+		ByteReader reader{frame};
+		auto maybeHeader = parser.parseMessageHeader(reader);
+		if (!maybeHeader) {
+			stats.errors += 1;
+			return;
+		}
+
+		auto const& header = *maybeHeader;
+		bool const isRequest = (static_cast<byte>(header.type) % 2) == 0;
+		if (isRequest) {
+			stats.requests += 1;
+			auto decompressBuffer = wrapMemory(_decompressBuffer.data(), _decompressBuffer.size());
+			auto result = parser.parseCompressedRequest(header, reader, decompressBuffer);
+			if (!result) {
+				stats.errors += 1;
+			}
+			return;
+		}
+
+		stats.responses += 1;
+		auto decompressBuffer = wrapMemory(_decompressBuffer.data(), _decompressBuffer.size());
+		auto maybeResponse = parser.parseCompressedResponse(header, reader, decompressBuffer);
+		if (!maybeResponse) {
+			stats.errors += 1;
+			return;
+		}
+
+		ByteWriter dest{wrapMemory(_encodeBuffer.data(), _encodeBuffer.size())};
+		EncodeResponse encode{ResponseWriter{dest, header.tag, CompressionPolicy{parser.negotiatedCompression()}},
+							  header.type};
+		std::visit(encode, *maybeResponse).build();
+
+		// Whether data is compressed depends on the compression threshold of the recording peer:
+		// frames with compressed data match if they decode to the same message.
+		bool const matches = (hasCompressedData(header, frame) || hasCompressedData(header, dest.viewRemaining()))
+				? decodesTo(parser, dest.viewRemaining(), std::get<Response::Read>(*maybeResponse))
+				: (dest.viewRemaining() == frame);
+		if (!matches) {
+			stats.mismatches += 1;
+		}
+
+		// Follow the session the way a client would.
+		if (auto version = std::get_if<Response::Version>(&*maybeResponse)) {
+			parser.setNegotiatedVersion(version->version);
+			parser.maxNegotiatedMessageSize(std::min(version->msize, parser.maxPossibleMessageSize()));
+		}
+	}
+
+	/// Check if the frame is RRead or RSRead with compressed data.
+	static bool hasCompressedData(MessageHeader const& header, MemoryView frame) {
+		if (header.type != MessageType::RRead && header.type != MessageType::RSRead) {
+			return false;
+		}
+
+		size_type dataSize = 0;
+		ByteReader reader{frame};
+		return reader.advance(headerSize()).isOk() &&
+				reader.readLE(dataSize).isOk() &&
+				(dataSize & kCompressedDataFlag) != 0;
+	}
+
+	/// Check if the encoded frame decodes to a read response with the same data.
+	bool decodesTo(Parser const& parser, MemoryView encoded, Response::Read const& expected) {
+		ByteReader reader{encoded};
+		auto maybeHeader = parser.parseMessageHeader(reader);
+		if (!maybeHeader) {
+			return false;
+		}
+
+		auto buffer = wrapMemory(_redecompressBuffer.data(), _redecompressBuffer.size());
+		auto maybeResponse = parser.parseCompressedResponse(*maybeHeader, reader, buffer);
+		if (!maybeResponse || !std::holds_alternative<Response::Read>(*maybeResponse)) {
+			return false;
+		}
+
+		return std::get<Response::Read>(*maybeResponse).data == expected.data;
+	}
+
+	size_type const		_maxMessageSize;
+	StringView const	_version;
+	std::vector<byte>	_encodeBuffer;
+	std::vector<byte>	_decompressBuffer;
+	std::vector<byte>	_redecompressBuffer;
+};
+
+
+void usage(char const* progname) {
+	std::cerr << "Usage: " << progname << " [-m msize] [-p version] [-n iterations] [-r] TRACE" << std::endl
+			  << "Replay a 9P trace through the parser and the response writer\n\n"
+			  << "Options:\n"
+			  << " -m <size> - Maximum message size [Default: " << kMaxMesssageSize << "]\n"
+			  << " -p <version> - Protocol version offered [Default: " << Parser::BATCH_PROTOCOL_VERSION << "]\n"
+			  << " -n <iterations> - Number of times to replay the trace [Default: 1]\n"
+			  << " -r - Replay at the pacing of the original session instead of as fast as possible\n"
+			  << std::endl;
+}
+
+}  // namespace
+
+
+int main(int argc, char* const* argv) {
+	size_type maxMessageSize = kMaxMesssageSize;
+	StringView version = Parser::BATCH_PROTOCOL_VERSION;
+	unsigned iterations = 1;
+	bool paced = false;
+
+	int c;
+	while ((c = getopt(argc, argv, "m:p:n:rh")) != -1) {
+		switch (c) {
+		case 'm': maxMessageSize = static_cast<size_type>(std::stoul(optarg)); break;
+		case 'p': version = StringView{optarg}; break;
+		case 'n': iterations = static_cast<unsigned>(std::stoul(optarg)); break;
+		case 'r': paced = true; break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind + 1 != argc) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	MappedFile file;
+	if (!file.map(argv[optind])) {
+		std::cerr << "Failed to map trace file " << std::quoted(argv[optind]) << ": " << std::strerror(errno) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	TraceReader trace{file.view()};
+	if (trace.startTime() == 0) {
+		std::cerr << "Not a trace file: " << std::quoted(argv[optind]) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// A trace of a session that has been cut short ends with an incomplete record: records before it are replayed.
+	auto valid = trace.validate(Parser{maxMessageSize, version});
+	if (!valid) {
+		std::cerr << "Ill-formed trace, replaying complete records only: " << valid.getError() << std::endl;
+	}
+
+	Replay replay{maxMessageSize, version};
+	ReplayStats stats;
+	auto const started = Clock::now();
+	for (unsigned i = 0; i < iterations; ++i) {
+		replay.run(trace, paced, stats);
+	}
+	auto const seconds = std::chrono::duration<double>(Clock::now() - started).count();
+
+	std::cout << "frames: " << stats.frames << " (" << stats.requests << " requests, " << stats.responses << " responses)"
+			  << " in " << std::fixed << std::setprecision(3) << seconds << "s\n"
+			  << "throughput: " << std::setprecision(1) << (stats.frames / seconds) << " frames/s, "
+			  << (stats.bytes / seconds / (1024 * 1024)) << " MiB/s\n"
+			  << "decode errors: " << stats.errors << ", re-encoded responses differing from the trace: " << stats.mismatches
+			  << std::endl;
+	if (paced) {
+		std::cout << "max lag behind the original pacing: " << std::setprecision(1) << (stats.maxLagNanos / 1000.0) << "us"
+				  << std::endl;
+	}
+
+	return (stats.errors == 0 && stats.mismatches == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
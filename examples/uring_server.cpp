@@ -0,0 +1,1149 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe example: 9P server using io_uring
+ *
+ * A reference for driving the library at scale: a single threaded 9P server serving a synthetic
+ * file tree with an io_uring event loop.
+ *  - Receive and send buffers are taken from one pool, each buffer sized to the negotiated message size.
+ *    Receive buffers are provided to the kernel as a buffer ring, send buffers are registered as fixed buffers.
+ *  - Each connection has a single multishot recv: data arrives without re-arming a recv per chunk.
+ *  - Complete frames of a chunk are parsed in place by Parser::parseRequests, only frames split between chunks
+ *    go through FrameAssembler.
+ *  - Responses are encoded with ResponseWriter straight into registered send buffers, batched with MessageBatch
+ *    and written once per event loop iteration.
+ *
+ * io_uring is used via raw system calls, liburing is not required. Linux 6.0 or later is required.
+ * See load_generator.cpp for a client to benchmark the server with.
+ *******************************************************************************/
+#include <styxe/styxe.hpp>
+
+#include <solace/output_utils.hpp>
+
+#include <linux/io_uring.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace {
+
+/// Minimal io_uring submission and completion queues over raw system calls.
+struct Uring {
+
+	~Uring() {
+		if (_sqes) munmap(_sqes, _sqesSize);
+		if (_cqRing && _cqRing != _sqRing) munmap(_cqRing, _cqRingSize);
+		if (_sqRing) munmap(_sqRing, _sqRingSize);
+		if (_fd >= 0) close(_fd);
+	}
+
+	bool init(unsigned entries) {
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+		params.flags = IORING_SETUP_SINGLE_ISSUER;
+		_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+		if (_fd < 0) {
+			return false;
+		}
+
+		_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool const singleMap = (params.features & IORING_FEAT_SINGLE_MMAP);
+		if (singleMap) {
+			_sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+		}
+
+		_sqRing = mapRing(_sqRingSize, IORING_OFF_SQ_RING);
+		_cqRing = singleMap ? _sqRing : mapRing(_cqRingSize, IORING_OFF_CQ_RING);
+		_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		_sqes = static_cast<io_uring_sqe*>(mapRing(_sqesSize, IORING_OFF_SQES));
+		if (!_sqRing || !_cqRing || !_sqes) {
+			return false;
+		}
+
+		auto const sq = static_cast<byte*>(_sqRing);
+		_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+		_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		_sqEntries = params.sq_entries;
+		_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		_sqLocalTail = *_sqTail;
+
+		auto const cq = static_cast<byte*>(_cqRing);
+		_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+		return true;
+	}
+
+	/// Get next free submission queue entry, submitting queued entries if the queue is full.
+	io_uring_sqe* sqe() {
+		if (_sqLocalTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries) {
+			submit(0);
+		}
+
+		auto const index = _sqLocalTail & _sqMask;
+		auto entry = &_sqes[index];
+		std::memset(entry, 0, sizeof(*entry));
+		_sqArray[index] = index;
+		_sqLocalTail += 1;
+
+		return entry;
+	}
+
+	/// Submit queued entries and wait for at least the given number of completions.
+	int submit(unsigned waitFor) {
+		auto const toSubmit = _sqLocalTail - *_sqTail;
+		__atomic_store_n(_sqTail, _sqLocalTail, __ATOMIC_RELEASE);
+
+		int result;
+		do {
+			result = static_cast<int>(syscall(__NR_io_uring_enter, _fd, toSubmit, waitFor,
+											  waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+		} while (result < 0 && errno == EINTR && waitFor == 0);
+
+		return result;
+	}
+
+	/// Call the handler for each completion queue entry available.
+	template<typename Handler>
+	unsigned drain(Handler&& handler) {
+		unsigned head = *_cqHead;
+		unsigned const tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+		unsigned count = 0;
+		for (; head != tail; ++head, ++count) {
+			handler(_cqes[head & _cqMask]);
+		}
+		__atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+
+		return count;
+	}
+
+	int registerBuffers(iovec const* buffers, unsigned count) {
+		return static_cast<int>(syscall(__NR_io_uring_register, _fd, IORING_REGISTER_BUFFERS, buffers, count));
+	}
+
+	int registerBufferRing(io_uring_buf_reg* reg, unsigned opcode) {
+		return static_cast<int>(syscall(__NR_io_uring_register, _fd, opcode, reg, 1));
+	}
+
+private:
+	void* mapRing(size_t size, __u64 offset) {
+		auto mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, static_cast<off_t>(offset));
+		return (mem == MAP_FAILED) ? nullptr : mem;
+	}
+
+	int				_fd{-1};
+	void*			_sqRing{nullptr};
+	void*			_cqRing{nullptr};
+	size_t			_sqRingSize{0};
+	size_t			_cqRingSize{0};
+	io_uring_sqe*	_sqes{nullptr};
+	size_t			_sqesSize{0};
+
+	unsigned*		_sqHead{nullptr};
+	unsigned*		_sqTail{nullptr};
+	unsigned*		_sqArray{nullptr};
+	unsigned		_sqMask{0};
+	unsigned		_sqEntries{0};
+	unsigned		_sqLocalTail{0};
+
+	unsigned*		_cqHead{nullptr};
+	unsigned*		_cqTail{nullptr};
+	unsigned		_cqMask{0};
+	io_uring_cqe*	_cqes{nullptr};
+};
+
+
+/// Kind of an operation submitted to the ring, encoded in the user data of submissions.
+enum class Op : uint64 {
+	Accept = 1,
+	Recv = 2,
+	Send = 3,
+	ProvideBuffers = 4,
+	Probe = 5,
+};
+
+constexpr uint64 userData(Op op, uint32 connectionId) noexcept {
+	return (static_cast<uint64>(op) << 32) | connectionId;
+}
+
+
+/// Buffer group id of the receive buffers.
+constexpr __u16 kRecvBufferGroup = 0;
+
+
+/**
+ * A pool of message sized buffers in a single memory region.
+ * Receive buffers are owned by the kernel until a recv completes with one. Send buffers are registered fixed buffers
+ * handed out to connections to encode responses into.
+ */
+struct BufferPool {
+
+	~BufferPool() {
+		if (_memory) munmap(_memory, _memorySize);
+		if (_ring) munmap(_ring, _ringSize);
+	}
+
+	bool init(Uring& ring, size_type bufferSize, unsigned recvCount, unsigned sendCount) {
+		_bufferSize = bufferSize;
+		_recvCount = recvCount;
+		_memorySize = static_cast<size_t>(bufferSize) * (recvCount + sendCount);
+		_memory = static_cast<byte*>(mmap(nullptr, _memorySize, PROT_READ | PROT_WRITE,
+										  MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0));
+		if (_memory == MAP_FAILED) {
+			_memory = nullptr;
+			return false;
+		}
+
+		// Send buffers are registered with the ring as fixed buffers, index of a buffer is its fixed buffer index.
+		std::vector<iovec> sendBuffers(sendCount);
+		for (unsigned i = 0; i < sendCount; ++i) {
+			sendBuffers[i] = {sendBuffer(i).dataAs<void>(), bufferSize};
+			_freeSend.push_back(sendCount - 1 - i);
+		}
+		if (ring.registerBuffers(sendBuffers.data(), sendCount) < 0) {
+			return false;
+		}
+
+		// Receive buffers are provided to the kernel with a buffer ring to be picked by multishot recv.
+		// Kernels where the buffer ring is not available get the buffers with IORING_OP_PROVIDE_BUFFERS.
+		_ringSize = recvCount * sizeof(io_uring_buf);
+		if (!initBufferRing(ring) || !probeBufferRing(ring)) {
+			unregisterBufferRing(ring);
+			_legacyBuffers = true;
+			provideBuffers(ring, 0, recvCount);
+		}
+
+		return true;
+	}
+
+	/// @return True if the receive buffers are provided with IORING_OP_PROVIDE_BUFFERS rather then a buffer ring.
+	bool legacyBuffers() const noexcept { return _legacyBuffers; }
+
+	MutableMemoryView recvBuffer(unsigned id) noexcept {
+		return wrapMemory(_memory + static_cast<size_t>(id) * _bufferSize, _bufferSize);
+	}
+
+	MutableMemoryView sendBuffer(unsigned index) noexcept {
+		return wrapMemory(_memory + static_cast<size_t>(_recvCount + index) * _bufferSize, _bufferSize);
+	}
+
+	/// Return receive buffer to the kernel. Buffers are made available in batches by publishRecv().
+	void recycleRecv(Uring& ring, __u16 id) {
+		if (_legacyBuffers) {
+			provideBuffers(ring, id, 1);
+			return;
+		}
+
+		auto& entry = _ring->bufs[_ringTail & (_recvCount - 1)];
+		entry.addr = reinterpret_cast<__u64>(recvBuffer(id).dataAs<void>());
+		entry.len = _bufferSize;
+		entry.bid = id;
+		_ringTail += 1;
+	}
+
+	void publishRecv() noexcept {
+		if (!_legacyBuffers) {
+			__atomic_store_n(&_ring->tail, _ringTail, __ATOMIC_RELEASE);
+		}
+	}
+
+	/// Take a free send buffer or return -1 if all the buffers are in use.
+	int acquireSend() {
+		if (_freeSend.empty()) {
+			return -1;
+		}
+
+		auto const index = _freeSend.back();
+		_freeSend.pop_back();
+		return static_cast<int>(index);
+	}
+
+	void releaseSend(int index) {
+		_freeSend.push_back(static_cast<unsigned>(index));
+	}
+
+private:
+	bool initBufferRing(Uring& ring) {
+		// Ring memory is populated before registration, so that the kernel does not pin a zero page.
+		_ring = static_cast<io_uring_buf_ring*>(mmap(nullptr, _ringSize, PROT_READ | PROT_WRITE,
+													 MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0));
+		if (_ring == MAP_FAILED) {
+			_ring = nullptr;
+			return false;
+		}
+		std::memset(static_cast<void*>(_ring), 0, _ringSize);
+
+		io_uring_buf_reg reg;
+		std::memset(&reg, 0, sizeof(reg));
+		reg.ring_addr = reinterpret_cast<__u64>(_ring);
+		reg.ring_entries = _recvCount;
+		reg.bgid = kRecvBufferGroup;
+		if (ring.registerBufferRing(&reg, IORING_REGISTER_PBUF_RING) < 0) {
+			return false;
+		}
+
+		_ringRegistered = true;
+		for (unsigned i = 0; i < _recvCount; ++i) {
+			recycleRecv(ring, static_cast<__u16>(i));
+		}
+		publishRecv();
+
+		return true;
+	}
+
+	void unregisterBufferRing(Uring& ring) {
+		if (_ringRegistered) {
+			io_uring_buf_reg reg;
+			std::memset(&reg, 0, sizeof(reg));
+			reg.bgid = kRecvBufferGroup;
+			ring.registerBufferRing(&reg, IORING_UNREGISTER_PBUF_RING);
+			_ringRegistered = false;
+		}
+	}
+
+	/// Check that a recv picks a buffer from the ring: some kernels accept the ring but never select from it.
+	bool probeBufferRing(Uring& ring) {
+		int sockets[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) < 0) {
+			return false;
+		}
+
+		byte const probe = 0;
+		bool picked = false;
+		if (write(sockets[1], &probe, sizeof(probe)) == sizeof(probe)) {
+			auto sqe = ring.sqe();
+			sqe->opcode = IORING_OP_RECV;
+			sqe->fd = sockets[0];
+			sqe->flags = IOSQE_BUFFER_SELECT;
+			sqe->buf_group = kRecvBufferGroup;
+			sqe->user_data = userData(Op::Probe, 0);
+			ring.submit(1);
+			ring.drain([&](io_uring_cqe const& cqe) {
+				if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+					picked = true;
+					recycleRecv(ring, static_cast<__u16>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+					publishRecv();
+				}
+			});
+		}
+
+		close(sockets[0]);
+		close(sockets[1]);
+		return picked;
+	}
+
+	void provideBuffers(Uring& ring, unsigned firstId, unsigned count) {
+		auto sqe = ring.sqe();
+		sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+		sqe->fd = static_cast<__s32>(count);
+		sqe->addr = reinterpret_cast<__u64>(recvBuffer(firstId).dataAs<void>());
+		sqe->len = _bufferSize;
+		sqe->off = firstId;
+		sqe->buf_group = kRecvBufferGroup;
+		sqe->user_data = userData(Op::ProvideBuffers, 0);
+	}
+
+	byte*				_memory{nullptr};
+	size_t				_memorySize{0};
+	size_type			_bufferSize{0};
+	unsigned			_recvCount{0};
+	std::vector<unsigned>	_freeSend;
+
+	io_uring_buf_ring*	_ring{nullptr};
+	size_t				_ringSize{0};
+	__u16				_ringTail{0};
+	bool				_ringRegistered{false};
+	bool				_legacyBuffers{false};
+};
+
+
+/// Synthetic file tree served: a root directory of files with generated content.
+struct FileTree {
+	static constexpr uint64 kRootPath = 0;
+
+	FileTree(unsigned count, uint64 size, size_type maxMessageSize)
+		: fileCount{count}
+		, fileSize{size}
+		, _content(2 * static_cast<size_t>(maxMessageSize))
+	{
+		for (size_t i = 0; i < _content.size(); ++i) {
+			_content[i] = static_cast<byte>('a' + i % 26);
+		}
+	}
+
+	Qid qidOf(uint64 path) const noexcept {
+		return (path == kRootPath)
+				? Qid{static_cast<byte>(QidType::DIR), 0, kRootPath}
+				: Qid{static_cast<byte>(QidType::FILE), 0, path};
+	}
+
+	/// Get path of the file with the given name or kRootPath if there is no such file.
+	uint64 lookup(StringView name) const {
+		auto const prefix = StringView{"file"};
+		if (!name.startsWith(prefix) || name.size() == prefix.size() || name.size() > prefix.size() + 9) {
+			return kRootPath;
+		}
+
+		uint64 index = 0;
+		for (auto c : name.substring(prefix.size())) {
+			if (c < '0' || c > '9') {
+				return kRootPath;
+			}
+			index = index * 10 + static_cast<unsigned>(c - '0');
+		}
+
+		return (index < fileCount) ? index + 1 : kRootPath;
+	}
+
+	Stat statOf(uint64 path, std::string& nameStorage) const {
+		nameStorage = (path == kRootPath) ? "/" : "file" + std::to_string(path - 1);
+
+		Stat stat;
+		stat.type = 0;
+		stat.dev = 0;
+		stat.qid = qidOf(path);
+		stat.mode = (path == kRootPath)
+				? (static_cast<uint32>(DirMode::DIR) | 0755)
+				: 0644;
+		stat.atime = 0;
+		stat.mtime = 0;
+		stat.length = (path == kRootPath) ? 0 : fileSize;
+		stat.name = StringView{nameStorage.data(), static_cast<StringView::size_type>(nameStorage.size())};
+		stat.uid = StringLiteral{"styxe"};
+		stat.gid = StringLiteral{"styxe"};
+		stat.muid = StringLiteral{""};
+		stat.size = DirListingWriter::sizeStat(stat);
+
+		return stat;
+	}
+
+	/// Get file content: the same pattern repeated over the length of each file.
+	MemoryView read(uint64 offset, size_type count) const noexcept {
+		if (offset >= fileSize) {
+			return {};
+		}
+
+		auto const size = static_cast<size_t>(std::min<uint64>({count, fileSize - offset, _content.size() / 2}));
+		auto const start = static_cast<size_t>(offset % 26);
+		return wrapMemory(_content.data() + start, size);
+	}
+
+	unsigned const		fileCount;
+	uint64 const		fileSize;
+
+private:
+	std::vector<byte>	_content;
+};
+
+
+/// State of a fid of a connection.
+struct FileState {
+	uint64		path{FileTree::kRootPath};
+	bool		isOpen{false};
+	DirListingCursor	cursor;
+};
+
+
+/// A queued write of a filled send buffer.
+struct PendingSend {
+	int				buffer;
+	size_type		size;
+	size_type		written;
+};
+
+
+struct Server;
+
+
+/// A client connection.
+struct Connection {
+	Connection(uint32 connectionId, int socket, size_type maxMessageSize)
+		: id{connectionId}
+		, fd{socket}
+		, parser{maxMessageSize, Parser::BATCH_PROTOCOL_VERSION}
+		, staging(maxMessageSize)
+		, assembler{parser, wrapMemory(staging.data(), staging.size())}
+	{}
+
+	uint32 const		id;
+	int const			fd;
+	Parser				parser;
+	std::vector<byte>	staging;
+	FrameAssembler		assembler;
+
+	std::unordered_map<Fid, FileState>	fids;
+
+	int							sendBuffer{-1};		//!< Send buffer responses are being encoded into.
+	std::optional<ByteWriter>	output;
+	std::optional<MessageBatch>	batch;
+	std::deque<PendingSend>		sendQueue;
+	bool						sending{false};
+	bool						receiving{false};
+	bool						closing{false};
+};
+
+
+/// Server statistics printed on exit.
+struct Stats {
+	uint64	connections{0};
+	uint64	messages{0};
+	uint64	recvs{0};
+	uint64	sends{0};
+	uint64	bytesIn{0};
+	uint64	bytesOut{0};
+};
+
+
+volatile std::sig_atomic_t gStop = 0;
+
+void onSignal(int) { gStop = 1; }
+
+
+struct Server {
+	Server(FileTree const& tree, size_type maxMessageSize)
+		: _tree{tree}
+		, _maxMessageSize{maxMessageSize}
+	{}
+
+	bool init(int listenSocket, unsigned recvBuffers, unsigned sendBuffers) {
+		_listenFd = listenSocket;
+		if (!_ring.init(1024)) {
+			std::cerr << "io_uring setup failed: " << std::strerror(errno) << std::endl;
+			return false;
+		}
+
+		if (!_pool.init(_ring, _maxMessageSize, recvBuffers, sendBuffers)) {
+			std::cerr << "Buffer pool registration failed: " << std::strerror(errno) << std::endl;
+			return false;
+		}
+
+		armAccept();
+		return true;
+	}
+
+	void run() {
+		while (!gStop) {
+			if (_ring.submit(1) < 0 && errno != EINTR) {
+				std::cerr << "io_uring_enter failed: " << std::strerror(errno) << std::endl;
+				break;
+			}
+
+			// Handle all the completions available, then flush responses of all the connections at once.
+			_ring.drain([this](io_uring_cqe const& cqe) { onCompletion(cqe); });
+			_pool.publishRecv();
+			for (auto id : _dirty) {
+				if (auto conn = connection(id)) {
+					flushOutput(*conn);
+				}
+			}
+			_dirty.clear();
+		}
+	}
+
+	Stats const& stats() const noexcept { return _stats; }
+
+	bool legacyBuffers() const noexcept { return _pool.legacyBuffers(); }
+
+private:
+
+	Connection* connection(uint32 id) noexcept {
+		return (id < _connections.size()) ? _connections[id].get() : nullptr;
+	}
+
+	void armAccept() {
+		auto sqe = _ring.sqe();
+		sqe->opcode = IORING_OP_ACCEPT;
+		sqe->fd = _listenFd;
+		sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+		sqe->accept_flags = SOCK_CLOEXEC;
+		sqe->user_data = userData(Op::Accept, 0);
+	}
+
+	void armRecv(Connection& conn) {
+		auto sqe = _ring.sqe();
+		sqe->opcode = IORING_OP_RECV;
+		sqe->fd = conn.fd;
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->flags = IOSQE_BUFFER_SELECT;
+		sqe->buf_group = kRecvBufferGroup;
+		sqe->user_data = userData(Op::Recv, conn.id);
+		conn.receiving = true;
+	}
+
+	void submitSend(Connection& conn) {
+		auto const& pending = conn.sendQueue.front();
+		auto const data = _pool.sendBuffer(static_cast<unsigned>(pending.buffer)).slice(pending.written, pending.size);
+
+		auto sqe = _ring.sqe();
+		sqe->opcode = IORING_OP_WRITE_FIXED;
+		sqe->fd = conn.fd;
+		sqe->addr = reinterpret_cast<__u64>(data.dataAs<void>());
+		sqe->len = static_cast<__u32>(data.size());
+		sqe->off = static_cast<__u64>(-1);
+		sqe->buf_index = static_cast<__u16>(pending.buffer);
+		sqe->user_data = userData(Op::Send, conn.id);
+		conn.sending = true;
+	}
+
+	void onCompletion(io_uring_cqe const& cqe) {
+		auto const op = static_cast<Op>(cqe.user_data >> 32);
+		auto const id = static_cast<uint32>(cqe.user_data & 0xFFFFFFFF);
+		bool const more = (cqe.flags & IORING_CQE_F_MORE);
+
+		switch (op) {
+		case Op::Accept:
+			if (cqe.res >= 0) {
+				onAccept(cqe.res);
+			}
+			if (!more) {
+				armAccept();
+			}
+			break;
+
+		case Op::Recv:
+			if (auto conn = connection(id)) {
+				onRecv(*conn, cqe, more);
+			}
+			break;
+
+		case Op::Send:
+			if (auto conn = connection(id)) {
+				onSend(*conn, cqe.res);
+			}
+			break;
+
+		case Op::ProvideBuffers:
+		case Op::Probe:
+			break;
+		}
+	}
+
+	void onAccept(int socket) {
+		int const noDelay = 1;
+		setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+		uint32 id = 0;
+		while (id < _connections.size() && _connections[id]) {
+			++id;
+		}
+		if (id == _connections.size()) {
+			_connections.emplace_back();
+		}
+
+		_connections[id] = std::make_unique<Connection>(id, socket, _maxMessageSize);
+		_stats.connections += 1;
+		armRecv(*_connections[id]);
+	}
+
+	void onRecv(Connection& conn, io_uring_cqe const& cqe, bool more) {
+		conn.receiving = more;
+		if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+			auto const bufferId = static_cast<__u16>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+			auto const size = static_cast<size_type>(cqe.res);
+			_stats.recvs += 1;
+			_stats.bytesIn += size;
+			if (!conn.closing) {
+				onData(conn, _pool.recvBuffer(bufferId).slice(0, size));
+			}
+			_pool.recycleRecv(_ring, bufferId);
+		} else if (cqe.res == -ENOBUFS) {
+			// All receive buffers are in use: buffers are returned once this batch of completions is handled.
+		} else {
+			shutdownConnection(conn);
+		}
+
+		if (!conn.receiving) {
+			if (conn.closing) {
+				maybeRelease(conn);
+			} else {
+				armRecv(conn);
+			}
+		}
+	}
+
+	void onSend(Connection& conn, int result) {
+		conn.sending = false;
+		if (result <= 0) {
+			while (!conn.sendQueue.empty()) {
+				_pool.releaseSend(conn.sendQueue.front().buffer);
+				conn.sendQueue.pop_front();
+			}
+			shutdownConnection(conn);
+			maybeRelease(conn);
+			return;
+		}
+
+		auto& pending = conn.sendQueue.front();
+		pending.written += static_cast<size_type>(result);
+		_stats.bytesOut += static_cast<uint64>(result);
+		if (pending.written == pending.size) {
+			_stats.sends += 1;
+			_pool.releaseSend(pending.buffer);
+			conn.sendQueue.pop_front();
+		}
+
+		if (!conn.sendQueue.empty()) {
+			submitSend(conn);
+		} else if (conn.closing) {
+			maybeRelease(conn);
+		}
+	}
+
+	/// Stop serving a connection. Connection is released once its operations in flight complete.
+	void shutdownConnection(Connection& conn) {
+		if (!conn.closing) {
+			conn.closing = true;
+			shutdown(conn.fd, SHUT_RDWR);  // Completes the multishot recv
+		}
+	}
+
+	void maybeRelease(Connection& conn) {
+		if (conn.receiving || conn.sending) {
+			return;
+		}
+
+		if (conn.sendBuffer >= 0) {
+			_pool.releaseSend(conn.sendBuffer);
+		}
+		for (auto const& pending : conn.sendQueue) {
+			_pool.releaseSend(pending.buffer);
+		}
+
+		close(conn.fd);
+		_connections[conn.id].reset();
+	}
+
+	/// Parse all the frames of the chunk received.
+	void onData(Connection& conn, MemoryView chunk) {
+		auto handler = [this, &conn](MessageHeader const& header, RequestMessage&& request) {
+			_stats.messages += 1;
+			std::visit([&](auto& message) { handle(conn, header.tag, message); }, request);
+		};
+
+		Result<void, Error> result{types::okTag};
+		if (conn.assembler.bytesPending() == 0) {
+			// Batch path: parse all the complete frames in place, stash the trailing part of a frame, if any.
+			ByteReader reader{chunk};
+			result = conn.parser.parseRequests(reader, handler);
+			while (!result) {
+				// Reader is left at the start of the failing frame: if its header is sound,
+				// reply with an error for its tag, skip the frame and carry on with the rest of the chunk.
+				auto header = conn.parser.parseMessageHeader(reader);
+				if (!header) {
+					break;  // Framing is lost: connection can not be recovered
+				}
+
+				auto const& failed = header.unwrap();
+				respond(conn, [&](MessageBatch& batch) { return batch.response(failed.tag).error(result.getError()); });
+				reader.advance(failed.payloadSize());
+				result = conn.parser.parseRequests(reader, handler);
+			}
+
+			if (result && reader.remaining() > 0) {
+				result = conn.assembler.feed(reader.viewRemaining(), [](MessageHeader const&, ByteReader&) {});
+			}
+		} else {
+			// Streaming path: complete the frame started by a previous chunk.
+			result = conn.assembler.feed(chunk, [&](MessageHeader const& header, ByteReader& payload) {
+				auto request = conn.parser.parseRequest(header, payload);
+				if (request) {
+					handler(header, std::move(*request));
+				} else {
+					respond(conn, [&](MessageBatch& batch) { return batch.response(header.tag).error(request.getError()); });
+				}
+			});
+		}
+
+		if (!result) {
+			std::cerr << "Connection " << conn.id << ": " << result.getError() << std::endl;
+			shutdownConnection(conn);
+		}
+	}
+
+	/// Encode a response into the send buffer of the connection.
+	template<typename Writer>
+	void respond(Connection& conn, Writer&& writer, size_type expectedSize = 512) {
+		if (conn.closing) {
+			return;
+		}
+
+		for (int attempt = 0; attempt < 2; ++attempt) {
+			if (!conn.batch) {
+				conn.sendBuffer = _pool.acquireSend();
+				if (conn.sendBuffer < 0) {
+					std::cerr << "Connection " << conn.id << ": send buffers exhausted" << std::endl;
+					shutdownConnection(conn);
+					return;
+				}
+
+				conn.output.emplace(_pool.sendBuffer(static_cast<unsigned>(conn.sendBuffer)));
+				conn.batch.emplace(*conn.output, conn.parser.maxNegotiatedMessageSize());
+				_dirty.push_back(conn.id);
+			}
+
+			if (conn.batch->fits(expectedSize) && conn.batch->add(writer(*conn.batch))) {
+				return;
+			}
+
+			sealOutput(conn);
+		}
+
+		std::cerr << "Connection " << conn.id << ": response does not fit a message" << std::endl;
+		shutdownConnection(conn);
+	}
+
+	/// Queue the send buffer being filled for sending.
+	void sealOutput(Connection& conn) {
+		if (!conn.batch) {
+			return;
+		}
+
+		if (conn.batch->empty()) {
+			_pool.releaseSend(conn.sendBuffer);
+		} else {
+			auto const size = static_cast<size_type>(conn.batch->seal().viewRemaining().size());
+			conn.sendQueue.push_back(PendingSend{conn.sendBuffer, size, 0});
+		}
+
+		conn.batch.reset();
+		conn.output.reset();
+		conn.sendBuffer = -1;
+	}
+
+	void flushOutput(Connection& conn) {
+		sealOutput(conn);
+		if (!conn.sending && !conn.sendQueue.empty() && !conn.closing) {
+			submitSend(conn);
+		}
+	}
+
+	FileState* fid(Connection& conn, Fid fidId) {
+		auto it = conn.fids.find(fidId);
+		return (it != conn.fids.end()) ? &it->second : nullptr;
+	}
+
+	void error(Connection& conn, Tag tag, StringView message) {
+		respond(conn, [&](MessageBatch& batch) { return batch.response(tag).error(message); });
+	}
+
+	void handle(Connection& conn, Tag, Request::Version const& request) {
+		auto const msize = conn.parser.maxNegotiatedMessageSize(std::min(request.msize, _maxMessageSize));
+		auto const version = negotiateProtocolVersion(parseProtocolVersion(request.version),
+													  ProtocolVersion::V9P2000EB);
+		auto const versionString = (version == ProtocolVersion::Unknown)
+				? StringView{Parser::UNKNOWN_PROTOCOL_VERSION}
+				: protocolVersionString(version);
+		conn.parser.setNegotiatedVersion(version);
+		conn.fids.clear();
+
+		respond(conn, [&](MessageBatch& batch) { return batch.response(Parser::NO_TAG).version(versionString, msize); });
+	}
+
+	void handle(Connection& conn, Tag tag, Request::Attach const& request) {
+		conn.fids[request.fid] = FileState{};
+		respond(conn, [&](MessageBatch& batch) { return batch.response(tag).attach(_tree.qidOf(FileTree::kRootPath)); });
+	}
+
+	void handle(Connection& conn, Tag tag, Request::Flush const&) {
+		respond(conn, [&](MessageBatch& batch) { return batch.response(tag).flush(); });
+	}
+
+	void handle(Connection& conn, Tag tag, Request::Walk const& request) {
+		auto from = fid(conn, request.fid);
+		if (!from) {
+			return error(conn, tag, "Unknown fid");
+		}
+
+		Qid qids[16];
+		uint32 nQids = 0;
+		auto path = from->path;
+		for (auto segment : request.path) {
+			auto const next = _tree.lookup(segment);
+			if (path != FileTree::kRootPath || next == FileTree::kRootPath || nQids == 16) {
+				break;
+			}
+
+			path = next;
+			qids[nQids++] = _tree.qidOf(path);
+		}
+
+		if (request.path.size() > 0 && nQids == 0) {
+			return error(conn, tag, "File not found");
+		}
+
+		if (nQids == request.path.size()) {
+			FileState state;
+			state.path = path;
+			conn.fids[request.newfid] = state;
+		}
+
+		respond(conn, [&](MessageBatch& batch) { return batch.response(tag).walk(ArrayView<Qid>{qids, nQids}); });
+	}
+
+	void handle(Connection& conn, Tag tag, Request::Open const& request) {
+		auto file = fid(conn, request.fid);
+		if (!file) {
+			return error(conn, tag, "Unknown fid");
+		}
+
+		file->isOpen = true;
+		auto const iounit = ioChunkSize(conn.parser.maxNegotiatedMessageSize());
+		respond(conn, [&](MessageBatch& batch) { return batch.response(tag).open(_tree.qidOf(file->path), iounit); });
+	}
+
+	void handle(Connection& conn, Tag tag, Request::Read const& request) {
+		auto file = fid(conn, request.fid);
+		if (!file || !file->isOpen) {
+			return error(conn, tag, "Fid is not open");
+		}
+
+		auto const count = std::min(request.count, ioChunkSize(conn.parser.maxNegotiatedMessageSize()));
+		if (file->path != FileTree::kRootPath) {
+			auto const data = _tree.read(request.offset, count);
+			return respond(conn, [&](MessageBatch& batch) { return batch.response(tag).read(data); },
+						   kIoHeaderSize + static_cast<size_type>(data.size()));
+		}
+
+		// Directory listing is encoded straight into the send buffer, after the header of the response.
+		respond(conn, [&](MessageBatch& batch) {
+			auto message = batch.response(tag).read();
+			DirListingWriter listing{*conn.output, count, request.offset, file->cursor};
+			std::string name;
+			for (auto i = listing.firstEntryIndex(); i < _tree.fileCount; ++i) {
+				if (!listing.encode(_tree.statOf(i + 1, name))) {
+					break;
+				}
+			}
+			file->cursor = listing.cursor();
+
+			return message;
+		}, kIoHeaderSize + count);
+	}
+
+	void handle(Connection& conn, Tag tag, Request::Write const& request) {
+		auto file = fid(conn, request.fid);
+		if (!file || !file->isOpen) {
+			return error(conn, tag, "Fid is not open");
+		}
+
+		// Content of the synthetic files is fixed: data written is discarded.
+		auto const count = static_cast<size_type>(request.data.size());
+		respond(conn, [&](MessageBatch& batch) { return batch.response(tag).write(count); });
+	}
+
+	void handle(Connection& conn, Tag tag, Request::Clunk const& request) {
+		if (conn.fids.erase(request.fid) == 0) {
+			return error(conn, tag, "Unknown fid");
+		}
+
+		respond(conn, [&](MessageBatch& batch) { return batch.response(tag).clunk(); });
+	}
+
+	void handle(Connection& conn, Tag tag, Request::StatRequest const& request) {
+		auto file = fid(conn, request.fid);
+		if (!file) {
+			return error(conn, tag, "Unknown fid");
+		}
+
+		std::string name;
+		auto const stat = _tree.statOf(file->path, name);
+		respond(conn, [&](MessageBatch& batch) { return batch.response(tag).stat(stat); });
+	}
+
+	template<typename Message>
+	void handle(Connection& conn, Tag tag, Message const&) {
+		error(conn, tag, "Operation not supported");
+	}
+
+private:
+	FileTree const&		_tree;
+	size_type const		_maxMessageSize;
+	int					_listenFd{-1};
+	Uring				_ring;
+	BufferPool			_pool;
+	std::vector<std::unique_ptr<Connection>>	_connections;
+	std::vector<uint32>	_dirty;
+	Stats				_stats;
+};
+
+
+int listenOn(uint16 port) {
+	int const fd = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -1;
+	}
+
+	int const enable = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+	sockaddr_in6 address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin6_family = AF_INET6;
+	address.sin6_port = htons(port);
+	address.sin6_addr = in6addr_any;
+	if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+
+/// Append a block of trace data to the trace file.
+void writeTrace(void* context, MemoryView data) {
+	int const fd = *static_cast<int*>(context);
+	auto bytes = data.dataAs<byte const>();
+	auto remaining = data.size();
+	while (remaining > 0) {
+		auto const written = write(fd, bytes, remaining);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			std::cerr << "Failed to write trace: " << std::strerror(errno) << std::endl;
+			return;
+		}
+
+		bytes += written;
+		remaining -= static_cast<size_t>(written);
+	}
+}
+
+
+void usage(char const* progname) {
+	std::cerr << "Usage: " << progname
+			  << " [-p port] [-m msize] [-n files] [-s file-size] [-r recv-buffers] [-b send-buffers] [-t trace-file]"
+			  << std::endl
+			  << "Serve a synthetic 9P file tree: a root directory of files named file0...fileN" << std::endl
+			  << "All the frames received and sent are recorded into the trace file if one is given, see trace.hpp"
+			  << std::endl;
+}
+
+}  // namespace
+
+
+int main(int argc, char* const* argv) {
+	uint16 port = 5640;
+	size_type msize = 64 * 1024;
+	unsigned files = 16;
+	uint64 fileSize = 1024 * 1024;
+	unsigned recvBuffers = 256;
+	unsigned sendBuffers = 256;
+	char const* tracePath = nullptr;
+
+	int c;
+	while ((c = getopt(argc, argv, "p:m:n:s:r:b:t:h")) != -1) {
+		switch (c) {
+		case 'p': port = static_cast<uint16>(std::stoul(optarg)); break;
+		case 'm': msize = static_cast<size_type>(std::stoul(optarg)); break;
+		case 'n': files = static_cast<unsigned>(std::stoul(optarg)); break;
+		case 's': fileSize = std::stoull(optarg); break;
+		case 'r': recvBuffers = static_cast<unsigned>(std::stoul(optarg)); break;
+		case 'b': sendBuffers = static_cast<unsigned>(std::stoul(optarg)); break;
+		case 't': tracePath = optarg; break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (msize < kIoHeaderSize + 1 || (recvBuffers & (recvBuffers - 1)) != 0 || recvBuffers == 0 || sendBuffers == 0) {
+		std::cerr << "Message size must be larger then " << kIoHeaderSize
+				  << " and number of receive buffers must be a power of two" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int const listenFd = listenOn(port);
+	if (listenFd < 0) {
+		std::cerr << "Failed to listen on port " << port << ": " << std::strerror(errno) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::signal(SIGINT, onSignal);
+	std::signal(SIGTERM, onSignal);
+	std::signal(SIGPIPE, SIG_IGN);
+
+	FileTree tree{files, fileSize, msize};
+	Server server{tree, msize};
+	if (!server.init(listenFd, recvBuffers, sendBuffers)) {
+		return EXIT_FAILURE;
+	}
+
+	// The server runs on the main thread: the trace hook of the thread records all the connections.
+	int traceFd = -1;
+	std::vector<byte> traceBuffer;
+	std::optional<TraceWriter> trace;
+	if (tracePath) {
+		traceFd = open(tracePath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (traceFd < 0) {
+			std::cerr << "Failed to open trace file " << tracePath << ": " << std::strerror(errno) << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		traceBuffer.resize(4 * 1024 * 1024);
+		trace.emplace(wrapMemory(traceBuffer.data(), traceBuffer.size()), writeTrace, &traceFd);
+		setTraceHook(trace->hook());
+	}
+
+	std::cout << "Serving " << files << " files on port " << port << ", msize " << msize
+			  << (server.legacyBuffers() ? " (legacy provided buffers)" : "") << std::endl;
+	server.run();
+
+	if (trace) {
+		setTraceHook({});
+		trace->flush();
+		close(traceFd);
+		std::cout << "traced frames: " << trace->frames() << std::endl;
+	}
+
+	auto const& stats = server.stats();
+	std::cout << "connections: " << stats.connections
+			  << ", messages: " << stats.messages
+			  << ", recvs: " << stats.recvs
+			  << ", sends: " << stats.sends
+			  << ", bytes in: " << stats.bytesIn
+			  << ", bytes out: " << stats.bytesOut << std::endl;
+
+	close(listenFd);
+	return EXIT_SUCCESS;
+}
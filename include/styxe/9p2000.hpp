@@ -17,6 +17,8 @@
 #ifndef STYXE_9P2000_HPP
 #define STYXE_9P2000_HPP
 
+#include <styxe/config.hpp>  // Generated build configuration
+
 #include <solace/stringView.hpp>
 #include <solace/string.hpp>
 #include <solace/byteReader.hpp>
@@ -65,6 +67,11 @@ enum class CannedError : int {
 		UnsupportedMessageType,
 		NotEnoughData,
 		MoreThenExpectedData,
+		WalkPathTooLong,
+		UnexpectedTag,
+		RequestFlushed,
+		UnsupportedBatchOperation,
+		IllFormedCompressedData,
 };
 
 /**
@@ -82,6 +89,13 @@ Error getCannedError(CannedError errorId) noexcept;
  */
 extern const size_type kMaxMesssageSize;
 
+/**
+ * Message size suitable for bulk data transfer, such as over virtio or high bandwidth network links.
+ * Protocol itself does not limit message size: any size that fits into size_type can be negotiated.
+ * @note Buffers used to build and to assemble messages must be at least as large as the negotiated message size.
+ */
+constexpr size_type kLargeMessageSize = 1024*1024;
+
 
 /**
  *  Flags for the mode field in TOpen and TCreate messages
@@ -172,6 +186,212 @@ struct Qid {
 	Solace::uint64  path;		  //!< Unique identifier of a file used by the server.
 };
 
+
+/**
+ * A view of a sequence of encoded qids, such as returned by a server in response to walk request.
+ * Qids are decoded on demand, when accessed.
+ * @note QidList does not own the data it refers to.
+ */
+struct QidList {
+	/// Type used to represent number of qids in the list
+	using size_type = var_datum_size_type;
+
+	/// Number of bytes used to encode a qid.
+	static constexpr Solace::MemoryView::size_type kEncodedQidSize =
+			sizeof(Solace::byte) + sizeof(Solace::uint32) + sizeof(Solace::uint64);
+
+	/// Forward iterator over qids in the list.
+	struct Iterator {
+		/**
+		 * Construct an iterator.
+		 * @param list List of qids to iterate over.
+		 * @param index Index of the current qid.
+		 */
+		constexpr Iterator(QidList const& list, size_type index) noexcept
+			: _list{&list}
+			, _index{index}
+		{}
+
+		/// @return Current qid.
+		Qid operator* () const noexcept { return (*_list)[_index]; }
+
+		/// Move to the next qid.
+		Iterator& operator++ () noexcept {
+			++_index;
+			return *this;
+		}
+
+		/// @return True if iterators refer to the same position in the list.
+		constexpr bool operator== (Iterator const& rhs) const noexcept { return _index == rhs._index; }
+
+		/// @return True if iterators refer to different positions in the list.
+		constexpr bool operator!= (Iterator const& rhs) const noexcept { return _index != rhs._index; }
+
+	private:
+		QidList const*	_list;   //!< List being iterated.
+		size_type		_index;  //!< Index of the current qid.
+	};
+
+	QidList() noexcept = default;
+
+	/**
+	 * Construct a view of encoded qids.
+	 * @param count Number of qids in the list.
+	 * @param data Encoded qids, must be at least count * kEncodedQidSize bytes long.
+	 */
+	QidList(size_type count, Solace::MemoryView data) noexcept
+		: _size{count}
+		, _data{data}
+	{}
+
+	/// @return Number of qids in the list.
+	constexpr size_type size() const noexcept { return _size; }
+
+	/// @return True if the list has no qids.
+	constexpr bool empty() const noexcept { return (_size == 0); }
+
+	/**
+	 * Decode a qid at the given index.
+	 * @param index Index of the qid in the list.
+	 * @return Decoded qid.
+	 */
+	Qid operator[] (size_type index) const noexcept;
+
+	/// @return Iterator to the first qid.
+	Iterator begin() const noexcept { return Iterator{*this, 0}; }
+
+	/// @return Iterator past the last qid.
+	Iterator end() const noexcept { return Iterator{*this, _size}; }
+
+private:
+	/// Number of qids in the list.
+	size_type			_size{0};
+	/// Encoded qids data.
+	Solace::MemoryView	_data;
+};
+
+
+/**
+ * An index of a walk path.
+ * Position, length and hash of every segment is recorded once, so that a server walking the path
+ * can access any segment in O(1) and look it up in a hash table without re-scanning the names.
+ * Index is stored inline: protocol limits a walk to kMaxSegments elements.
+ * Path of a walk request is indexed on demand, by the handler that needs it:
+ * \code{.cpp}
+	IndexedWalkPath const path{request.path};
+ * \endcode
+ *
+ * @note IndexedWalkPath does not own the data it refers to.
+ */
+struct IndexedWalkPath {
+	/// Type used to represent number of segments in the path
+	using size_type = WalkPath::size_type;
+
+	/// Maximum number of path segments in a single walk request, MAXWELEM of the protocol spec.
+	static constexpr size_type kMaxSegments = 16;
+
+	/// Forward iterator over segments of the path.
+	struct Iterator {
+		/**
+		 * Construct an iterator.
+		 * @param path Path to iterate over.
+		 * @param index Index of the current segment.
+		 */
+		constexpr Iterator(IndexedWalkPath const& path, size_type index) noexcept
+			: _path{&path}
+			, _index{index}
+		{}
+
+		/// @return Current segment.
+		Solace::StringView operator* () const noexcept { return (*_path)[_index]; }
+
+		/// Move to the next segment.
+		Iterator& operator++ () noexcept {
+			++_index;
+			return *this;
+		}
+
+		/// @return True if iterators refer to the same position in the path.
+		constexpr bool operator== (Iterator const& rhs) const noexcept { return _index == rhs._index; }
+
+		/// @return True if iterators refer to different positions in the path.
+		constexpr bool operator!= (Iterator const& rhs) const noexcept { return _index != rhs._index; }
+
+	private:
+		IndexedWalkPath const*	_path;   //!< Path being iterated.
+		size_type				_index;  //!< Index of the current segment.
+	};
+
+	/**
+	 * Hash function used to pre-compute segment hashes: 32 bit FNV-1a.
+	 * Use it to hash keys of a lookup table, indexed by values of hash().
+	 * @param segment A string to hash.
+	 * @return Hash value of the string.
+	 */
+	static Solace::uint32 hashOf(Solace::StringView segment) noexcept;
+
+	IndexedWalkPath() noexcept = default;
+
+	/**
+	 * Index a decoded walk path.
+	 * @param path A walk path, such as the path of a parsed walk request. Must not exceed kMaxSegments.
+	 */
+	explicit IndexedWalkPath(WalkPath const& path) noexcept {
+		assign(path.size(), path.data());
+	}
+
+	/**
+	 * Index encoded walk path.
+	 * @param count Number of segments in the path, must not exceed kMaxSegments.
+	 * @param data Encoded path segments, each segment is a size prefixed string.
+	 * @return Number of bytes of data occupied by the path or 0 if data is too short to hold count segments.
+	 */
+	Solace::MemoryView::size_type assign(size_type count, Solace::MemoryView data) noexcept;
+
+	/// @return Number of segments in the path.
+	constexpr size_type size() const noexcept { return _size; }
+
+	/// @return True if the path has no segments.
+	constexpr bool empty() const noexcept { return (_size == 0); }
+
+	/**
+	 * Get a path segment by index.
+	 * @param index Index of the segment.
+	 * @return A view of the segment.
+	 */
+	Solace::StringView operator[] (size_type index) const noexcept {
+		return Solace::StringView{_data.dataAs<char const>() + _offsets[index], _lengths[index]};
+	}
+
+	/**
+	 * Get precomputed hash of a path segment.
+	 * @param index Index of the segment.
+	 * @return Hash value of the segment, equal to hashOf((*this)[index]).
+	 */
+	constexpr Solace::uint32 hash(size_type index) const noexcept { return _hashes[index]; }
+
+	/// @return Iterator to the first segment.
+	Iterator begin() const noexcept { return Iterator{*this, 0}; }
+
+	/// @return Iterator past the last segment.
+	Iterator end() const noexcept { return Iterator{*this, _size}; }
+
+	/// @return Non-indexed view of the same path.
+	WalkPath walkPath() const noexcept { return WalkPath{_size, _data}; }
+
+private:
+	/// Number of segments in the path.
+	size_type				_size{0};
+	/// Encoded path data.
+	Solace::MemoryView		_data;
+	/// Offsets of the segments' strings in the encoded data.
+	Solace::uint32			_offsets[kMaxSegments];
+	/// Lengths of the segments.
+	var_datum_size_type		_lengths[kMaxSegments];
+	/// Hashes of the segments.
+	Solace::uint32			_hashes[kMaxSegments];
+};
+
 /**
  * Stat about a file on the server.
  */
@@ -235,6 +455,12 @@ enum class MessageType : Solace::byte {
 	TSWrite = 154,
 	RSWrite,
 
+	/**
+	 * 9P2000.eb: batched short read and write, extension of 9P2000.e
+	 */
+	TSBatch = 156,
+	RSBatch,
+
 	_endSupportedMessageCode
 };
 
@@ -279,6 +505,68 @@ MessageHeader makeHeaderWithPayload(MessageType type, Tag tag, size_type payload
 }
 
 
+/**
+ * Instrumentation hooks called by the parser and message writers to collect protocol metrics.
+ * When metrics are disabled hooks do nothing and compile away.
+ */
+namespace metrics {
+
+#if STYXE_METRICS
+
+/// Point in time an operation has started.
+struct Stopwatch {
+	/// Start measuring time.
+	Stopwatch() noexcept;
+
+	/// Construct a stopwatch started at a given time.
+	constexpr explicit Stopwatch(Solace::uint64 startedNanos) noexcept
+		: _started{startedNanos}
+	{}
+
+	/// @return Nanoseconds since the stopwatch creation.
+	Solace::uint64 elapsedNanos() const noexcept;
+
+private:
+	Solace::uint64	_started;  //!< Timestamp of the creation in nanoseconds.
+};
+
+/// Record a successfully decoded message.
+void recordDecode(MessageHeader const& header, Stopwatch const& started) noexcept;
+
+/// Record an encoded message.
+void recordEncode(MessageHeader const& header, Stopwatch const& started) noexcept;
+
+/// Record size of a complete received frame.
+void recordFrame(size_type frameSize, size_type maxMessageSize) noexcept;
+
+/// Record a protocol error.
+void recordError(CannedError errorId) noexcept;
+
+#else
+
+/// Point in time an operation has started: measures nothing.
+struct Stopwatch {
+	/// @return Nanoseconds since the stopwatch creation.
+	constexpr Solace::uint64 elapsedNanos() const noexcept { return 0; }
+};
+
+/// Record a successfully decoded message.
+constexpr void recordDecode(MessageHeader const&, Stopwatch const&) noexcept {}
+
+/// Record an encoded message.
+constexpr void recordEncode(MessageHeader const&, Stopwatch const&) noexcept {}
+
+/// Record size of a complete received frame.
+constexpr void recordFrame(size_type, size_type) noexcept {}
+
+/// Record a protocol error.
+constexpr void recordError(CannedError) noexcept {}
+
+#endif
+
+}  // namespace metrics
+
+
 
 /**
  * Request message as decoded from a buffer.
@@ -328,7 +616,7 @@ struct Request {
 	struct Walk {
 		Fid             fid;            //!< Fid of the directory where to start walk from.
 		Fid             newfid;         //!< A client provided new fid representing resulting file.
-		WalkPath		path;           //!< A path to walk from the fid.
+		WalkPath        path;           //!< A path to walk from the fid. @see IndexedWalkPath
 	};
 
 	/**
@@ -404,6 +692,164 @@ struct Request {
 };
 
 
+/**
+ * Operation of an entry of the batched short read/write request.
+ * @see Request_9P2000E::SBatch
+ */
+enum class ShortBatchOp : Solace::byte {
+	Read = 0,       //!< Read entire file contents, as TSRead does.
+	Write = 1,      //!< Overwrite file contents with the data of the entry, as TSWrite does.
+};
+
+
+/**
+ * Status of an entry of the batched short read/write response.
+ * @see Response_9P2000E::SBatch
+ */
+enum class ShortBatchStatus : Solace::byte {
+	Data = 0,       //!< File has been read, entry carries the file contents.
+	Written = 1,    //!< File has been written, entry carries the number of bytes written.
+	Failed = 2,     //!< Operation has failed, entry carries the error message.
+};
+
+
+/**
+ * An entry of the batched short read/write request: an operation on a single file.
+ */
+struct ShortBatchEntry {
+	ShortBatchOp		op;     //!< Operation to be performed on the file.
+	WalkPath			path;   //!< A path to the file, walked from the root fid of the request.
+	Solace::MemoryView	data;   //!< A data to be written into the file. Empty for the read operation.
+};
+
+
+/**
+ * An entry of the batched short read/write response: an outcome of the operation on a single file.
+ */
+struct ShortBatchResult {
+	ShortBatchStatus	status;		//!< Status of the operation.
+	Solace::MemoryView	data;		//!< Data read from the file if status is ShortBatchStatus::Data.
+	size_type			count;		//!< Number of bytes written if status is ShortBatchStatus::Written.
+	Solace::StringView	ename;		//!< Error description if status is ShortBatchStatus::Failed.
+};
+
+
+/**
+ * Decode an entry of the batched short read/write request.
+ * @param data Encoded entries, starting with the entry to decode.
+ * @param dest An entry to decode into.
+ * @return Number of bytes occupied by the decoded entry or 0 if data does not start with a well-formed entry.
+ */
+Solace::MemoryView::size_type decodeBatchEntry(Solace::MemoryView data, ShortBatchEntry& dest);
+
+/**
+ * Decode an entry of the batched short read/write response.
+ * @param data Encoded entries, starting with the entry to decode.
+ * @param dest An entry to decode into.
+ * @return Number of bytes occupied by the decoded entry or 0 if data does not start with a well-formed entry.
+ */
+Solace::MemoryView::size_type decodeBatchEntry(Solace::MemoryView data, ShortBatchResult& dest);
+
+
+/**
+ * A view of a sequence of encoded entries of a batched short read/write message.
+ * Entries are validated when the message is decoded, and decoded on demand one at a time as the view is iterated.
+ * @note ShortBatchView does not own the data it refers to.
+ * @tparam Entry Type of entries: ShortBatchEntry or ShortBatchResult.
+ */
+template<typename Entry>
+struct ShortBatchView {
+	/// Type used to represent number of entries in the batch
+	using size_type = var_datum_size_type;
+
+	/// Forward iterator over entries of the batch.
+	struct Iterator {
+		/**
+		 * Construct an iterator.
+		 * @param data Encoded entries starting with the current one.
+		 * @param index Index of the current entry.
+		 */
+		Iterator(Solace::MemoryView data, size_type index)
+			: _data{data}
+			, _index{index}
+		{
+			load();
+		}
+
+		/// @return Current entry.
+		Entry const& operator* () const noexcept { return _entry; }
+
+		/// @return Pointer to the current entry.
+		Entry const* operator-> () const noexcept { return &_entry; }
+
+		/// Move to the next entry.
+		Iterator& operator++ () {
+			_data = _data.slice(_entrySize, _data.size());
+			++_index;
+			load();
+
+			return *this;
+		}
+
+		/// @return True if iterators refer to the same position in the batch.
+		constexpr bool operator== (Iterator const& rhs) const noexcept { return _index == rhs._index; }
+
+		/// @return True if iterators refer to different positions in the batch.
+		constexpr bool operator!= (Iterator const& rhs) const noexcept { return _index != rhs._index; }
+
+	private:
+		/// Decode the current entry.
+		void load() {
+			_entrySize = (_data.size() != 0) ? decodeBatchEntry(_data, _entry) : 0;
+		}
+
+		Solace::MemoryView				_data;				//!< Encoded entries starting with the current one.
+		size_type						_index;				//!< Index of the current entry.
+		Solace::MemoryView::size_type	_entrySize{0};		//!< Number of bytes occupied by the current entry.
+		Entry							_entry{};			//!< Decoded current entry.
+	};
+
+	ShortBatchView() noexcept = default;
+
+	/**
+	 * Construct a view of encoded entries.
+	 * @param count Number of entries in the batch.
+	 * @param data Encoded entries, must hold count well-formed entries.
+	 */
+	ShortBatchView(size_type count, Solace::MemoryView data) noexcept
+		: _size{count}
+		, _data{data}
+	{}
+
+	/// @return Number of entries in the batch.
+	constexpr size_type size() const noexcept { return _size; }
+
+	/// @return True if the batch has no entries.
+	constexpr bool empty() const noexcept { return (_size == 0); }
+
+	/// @return Encoded entries.
+	constexpr Solace::MemoryView data() const noexcept { return _data; }
+
+	/// @return Iterator to the first entry.
+	Iterator begin() const { return Iterator{_data, 0}; }
+
+	/// @return Iterator past the last entry.
+	Iterator end() const { return Iterator{Solace::MemoryView{}, _size}; }
+
+private:
+	/// Number of entries in the batch.
+	size_type			_size{0};
+	/// Encoded entries data.
+	Solace::MemoryView	_data;
+};
+
+/// Entries of the batched short read/write request.
+using ShortBatchEntries = ShortBatchView<ShortBatchEntry>;
+
+/// Entries of the batched short read/write response.
+using ShortBatchResults = ShortBatchView<ShortBatchResult>;
+
+
 /// 9P2000 protocol Erlang extension new messages
 struct Request_9P2000E {
 
@@ -424,6 +870,15 @@ struct Request_9P2000E {
 		WalkPath			path;   //!< A path to the file to be read.
 		Solace::MemoryView	data;   //!< A data to be written into the file.
 	};
+
+	/**
+	 * A request to read or overwrite contents of many files at once: a batch of short reads and writes.
+	 * Part of 9P2000.eb extension, @see Parser::BATCH_PROTOCOL_VERSION.
+	 */
+	struct SBatch {
+		Fid					fid;		//!< Fid of the root directory to walk paths of all the entries from.
+		ShortBatchEntries	entries;	//!< Operations to perform, each on a single file.
+	};
 };
 
 
@@ -461,8 +916,7 @@ struct Response {
 
 	/// Walk response
 	struct Walk {
-		var_datum_size_type nqids;  //!< Number of qids returned
-		Qid qids[16];               //!< QIDs of the directories walked
+		QidList qids;  //!< QIDs of the directories walked
 	};
 
 	/// Open file response
@@ -511,9 +965,51 @@ struct Response {
 struct Response_9P2000E {
 	/// Session re-establishment response
 	struct Session {};
+
+	/// Batched short read and write response: an outcome for each entry of the request, in the same order.
+	struct SBatch {
+		ShortBatchResults	results;	//!< Outcomes of the operations.
+	};
+};
+
+
+/**
+ * Gather list of a message frame with the data payload kept out of line.
+ * A frame is made of two segments: the bytes encoded into the message buffer - message header,
+ * fixed size fields and the payload size prefix, followed by the payload data borrowed from the caller.
+ * Segments are meant to be sent with vectored IO, such as writev/sendmsg, avoiding
+ * a copy of the payload into the message buffer.
+ */
+struct FrameSegments {
+	Solace::MemoryView	header;		//!< Encoded part of the message frame.
+	Solace::MemoryView	payload;	//!< Data payload of the message as provided by the caller.
+
+	/** Get total size of the message frame in bytes.
+	 * @return Size of the message frame that is sum of the sizes of all the segments.
+	 */
+	size_type size() const noexcept {
+		return Solace::narrow_cast<size_type>(header.size() + payload.size());
+	}
 };
 
 
+/**
+ * Hooks called by the parser and message writers to pass frames to the trace hook of the calling thread.
+ * @see trace.hpp
+ */
+namespace trace {
+
+/// Record a frame received by the parser.
+void recordReceived(MessageHeader const& header, Solace::MemoryView payload) noexcept;
+
+/// Record a frame encoded by a message writer.
+void recordSent(FrameSegments const& frame) noexcept;
+
+}  // namespace trace
+
+
+struct MessageBatch;
+
 /**
 * Helper type used to represent a message being built.
 */
@@ -523,11 +1019,14 @@ struct TypedWriter {
 	 * @param buffer A byte stream to write the resulting message to.
 	 * @param pos A position in the stream where the message header has been written.
 	 * @param header Message header.
+	 * @param started Time when encoding of the message has started, used to collect encoding metrics.
 	 */
-	constexpr TypedWriter(Solace::ByteWriter& buffer, Solace::ByteWriter::size_type pos, MessageHeader header) noexcept
+	constexpr TypedWriter(Solace::ByteWriter& buffer, Solace::ByteWriter::size_type pos, MessageHeader header,
+						  metrics::Stopwatch started = {}) noexcept
 		: _buffer{buffer}
 		, _pos{pos}
 		, _header{header}
+		, _started{started}
 	{}
 
 	/**
@@ -541,6 +1040,21 @@ struct TypedWriter {
 	*/
 	Solace::ByteWriter& build();
 
+	/** Finalize the message without flipping the stream, so that more messages can be written after it.
+	 * @see MessageBatch
+	 * @return ByteWriter stream positioned at the end of the message.
+	 */
+	Solace::ByteWriter& complete();
+
+	/** Finalize the message build leaving data payload out of line.
+	 * Only the size of the payload is encoded into the buffer, while the payload itself is not copied.
+	 * This is only valid for messages that end with a data field, such as RRead, RSRead, TWrite and TSWrite,
+	 * which data field has not been written yet. It is a programming error to call it for any other message.
+	 * @param payload Data payload of the message.
+	 * @return Segments of the message frame.
+	 */
+	FrameSegments build(Solace::MemoryView payload);
+
 	/** Get message tag.
 	 * @return Get message tag.
 	 */
@@ -556,6 +1070,17 @@ struct TypedWriter {
 	 */
 	constexpr size_type payloadSize() const noexcept { return _header.payloadSize(); }
 
+	/** Get position of the message in the stream.
+	 * @return Position in the stream where the message header starts.
+	 */
+	constexpr Solace::ByteWriter::size_type startPosition() const noexcept { return _pos; }
+
+private:
+	friend struct MessageBatch;
+
+	/// Complete the message without recording it in a trace: a batch records only the messages it accepts.
+	Solace::ByteWriter& finish();
+
 private:
 	/// Byte writer where all data goes
 	Solace::ByteWriter&				_buffer;
@@ -565,6 +1090,9 @@ private:
 
 	/// Message header
 	MessageHeader					_header;
+
+	/// Time when encoding of the message has started
+	metrics::Stopwatch				_started;
 };
 
 
@@ -585,7 +1113,8 @@ using RequestMessage = std::variant<
 							Request::WStat,
 							Request_9P2000E::Session,
 							Request_9P2000E::SRead,
-							Request_9P2000E::SWrite
+							Request_9P2000E::SWrite,
+							Request_9P2000E::SBatch
 							>;
 
 /// Type representing response message
@@ -604,16 +1133,227 @@ using ResponseMessage = std::variant<
 							Response::Remove,
 							Response::Stat,
 							Response::WStat,
-							Response_9P2000E::Session
+							Response_9P2000E::Session,
+							Response_9P2000E::SBatch
 							>;
 
 
+/*
+ * Decoders of message specific content.
+ * Each function reads message payload, following the message header, from the byte stream into the message struct.
+ * Return void if message has been decoded successfully or an error otherwise.
+ */
+/// Decode TVersion message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Version& dest);
+/// Decode TAuth message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Auth& dest);
+/// Decode TFlush message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Flush& dest);
+/// Decode TAttach message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Attach& dest);
+/// Decode TWalk message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Walk& dest);
+/// Decode TOpen message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Open& dest);
+/// Decode TCreate message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Create& dest);
+/// Decode TRead message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Read& dest);
+/// Decode TWrite message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Write& dest);
+/// Decode TWrite message content, decompressing compressed data into the buffer given.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Write& dest, Solace::MutableMemoryView buffer);
+/// Decode TClunk message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Clunk& dest);
+/// Decode TRemove message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::Remove& dest);
+/// Decode TStat message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::StatRequest& dest);
+/// Decode TWStat message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request::WStat& dest);
+/// Decode TSession message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request_9P2000E::Session& dest);
+/// Decode TSRead message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request_9P2000E::SRead& dest);
+/// Decode TSWrite message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request_9P2000E::SWrite& dest);
+/// Decode TSWrite message content, decompressing compressed data into the buffer given.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request_9P2000E::SWrite& dest,
+								   Solace::MutableMemoryView buffer);
+/// Decode TSBatch message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Request_9P2000E::SBatch& dest);
+
+/// Decode RVersion message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Version& dest);
+/// Decode RAuth message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Auth& dest);
+/// Decode RAttach message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Attach& dest);
+/// Decode RError message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Error& dest);
+/// Decode RFlush message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Flush& dest);
+/// Decode RWalk message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Walk& dest);
+/// Decode ROpen message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Open& dest);
+/// Decode RCreate message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Create& dest);
+/// Decode RRead and RSRead message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Read& dest);
+/// Decode RRead and RSRead message content, decompressing compressed data into the buffer given.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Read& dest, Solace::MutableMemoryView buffer);
+/// Decode RWrite and RSWrite message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Write& dest);
+/// Decode RClunk message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Clunk& dest);
+/// Decode RRemove message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Remove& dest);
+/// Decode RStat message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::Stat& dest);
+/// Decode RWStat message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response::WStat& dest);
+/// Decode RSession message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response_9P2000E::Session& dest);
+/// Decode RSBatch message content.
+Solace::Result<void, Error> decode(Solace::ByteReader& data, Response_9P2000E::SBatch& dest);
+
+
+/**
+ * Versions of the protocol supported by the library.
+ */
+enum class ProtocolVersion : Solace::byte {
+	Unknown = 0,    //!< Version is not known or not supported.
+	V9P2000,        //!< Base 9P2000 protocol.
+	V9P2000E,       //!< 9P2000.e: Erlang extension of the protocol.
+	V9P2000EB,      //!< 9P2000.eb: 9P2000.e with batched short reads and writes.
+};
+
+
+/**
+ * Get protocol version by its name, as used in version negotiation messages.
+ * A payload compression suffix of the name, if any, is ignored, @see parsePayloadCompression.
+ * @param version Name of the protocol version.
+ * @return Protocol version or ProtocolVersion::Unknown if the version is not supported.
+ */
+ProtocolVersion parseProtocolVersion(Solace::StringView version) noexcept;
+
+/**
+ * Get name of the protocol version, as used in version negotiation messages.
+ * @param version Protocol version.
+ * @return Name of the protocol version.
+ */
+Solace::StringView protocolVersionString(ProtocolVersion version) noexcept;
+
+/**
+ * Negotiate protocol version to be used by a session.
+ * Each supported version is an extension of the previous one, thus a server that supports a version
+ * can talk any of the preceding versions as well. For example a client offering 9P2000.eb to a 9P2000.e server
+ * continues with 9P2000.e, while a client offering 9P2000.e to a 9P2000.eb server gets 9P2000.e.
+ * @param offered Protocol version offered by a peer.
+ * @param supported Protocol version supported.
+ * @return The highest protocol version both peers support or ProtocolVersion::Unknown if the offer is not supported.
+ */
+constexpr ProtocolVersion negotiateProtocolVersion(ProtocolVersion offered, ProtocolVersion supported) noexcept {
+	return (offered < supported) ? offered : supported;
+}
+
+
+/**
+ * Compression of data payloads of RRead, TWrite, RSRead and TSWrite messages.
+ * Compression is an optional feature of a session negotiated alongside the protocol version:
+ * a peer offers it by appending a suffix, such as `+lz4`, to the version string of TVersion, e.g. `9P2000.e+lz4`,
+ * and a peer that accepts it responds with the same suffix in RVersion.
+ *
+ * Once negotiated, a data field may be sent compressed. The top bit of the data size marks compressed field,
+ * the remaining bits are the size of the encoded field: size of the data before compression followed by
+ * compressed data. Data smaller than the compression threshold or data that does not compress is sent as is.
+ * @see encodeCompressed
+ */
+enum class PayloadCompression : Solace::byte {
+	None = 0,       //!< Data payloads are not compressed.
+	LZ4 = 1,        //!< Data payloads are compressed with LZ4 block format.
+};
+
+/// Default minimal size of a data payload worth compressing.
+constexpr size_type kCompressionThreshold = 256;
+
+/**
+ * Compression of data payloads used by message writers.
+ */
+struct CompressionPolicy {
+	/**
+	 * Construct a compression policy.
+	 * @param compressionMethod Compression method negotiated by the session.
+	 * @param minPayloadSize Data payloads smaller than this are sent without compression.
+	 */
+	constexpr CompressionPolicy(PayloadCompression compressionMethod = PayloadCompression::None,
+								size_type minPayloadSize = kCompressionThreshold) noexcept
+		: method{compressionMethod}
+		, threshold{minPayloadSize}
+	{}
+
+	PayloadCompression	method;		//!< Compression method to use.
+	size_type			threshold;	//!< Minimal size of a data payload to compress.
+};
+
+
+/**
+ * Get payload compression offered by a version string, as used in version negotiation messages.
+ * @param version Version string, such as `9P2000.e+lz4`.
+ * @return Payload compression or PayloadCompression::None if the version does not offer a supported compression.
+ */
+PayloadCompression parsePayloadCompression(Solace::StringView version) noexcept;
+
+/**
+ * Get version string offering the protocol version and the payload compression.
+ * @param version Protocol version.
+ * @param compression Payload compression.
+ * @return Version string to be used in version negotiation messages.
+ */
+Solace::StringView protocolVersionString(ProtocolVersion version, PayloadCompression compression) noexcept;
+
+/**
+ * Negotiate payload compression to be used by a session.
+ * @param offered Payload compression offered by a peer.
+ * @param supported Payload compression supported.
+ * @return Offered compression if it is supported or PayloadCompression::None otherwise.
+ */
+constexpr PayloadCompression negotiatePayloadCompression(PayloadCompression offered,
+														 PayloadCompression supported) noexcept {
+	return (offered == supported) ? offered : PayloadCompression::None;
+}
+
+
+/**
+ * Protocol configuration. Immutable and can be shared by all connections.
+ */
+struct ProtocolConfig {
+	size_type           maxMessageSize;     //!< Maximum message size in bytes, offered during negotiation.
+	ProtocolVersion     version;            //!< Supported protocol version, offered during negotiation.
+	PayloadCompression  compression{PayloadCompression::None};  //!< Supported payload compression.
+};
+
+
+/**
+ * State of a session negotiated by a connection.
+ */
+struct SessionState {
+	size_type           maxNegotiatedMessageSize;   //!< Negotiated maximum message size in bytes.
+	ProtocolVersion     negotiatedVersion;          //!< Negotiated protocol version.
+	PayloadCompression  compression{PayloadCompression::None};  //!< Negotiated payload compression.
+};
+
+
 /**
  * An implementation of 9P2000 protocol.
  *
  * The protocol is state-full as version, supported extentions and messages size are negotiated.
  * Thus this info must be preserved during communication. Instance of this class serves this purpose as well as
  * helps with message parsing.
+ * Parser is made of immutable ProtocolConfig and SessionState of the connection. Both are small and trivially
+ * copyable, so a server can share one configuration and keep per connection parser without any allocation.
+ * Parsing methods are const and do not modify the parser, thus can be called concurrently.
  *
  * @note The implementation of the protocol does not allocate memory for any operation.
  * Message parser acts on an instance of the user provided Solace::ByteReader and any message data such as
@@ -628,6 +1368,9 @@ struct Parser {
 	/** String representing version of protocol. */
 	static const Solace::StringLiteral PROTOCOL_VERSION;
 
+	/** String representing version of protocol with batched short reads and writes, @see Request_9P2000E::SBatch. */
+	static const Solace::StringLiteral BATCH_PROTOCOL_VERSION;
+
 	/** String const for unknow version. */
 	static const Solace::StringLiteral UNKNOWN_PROTOCOL_VERSION;
 
@@ -637,33 +1380,56 @@ struct Parser {
 	/** Special value of a message FID representing 'no Fid'. */
 	static const Fid NOFID;
 
-	/// Default destructor
-	~Parser() noexcept = default;
-
-	Parser(Parser const& ) = delete;
-	Parser& operator= (Parser const& ) = delete;
-
 	/**
 	 * Construct a new instance of the protocol.
-	 * Usually one would create an instance per connection as protocol stores state per estanblished session.
 	 * @param maxMassageSize Maximum message size in bytes. This will be used by during version and size negotiation.
 	 * @param version Supported protocol version. This is advertized by the protocol during version/size negotiation.
 	 */
 	Parser(size_type maxMassageSize = kMaxMesssageSize,
 		   Solace::StringView version = PROTOCOL_VERSION) noexcept
-		: _maxMassageSize{maxMassageSize}
-		, _maxNegotiatedMessageSize{maxMassageSize}
-		, _initialVersion{version}
-		, _negotiatedVersion{makeString(version).unwrap()}
+		: Parser{ProtocolConfig{maxMassageSize, parseProtocolVersion(version), parsePayloadCompression(version)}}
 	{
 	}
 
+	/**
+	 * Construct a new instance of the protocol for a new connection.
+	 * @param config Protocol configuration.
+	 */
+	constexpr Parser(ProtocolConfig config) noexcept
+		: _config{config}
+		, _session{config.maxMessageSize, config.version, config.compression}
+	{
+	}
+
+	/**
+	 * Construct a new instance of the protocol for a connection with already negotiated session.
+	 * @param config Protocol configuration.
+	 * @param session Negotiated session state.
+	 */
+	constexpr Parser(ProtocolConfig config, SessionState session) noexcept
+		: _config{config}
+		, _session{session}
+	{
+	}
+
+	/**
+	 * Get protocol configuration.
+	 * @return Protocol configuration this parser has been created with.
+	 */
+	constexpr ProtocolConfig const& config() const noexcept { return _config; }
+
+	/**
+	 * Get state of the negotiated session.
+	 * @return Session state.
+	 */
+	constexpr SessionState const& session() const noexcept { return _session; }
+
 	/**
 	 * Get maximum message size supported by the protocol instance.
 	 * @return Maximum message size in bytes.
 	 */
 	constexpr size_type maxPossibleMessageSize() const noexcept {
-		return _maxMassageSize;
+		return _config.maxMessageSize;
 	}
 
 	/**
@@ -671,7 +1437,7 @@ struct Parser {
 	 * @return Negotiated message size in bytes.
 	 */
 	constexpr size_type maxNegotiatedMessageSize() const noexcept {
-		return _maxNegotiatedMessageSize;
+		return _session.maxNegotiatedMessageSize;
 	}
 
 	/**
@@ -683,18 +1449,46 @@ struct Parser {
 
 	/**
 	 * Get negotiated protocol version effective for the estanblished session.
-	 * @return Negotiated version string.
+	 * @return Negotiated version.
+	 */
+	constexpr ProtocolVersion negotiatedVersion() const noexcept {
+		return _session.negotiatedVersion;
+	}
+
+	/**
+	 * Get negotiated protocol version effective for the estanblished session.
+	 * @return Negotiated version string, including negotiated payload compression if any.
+	 */
+	Solace::StringView getNegotiatedVersion() const noexcept {
+		return protocolVersionString(_session.negotiatedVersion, _session.compression);
+	}
+
+	/**
+	 * Get payload compression negotiated for the established session.
+	 * @return Negotiated payload compression.
 	 */
-	constexpr Solace::String const& getNegotiatedVersion() const noexcept {
-		return _negotiatedVersion;
+	constexpr PayloadCompression negotiatedCompression() const noexcept {
+		return _session.compression;
 	}
 
 	/**
 	 * Set negotiated protocol version.
 	 * @param version A new negotited protocol version.
+	 * @param compression Payload compression negotiated along with the version. None unless given.
 	 */
-	void setNegotiatedVersion(Solace::String&& version) noexcept {
-		_negotiatedVersion = Solace::mv(version);
+	void setNegotiatedVersion(ProtocolVersion version,
+							  PayloadCompression compression = PayloadCompression::None) noexcept {
+		_session.negotiatedVersion = version;
+		_session.compression = compression;
+	}
+
+	/**
+	 * Set negotiated protocol version.
+	 * @param version A new negotited protocol version string.
+	 */
+	void setNegotiatedVersion(Solace::StringView version) noexcept {
+		_session.negotiatedVersion = parseProtocolVersion(version);
+		_session.compression = parsePayloadCompression(version);
 	}
 
 	/**
@@ -727,13 +1521,253 @@ struct Parser {
 	Solace::Result<RequestMessage, Error>
 	parseRequest(MessageHeader const& header, Solace::ByteReader& data) const;
 
+	/**
+	 * Parse 9P Response type message of a session with negotiated payload compression.
+	 * Compressed data of RRead and RSRead messages is decompressed into the buffer given,
+	 * so that Response::Read::data is a view into the buffer. Other messages are parsed as by parseResponse.
+	 *
+	 * @param header Message header.
+	 * @param data Byte buffer to read message content from.
+	 * @param buffer Buffer to decompress data into. Must be at least the negotiated message size.
+	 * @return Resulting message if parsed successfully or an error otherwise.
+	 */
+	Solace::Result<ResponseMessage, Error>
+	parseCompressedResponse(MessageHeader const& header, Solace::ByteReader& data, Solace::MutableMemoryView buffer) const;
+
+	/**
+	 * Parse 9P Request type message of a session with negotiated payload compression.
+	 * Compressed data of TWrite and TSWrite messages is decompressed into the buffer given,
+	 * so that the data of the request is a view into the buffer. Other messages are parsed as by parseRequest.
+	 *
+	 * @param header Message header.
+	 * @param data Byte buffer to read message content from.
+	 * @param buffer Buffer to decompress data into. Must be at least the negotiated message size.
+	 * @return Resulting message if parsed successfully or an error otherwise.
+	 */
+	Solace::Result<RequestMessage, Error>
+	parseCompressedRequest(MessageHeader const& header, Solace::ByteReader& data, Solace::MutableMemoryView buffer) const;
+
+	/**
+	 * Parse 9P Response type message from a byte byffer and pass it to the handler.
+	 * Unlike parseResponse that returns a variant, message is constructed on the stack
+	 * and the handler is called directly with the message of the specific type.
+	 *
+	 * @param header Message header.
+	 * @param data Byte buffer to read message content from.
+	 * @param handler A callable object with an overload of `operator()` for each Response::* and Response_9P2000E::*
+	 * message type.
+	 * @return Void if message has been parsed and handled successfully or an error otherwise.
+	 */
+	template<typename Handler>
+	Solace::Result<void, Error>
+	parseResponse(MessageHeader const& header, Solace::ByteReader& data, Handler&& handler) const {
+		auto frameCheck = checkFrame(header, data);
+		if (!frameCheck) {
+			return frameCheck;
+		}
+
+		return visitResponsePayload(header, data, handler);
+	}
+
+	/**
+	 * Parse 9P Request type message from a byte byffer and pass it to the handler.
+	 * Unlike parseRequest that returns a variant, message is constructed on the stack
+	 * and the handler is called directly with the message of the specific type.
+	 *
+	 * @param header Message header.
+	 * @param data Byte buffer to read message content from.
+	 * @param handler A callable object with an overload of `operator()` for each Request::* and Request_9P2000E::*
+	 * message type.
+	 * @return Void if message has been parsed and handled successfully or an error otherwise.
+	 */
+	template<typename Handler>
+	Solace::Result<void, Error>
+	parseRequest(MessageHeader const& header, Solace::ByteReader& data, Handler&& handler) const {
+		auto frameCheck = checkFrame(header, data);
+		if (!frameCheck) {
+			return frameCheck;
+		}
+
+		return visitRequestPayload(header, data, handler);
+	}
+
+	/**
+	 * Parse all Request type messages pipelined into a byte buffer.
+	 * Each successfully parsed message is passed to the handler in the order messages appear in the buffer.
+	 * Parsing stops at the first incomplete frame, leaving it in the buffer, or at the first ill-formed message.
+	 *
+	 * @param data Byte buffer to read messages from.
+	 * @param handler A callable with a signature `void (MessageHeader const&, RequestMessage&&)`.
+	 * @return Void if all complete frames have been parsed or an error otherwise.
+	 * In case of an error the buffer is positioned at the start of the frame that failed to parse.
+	 */
+	template<typename Handler>
+	Solace::Result<void, Error>
+	parseRequests(Solace::ByteReader& data, Handler&& handler) const {
+		return parseFrames(data, handler, &Parser::parseRequestPayload);
+	}
+
+	/**
+	 * Parse all Response type messages pipelined into a byte buffer.
+	 * Each successfully parsed message is passed to the handler in the order messages appear in the buffer.
+	 * Parsing stops at the first incomplete frame, leaving it in the buffer, or at the first ill-formed message.
+	 *
+	 * @param data Byte buffer to read messages from.
+	 * @param handler A callable with a signature `void (MessageHeader const&, ResponseMessage&&)`.
+	 * @return Void if all complete frames have been parsed or an error otherwise.
+	 * In case of an error the buffer is positioned at the start of the frame that failed to parse.
+	 */
+	template<typename Handler>
+	Solace::Result<void, Error>
+	parseResponses(Solace::ByteReader& data, Handler&& handler) const {
+		return parseFrames(data, handler, &Parser::parseResponsePayload);
+	}
+
 private:
 
-	size_type const         _maxMassageSize;                /// Initial value of the maximum message size in bytes.
-	size_type               _maxNegotiatedMessageSize;      /// Negotiated value of the maximum message size in bytes.
+	/**
+	 * Check that the data given holds exactly one complete frame described by the header.
+	 * @param header Message header.
+	 * @param data Byte buffer to read message content from.
+	 * @return Void if data size matches the header or an error otherwise.
+	 */
+	Solace::Result<void, Error>
+	checkFrame(MessageHeader const& header, Solace::ByteReader const& data) const;
+
+	/// Decode a message of a given type and pass it to the handler.
+	template<typename Message, typename Handler>
+	static Solace::Result<void, Error>
+	visitMessage(MessageHeader const& header, Solace::ByteReader& data, Handler& handler) {
+		metrics::Stopwatch const started;
+		Message msg;
+		auto result = decode(data, msg);
+		if (result) {
+			metrics::recordDecode(header, started);
+			handler(msg);
+		}
+
+		return result;
+	}
+
+	/// Decode content of a validated Response frame and pass it to the handler.
+	template<typename Handler>
+	static Solace::Result<void, Error>
+	visitResponsePayload(MessageHeader const& header, Solace::ByteReader& data, Handler& handler) {
+		switch (header.type) {
+		case MessageType::RError:   return visitMessage<Response::Error>(header, data, handler);
+		case MessageType::RVersion: return visitMessage<Response::Version>(header, data, handler);
+		case MessageType::RAuth:    return visitMessage<Response::Auth>(header, data, handler);
+		case MessageType::RAttach:  return visitMessage<Response::Attach>(header, data, handler);
+		case MessageType::RFlush:   return visitMessage<Response::Flush>(header, data, handler);
+		case MessageType::RWalk:    return visitMessage<Response::Walk>(header, data, handler);
+		case MessageType::ROpen:    return visitMessage<Response::Open>(header, data, handler);
+		case MessageType::RCreate:  return visitMessage<Response::Create>(header, data, handler);
+		case MessageType::RSRead:  // Note: RRead is re-used here for RSRead
+		case MessageType::RRead:    return visitMessage<Response::Read>(header, data, handler);
+		case MessageType::RSWrite:  // Note: RWrite is re-used here for RSWrite
+		case MessageType::RWrite:   return visitMessage<Response::Write>(header, data, handler);
+		case MessageType::RClunk:   return visitMessage<Response::Clunk>(header, data, handler);
+		case MessageType::RRemove:  return visitMessage<Response::Remove>(header, data, handler);
+		case MessageType::RStat:    return visitMessage<Response::Stat>(header, data, handler);
+		case MessageType::RWStat:   return visitMessage<Response::WStat>(header, data, handler);
+		/* 9P2000.e extension messages */
+		case MessageType::RSession: return visitMessage<Response_9P2000E::Session>(header, data, handler);
+		/* 9P2000.eb extension messages */
+		case MessageType::RSBatch:  return visitMessage<Response_9P2000E::SBatch>(header, data, handler);
+
+		default:
+			return getCannedError(CannedError::UnsupportedMessageType);
+		}
+	}
+
+	/// Decode content of a validated Request frame and pass it to the handler.
+	template<typename Handler>
+	static Solace::Result<void, Error>
+	visitRequestPayload(MessageHeader const& header, Solace::ByteReader& data, Handler& handler) {
+		switch (header.type) {
+		case MessageType::TVersion: return visitMessage<Request::Version>(header, data, handler);
+		case MessageType::TAuth:    return visitMessage<Request::Auth>(header, data, handler);
+		case MessageType::TFlush:   return visitMessage<Request::Flush>(header, data, handler);
+		case MessageType::TAttach:  return visitMessage<Request::Attach>(header, data, handler);
+		case MessageType::TWalk:    return visitMessage<Request::Walk>(header, data, handler);
+		case MessageType::TOpen:    return visitMessage<Request::Open>(header, data, handler);
+		case MessageType::TCreate:  return visitMessage<Request::Create>(header, data, handler);
+		case MessageType::TRead:    return visitMessage<Request::Read>(header, data, handler);
+		case MessageType::TWrite:   return visitMessage<Request::Write>(header, data, handler);
+		case MessageType::TClunk:   return visitMessage<Request::Clunk>(header, data, handler);
+		case MessageType::TRemove:  return visitMessage<Request::Remove>(header, data, handler);
+		case MessageType::TStat:    return visitMessage<Request::StatRequest>(header, data, handler);
+		case MessageType::TWStat:   return visitMessage<Request::WStat>(header, data, handler);
+		/* 9P2000.e extension messages */
+		case MessageType::TSession: return visitMessage<Request_9P2000E::Session>(header, data, handler);
+		case MessageType::TSRead:   return visitMessage<Request_9P2000E::SRead>(header, data, handler);
+		case MessageType::TSWrite:  return visitMessage<Request_9P2000E::SWrite>(header, data, handler);
+		/* 9P2000.eb extension messages */
+		case MessageType::TSBatch:  return visitMessage<Request_9P2000E::SBatch>(header, data, handler);
+
+		default:
+			return getCannedError(CannedError::UnsupportedMessageType);
+		}
+	}
+
+	/**
+	 * Parse Request message content of a validated frame.
+	 * @param header Message header.
+	 * @param data Byte buffer holding exactly the payload of the message.
+	 * @return Resulting message if parsed successfully or an error otherwise.
+	 */
+	Solace::Result<RequestMessage, Error>
+	parseRequestPayload(MessageHeader const& header, Solace::ByteReader& data) const;
 
-	Solace::StringView const    _initialVersion;            /// Initial value of the used protocol version.
-	Solace::String              _negotiatedVersion;         /// Negotiated value of the protocol version.
+	/**
+	 * Parse Response message content of a validated frame.
+	 * @param header Message header.
+	 * @param data Byte buffer holding exactly the payload of the message.
+	 * @return Resulting message if parsed successfully or an error otherwise.
+	 */
+	Solace::Result<ResponseMessage, Error>
+	parseResponsePayload(MessageHeader const& header, Solace::ByteReader& data) const;
+
+	/// Walk all complete frames in the buffer, checking frame size only once per message.
+	template<typename Handler, typename Message>
+	Solace::Result<void, Error>
+	parseFrames(Solace::ByteReader& data, Handler& handler,
+				Solace::Result<Message, Error> (Parser::*parsePayload)(MessageHeader const&, Solace::ByteReader&) const)
+	const {
+		while (data.remaining() >= headerSize()) {
+			auto const frameStart = data.position();
+			auto maybeHeader = parseMessageHeader(data);
+			if (!maybeHeader) {
+				data.position(frameStart);
+				return maybeHeader.getError();
+			}
+
+			auto const& header = maybeHeader.unwrap();
+			auto const payloadSize = header.payloadSize();
+			if (payloadSize > data.remaining()) {  // Incomplete frame is left for the caller to deal with.
+				data.position(frameStart);
+				break;
+			}
+
+			Solace::ByteReader payload{data.viewRemaining().slice(0, payloadSize)};
+			metrics::recordFrame(header.messageSize, maxNegotiatedMessageSize());
+			trace::recordReceived(header, payload.viewRemaining());
+			auto maybeMessage = (this->*parsePayload)(header, payload);
+			if (!maybeMessage) {
+				data.position(frameStart);
+				return maybeMessage.getError();
+			}
+
+			data.advance(payloadSize);
+			handler(header, Solace::mv(maybeMessage.unwrap()));
+		}
+
+		return Solace::Result<void, Error>{Solace::types::okTag};
+	}
+
+
+	ProtocolConfig          _config;    /// Protocol configuration: maximum message size and version offered.
+	SessionState            _session;   /// Negotiated session state.
 };
 
 
@@ -769,6 +1803,17 @@ bool operator == (Stat const& lhs, Stat const& rhs) noexcept {
 }
 
 
+/**
+ * Position in a directory listing where a previous directory read has stopped.
+ * Server keeps a cursor per open directory fid to resume listing from where the previous read has ended,
+ * without re-measuring all the preceding entries. @see DirListingWriter
+ */
+struct DirListingCursor {
+	Solace::uint64	offset{0};  //!< Byte offset in the listing where the next read is expected to start.
+	Solace::uint64	index{0};   //!< Index of the directory entry that starts at the offset.
+};
+
+
 /**
  * @brief A helper class that allows to build response content for DIR `read` request.
  * @see Protocol::Request::Read
@@ -790,6 +1835,19 @@ bool operator == (Stat const& lhs, Stat const& rhs) noexcept {
 ...
  * \endcode
  *
+ * Clients read directories sequentially: each read starts at the offset where the previous one ended.
+ * To avoid measuring all the entries preceding the offset on each read, a cursor can be used to resume:
+ * \code{.cpp}
+...
+	DirListingWriter encoder{dest, count, offset, fidState.cursor};
+	for (auto i = encoder.firstEntryIndex(); i < entries.size(); ++i) {
+		if (!encoder.encode(mapEntryStats(entries[i]))) {
+			break;
+		}
+	}
+	fidState.cursor = encoder.cursor();
+...
+ * \endcode
  */
 struct DirListingWriter {
 
@@ -812,6 +1870,24 @@ struct DirListingWriter {
 			, _dest{dest}
 	{}
 
+	/**
+	 * @brief Create an instance of Dir listing writer that resumes listing from the cursor of the previous read.
+	 * If the offset matches the cursor, the entries preceding it are not required to be encoded again:
+	 * the listing shall start with the entry at firstEntryIndex(). Otherwise the listing starts from the first entry.
+	 * @param inCount Maximum number of bytes that can be written into dest.
+	 * @param inOffset Number of bytes to skip.
+	 * @param dest Output buffer where resuling data is written.
+	 * @param resume Cursor where previous directory read has stopped.
+	 */
+	constexpr DirListingWriter(Solace::ByteWriter& dest, Solace::uint32 inCount, Solace::uint64 inOffset,
+							   DirListingCursor resume) noexcept
+			: _bytesTraversed{(resume.offset == inOffset) ? inOffset : 0}
+			, _entryIndex{(resume.offset == inOffset) ? resume.index : 0}
+			, offset{inOffset}
+			, count{inCount}
+			, _dest{dest}
+	{}
+
 	/**
 	 * @brief Encode directory entry into response message
 	 * @param stat Directory entry stat.
@@ -829,9 +1905,25 @@ struct DirListingWriter {
 	 */
 	constexpr auto bytesEncoded() const noexcept { return _bytesEncoded; }
 
+	/** Get index of the directory entry to start listing with.
+	 * @return Index of the first entry expected by encode().
+	 */
+	constexpr Solace::uint64 firstEntryIndex() const noexcept { return _firstEntryIndex; }
+
+	/** Get the cursor to resume the next sequential read from.
+	 * @return Position in the listing past the last encoded entry.
+	 */
+	constexpr DirListingCursor cursor() const noexcept {
+		return DirListingCursor{offset + _bytesEncoded, _entryIndex};
+	}
+
 private:
 	/// Number of bytes traversed so far.
 	Solace::uint64			_bytesTraversed{0};
+	/// Index of the next entry to be given to encode.
+	Solace::uint64			_entryIndex{0};
+	/// Index of the entry the listing starts with.
+	Solace::uint64 const	_firstEntryIndex{_entryIndex};
 	/// Number of bytes to skip before starting to write data.
 	Solace::uint64 const	offset;
 	/// Max number of bytes to write.
@@ -0,0 +1,325 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_CHUNKEDIO_HPP
+#define STYXE_CHUNKEDIO_HPP
+
+#include "9p2000.hpp"
+#include "messageBatch.hpp"
+
+#include <bitset>
+#include <limits>
+
+
+namespace styxe {
+
+/**
+ * Number of bytes of a read or write message that are not data: the largest of TRead, TWrite and RRead overheads.
+ * Matches IOHDRSZ of Plan 9, so that msize - kIoHeaderSize is the iounit a server would announce.
+ */
+constexpr size_type kIoHeaderSize = 24;
+
+
+/**
+ * Get maximum number of data bytes a single TRead or TWrite message can transfer.
+ * @param messageSize Negotiated message size.
+ * @param iounit I/O unit announced by the server in ROpen / RCreate response. 0 means no limit.
+ * @return Maximum data size of a single read or write, 0 if message size is too small to carry any data.
+ */
+constexpr size_type ioChunkSize(size_type messageSize, size_type iounit = 0) noexcept {
+	auto const maxData = (messageSize > kIoHeaderSize) ? messageSize - kIoHeaderSize : 0;
+	return (iounit != 0 && iounit < maxData) ? iounit : maxData;
+}
+
+
+/**
+ * Book keeping of a large logical I/O operation split into a sequence of chunk sized TRead or TWrite messages.
+ *
+ * Chunk N covers bytes [offset + N * chunkSize, offset + (N + 1) * chunkSize) of the file and is sent with
+ * tag firstTag + N, so that a response can be matched to its chunk without any lookup table.
+ * Responses may arrive in any order, but only one response is accepted for each chunk.
+ * A chunk that transfers less than requested - end of file, a short write
+ * or an error - ends the operation: no more chunks are issued and
+ * only bytes before the first short chunk are reported as transferred.
+ *
+ * @note Length of the operation is capped by the number of tags available after the first tag.
+ * Continue with a new operation from offset() + bytesTransferred() to transfer the rest.
+ */
+struct ChunkedIo {
+
+	/**
+	 * Construct a new chunked operation.
+	 * @param fid Fid of the open file.
+	 * @param offset Offset in the file of the first byte of the operation.
+	 * @param length Total number of bytes to transfer.
+	 * @param chunkSize Maximum number of bytes transferred by a single message, @see ioChunkSize().
+	 * @param firstTag Tag of the first chunk message. Following chunks use consecutive tags.
+	 */
+	ChunkedIo(Fid fid, Solace::uint64 offset, Solace::uint64 length, size_type chunkSize, Tag firstTag) noexcept;
+
+	/// @return Fid of the file.
+	Fid fid() const noexcept { return _fid; }
+
+	/// @return Offset in the file of the first byte of the operation.
+	Solace::uint64 offset() const noexcept { return _offset; }
+
+	/// @return Total number of bytes of the operation.
+	Solace::uint64 length() const noexcept { return _length; }
+
+	/// @return Maximum number of bytes transferred by a single message.
+	size_type chunkSize() const noexcept { return _chunkSize; }
+
+	/// @return Number of chunk messages required to transfer the whole length.
+	Solace::uint32 chunkCount() const noexcept { return _chunkCount; }
+
+	/// @return Number of chunk messages issued so far.
+	Solace::uint32 chunksSent() const noexcept { return _sent; }
+
+	/// @return Number of chunk messages that have been responded to.
+	Solace::uint32 chunksCompleted() const noexcept { return _completed; }
+
+	/// @return Number of chunk messages issued but not responded to yet.
+	Solace::uint32 inFlight() const noexcept { return _sent - _completed; }
+
+	/// @return True if no more chunk messages need to be issued.
+	bool allSent() const noexcept { return (_sent == _chunkCount) || isShort(); }
+
+	/// @return True if all the chunks issued have been responded to and no more chunks need to be issued.
+	bool done() const noexcept { return allSent() && (inFlight() == 0); }
+
+	/// @return True if a chunk transferred less than requested.
+	bool isShort() const noexcept { return (_shortChunk != kNoChunk); }
+
+	/**
+	 * Get number of bytes transferred contiguously from the start of the operation.
+	 * @return Number of bytes transferred. The value is final once the operation is done().
+	 */
+	Solace::uint64 bytesTransferred() const noexcept;
+
+	/**
+	 * Check if a tag belongs to a chunk issued by this operation.
+	 * @param tag Tag of a response message.
+	 * @return True if the tag is a tag of an issued chunk.
+	 */
+	bool owns(Tag tag) const noexcept {
+		return (tag >= _firstTag) && (static_cast<Solace::uint32>(tag - _firstTag) < _sent);
+	}
+
+	/**
+	 * Get the tag of a chunk message.
+	 * @param chunk Index of the chunk.
+	 * @return Tag of the chunk.
+	 */
+	Tag tagOf(Solace::uint32 chunk) const noexcept { return static_cast<Tag>(_firstTag + chunk); }
+
+	/**
+	 * Get offset in the file of a chunk.
+	 * @param chunk Index of the chunk.
+	 * @return Offset in the file of the first byte of the chunk.
+	 */
+	Solace::uint64 chunkOffset(Solace::uint32 chunk) const noexcept {
+		return _offset + static_cast<Solace::uint64>(chunk) * _chunkSize;
+	}
+
+	/**
+	 * Get number of bytes a chunk is to transfer.
+	 * @param chunk Index of the chunk.
+	 * @return Number of bytes of the chunk. Only the last chunk may be shorter than chunkSize().
+	 */
+	size_type chunkLength(Solace::uint32 chunk) const noexcept;
+
+	/**
+	 * Mark a chunk as failed, due to an RError response for example.
+	 * @param tag Tag of the failed chunk.
+	 * @return Error if the tag does not belong to an issued chunk, void otherwise.
+	 */
+	Solace::Result<void, Error> fail(Tag tag);
+
+protected:
+
+	/**
+	 * Record a response to a chunk.
+	 * @param tag Tag of the response.
+	 * @param transferred Number of bytes the response reports transferred.
+	 * @return Index of the chunk or an error if the tag is not of an issued chunk, the chunk has already been
+	 * responded to or more data has been transferred than requested.
+	 */
+	Solace::Result<Solace::uint32, Error> complete(Tag tag, size_type transferred);
+
+	/**
+	 * Get index of the next chunk to issue and account it as sent.
+	 * @return Index of the chunk issued.
+	 */
+	Solace::uint32 issue() noexcept { return _sent++; }
+
+	/// Roll back the last issue() if the message did not fit.
+	void unissue() noexcept { _sent -= 1; }
+
+private:
+	/// Chunk index value representing no chunk.
+	static constexpr Solace::uint32 kNoChunk = ~Solace::uint32{0};
+
+	/// Maximum number of chunks of an operation: one for each tag except for Parser::NO_TAG.
+	static constexpr Solace::uint32 kMaxChunks = std::numeric_limits<Tag>::max();
+
+	/// Fid of the file.
+	Fid					_fid;
+	/// Tag of the first chunk.
+	Tag					_firstTag;
+	/// Maximum size of a chunk.
+	size_type			_chunkSize;
+	/// File offset of the operation.
+	Solace::uint64		_offset;
+	/// Number of bytes of the operation.
+	Solace::uint64		_length;
+	/// Total number of chunks.
+	Solace::uint32		_chunkCount;
+	/// Number of chunks issued.
+	Solace::uint32		_sent{0};
+	/// Number of chunks responded to.
+	Solace::uint32		_completed{0};
+	/// Index of the first chunk that transferred less than requested.
+	Solace::uint32		_shortChunk{kNoChunk};
+	/// Number of bytes transferred by the first short chunk.
+	size_type			_shortLength{0};
+	/// Total number of bytes reported by all chunk responses.
+	Solace::uint64		_transferred{0};
+	/// Mask of chunks that have been responded to.
+	std::bitset<kMaxChunks>	_responded;
+};
+
+
+/**
+ * A large read split into a sequence of TRead messages, with data of the RRead responses reassembled
+ * into a single destination buffer.
+ *
+ * \code{.cpp}
+...
+	ChunkedRead read{fid, offset, wrapMemory(fileData), ioChunkSize(parser.maxNegotiatedMessageSize(), iounit), tag};
+	while (!read.done()) {
+		MessageBatch batch{buffer, parser.maxNegotiatedMessageSize()};
+		read.writeRequests(batch);
+		send(socket, batch.seal().viewRemaining());
+
+		// For each response received:
+		if (read.owns(header.tag)) {
+			read.onResponse(header.tag, readResponse);
+		}
+	}
+	auto const bytesRead = read.bytesTransferred();
+...
+ * \endcode
+ */
+struct ChunkedRead : public ChunkedIo {
+
+	/**
+	 * Construct a new chunked read.
+	 * @param fid Fid of the file open for reading.
+	 * @param offset Offset in the file to start reading from.
+	 * @param dest Buffer to read data into. Size of the buffer is the length of the read.
+	 * @param chunkSize Maximum number of bytes read by a single message, @see ioChunkSize().
+	 * @param firstTag Tag of the first TRead message.
+	 */
+	ChunkedRead(Fid fid, Solace::uint64 offset, Solace::MutableMemoryView dest, size_type chunkSize,
+				Tag firstTag) noexcept
+		: ChunkedIo{fid, offset, dest.size(), chunkSize, firstTag}
+		, _dest{dest}
+	{}
+
+	/**
+	 * Append TRead messages of chunks not yet issued to a batch, while they fit.
+	 * @param batch A batch of messages to append requests to.
+	 * @return Number of messages added to the batch.
+	 */
+	Solace::uint32 writeRequests(MessageBatch& batch);
+
+	/**
+	 * Accept RRead response to one of the chunks, copying its data into the destination buffer.
+	 * @param tag Tag of the response.
+	 * @param response Read response.
+	 * @return Error if the tag does not belong to an issued chunk or the response carries more data than requested.
+	 */
+	Solace::Result<void, Error> onResponse(Tag tag, Response::Read const& response);
+
+	/// @return Data read so far. Final once the read is done().
+	Solace::MemoryView data() const noexcept { return _dest.slice(0, bytesTransferred()); }
+
+private:
+	/// Buffer the data is read into.
+	Solace::MutableMemoryView	_dest;
+};
+
+
+/**
+ * A large write split into a sequence of TWrite messages, with byte counts of the RWrite responses accounted for.
+ *
+ * Data of a chunk can either be copied into a batch of messages, see writeRequests(),
+ * or left out of line, see writeNext(), to be sent with a scatter-gather write without a copy.
+ */
+struct ChunkedWrite : public ChunkedIo {
+
+	/**
+	 * Construct a new chunked write.
+	 * @param fid Fid of the file open for writing.
+	 * @param offset Offset in the file to start writing at.
+	 * @param data Data to write. Size of the data is the length of the write.
+	 * @param chunkSize Maximum number of bytes written by a single message, @see ioChunkSize().
+	 * @param firstTag Tag of the first TWrite message.
+	 */
+	ChunkedWrite(Fid fid, Solace::uint64 offset, Solace::MemoryView data, size_type chunkSize,
+				 Tag firstTag) noexcept
+		: ChunkedIo{fid, offset, data.size(), chunkSize, firstTag}
+		, _data{data}
+	{}
+
+	/**
+	 * Append TWrite messages of chunks not yet issued to a batch, while they fit.
+	 * Data of each chunk is copied into the message.
+	 * @param batch A batch of messages to append requests to.
+	 * @return Number of messages added to the batch.
+	 */
+	Solace::uint32 writeRequests(MessageBatch& batch);
+
+	/**
+	 * Write TWrite message of the next chunk, leaving the data out of line.
+	 * @param dest Buffer to write the message header into. The buffer is flipped, as by TypedWriter::build().
+	 * @return Segments of the message frame: encoded header and a view of the chunk data.
+	 * Both segments are empty if all the chunks have been issued.
+	 */
+	FrameSegments writeNext(Solace::ByteWriter& dest);
+
+	/**
+	 * Accept RWrite response to one of the chunks.
+	 * @param tag Tag of the response.
+	 * @param response Write response.
+	 * @return Error if the tag does not belong to an issued chunk or the response reports more bytes than requested.
+	 */
+	Solace::Result<void, Error> onResponse(Tag tag, Response::Write const& response) {
+		auto result = complete(tag, response.count);
+		if (!result) {
+			return result.getError();
+		}
+
+		return Solace::Result<void, Error>{Solace::types::okTag};
+	}
+
+private:
+	/// Data to be written.
+	Solace::MemoryView	_data;
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_CHUNKEDIO_HPP
@@ -0,0 +1,69 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_COMPRESSION_HPP
+#define STYXE_COMPRESSION_HPP
+
+#include "9p2000.hpp"
+
+
+namespace styxe {
+
+/// Flag of the data field size that marks the data as compressed, @see PayloadCompression.
+constexpr size_type kCompressedDataFlag = 0x80000000;
+
+/**
+ * Get maximum size of LZ4 compressed data of the given size, which is reached when data does not compress.
+ * @param size Size of the data to be compressed.
+ * @return Size of the buffer that is always enough to hold compressed data.
+ */
+constexpr Solace::MemoryView::size_type lz4CompressBound(Solace::MemoryView::size_type size) noexcept {
+	return size + size / 255 + 16;
+}
+
+/**
+ * Compress data using LZ4 block format.
+ * Compression is greedy and single pass, using a hash table on the stack, and never allocates memory.
+ * Compressed block is compatible with the reference LZ4 block decoders.
+ * @param src Data to compress.
+ * @param dest Buffer to write compressed data to.
+ * @return Size of the compressed data or 0 if compressed data does not fit into dest.
+ */
+Solace::MemoryView::size_type lz4Compress(Solace::MemoryView src, Solace::MutableMemoryView dest) noexcept;
+
+/**
+ * Decompress data of LZ4 block format.
+ * Input is not trusted: decompression never reads past the end of src or writes past the end of dest.
+ * @param src Compressed data block.
+ * @param dest Buffer to write decompressed data into.
+ * @return View of the decompressed data in dest or an error if the block is corrupted or does not fit into dest.
+ */
+Solace::Result<Solace::MemoryView, Error> lz4Decompress(Solace::MemoryView src, Solace::MutableMemoryView dest);
+
+/**
+ * Write compressed data field of a message at the current position of the stream.
+ * Data is compressed straight into the stream, without intermediate buffers. The field is written only if
+ * the compression is enabled by the policy, the data is not smaller than the policy threshold,
+ * and compressed field is smaller than the data field would have been without compression.
+ * @param dest Byte stream to write the field to.
+ * @param data Data to compress.
+ * @param compression Compression policy.
+ * @return Number of bytes written or 0 if nothing has been written and data should be written as is.
+ */
+size_type encodeCompressed(Solace::ByteWriter& dest, Solace::MemoryView data, CompressionPolicy compression);
+
+}  // end of namespace styxe
+#endif  // STYXE_COMPRESSION_HPP
@@ -102,6 +102,20 @@ Solace::Result<Decoder&, Error> operator>> (Decoder& decoder, Solace::MemoryView
  */
 Solace::Result<Decoder&, Error> operator>> (Decoder& decoder, WalkPath& dest);
 
+/** Decode and index a walk path from the stream.
+ * @param decoder A data stream to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if operation has failed or the path is longer than allowed.
+ */
+Solace::Result<Decoder&, Error> operator>> (Decoder& decoder, IndexedWalkPath& dest);
+
+/** Decode a view of qids list from the stream.
+ * @param decoder A data stream to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if operation has failed.
+ */
+Solace::Result<Decoder&, Error> operator>> (Decoder& decoder, QidList& dest);
+
 /** Decode a file Qid from the stream.
  * @param decoder A data stream to read a value from.
  * @param dest An address where to store decoded value.
@@ -131,5 +145,239 @@ operator>> (Solace::Result<Decoder&, Error>&& decoder, T& dest) {
 		: Solace::mv(decoder);
 }
 
+/**
+ * Decoder of a validated message frame.
+ *
+ * Protocol frames are validated by the Parser before decoding: once the frame payload is known to be
+ * available in the buffer, re-checking the bounds and building a Result for every fixed size field is wasted work.
+ * This decoder is constructed over the remaining data of a byte stream, that is the payload of the frame being decoded.
+ * Fixed size fields are read without bounds checks. It is a caller responsibility to ensure that the frame
+ * holds enough data to read fixed size fields, @see FixedSize, and a single check covers a run of fixed fields.
+ * Variable size fields, such as strings, data and paths, are always checked against the end of the frame.
+ *
+ * Data is consumed from the underlying byte stream only when decoding is complete, @see commit().
+ */
+struct UncheckedDecoder {
+
+	/** Construct a decoder of the frame payload.
+	 * @param src A byte stream positioned at the start of the frame payload. Stream limit is the end of the frame.
+	 */
+	explicit UncheckedDecoder(Solace::ByteReader& src) noexcept
+		: _src{src}
+		, _frame{src.viewRemaining()}
+	{}
+
+	UncheckedDecoder(UncheckedDecoder const&) = delete;
+	UncheckedDecoder& operator= (UncheckedDecoder const&) = delete;
+
+	/// @return Number of bytes of the frame not yet decoded.
+	Solace::MemoryView::size_type remaining() const noexcept { return _frame.size() - _offset; }
+
+	/// @return Number of bytes of the frame decoded so far.
+	Solace::MemoryView::size_type consumed() const noexcept { return _offset; }
+
+	/// @return Pointer to the first byte of the frame not yet decoded.
+	Solace::byte const* cursor() const noexcept { return _frame.begin() + _offset; }
+
+	/**
+	 * Get a view of the next bytes of the frame without consuming them.
+	 * @return Memory view of the frame data not yet decoded.
+	 */
+	Solace::MemoryView view() const noexcept { return _frame.slice(_offset, _frame.size()); }
+
+	/**
+	 * Consume bytes of the frame.
+	 * @param count Number of bytes to skip. Must not exceed the number of remaining bytes.
+	 */
+	void skip(Solace::MemoryView::size_type count) noexcept { _offset += count; }
+
+	/**
+	 * Advance underlying byte stream past all the data decoded.
+	 * @return Void or an error if the stream can not be advanced.
+	 */
+	Solace::Result<void, Error> commit() { return _src.advance(_offset); }
+
+private:
+	/// Data stream the frame is read from.
+	Solace::ByteReader&				_src;
+	/// Frame payload.
+	Solace::MemoryView				_frame;
+	/// Number of bytes of the frame decoded.
+	Solace::MemoryView::size_type	_offset{0};
+};
+
+
+/**
+ * A marker to check that the frame holds enough data to read following fixed size fields.
+ * \code{.cpp}
+	decoder >> FixedSize{sizeof(fid) + sizeof(offset)}
+			>> fid
+			>> offset
+			>> data;
+ * \endcode
+ */
+struct FixedSize {
+	Solace::MemoryView::size_type size;  //!< Number of bytes fixed size fields occupy.
+};
+
+
+/** Check that a frame holds enough data for the fixed size fields that follow.
+ * @param decoder A frame decoder.
+ * @param fixed Number of bytes required.
+ * @return Ref to the decoder or Error if there is not enough data.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, FixedSize fixed);
+
+/** Decode uint8 value from the frame without bounds check.
+ * @param decoder A frame to read a value from.
+ * @param dest  An address where to store decoded value.
+ * @return Ref to the decoder.
+ */
+UncheckedDecoder& operator>> (UncheckedDecoder& decoder, Solace::uint8& dest) noexcept;
+
+/** Decode uint16 value from the frame without bounds check.
+ * @param decoder A frame to read a value from.
+ * @param dest  An address where to store decoded value.
+ * @return Ref to the decoder.
+ */
+UncheckedDecoder& operator>> (UncheckedDecoder& decoder, Solace::uint16& dest) noexcept;
+
+/** Decode uint32 value from the frame without bounds check.
+ * @param decoder A frame to read a value from.
+ * @param dest  An address where to store decoded value.
+ * @return Ref to the decoder.
+ */
+UncheckedDecoder& operator>> (UncheckedDecoder& decoder, Solace::uint32& dest) noexcept;
+
+/** Decode uint64 value from the frame without bounds check.
+ * @param decoder A frame to read a value from.
+ * @param dest  An address where to store decoded value.
+ * @return Ref to the decoder.
+ */
+UncheckedDecoder& operator>> (UncheckedDecoder& decoder, Solace::uint64& dest) noexcept;
+
+/** Decode a file Qid from the frame without bounds check.
+ * @param decoder A frame to read a value from.
+ * @param dest  An address where to store decoded value.
+ * @return Ref to the decoder.
+ */
+UncheckedDecoder& operator>> (UncheckedDecoder& decoder, Qid& dest) noexcept;
+
+/** Decode a string value from the frame.
+ * @param decoder A frame to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if the string exceeds the frame.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, Solace::StringView& dest);
+
+/** Decode a raw byte view from the frame.
+ * @param decoder A frame to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if the data exceeds the frame.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, Solace::MemoryView& dest);
+
+/** Decode a path view from the frame.
+ * @param decoder A frame to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if the path exceeds the frame.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, WalkPath& dest);
+
+/** Decode and index a walk path from the frame.
+ * @param decoder A frame to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if the path exceeds the frame or is longer than allowed.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, IndexedWalkPath& dest);
+
+/** Decode a view of qids list from the frame.
+ * @param decoder A frame to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if the list exceeds the frame.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, QidList& dest);
+
+/** Decode a Stat struct from the frame.
+ * @param decoder A frame to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if the stat exceeds the frame.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, Stat& dest);
+
+/**
+ * A data field that may be compressed, @see PayloadCompression.
+ * Compressed data is decompressed into the buffer, otherwise the data is a view into the frame.
+ */
+struct CompressedData {
+	Solace::MemoryView&			data;       //!< Decoded data.
+	Solace::MutableMemoryView	buffer;     //!< Buffer to decompress data into.
+};
+
+/** Decode a data field that may be compressed from the frame.
+ * @param decoder A frame to read a value from.
+ * @param dest Destination of decoded data.
+ * @return Ref to the decoder or Error if the data exceeds the frame or can not be decompressed into the buffer.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, CompressedData dest);
+
+/** Decode an entry of a batched short read/write request from the frame.
+ * @param decoder A frame to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if the entry exceeds the frame or its operation is not supported.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, ShortBatchEntry& dest);
+
+/** Decode an entry of a batched short read/write response from the frame.
+ * @param decoder A frame to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if the entry exceeds the frame or its status is not supported.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, ShortBatchResult& dest);
+
+/** Decode and validate a view of batched short read/write request entries from the frame.
+ * @param decoder A frame to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if any of the entries is ill-formed.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, ShortBatchEntries& dest);
+
+/** Decode and validate a view of batched short read/write response entries from the frame.
+ * @param decoder A frame to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if any of the entries is ill-formed.
+ */
+Solace::Result<UncheckedDecoder&, Error> operator>> (UncheckedDecoder& decoder, ShortBatchResults& dest);
+
+
+/// Lift the result of an unchecked field decoding into a Result.
+inline
+Solace::Result<UncheckedDecoder&, Error> liftDecoded(UncheckedDecoder& decoder) noexcept {
+	return Solace::Result<UncheckedDecoder&, Error>{Solace::types::okTag, decoder};
+}
+
+/// Lift the result of a checked field decoding into a Result.
+inline
+Solace::Result<UncheckedDecoder&, Error> liftDecoded(Solace::Result<UncheckedDecoder&, Error>&& result) noexcept {
+	return Solace::mv(result);
+}
+
+/**
+ * An interop for Result<UncheckedDecoder&, Error>.
+ * @param decoder A frame to read a value from.
+ * @param dest An address where to store decoded value.
+ * @return Ref to the decoder or Error if operation has failed.
+ */
+template<typename T>
+Solace::Result<UncheckedDecoder&, Error>
+operator>> (Solace::Result<UncheckedDecoder&, Error>&& decoder, T&& dest) {
+	if (!decoder) {
+		return Solace::mv(decoder);
+	}
+
+	return liftDecoded(decoder.unwrap() >> Solace::fwd<T>(dest));
+}
+
+
 }  // namespace styxe
 #endif  // STYXE_DECODER_HPP
@@ -0,0 +1,167 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_DIRLISTINGREADER_HPP
+#define STYXE_DIRLISTINGREADER_HPP
+
+#include "9p2000.hpp"
+
+
+namespace styxe {
+
+/**
+ * A view of an encoded Stat structure.
+ * Fields are decoded only when requested. Fixed size fields are read directly at their offset
+ * while variable size string fields are located by skipping over the preceding strings.
+ *
+ * @note Stat view does not own the data it refers to.
+ */
+struct StatView {
+
+	/** Minimal number of bytes an encoded Stat structure can occupy: all fixed fields and empty strings. */
+	static const Solace::uint16 kMinEncodedSize;
+
+	StatView() noexcept = default;
+
+	/**
+	 * Construct a view of the encoded Stat struct.
+	 * @param data Bytes of the encoded Stat, including the size prefix.
+	 */
+	explicit StatView(Solace::MemoryView data) noexcept
+		: _data{data}
+	{}
+
+	/** Get the raw data of the encoded Stat.
+	 * @return Memory view of the encoded data, including the size prefix.
+	 */
+	Solace::MemoryView data() const noexcept { return _data; }
+
+	/// @return Total byte count of the following data.
+	Solace::uint16      size() const noexcept;
+	/// @return Server type.
+	Solace::uint16      type() const noexcept;
+	/// @return Server subtype.
+	Solace::uint32      dev() const noexcept;
+	/// @return Unique id from server.
+	Qid                 qid() const noexcept;
+	/// @return Permissions and flags.
+	Solace::uint32      mode() const noexcept;
+	/// @return Last read time.
+	Solace::uint32      atime() const noexcept;
+	/// @return Last write time.
+	Solace::uint32      mtime() const noexcept;
+	/// @return Length of the file in bytes.
+	Solace::uint64      length() const noexcept;
+	/// @return File name.
+	Solace::StringView  name() const noexcept;
+	/// @return Owner name.
+	Solace::StringView  uid() const noexcept;
+	/// @return Group name.
+	Solace::StringView  gid() const noexcept;
+	/// @return Name of the user who last modified the file.
+	Solace::StringView  muid() const noexcept;
+
+	/**
+	 * Decode all the fields of the stat.
+	 * @return Decoded Stat struct.
+	 */
+	Stat decode() const noexcept;
+
+private:
+	/**
+	 * Find a string field by its index.
+	 * @param index Index of the string field, where 0 is the name.
+	 * @return View of the string or an empty view if ill-formed data is encountered.
+	 */
+	Solace::StringView stringField(unsigned index) const noexcept;
+
+private:
+	/// Encoded data of the stat.
+	Solace::MemoryView	_data;
+};
+
+
+/**
+ * A reader of the directory listing as returned by the server in the RRead response to a directory read.
+ * Data of the response is a sequence of encoded Stat structs. Reader iterates over the entries
+ * using the size prefix of each entry, without decoding any of its fields.
+ *
+ * \code{.cpp}
+...
+	for (auto entry : DirListingReader{readResponse.data}) {
+		std::cout << entry.name() << std::endl;
+	}
+...
+ * \endcode
+ *
+ * @note Iteration stops at the first ill-formed entry. @see validate() to check that the data is well-formed.
+ */
+struct DirListingReader {
+
+	/** Forward iterator over directory entries. */
+	struct Iterator {
+		/**
+		 * Construct an iterator.
+		 * @param data Data of the rest of the directory listing.
+		 */
+		explicit Iterator(Solace::MemoryView data) noexcept;
+
+		/// @return View of the current entry.
+		StatView operator* () const noexcept;
+
+		/// Move to the next entry.
+		Iterator& operator++ () noexcept;
+
+		/// @return True if iterators refer the same position in the listing.
+		bool operator== (Iterator const& rhs) const noexcept {
+			return _data.size() == rhs._data.size();
+		}
+
+		/// @return True if iterators refer different positions in the listing.
+		bool operator!= (Iterator const& rhs) const noexcept { return !(*this == rhs); }
+
+	private:
+		/// Directory listing data starting with the current entry.
+		Solace::MemoryView	_data;
+	};
+
+	/**
+	 * Construct a reader of directory listing.
+	 * @param data Data of the RRead response to a directory read.
+	 */
+	explicit DirListingReader(Solace::MemoryView data) noexcept
+		: _data{data}
+	{}
+
+	/// @return Iterator to the first directory entry.
+	Iterator begin() const noexcept { return Iterator{_data}; }
+
+	/// @return Iterator past the last directory entry.
+	Iterator end() const noexcept { return Iterator{Solace::MemoryView{}}; }
+
+	/**
+	 * Check that the listing data is a sequence of complete entries.
+	 * @return Void if data is well-formed or an error otherwise.
+	 */
+	Solace::Result<void, Error> validate() const;
+
+private:
+	/// Directory listing data.
+	Solace::MemoryView	_data;
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_DIRLISTINGREADER_HPP
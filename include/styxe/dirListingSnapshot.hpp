@@ -0,0 +1,135 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_DIRLISTINGSNAPSHOT_HPP
+#define STYXE_DIRLISTINGSNAPSHOT_HPP
+
+#include "9p2000.hpp"
+#include "dirListingReader.hpp"  // StatView
+
+
+namespace styxe {
+
+/**
+ * A directory listing encoded once and served to any number of directory reads.
+ * Entries are stored in wire format back to back, as they appear in RRead data, together with an index of
+ * end offsets of the entries. A directory read is then a binary search of the index for the requested offset
+ * and a view of the entries that fit into the requested count: no stat is re-encoded.
+ *
+ * Snapshot does not allocate memory: storage for the encoded entries and the index is provided by the caller.
+ *
+ * \code{.cpp}
+...
+	DirListingSnapshot snapshot{wrapMemory(dirState.data), arrayView(dirState.index)};
+	for (auto const& dirEntry : entries) {
+		snapshot.add(mapEntryStats(dirEntry));
+	}
+...
+	// Copy the entries into the response
+	ResponseWriter{dest, tag}
+		.read(snapshot.read(request.offset, request.count))
+		.build();
+
+	// Or refer to the snapshot data without a copy
+	auto segments = ResponseWriter{dest, tag}
+		.read()
+		.build(snapshot.read(request.offset, request.count));
+...
+ * \endcode
+ *
+ * @note Data of the snapshot must not change while any view returned by read() is in use.
+ */
+struct DirListingSnapshot {
+	/// Type used to count entries of the snapshot.
+	using size_type = Solace::uint32;
+
+	/**
+	 * Construct an empty snapshot.
+	 * @param storage Memory to store encoded entries in.
+	 * @param index Memory to store the index of entries. Size of the index is the maximum number of entries.
+	 */
+	DirListingSnapshot(Solace::MutableMemoryView storage, Solace::ArrayView<Solace::uint32> index) noexcept
+		: _storage{storage}
+		, _index{index}
+	{}
+
+	/**
+	 * Encode and add an entry to the snapshot.
+	 * @param stat Directory entry stat.
+	 * @return True if the entry has been added, false if the storage or the index is exhausted.
+	 */
+	bool add(Stat const& stat);
+
+	/**
+	 * Add an already encoded entry to the snapshot.
+	 * @param entry Encoded directory entry stat.
+	 * @return True if the entry has been added, false if the storage or the index is exhausted.
+	 */
+	bool add(StatView entry) noexcept;
+
+	/// Remove all the entries from the snapshot.
+	void clear() noexcept { _size = 0; }
+
+	/// @return Number of entries in the snapshot.
+	size_type size() const noexcept { return _size; }
+
+	/// @return True if the snapshot has no entries.
+	bool empty() const noexcept { return (_size == 0); }
+
+	/// @return Maximum number of entries the snapshot can hold.
+	size_type capacity() const noexcept { return _index.size(); }
+
+	/// @return Encoded data of all the entries.
+	Solace::MemoryView data() const noexcept { return _storage.slice(0, endOf(_size)); }
+
+	/**
+	 * Get an entry by index.
+	 * @param index Index of the entry.
+	 * @return View of the encoded entry.
+	 */
+	StatView operator[] (size_type index) const noexcept {
+		return StatView{_storage.slice(endOf(index), endOf(index + 1))};
+	}
+
+	/**
+	 * Get a directory read response data.
+	 * Semantic of offset and count matches DirListingWriter: listing starts with the entry that ends past the
+	 * offset and includes as many whole entries as fit within count bytes.
+	 * @param offset Offset in the directory listing to read from.
+	 * @param count Maximum number of bytes to read.
+	 * @return View of the encoded entries. View is empty if offset is past the end of the listing or
+	 * the first entry does not fit into count.
+	 */
+	Solace::MemoryView read(Solace::uint64 offset, Solace::uint32 count) const noexcept;
+
+private:
+	/// Get offset of the end of the first n entries.
+	Solace::uint32 endOf(size_type n) const noexcept { return (n == 0) ? 0 : _index[n - 1]; }
+
+	/// Record an entry of the given size that has been written past the end of data.
+	bool commit(Solace::MemoryView::size_type entrySize) noexcept;
+
+private:
+	/// Memory to store encoded entries.
+	Solace::MutableMemoryView			_storage;
+	/// End offsets of the entries.
+	Solace::ArrayView<Solace::uint32>	_index;
+	/// Number of entries in the snapshot.
+	size_type							_size{0};
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_DIRLISTINGSNAPSHOT_HPP
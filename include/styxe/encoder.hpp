@@ -19,6 +19,7 @@
 
 
 #include <styxe/9p2000.hpp>
+#include <styxe/messageLayout.hpp>  // WireField
 
 
 namespace styxe {
@@ -155,6 +156,15 @@ Encoder& operator<< (Encoder& encoder, Solace::StringView value);
  */
 Encoder& operator<< (Encoder& encoder, Solace::MemoryView value);
 
+/** Write a raw byte buffer into the output stream, without size prefix.
+ * @param encoder Encoder used to encode the value.
+ * @param value Bytes to write.
+ */
+inline
+void storeBytes(Encoder& encoder, Solace::MemoryView value) {
+	encoder.buffer().write(value);
+}
+
 /** Encode a file Qid into the output stream.
  * @param encoder Encoder used to encode the value.
  * @param value Value to encode.
@@ -238,5 +248,184 @@ operator<< (Solace::Result<Encoder&, Error>&& encoder, T value) {
 }
 
 
+
+/**
+ * Encoder writing into a region of the output stream reserved up front.
+ *
+ * Writers compute the size of a message before encoding it. Once a region of that size is reserved,
+ * there is no need to check the capacity of the stream for every field: fields are written with plain stores.
+ * It is the caller's responsibility to reserve enough space for all the fields encoded.
+ * @see encodeMessage
+ */
+struct UncheckedEncoder {
+
+	/** Construct an encoder writing into a reserved memory region.
+	 * @param region Writable memory region, large enough for all the data to be encoded.
+	 */
+	explicit UncheckedEncoder(Solace::MutableMemoryView region) noexcept
+		: _region{region}
+	{}
+
+	UncheckedEncoder(UncheckedEncoder const&) = delete;
+	UncheckedEncoder& operator= (UncheckedEncoder const&) = delete;
+
+	/// @return Pointer to the first byte of the region not yet written.
+	Solace::byte* cursor() const noexcept { return _region.begin() + _offset; }
+
+	/// @return Number of bytes written so far.
+	Solace::MutableMemoryView::size_type size() const noexcept { return _offset; }
+
+	/**
+	 * Mark bytes of the region as written.
+	 * @param count Number of bytes written at the cursor.
+	 */
+	void skip(Solace::MutableMemoryView::size_type count) noexcept { _offset += count; }
+
+private:
+	/// Reserved memory region.
+	Solace::MutableMemoryView				_region;
+	/// Number of bytes written into the region.
+	Solace::MutableMemoryView::size_type	_offset{0};
+};
+
+
+/** Store a fixed size value into the reserved region.
+ * @param encoder Encoder used to encode the value.
+ * @param value Value to encode.
+ * @return Ref to the encoder for fluency.
+ */
+template<typename T>
+std::enable_if_t<std::is_integral<T>::value || std::is_same<T, Qid>::value || std::is_same<T, MessageType>::value,
+UncheckedEncoder&>
+operator<< (UncheckedEncoder& encoder, T value) noexcept {
+	WireField<T>::store(encoder.cursor(), value);
+	encoder.skip(WireField<T>::kSize);
+
+	return encoder;
+}
+
+/** Store a raw byte buffer into the reserved region, without size prefix.
+ * @param encoder Encoder used to encode the value.
+ * @param value Bytes to copy.
+ */
+inline
+void storeBytes(UncheckedEncoder& encoder, Solace::MemoryView value) noexcept {
+	if (!value.empty()) {
+		std::memcpy(encoder.cursor(), value.begin(), value.size());
+		encoder.skip(value.size());
+	}
+}
+
+/** Encode a string value into the reserved region.
+ * @param encoder Encoder used to encode the value.
+ * @param value Value to encode.
+ * @return Ref to the encoder for fluency.
+ */
+inline
+UncheckedEncoder& operator<< (UncheckedEncoder& encoder, Solace::StringView value) noexcept {
+	encoder << Solace::narrow_cast<var_datum_size_type>(value.size());
+	storeBytes(encoder, value.view());
+
+	return encoder;
+}
+
+/** Encode a raw byte buffer into the reserved region.
+ * @param encoder Encoder used to encode the value.
+ * @param value Value to encode.
+ * @return Ref to the encoder for fluency.
+ */
+inline
+UncheckedEncoder& operator<< (UncheckedEncoder& encoder, Solace::MemoryView value) noexcept {
+	encoder << Solace::narrow_cast<size_type>(value.size());
+	storeBytes(encoder, value);
+
+	return encoder;
+}
+
+/** Encode a message header into the reserved region.
+ * @param encoder Encoder used to encode the value.
+ * @param value Value to encode.
+ * @return Ref to the encoder for fluency.
+ */
+inline
+UncheckedEncoder& operator<< (UncheckedEncoder& encoder, MessageHeader value) noexcept {
+	return encoder << value.messageSize
+				   << value.type
+				   << value.tag;
+}
+
+/** Encode a file stats into the reserved region.
+ * @param encoder Encoder used to encode the value.
+ * @param value Value to encode.
+ * @return Ref to the encoder for fluency.
+ */
+inline
+UncheckedEncoder& operator<< (UncheckedEncoder& encoder, Stat const& value) noexcept {
+	return encoder << value.size
+				   << value.type
+				   << value.dev
+				   << value.qid
+				   << value.mode
+				   << value.atime
+				   << value.mtime
+				   << value.length
+				   << value.name
+				   << value.uid
+				   << value.gid
+				   << value.muid;
+}
+
+/** Encode a list of qids into the reserved region.
+ * @param encoder Encoder used to encode the value.
+ * @param value Value to encode.
+ * @return Ref to the encoder for fluency.
+ */
+inline
+UncheckedEncoder& operator<< (UncheckedEncoder& encoder, Solace::ArrayView<Qid> value) noexcept {
+	encoder << Solace::narrow_cast<var_datum_size_type>(value.size());
+	for (auto const& qid : value) {
+		encoder << qid;
+	}
+
+	return encoder;
+}
+
+
+/**
+ * Encode a message which size is known up front.
+ * Space for the message is reserved once and all the fields are written without capacity checks.
+ * If the stream does not have enough capacity left, encoding falls back to the checked Encoder.
+ *
+ * \code{.cpp}
+	encodeMessage(buffer, header, headerSize() + payloadSize, [&](auto& encoder) {
+		encoder << fid
+				<< name;
+	});
+ * \endcode
+ *
+ * @param dest Output stream to write the message to.
+ * @param header Header of the message.
+ * @param encodedSize Number of bytes the header and fields occupy.
+ * @param fields A generic callable encoding message fields with the encoder passed as an argument.
+ */
+template<typename Fields>
+void encodeMessage(Solace::ByteWriter& dest, MessageHeader const& header,
+				   Solace::ByteWriter::size_type encodedSize, Fields&& fields) {
+	auto region = dest.viewRemaining();
+	if (region.size() < encodedSize) {
+		Encoder encoder{dest};
+		encoder << header;
+		fields(encoder);
+
+		return;
+	}
+
+	UncheckedEncoder encoder{region.slice(0, encodedSize)};
+	encoder << header;
+	fields(encoder);
+	dest.advance(encoder.size());
+}
+
+
 }  // namespace styxe
 #endif  // STYXE_ENCODER_HPP
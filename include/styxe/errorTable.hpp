@@ -0,0 +1,150 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_ERRORTABLE_HPP
+#define STYXE_ERRORTABLE_HPP
+
+#include "9p2000.hpp"
+#include "encoder.hpp"
+
+
+namespace styxe {
+
+/**
+ * A pre-encoded RError message.
+ * Frame is encoded with Parser::NO_TAG and is copied into a response as is, with only the tag replaced.
+ * @see ResponseWriter::error(EncodedError const&)
+ */
+struct EncodedError {
+	/// Complete RError frame, including the message header.
+	Solace::MemoryView	frame;
+
+	/// @return True if no error frame is referred to.
+	bool empty() const noexcept { return frame.empty(); }
+
+	/// @return Error message encoded in the frame.
+	Solace::StringView message() const noexcept {
+		auto const prefixSize = headerSize() + sizeof(var_datum_size_type);
+		return (frame.size() < prefixSize)
+				? Solace::StringView{}
+				: Solace::StringView{frame.dataAs<char const>() + prefixSize,
+									 static_cast<Solace::StringView::size_type>(frame.size() - prefixSize)};
+	}
+};
+
+
+/**
+ * Get pre-encoded RError for a canned protocol error.
+ * Frames of all the canned errors are encoded once, on the first use.
+ * @param errorId Id of the canned error.
+ * @return Pre-encoded error response with the canned error message.
+ */
+EncodedError getEncodedCannedError(CannedError errorId) noexcept;
+
+
+/**
+ * A table of error messages interned by error code, such as errno values, and pre-encoded as RError frames.
+ * A server can respond with an error from the table without formatting or allocating a message string:
+ *
+ * \code{.cpp}
+...
+	ErrorTable<256> errors;
+	errors.add(ENOENT, "No such file or directory");
+	errors.add(EACCES, "Permission denied");
+...
+	ResponseWriter{dest, tag}
+		.error(errors.find(ENOENT))
+		.build();
+...
+ * \endcode
+ *
+ * Table never allocates memory: both the index and encoded frames are stored inline.
+ *
+ * @tparam Capacity Number of error codes the table can hold: codes are in the range [0, Capacity).
+ * @tparam StorageSize Number of bytes available to store encoded frames.
+ */
+template<Solace::uint32 Capacity, Solace::uint32 StorageSize = Capacity * 64>
+struct ErrorTable {
+
+	/**
+	 * Intern an error message.
+	 * @param code Error code to register the message for.
+	 * @param message Error message.
+	 * @return True if the message has been added, false if the code is out of range or already registered,
+	 * or the table has no space left to store the message.
+	 */
+	bool add(Solace::uint32 code, Solace::StringView message) noexcept {
+		if (code >= Capacity || _sizes[code] != 0) {
+			return false;
+		}
+
+		auto const payloadSize = Encoder::protocolSize(message);
+		auto const frameSize = headerSize() + payloadSize;
+		if (frameSize > StorageSize - _used) {
+			return false;
+		}
+
+		UncheckedEncoder encoder{Solace::wrapMemory(_storage + _used, frameSize)};
+		encoder << makeHeaderWithPayload(MessageType::RError, Parser::NO_TAG, payloadSize)
+				<< message;
+
+		_offsets[code] = _used;
+		_sizes[code] = frameSize;
+		_used += frameSize;
+		_size += 1;
+
+		return true;
+	}
+
+	/**
+	 * Find an interned error.
+	 * @param code Error code to look up.
+	 * @return Pre-encoded error or an empty one if no message is registered for the code.
+	 */
+	EncodedError find(Solace::uint32 code) const noexcept {
+		return (code < Capacity && _sizes[code] != 0)
+				? EncodedError{Solace::wrapMemory(_storage + _offsets[code], _sizes[code])}
+				: EncodedError{};
+	}
+
+	/**
+	 * Check if a message is registered for the error code.
+	 * @param code Error code to check.
+	 * @return True if the code has a message.
+	 */
+	bool contains(Solace::uint32 code) const noexcept { return (code < Capacity && _sizes[code] != 0); }
+
+	/// @return Number of registered error codes.
+	Solace::uint32 size() const noexcept { return _size; }
+
+	/// @return Number of bytes left to store more messages.
+	Solace::uint32 remaining() const noexcept { return StorageSize - _used; }
+
+private:
+	/// Offsets of the encoded frames by the error code.
+	Solace::uint32	_offsets[Capacity] = {};
+	/// Sizes of the encoded frames by the error code, 0 for codes with no message.
+	Solace::uint32	_sizes[Capacity] = {};
+	/// Number of bytes of storage used.
+	Solace::uint32	_used{0};
+	/// Number of registered codes.
+	Solace::uint32	_size{0};
+	/// Encoded frames.
+	Solace::byte	_storage[StorageSize];
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_ERRORTABLE_HPP
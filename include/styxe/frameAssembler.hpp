@@ -0,0 +1,133 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_FRAMEASSEMBLER_HPP
+#define STYXE_FRAMEASSEMBLER_HPP
+
+#include "9p2000.hpp"
+
+
+namespace styxe {
+
+/**
+ * A helper class to re-assemble 9P message frames from a stream of arbitrary sized chunks of data.
+ *
+ * Parser can only decode a message when given a complete frame. Data read from a socket, however,
+ * may contain only a part of the frame or several frames at once. Frame assembler keeps track of the frame boundaries
+ * and calls a user provided handler for each complete frame found in the stream.
+ *
+ * Frames that are contained in the chunk completely are handed to the handler as views into the chunk itself.
+ * Only a trailing incomplete frame is copied into the staging buffer, provided by the user,
+ * to be completed by the next chunk.
+ *
+ * \code{.cpp}
+...
+	FrameAssembler assembler{parser, wrapMemory(stagingBuffer)};
+	...
+	assembler.feed(socketData, [&](MessageHeader const& header, ByteReader& payload) {
+		parser.parseRequest(header, payload)
+			.then(handleRequest);
+	});
+...
+ * \endcode
+ *
+ * @note The staging buffer must be large enough to hold a complete frame, thus it should be at least
+ * Parser::maxPossibleMessageSize() bytes.
+ * @note Views given to the handler are only valid until the handler returns.
+ */
+struct FrameAssembler {
+
+	/**
+	 * Construct a new frame assembler.
+	 * @param parser Protocol parser used to parse and validate message headers.
+	 * @param stagingBuffer Storage to accumulate incomplete frames in.
+	 */
+	FrameAssembler(Parser const& parser, Solace::MutableMemoryView stagingBuffer) noexcept
+		: _parser{parser}
+		, _staging{stagingBuffer}
+	{}
+
+	FrameAssembler(FrameAssembler const&) = delete;
+	FrameAssembler& operator= (FrameAssembler const&) = delete;
+
+	/**
+	 * Feed next chunk of data from the stream into the assembler.
+	 * @param chunk A chunk of data received from the stream.
+	 * @param handler A callable with a signature `void (MessageHeader const&, Solace::ByteReader&)`
+	 * to be called for each frame completed by the chunk.
+	 * @return Error if ill-formed message header has been encountered, void otherwise.
+	 * Once an error is returned the stream is out of sync and all the data buffered so far is discarded.
+	 */
+	template<typename Handler>
+	Solace::Result<void, Error>
+	feed(Solace::MemoryView chunk, Handler&& handler) {
+		Solace::ByteReader reader{chunk};
+		MessageHeader header;
+		Solace::MemoryView payload;
+
+		while (true) {
+			auto maybeFrame = nextFrame(reader, header, payload);
+			if (!maybeFrame) {
+				return maybeFrame.getError();
+			}
+
+			if (!maybeFrame.unwrap()) {
+				break;
+			}
+
+			Solace::ByteReader payloadReader{payload};
+			handler(header, payloadReader);
+		}
+
+		return Solace::Result<void, Error>{Solace::types::okTag};
+	}
+
+	/**
+	 * Get number of bytes of incomplete frame kept in the staging buffer.
+	 * @return Number of bytes buffered.
+	 */
+	Solace::ByteWriter::size_type bytesPending() const noexcept { return _staging.position(); }
+
+	/**
+	 * Discard any buffered data of incomplete frame.
+	 */
+	void reset() noexcept;
+
+protected:
+
+	/**
+	 * Extract next complete frame from the stream.
+	 * @param chunk A chunk of data received from the stream.
+	 * @param header Header of the extracted frame.
+	 * @param payload View of the message payload of the extracted frame.
+	 * @return True if a complete frame has been extracted, false if more data is required or an error.
+	 */
+	Solace::Result<bool, Error>
+	nextFrame(Solace::ByteReader& chunk, MessageHeader& header, Solace::MemoryView& payload);
+
+private:
+	/// Parser used to validate message headers.
+	Parser const&			_parser;
+
+	/// Staging buffer for the incomplete frame.
+	Solace::ByteWriter		_staging;
+
+	/// Header of the frame being assembled in the staging buffer.
+	MessageHeader			_stagedHeader{};
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_FRAMEASSEMBLER_HPP
@@ -0,0 +1,537 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_IOSCHEDULER_HPP
+#define STYXE_IOSCHEDULER_HPP
+
+#include "9p2000.hpp"
+#include "messageBatch.hpp"
+#include "responseWriter.hpp"
+
+#include <algorithm>  // std::min
+#include <cstring>  // std::memcpy
+
+
+namespace styxe {
+
+/**
+ * A backend I/O operation made of one or more coalesced read or write requests to the same fid
+ * with contiguous offsets.
+ */
+struct CoalescedIo {
+	MessageType		type{MessageType::TRead};	//!< Type of the requests: TRead or TWrite.
+	Fid				fid{0};						//!< Fid of the file.
+	Solace::uint64	offset{0};					//!< Offset of the first byte of the operation.
+	size_type		count{0};					//!< Total number of bytes to read or write.
+	Solace::uint32	requests{0};				//!< Number of requests not yet responded to.
+	Solace::uint32	first{0};					//!< Internal: first request not yet responded to.
+};
+
+
+/**
+ * Server side scheduler of read and write requests.
+ *
+ * Decoded TRead and TWrite requests are queued per fid in order of arrival. Backend I/O operations are taken
+ * round-robin across fids, merging queued requests of the same type with contiguous offsets into
+ * a single CoalescedIo, up to a maximum I/O size. Once the backend operation completes, respond() splits
+ * its result back into an RRead or RWrite response per request tag.
+ * A request still queued can be cancelled in O(1) when a TFlush for its tag arrives.
+ *
+ * \code{.cpp}
+...
+	// For each decoded request:
+	scheduler.enqueue(header.tag, readRequest);
+
+	CoalescedIo io;
+	while (scheduler.next(io)) {
+		auto const data = backend.read(io.fid, io.offset, io.count);
+		MessageBatch batch{outBuffer, parser.maxNegotiatedMessageSize()};
+		scheduler.respond(io, data, batch);
+	}
+...
+ * \endcode
+ *
+ * @tparam Capacity Maximum number of requests kept by the scheduler.
+ * @note Data of queued write requests is referenced, not copied: it must stay valid until the request is responded to.
+ * @note Scheduler is not synchronized and is meant to be owned by a single I/O thread.
+ */
+template<Solace::uint32 Capacity>
+struct IoScheduler {
+	static_assert(Capacity > 0 && Capacity < 0x7FFFFFFF, "Capacity out of range");
+
+	/**
+	 * Construct a new scheduler.
+	 * @param maxIoSize Maximum number of bytes a coalesced operation may transfer.
+	 * Requests larger than that are never merged but are still scheduled.
+	 */
+	explicit IoScheduler(size_type maxIoSize) noexcept
+		: _maxIoSize{maxIoSize}
+	{
+		for (Solace::uint32 i = 0; i < Capacity; ++i) {
+			_requests[i].next = i + 1;
+			_queues[i].next = i + 1;
+		}
+	}
+
+	IoScheduler(IoScheduler const&) = delete;
+	IoScheduler& operator= (IoScheduler const&) = delete;
+
+	/**
+	 * Queue a read request.
+	 * @param tag Tag of the request.
+	 * @param request Decoded read request.
+	 * @return False if the scheduler is full or a request with the same tag is already scheduled.
+	 */
+	bool enqueue(Tag tag, Request::Read const& request) noexcept {
+		return enqueue(tag, MessageType::TRead, request.fid, request.offset, request.count, Solace::MemoryView{});
+	}
+
+	/**
+	 * Queue a write request.
+	 * @param tag Tag of the request.
+	 * @param request Decoded write request. Data is not copied.
+	 * @return False if the scheduler is full or a request with the same tag is already scheduled.
+	 */
+	bool enqueue(Tag tag, Request::Write const& request) noexcept {
+		return enqueue(tag, MessageType::TWrite, request.fid, request.offset,
+					   static_cast<size_type>(request.data.size()), request.data);
+	}
+
+	/**
+	 * Cancel a queued request, as a result of TFlush.
+	 * @param tag Tag of the request to cancel, Request::Flush::oldtag.
+	 * @return True if the request was queued and is removed: no response must be sent for it.
+	 * False if no such request is queued or it is being served by the backend already,
+	 * in which case RFlush should follow its response.
+	 */
+	bool cancel(Tag tag) noexcept {
+		auto const index = _byTag.find(tag);
+		if (index == kNone || _requests[index].queue == kNone) {
+			return false;
+		}
+
+		auto const queueIndex = _requests[index].queue;
+		auto& queue = _queues[queueIndex];
+		unlink(_requests[index], queue);
+		if (queue.head == kNone) {
+			deactivate(queueIndex);
+		}
+
+		release(index);
+		return true;
+	}
+
+	/**
+	 * Take the next backend operation to perform.
+	 * @param io Operation to fill in.
+	 * @return True if an operation has been scheduled, false if no requests are queued.
+	 */
+	bool next(CoalescedIo& io) noexcept {
+		if (_active == kNone) {
+			return false;
+		}
+
+		auto const queueIndex = _active;
+		auto& queue = _queues[queueIndex];
+		auto const first = pop(queue);
+		auto& firstRequest = _requests[first];
+
+		io.type = firstRequest.type;
+		io.fid = firstRequest.fid;
+		io.offset = firstRequest.offset;
+		io.count = firstRequest.count;
+		io.requests = 1;
+		io.first = first;
+
+		// Merge following requests that continue the operation.
+		auto last = first;
+		while (queue.head != kNone) {
+			auto const& candidate = _requests[queue.head];
+			if (candidate.type != io.type ||
+				candidate.offset != io.offset + io.count ||
+				static_cast<Solace::uint64>(io.count) + candidate.count > _maxIoSize) {
+				break;
+			}
+
+			auto const merged = pop(queue);
+			_requests[last].next = merged;
+			last = merged;
+			io.count += candidate.count;
+			io.requests += 1;
+		}
+		_requests[last].next = kNone;
+
+		// Next fid gets its turn.
+		_active = _queues[queueIndex].nextActive;
+		if (queue.head == kNone) {
+			deactivate(queueIndex);
+		}
+
+		return true;
+	}
+
+	/**
+	 * Copy data of a coalesced write into a contiguous buffer.
+	 * @param io Write operation returned by next().
+	 * @param dest Buffer to copy data to.
+	 * @return Number of bytes copied.
+	 */
+	Solace::MemoryView::size_type gather(CoalescedIo const& io, Solace::MutableMemoryView dest) const noexcept {
+		Solace::MemoryView::size_type copied = 0;
+		forEachData(io, [&](Solace::MemoryView data) noexcept {
+			auto const n = std::min<Solace::MemoryView::size_type>(data.size(), dest.size() - copied);
+			if (n > 0) {
+				std::memcpy(dest.template dataAs<Solace::byte>(copied), data.begin(), n);
+				copied += n;
+			}
+		});
+
+		return copied;
+	}
+
+	/**
+	 * Visit data of each request of a coalesced write, in file order. Useful to build an iovec for vectored I/O.
+	 * @param io Write operation returned by next().
+	 * @param visitor A callable with a signature `void (Solace::MemoryView)`.
+	 */
+	template<typename Visitor>
+	void forEachData(CoalescedIo const& io, Visitor&& visitor) const {
+		Solace::uint32 index = io.first;
+		for (Solace::uint32 i = 0; i < io.requests; ++i) {
+			visitor(_requests[index].data);
+			index = _requests[index].next;
+		}
+	}
+
+	/**
+	 * Respond to the requests of a coalesced read with the data read by the backend.
+	 * Each request receives its part of the data; a short read gives short or empty responses to the requests
+	 * past the end of the data.
+	 * @param io Read operation returned by next(). Updated to the requests not yet responded to.
+	 * @param data Data read by the backend, starting at io.offset.
+	 * @param batch A batch of messages to append the responses to.
+	 * @return True if all the requests have been responded to,
+	 * false if the batch is full and respond() should be called again with a new batch.
+	 */
+	bool respond(CoalescedIo& io, Solace::MemoryView data, MessageBatch& batch) {
+		return respondEach(io, batch, [&](Pending const& request, ResponseWriter& writer) {
+			// Slice bounds are clamped to the data: a short read may end anywhere before or inside the request.
+			auto const start = std::min<Solace::MemoryView::size_type>(request.offset - io.offset, data.size());
+			auto const end = std::min<Solace::MemoryView::size_type>(start + request.count, data.size());
+			return writer.read(data.slice(start, end));
+		});
+	}
+
+	/**
+	 * Respond to the requests of a coalesced write with the number of bytes written by the backend.
+	 * Bytes written are attributed to the requests in file order.
+	 * @param io Write operation returned by next(). Updated to the requests not yet responded to.
+	 * @param written Number of bytes the backend has written, starting at io.offset.
+	 * @param batch A batch of messages to append the responses to.
+	 * @return True if all the requests have been responded to,
+	 * false if the batch is full and respond() should be called again with a new batch.
+	 */
+	bool respond(CoalescedIo& io, size_type written, MessageBatch& batch) {
+		return respondEach(io, batch, [&](Pending const& request, ResponseWriter& writer) {
+			auto const start = request.offset - io.offset;
+			auto const count = (written > start)
+					? std::min<Solace::uint64>(written - start, request.count)
+					: 0;
+			return writer.write(static_cast<size_type>(count));
+		});
+	}
+
+	/// @return Number of requests queued or being served.
+	Solace::uint32 size() const noexcept { return _size; }
+
+	/// @return True if there are no requests.
+	bool empty() const noexcept { return (_size == 0); }
+
+	/// @return True if a request with the given tag is queued or being served.
+	bool contains(Tag tag) const noexcept { return (_byTag.find(tag) != kNone); }
+
+	/// @return Maximum number of requests kept by the scheduler.
+	static constexpr Solace::uint32 capacity() noexcept { return Capacity; }
+
+private:
+
+	/// Index value representing no entry.
+	static constexpr Solace::uint32 kNone = ~Solace::uint32{0};
+
+	/// A request kept by the scheduler.
+	struct Pending {
+		Solace::uint64		offset{0};					//!< Offset in the file.
+		Solace::MemoryView	data;						//!< Data of a write request.
+		size_type			count{0};					//!< Number of bytes to transfer.
+		Fid					fid{0};						//!< Fid of the file.
+		Solace::uint32		queue{kNone};				//!< Queue the request is in, kNone if being served.
+		Solace::uint32		prev{kNone};				//!< Previous request in the queue.
+		Solace::uint32		next{kNone};				//!< Next request in the queue or the free list.
+		Tag					tag{0};						//!< Tag of the request.
+		MessageType			type{MessageType::TRead};	//!< TRead or TWrite.
+	};
+
+	/// Queue of requests to one fid.
+	struct Queue {
+		Fid					fid{0};				//!< Fid of the queue.
+		Solace::uint32		head{kNone};		//!< First request.
+		Solace::uint32		tail{kNone};		//!< Last request.
+		Solace::uint32		prevActive{kNone};	//!< Previous queue in the ring of queues with requests.
+		Solace::uint32		nextActive{kNone};	//!< Next queue in the ring of queues with requests.
+		Solace::uint32		next{kNone};		//!< Next queue in the free list.
+	};
+
+	/**
+	 * Map from a 32 bit key to an entry index. Linear probing with backward shift deletion,
+	 * sized to twice the capacity so that it never fills up.
+	 */
+	struct KeyIndex {
+		/// @return Number of slots: the smallest power of 2 no less than twice the capacity.
+		static constexpr Solace::uint32 size() noexcept {
+			Solace::uint32 size = 1;
+			while (size < 2 * Capacity) {
+				size <<= 1;
+			}
+			return size;
+		}
+
+		static constexpr Solace::uint32 kSize = size();
+
+		/// @return Slot the probe sequence of a key starts at.
+		static constexpr Solace::uint32 home(Solace::uint32 key) noexcept {
+			return (key * 0x9E3779B1u) & (kSize - 1);
+		}
+
+		/// @return Value of a key or kNone.
+		Solace::uint32 find(Solace::uint32 key) const noexcept {
+			for (auto slot = home(key); _values[slot] != kNone; slot = (slot + 1) & (kSize - 1)) {
+				if (_keys[slot] == key) {
+					return _values[slot];
+				}
+			}
+
+			return kNone;
+		}
+
+		/// Insert a key that is not in the index.
+		void insert(Solace::uint32 key, Solace::uint32 value) noexcept {
+			auto slot = home(key);
+			while (_values[slot] != kNone) {
+				slot = (slot + 1) & (kSize - 1);
+			}
+
+			_keys[slot] = key;
+			_values[slot] = value;
+		}
+
+		/// Remove a key from the index.
+		void erase(Solace::uint32 key) noexcept {
+			auto slot = home(key);
+			while (_values[slot] != kNone && _keys[slot] != key) {
+				slot = (slot + 1) & (kSize - 1);
+			}
+
+			if (_values[slot] == kNone) {
+				return;
+			}
+
+			// Shift following entries of the probe sequence back so that lookups do not stop at the hole.
+			auto hole = slot;
+			for (auto next = (hole + 1) & (kSize - 1); _values[next] != kNone; next = (next + 1) & (kSize - 1)) {
+				auto const ideal = home(_keys[next]);
+				auto const distanceToNext = (next - ideal) & (kSize - 1);
+				auto const distanceToHole = (hole - ideal) & (kSize - 1);
+				if (distanceToHole < distanceToNext) {
+					_keys[hole] = _keys[next];
+					_values[hole] = _values[next];
+					hole = next;
+				}
+			}
+
+			_values[hole] = kNone;
+		}
+
+		KeyIndex() noexcept {
+			for (auto& value : _values) {
+				value = kNone;
+			}
+		}
+
+		Solace::uint32	_keys[kSize] = {};		//!< Keys by slot.
+		Solace::uint32	_values[kSize];			//!< Values by slot, kNone for a free slot.
+	};
+
+	bool enqueue(Tag tag, MessageType type, Fid fid, Solace::uint64 offset, size_type count,
+				 Solace::MemoryView data) noexcept {
+		if (_freeRequest == Capacity || contains(tag)) {
+			return false;
+		}
+
+		auto queueIndex = _byFid.find(fid);
+		if (queueIndex == kNone) {
+			queueIndex = _freeQueue;
+			auto& queue = _queues[queueIndex];
+			_freeQueue = queue.next;
+			queue.fid = fid;
+			queue.head = kNone;
+			queue.tail = kNone;
+			_byFid.insert(fid, queueIndex);
+			activate(queueIndex);
+		}
+
+		auto const index = _freeRequest;
+		auto& request = _requests[index];
+		_freeRequest = request.next;
+
+		request.offset = offset;
+		request.data = data;
+		request.count = count;
+		request.fid = fid;
+		request.tag = tag;
+		request.type = type;
+
+		// Append to the queue of the fid.
+		auto& queue = _queues[queueIndex];
+		request.queue = queueIndex;
+		request.prev = queue.tail;
+		request.next = kNone;
+		if (queue.tail != kNone) {
+			_requests[queue.tail].next = index;
+		} else {
+			queue.head = index;
+		}
+		queue.tail = index;
+
+		_byTag.insert(tag, index);
+		_size += 1;
+
+		return true;
+	}
+
+	/// Remove the first request of a queue, leaving it in service.
+	Solace::uint32 pop(Queue& queue) noexcept {
+		auto const index = queue.head;
+		unlink(_requests[index], queue);
+
+		return index;
+	}
+
+	/// Remove a request from its queue.
+	void unlink(Pending& request, Queue& queue) noexcept {
+		if (request.prev != kNone) {
+			_requests[request.prev].next = request.next;
+		} else {
+			queue.head = request.next;
+		}
+
+		if (request.next != kNone) {
+			_requests[request.next].prev = request.prev;
+		} else {
+			queue.tail = request.prev;
+		}
+
+		request.queue = kNone;
+		request.prev = kNone;
+		request.next = kNone;
+	}
+
+	/// Add a queue to the ring of queues with requests, just before the current one.
+	void activate(Solace::uint32 index) noexcept {
+		auto& queue = _queues[index];
+		if (_active == kNone) {
+			queue.prevActive = index;
+			queue.nextActive = index;
+			_active = index;
+			return;
+		}
+
+		auto const prev = _queues[_active].prevActive;
+		queue.prevActive = prev;
+		queue.nextActive = _active;
+		_queues[prev].nextActive = index;
+		_queues[_active].prevActive = index;
+	}
+
+	/// Remove an empty queue from the ring and release it.
+	void deactivate(Solace::uint32 index) noexcept {
+		auto& queue = _queues[index];
+		if (queue.nextActive == index) {
+			_active = kNone;
+		} else {
+			_queues[queue.prevActive].nextActive = queue.nextActive;
+			_queues[queue.nextActive].prevActive = queue.prevActive;
+			if (_active == index) {
+				_active = queue.nextActive;
+			}
+		}
+
+		_byFid.erase(queue.fid);
+		queue.next = _freeQueue;
+		_freeQueue = index;
+	}
+
+	/// Release a request that is not in a queue.
+	void release(Solace::uint32 index) noexcept {
+		auto& request = _requests[index];
+		_byTag.erase(request.tag);
+		request.data = Solace::MemoryView{};
+		request.next = _freeRequest;
+		_freeRequest = index;
+		_size -= 1;
+	}
+
+	/// Write a response for each request of an operation while they fit into the batch, releasing the requests.
+	template<typename Respond>
+	bool respondEach(CoalescedIo& io, MessageBatch& batch, Respond&& respond) {
+		while (io.requests > 0) {
+			auto const index = io.first;
+			auto const& request = _requests[index];
+			auto writer = batch.response(request.tag);
+			if (!batch.add(respond(request, writer))) {
+				return false;
+			}
+
+			io.first = request.next;
+			io.requests -= 1;
+			release(index);
+		}
+
+		return true;
+	}
+
+private:
+	/// Maximum size of a coalesced operation.
+	size_type			_maxIoSize;
+	/// Number of requests kept.
+	Solace::uint32		_size{0};
+	/// Head of the list of free request slots.
+	Solace::uint32		_freeRequest{0};
+	/// Head of the list of free queues.
+	Solace::uint32		_freeQueue{0};
+	/// Queue to take the next operation from, kNone if no requests are queued.
+	Solace::uint32		_active{kNone};
+	/// Requests by tag.
+	KeyIndex			_byTag;
+	/// Queues by fid.
+	KeyIndex			_byFid;
+	/// Request slots.
+	Pending				_requests[Capacity];
+	/// Queue slots, at most one per request.
+	Queue				_queues[Capacity];
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_IOSCHEDULER_HPP
@@ -0,0 +1,562 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_IOSTREAM_HPP
+#define STYXE_IOSTREAM_HPP
+
+#include "chunkedIo.hpp"
+#include "requestWriter.hpp"
+
+#include <solace/assert.hpp>
+
+#include <algorithm>  // std::min
+#include <cstring>  // std::memcpy
+#include <limits>
+
+
+namespace styxe {
+
+/**
+ * Sequential read-ahead stream over a fid.
+ *
+ * Stream keeps a window of up to Window TRead requests in flight, each for the next chunk of the file.
+ * Data of the RRead responses, that may arrive in any order, is kept in a slot of the user provided storage
+ * until it is consumed, so the reader sees a contiguous byte stream. A slot is re-used, and its tag re-issued,
+ * once its data has been consumed.
+ * A short read marks the end of file and an RError ends the stream: no more requests are issued past that chunk.
+ *
+ * \code{.cpp}
+...
+	ReadAheadStream<8> stream{fid, 0, wrapMemory(storage), ioChunkSize(msize, iounit), firstTag};
+	while (!stream.atEnd()) {
+		stream.writeRequests(batch);  // Top up the window.
+		...
+		stream.onResponse(header.tag, readResponse);
+		auto const data = stream.peek();
+		process(data);
+		stream.consume(data.size());
+	}
+...
+ * \endcode
+ *
+ * @tparam Window Maximum number of requests in flight.
+ * @note Chunk N is sent with tag firstTag + N % Window.
+ */
+template<Solace::uint32 Window>
+struct ReadAheadStream {
+	static_assert(Window > 0, "Window must be non-empty");
+	static_assert(Window < std::numeric_limits<Tag>::max(), "Window exceeds the range of tags");
+
+	/**
+	 * Construct a new read-ahead stream.
+	 * @param fid Fid of the file open for reading.
+	 * @param offset Offset in the file to start reading from.
+	 * @param storage Storage for data of the chunks. Must hold at least Window chunks.
+	 * @param chunkSize Number of bytes requested by a single TRead, @see ioChunkSize().
+	 * @param firstTag Tag of the first slot of the window.
+	 */
+	ReadAheadStream(Fid fid, Solace::uint64 offset, Solace::MutableMemoryView storage, size_type chunkSize,
+					Tag firstTag)
+		: _fid{fid}
+		, _firstTag{firstTag}
+		, _chunkSize{chunkSize}
+		, _offset{offset}
+		, _storage{storage}
+	{
+		Solace::assertTrue(chunkSize > 0 && static_cast<Solace::uint64>(chunkSize) * Window <= storage.size());
+		Solace::assertTrue(static_cast<Solace::uint64>(firstTag) + Window <= Parser::NO_TAG);
+	}
+
+	ReadAheadStream(ReadAheadStream const&) = delete;
+	ReadAheadStream& operator= (ReadAheadStream const&) = delete;
+
+	/**
+	 * Append TRead requests to a batch to fill the window, while they fit.
+	 * @param batch A batch of messages to append requests to.
+	 * @return Number of messages added to the batch.
+	 */
+	Solace::uint32 writeRequests(MessageBatch& batch) {
+		Solace::uint32 added = 0;
+		while (_endChunk == kNoChunk && _nextChunk - _head < Window) {
+			auto& slot = _slots[_nextChunk % Window];
+			auto message = batch.request(tagOf(_nextChunk))
+					.read(_fid, chunkOffset(_nextChunk), _chunkSize);
+			if (!batch.add(message)) {
+				break;
+			}
+
+			slot.chunk = _nextChunk;
+			slot.state = SlotState::InFlight;
+			_nextChunk += 1;
+			_inFlight += 1;
+			added += 1;
+		}
+
+		return added;
+	}
+
+	/**
+	 * Accept RRead response to one of the requests of the window.
+	 * @param tag Tag of the response.
+	 * @param response Read response.
+	 * @return Error if the tag is not of a request in flight or the response has more data than requested.
+	 */
+	Solace::Result<void, Error> onResponse(Tag tag, Response::Read const& response) {
+		auto const dataSize = response.data.size();
+		if (dataSize > _chunkSize) {
+			return getCannedError(CannedError::MoreThenExpectedData);
+		}
+
+		auto slot = inFlightSlot(tag);
+		if (!slot) {
+			return getCannedError(CannedError::UnexpectedTag);
+		}
+
+		if (dataSize > 0 && slot->chunk <= _endChunk) {
+			std::memcpy(slotData(tag).template dataAs<Solace::byte>(), response.data.begin(), dataSize);
+		}
+
+		complete(*slot, static_cast<size_type>(dataSize));
+		if (dataSize < _chunkSize) {
+			end(slot->chunk);
+		}
+
+		return Solace::Result<void, Error>{Solace::types::okTag};
+	}
+
+	/**
+	 * Accept RError response to one of the requests of the window. Stream ends before the failed chunk.
+	 * @param tag Tag of the response.
+	 * @return Error if the tag is not of a request in flight.
+	 */
+	Solace::Result<void, Error> onError(Tag tag) {
+		auto slot = inFlightSlot(tag);
+		if (!slot) {
+			return getCannedError(CannedError::UnexpectedTag);
+		}
+
+		complete(*slot, 0);
+		end(slot->chunk);
+		_failedChunk = std::min(_failedChunk, slot->chunk);
+
+		return Solace::Result<void, Error>{Solace::types::okTag};
+	}
+
+	/**
+	 * Get contiguous data available to read at the current position.
+	 * @return Data of the current chunk not yet consumed. Empty if the chunk has not been received yet.
+	 */
+	Solace::MemoryView peek() const noexcept {
+		auto const& slot = _slots[_head % Window];
+		if (slot.state != SlotState::Ready || slot.chunk != _head) {
+			return {};
+		}
+
+		return _storage.slice(slotStart(_head) + _consumed, slotStart(_head) + slot.length);
+	}
+
+	/**
+	 * Consume data of the current chunk. Once a chunk is consumed, its slot is released.
+	 * @param bytes Number of bytes to consume, no more than peek().size().
+	 */
+	void consume(Solace::MemoryView::size_type bytes) noexcept {
+		auto& slot = _slots[_head % Window];
+		if (slot.state != SlotState::Ready || slot.chunk != _head) {
+			return;
+		}
+
+		_consumed = static_cast<size_type>(std::min<Solace::MemoryView::size_type>(_consumed + bytes, slot.length));
+		if (_consumed == slot.length && _head < _endChunk) {
+			slot.state = SlotState::Free;
+			_head += 1;
+			_consumed = 0;
+		}
+	}
+
+	/// @return True if all the data of the stream has been consumed.
+	bool atEnd() const noexcept {
+		auto const& slot = _slots[_head % Window];
+		return (_head == _endChunk) && (slot.state == SlotState::Ready) && (_consumed == slot.length);
+	}
+
+	/// @return True if the stream has been ended by an error rather then the end of file.
+	bool failed() const noexcept { return (_endChunk != kNoChunk) && (_failedChunk == _endChunk); }
+
+	/// @return Offset in the file of the next byte to consume.
+	Solace::uint64 position() const noexcept { return chunkOffset(_head) + _consumed; }
+
+	/// @return Number of requests in flight.
+	Solace::uint32 inFlight() const noexcept { return _inFlight; }
+
+	/// @return Fid of the file.
+	Fid fid() const noexcept { return _fid; }
+
+	/// @return True if the tag belongs to a request of the window in flight.
+	bool owns(Tag tag) const noexcept { return (inFlightSlotIndex(tag) < Window); }
+
+private:
+
+	/// State of a window slot.
+	enum class SlotState : Solace::byte {
+		Free,
+		InFlight,
+		Ready,
+	};
+
+	/// A slot of the read window.
+	struct Slot {
+		Solace::uint64		chunk{0};				//!< Index of the chunk in the slot.
+		size_type			length{0};				//!< Number of bytes received.
+		SlotState			state{SlotState::Free};	//!< State of the slot.
+	};
+
+	/// Chunk index representing no chunk.
+	static constexpr Solace::uint64 kNoChunk = ~Solace::uint64{0};
+
+	Tag tagOf(Solace::uint64 chunk) const noexcept { return static_cast<Tag>(_firstTag + chunk % Window); }
+	Solace::uint64 chunkOffset(Solace::uint64 chunk) const noexcept { return _offset + chunk * _chunkSize; }
+	Solace::MemoryView::size_type slotStart(Solace::uint64 chunk) const noexcept {
+		return static_cast<Solace::MemoryView::size_type>(chunk % Window) * _chunkSize;
+	}
+
+	Solace::MutableMemoryView slotData(Tag tag) const noexcept {
+		auto const start = static_cast<Solace::MemoryView::size_type>(tag - _firstTag) * _chunkSize;
+		return _storage.slice(start, start + _chunkSize);
+	}
+
+	Solace::uint32 inFlightSlotIndex(Tag tag) const noexcept {
+		if (tag < _firstTag || static_cast<Solace::uint32>(tag - _firstTag) >= Window) {
+			return Window;
+		}
+
+		auto const index = static_cast<Solace::uint32>(tag - _firstTag);
+		return (_slots[index].state == SlotState::InFlight) ? index : Window;
+	}
+
+	Slot* inFlightSlot(Tag tag) noexcept {
+		auto const index = inFlightSlotIndex(tag);
+		return (index < Window) ? &_slots[index] : nullptr;
+	}
+
+	void complete(Slot& slot, size_type length) noexcept {
+		_inFlight -= 1;
+		slot.length = length;
+		// Chunks past the end of the stream are discarded.
+		slot.state = (slot.chunk <= _endChunk) ? SlotState::Ready : SlotState::Free;
+	}
+
+	void end(Solace::uint64 chunk) noexcept {
+		_endChunk = std::min(_endChunk, chunk);
+	}
+
+private:
+	Fid						_fid;
+	Tag						_firstTag;
+	size_type				_chunkSize;
+	Solace::uint64			_offset;
+	Solace::MutableMemoryView	_storage;
+
+	/// Index of the chunk being consumed.
+	Solace::uint64			_head{0};
+	/// Number of bytes of the head chunk consumed.
+	size_type				_consumed{0};
+	/// Index of the next chunk to request.
+	Solace::uint64			_nextChunk{0};
+	/// Index of the last chunk of the stream, once known.
+	Solace::uint64			_endChunk{kNoChunk};
+	/// Index of the first chunk that failed with an error.
+	Solace::uint64			_failedChunk{kNoChunk};
+	/// Number of requests in flight.
+	Solace::uint32			_inFlight{0};
+	/// Slots of the window.
+	Slot					_slots[Window];
+};
+
+
+/**
+ * Sequential write-behind stream over a fid.
+ *
+ * Data written to the stream is copied into chunk sized slots of the user provided storage.
+ * Full slots - or the partially filled one once flush() is called - are sent as TWrite requests with consecutive
+ * offsets, keeping up to Window writes in flight. A slot is re-used once its write has been acknowledged.
+ * A short write or an RError fails the stream: no more writes are issued and
+ * bytesCommitted() reports how much of the data is known to be written.
+ *
+ * @tparam Window Maximum number of writes in flight.
+ */
+template<Solace::uint32 Window>
+struct WriteBehindStream {
+	static_assert(Window > 0, "Window must be non-empty");
+	static_assert(Window < std::numeric_limits<Tag>::max(), "Window exceeds the range of tags");
+
+	/**
+	 * Construct a new write-behind stream.
+	 * @param fid Fid of the file open for writing.
+	 * @param offset Offset in the file to start writing at.
+	 * @param storage Storage for data of the chunks. Must hold at least Window chunks.
+	 * @param chunkSize Maximum number of bytes written by a single TWrite, @see ioChunkSize().
+	 * @param firstTag Tag of the first slot of the window.
+	 */
+	WriteBehindStream(Fid fid, Solace::uint64 offset, Solace::MutableMemoryView storage, size_type chunkSize,
+					  Tag firstTag)
+		: _fid{fid}
+		, _firstTag{firstTag}
+		, _chunkSize{chunkSize}
+		, _storage{storage}
+		, _nextOffset{offset}
+		, _committed{offset}
+	{
+		Solace::assertTrue(chunkSize > 0 && static_cast<Solace::uint64>(chunkSize) * Window <= storage.size());
+		Solace::assertTrue(static_cast<Solace::uint64>(firstTag) + Window <= Parser::NO_TAG);
+	}
+
+	WriteBehindStream(WriteBehindStream const&) = delete;
+	WriteBehindStream& operator= (WriteBehindStream const&) = delete;
+
+	/**
+	 * Copy data into the stream.
+	 * @param data Data to write.
+	 * @return Number of bytes accepted, less than data size if all the slots are busy.
+	 */
+	Solace::MemoryView::size_type write(Solace::MemoryView data) noexcept {
+		Solace::MemoryView::size_type accepted = 0;
+		while (accepted < data.size() && !_failed) {
+			auto& slot = _slots[_fill % Window];
+			if (slot.state == SlotState::Free) {
+				slot.state = SlotState::Filling;
+				slot.offset = _nextOffset;
+				slot.length = 0;
+			} else if (slot.state != SlotState::Filling) {
+				break;
+			}
+
+			auto const n = std::min<Solace::MemoryView::size_type>(_chunkSize - slot.length, data.size() - accepted);
+			std::memcpy(slotData(_fill).template dataAs<Solace::byte>(slot.length), data.begin() + accepted, n);
+			slot.length += static_cast<size_type>(n);
+			accepted += n;
+			_nextOffset += n;
+
+			if (slot.length == _chunkSize) {
+				slot.state = SlotState::Ready;
+				_fill += 1;
+			}
+		}
+
+		return accepted;
+	}
+
+	/**
+	 * Make the partially filled chunk ready to be sent, so that all the data written so far is sent
+	 * by the following writeRequests().
+	 */
+	void flush() noexcept {
+		auto& slot = _slots[_fill % Window];
+		if (slot.state == SlotState::Filling && slot.length > 0) {
+			slot.state = SlotState::Ready;
+			_fill += 1;
+		}
+	}
+
+	/**
+	 * Append TWrite requests of chunks ready to be sent to a batch, while they fit. Data is copied into the batch.
+	 * @param batch A batch of messages to append requests to.
+	 * @return Number of messages added to the batch.
+	 */
+	Solace::uint32 writeRequests(MessageBatch& batch) {
+		Solace::uint32 added = 0;
+		while (_sent < _fill && !_failed) {
+			auto& slot = _slots[_sent % Window];
+			// Data is appended to the message piecewise, so make sure it fits up front.
+			if (!batch.fits(headerSize() + sizeof(Fid) + sizeof(slot.offset) + sizeof(size_type) + slot.length)) {
+				break;
+			}
+
+			auto message = batch.request(tagOf(_sent))
+					.write(_fid, slot.offset)
+					.data(slotData(_sent).slice(0, slot.length));
+			if (!batch.add(message)) {
+				break;
+			}
+
+			slot.state = SlotState::InFlight;
+			_sent += 1;
+			added += 1;
+		}
+
+		return added;
+	}
+
+	/**
+	 * Write TWrite request of the next ready chunk, leaving the data out of line.
+	 * @param dest Buffer to write the message header into. The buffer is flipped, as by TypedWriter::build().
+	 * @return Segments of the message frame. Both segments are empty if no chunk is ready to be sent.
+	 */
+	FrameSegments writeNext(Solace::ByteWriter& dest) {
+		if (_sent == _fill || _failed) {
+			return FrameSegments{};
+		}
+
+		auto& slot = _slots[_sent % Window];
+		slot.state = SlotState::InFlight;
+		auto const chunk = _sent++;
+
+		return RequestWriter{dest, tagOf(chunk)}
+				.write(_fid, slot.offset)
+				.build(slotData(chunk).slice(0, slot.length));
+	}
+
+	/**
+	 * Accept RWrite response to one of the writes in flight.
+	 * @param tag Tag of the response.
+	 * @param response Write response.
+	 * @return Error if the tag is not of a write in flight or the response reports more bytes than requested.
+	 */
+	Solace::Result<void, Error> onResponse(Tag tag, Response::Write const& response) {
+		auto slot = inFlightSlot(tag);
+		if (!slot) {
+			return getCannedError(CannedError::UnexpectedTag);
+		}
+
+		if (response.count > slot->length) {
+			return getCannedError(CannedError::MoreThenExpectedData);
+		}
+
+		acknowledge(*slot, response.count);
+		return Solace::Result<void, Error>{Solace::types::okTag};
+	}
+
+	/**
+	 * Accept RError response to one of the writes in flight. The stream fails.
+	 * @param tag Tag of the response.
+	 * @return Error if the tag is not of a write in flight.
+	 */
+	Solace::Result<void, Error> onError(Tag tag) {
+		auto slot = inFlightSlot(tag);
+		if (!slot) {
+			return getCannedError(CannedError::UnexpectedTag);
+		}
+
+		acknowledge(*slot, 0);
+		return Solace::Result<void, Error>{Solace::types::okTag};
+	}
+
+	/// @return Offset in the file up to which all the data is known to have been written.
+	Solace::uint64 bytesCommitted() const noexcept { return _committed; }
+
+	/// @return Offset in the file past the last byte written to the stream.
+	Solace::uint64 position() const noexcept { return _nextOffset; }
+
+	/// @return True if a write has failed or was short.
+	bool failed() const noexcept { return _failed; }
+
+	/// @return True if all the data written to the stream has been acknowledged, or the stream has failed.
+	bool idle() const noexcept { return (inFlight() == 0) && (_failed || _committed == _nextOffset); }
+
+	/// @return Number of writes in flight.
+	Solace::uint32 inFlight() const noexcept { return static_cast<Solace::uint32>(_sent - _acked); }
+
+	/// @return True if the tag belongs to a write in flight.
+	bool owns(Tag tag) const noexcept { return (inFlightSlotIndex(tag) < Window); }
+
+private:
+
+	/// State of a window slot.
+	enum class SlotState : Solace::byte {
+		Free,
+		Filling,
+		Ready,
+		InFlight,
+		Acknowledged,
+	};
+
+	/// A slot of the write window.
+	struct Slot {
+		Solace::uint64		offset{0};				//!< Offset in the file of the chunk in the slot.
+		size_type			length{0};				//!< Number of bytes in the slot.
+		size_type			written{0};				//!< Number of bytes acknowledged by the server.
+		SlotState			state{SlotState::Free};	//!< State of the slot.
+	};
+
+	Tag tagOf(Solace::uint64 chunk) const noexcept { return static_cast<Tag>(_firstTag + chunk % Window); }
+
+	Solace::MutableMemoryView slotData(Solace::uint64 chunk) const noexcept {
+		auto const start = static_cast<Solace::MemoryView::size_type>(chunk % Window) * _chunkSize;
+		return _storage.slice(start, start + _chunkSize);
+	}
+
+	Solace::uint32 inFlightSlotIndex(Tag tag) const noexcept {
+		if (tag < _firstTag || static_cast<Solace::uint32>(tag - _firstTag) >= Window) {
+			return Window;
+		}
+
+		auto const index = static_cast<Solace::uint32>(tag - _firstTag);
+		return (_slots[index].state == SlotState::InFlight) ? index : Window;
+	}
+
+	Slot* inFlightSlot(Tag tag) noexcept {
+		auto const index = inFlightSlotIndex(tag);
+		return (index < Window) ? &_slots[index] : nullptr;
+	}
+
+	/// Record acknowledgement of a write and release slots acknowledged in order.
+	void acknowledge(Slot& slot, size_type written) noexcept {
+		slot.written = written;
+		slot.state = SlotState::Acknowledged;
+		// No more writes are issued after a short one, even if writes before it are not acknowledged yet.
+		_failed = _failed || (written < slot.length);
+
+		while (_acked < _sent) {
+			auto& head = _slots[_acked % Window];
+			if (head.state != SlotState::Acknowledged) {
+				break;
+			}
+
+			if (!_truncated) {
+				_committed = head.offset + head.written;
+				_truncated = (head.written < head.length);
+			}
+
+			head.state = SlotState::Free;
+			_acked += 1;
+		}
+	}
+
+private:
+	Fid						_fid;
+	Tag						_firstTag;
+	size_type				_chunkSize;
+	Solace::MutableMemoryView	_storage;
+
+	/// Offset in the file of the next byte written to the stream.
+	Solace::uint64			_nextOffset;
+	/// Offset in the file up to which data has been acknowledged.
+	Solace::uint64			_committed;
+	/// Index of the chunk being filled.
+	Solace::uint64			_fill{0};
+	/// Index of the next chunk to send.
+	Solace::uint64			_sent{0};
+	/// Index of the oldest chunk not acknowledged.
+	Solace::uint64			_acked{0};
+	/// True once a write has failed.
+	bool					_failed{false};
+	/// True once committed data has reached a failed write.
+	bool					_truncated{false};
+	/// Slots of the window.
+	Slot					_slots[Window];
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_IOSTREAM_HPP
@@ -0,0 +1,140 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_MESSAGEBATCH_HPP
+#define STYXE_MESSAGEBATCH_HPP
+
+#include "requestWriter.hpp"
+#include "responseWriter.hpp"
+
+
+namespace styxe {
+
+/**
+ * A builder of a batch of complete messages written back-to-back into a single buffer.
+ *
+ * TypedWriter::build() flips the output stream, making a buffer hold exactly one message.
+ * A batch instead completes each message in place, so that many requests or responses, each with its own tag,
+ * can be pipelined and sent with a single write call. Only seal() flips the stream.
+ *
+ * A batch enforces two limits: no single message may exceed the negotiated message size,
+ * and all the messages together may not exceed a byte budget, such as a socket send buffer size.
+ * A message that does not fit is rolled back, leaving the batch as it was before the message was written.
+ *
+ * \code{.cpp}
+...
+	MessageBatch batch{buffer, parser.maxNegotiatedMessageSize()};
+	for (auto const& pending : readQueue) {
+		if (!batch.add(batch.request(pending.tag).read(pending.fid, pending.offset, pending.count))) {
+			break;  // Next message would exceed the budget: send what we have.
+		}
+	}
+
+	send(socket, batch.seal().viewRemaining());
+...
+ * \endcode
+ */
+struct MessageBatch {
+
+	/**
+	 * Construct a new batch.
+	 * @param dest A byte stream to write messages to. Messages are appended from the current position of the stream.
+	 * @param maxMessageSize Maximum size of a single message, usually negotiated message size.
+	 * @param budget Maximum number of bytes all the messages in the batch can occupy.
+	 * Budget is capped by the space remaining in the stream.
+	 */
+	MessageBatch(Solace::ByteWriter& dest, size_type maxMessageSize, Solace::ByteWriter::size_type budget) noexcept;
+
+	/**
+	 * Construct a new batch limited only by the space remaining in the stream.
+	 * @param dest A byte stream to write messages to. Messages are appended from the current position of the stream.
+	 * @param maxMessageSize Maximum size of a single message, usually negotiated message size.
+	 */
+	MessageBatch(Solace::ByteWriter& dest, size_type maxMessageSize) noexcept
+		: MessageBatch{dest, maxMessageSize, dest.remaining()}
+	{}
+
+	MessageBatch(MessageBatch const&) = delete;
+	MessageBatch& operator= (MessageBatch const&) = delete;
+
+	/**
+	 * Start a new request message in the batch.
+	 * @param tag Tag of the request.
+	 * @return Request writer appending to the batch. Pass the resulting message to add().
+	 */
+	RequestWriter request(Tag tag) noexcept { return RequestWriter{_dest, tag}; }
+
+	/**
+	 * Start a new response message in the batch.
+	 * @param tag Tag of the response.
+	 * @return Response writer appending to the batch. Pass the resulting message to add().
+	 */
+	ResponseWriter response(Tag tag) noexcept { return ResponseWriter{_dest, tag}; }
+
+	/**
+	 * Check if a message of a given size can be added to the batch.
+	 * Useful to check before writing a message which size is known up front, @see MessageLayout.
+	 * @param messageSize Size of the message frame in bytes.
+	 * @return True if a message of the given size fits into the batch.
+	 */
+	bool fits(Solace::ByteWriter::size_type messageSize) const noexcept {
+		return messageSize <= _maxMessageSize && messageSize <= remaining();
+	}
+
+	/**
+	 * Complete a message written into the batch.
+	 * If the message exceeds maximum message size, the budget or did not fit into the stream,
+	 * it is rolled back and the batch is not changed.
+	 * @param message A message started with request() or response().
+	 * @return True if the message has been added to the batch, false if it has been rolled back.
+	 */
+	bool add(TypedWriter message);
+
+	/**
+	 * Finalize the batch.
+	 * @return Output stream flipped to contain all the messages of the batch.
+	 */
+	Solace::ByteWriter& seal() { return _dest.flip(); }
+
+	/// @return Number of messages in the batch.
+	Solace::uint32 size() const noexcept { return _count; }
+
+	/// @return True if the batch has no messages.
+	bool empty() const noexcept { return (_count == 0); }
+
+	/// @return Number of bytes all messages of the batch occupy.
+	Solace::ByteWriter::size_type bytes() const noexcept { return _end - _start; }
+
+	/// @return Number of bytes of the budget not yet used.
+	Solace::ByteWriter::size_type remaining() const noexcept { return _budget - bytes(); }
+
+private:
+	/// Output stream messages are written to.
+	Solace::ByteWriter&				_dest;
+	/// Maximum size of a single message.
+	size_type						_maxMessageSize;
+	/// Position in the stream where the batch starts.
+	Solace::ByteWriter::size_type	_start;
+	/// Position in the stream past the last complete message.
+	Solace::ByteWriter::size_type	_end;
+	/// Maximum number of bytes the batch may occupy.
+	Solace::ByteWriter::size_type	_budget;
+	/// Number of messages in the batch.
+	Solace::uint32					_count{0};
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_MESSAGEBATCH_HPP
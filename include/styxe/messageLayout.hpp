@@ -0,0 +1,390 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_MESSAGELAYOUT_HPP
+#define STYXE_MESSAGELAYOUT_HPP
+
+#include "9p2000.hpp"
+
+#include <cstring>  // std::memcpy
+#include <tuple>
+#include <type_traits>
+#include <utility>  // std::index_sequence
+
+
+namespace styxe {
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+/// True if the host byte order matches the protocol byte order, so values can be copied as is.
+constexpr bool kHostIsLittleEndian = (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__);
+#else
+constexpr bool kHostIsLittleEndian = false;
+#endif
+
+
+/**
+ * Wire representation of a fixed size protocol field.
+ * Specialized for every field type that can appear in a fixed layout message.
+ * @tparam T Type of the field.
+ */
+template<typename T, typename Enable = void>
+struct WireField;
+
+
+/// Integral fields are stored as little-endian values.
+template<typename T>
+struct WireField<T, std::enable_if_t<std::is_integral<T>::value>> {
+	/// Number of bytes the field occupies on the wire.
+	static constexpr size_type kSize = sizeof(T);
+
+	/// Store a value at the given location.
+	static void store(Solace::byte* dest, T value) noexcept {
+		if constexpr (kHostIsLittleEndian) {
+			std::memcpy(dest, &value, sizeof(T));
+		} else {
+			for (size_type i = 0; i < sizeof(T); ++i) {
+				dest[i] = static_cast<Solace::byte>(static_cast<std::make_unsigned_t<T>>(value) >> (8*i));
+			}
+		}
+	}
+
+	/// Load a value from the given location.
+	static void load(Solace::byte const* src, T& value) noexcept {
+		if constexpr (kHostIsLittleEndian) {
+			std::memcpy(&value, src, sizeof(T));
+		} else {
+			std::make_unsigned_t<T> result = 0;
+			for (size_type i = 0; i < sizeof(T); ++i) {
+				result |= static_cast<std::make_unsigned_t<T>>(src[i]) << (8*i);
+			}
+			value = static_cast<T>(result);
+		}
+	}
+};
+
+
+/// Qid is stored as a packed sequence of its fields.
+template<>
+struct WireField<Qid> {
+	/// Number of bytes the field occupies on the wire.
+	static constexpr size_type kSize = sizeof(Qid::type) + sizeof(Qid::version) + sizeof(Qid::path);
+
+	/// Store a value at the given location.
+	static void store(Solace::byte* dest, Qid const& value) noexcept {
+		WireField<Solace::byte>::store(dest, value.type);
+		WireField<Solace::uint32>::store(dest + sizeof(Qid::type), value.version);
+		WireField<Solace::uint64>::store(dest + sizeof(Qid::type) + sizeof(Qid::version), value.path);
+	}
+
+	/// Load a value from the given location.
+	static void load(Solace::byte const* src, Qid& value) noexcept {
+		WireField<Solace::byte>::load(src, value.type);
+		WireField<Solace::uint32>::load(src + sizeof(Qid::type), value.version);
+		WireField<Solace::uint64>::load(src + sizeof(Qid::type) + sizeof(Qid::version), value.path);
+	}
+};
+
+
+/// Open mode is stored as a single byte.
+template<>
+struct WireField<OpenMode> {
+	/// Number of bytes the field occupies on the wire.
+	static constexpr size_type kSize = sizeof(OpenMode::mode);
+
+	/// Store a value at the given location.
+	static void store(Solace::byte* dest, OpenMode const& value) noexcept {
+		WireField<Solace::byte>::store(dest, value.mode);
+	}
+
+	/// Load a value from the given location.
+	static void load(Solace::byte const* src, OpenMode& value) noexcept {
+		WireField<Solace::byte>::load(src, value.mode);
+	}
+};
+
+
+/// Message type is stored as a single byte.
+template<>
+struct WireField<MessageType> {
+	/// Number of bytes the field occupies on the wire.
+	static constexpr size_type kSize = sizeof(Solace::byte);
+
+	/// Store a value at the given location.
+	static void store(Solace::byte* dest, MessageType value) noexcept {
+		WireField<Solace::byte>::store(dest, static_cast<Solace::byte>(value));
+	}
+
+	/// Load a value from the given location.
+	static void load(Solace::byte const* src, MessageType& value) noexcept {
+		Solace::byte type;
+		WireField<Solace::byte>::load(src, type);
+		value = static_cast<MessageType>(type);
+	}
+};
+
+/**
+ * Compile time layout of a packed sequence of fixed size fields.
+ * @tparam Fields Types of the fields in the order they appear on the wire.
+ */
+template<typename... Fields>
+struct PackedLayout {
+	/// Number of fields in the layout.
+	static constexpr size_type kFieldCount = sizeof...(Fields);
+
+	/// Total number of bytes occupied by all the fields.
+	static constexpr size_type kSize = (size_type{0} + ... + WireField<Fields>::kSize);
+
+	/**
+	 * Get offset of a field.
+	 * @param index Index of the field.
+	 * @return Offset in bytes of the field from the start of the layout.
+	 */
+	static constexpr size_type offset(size_type index) noexcept {
+		constexpr size_type sizes[] = {0, WireField<Fields>::kSize...};
+
+		size_type result = 0;
+		for (size_type i = 0; i < index && i < kFieldCount; ++i) {
+			result += sizes[i + 1];
+		}
+
+		return result;
+	}
+
+	/**
+	 * Store field values into a memory location of at least kSize bytes.
+	 * @param dest Memory location to store fields to.
+	 * @param values Values of the fields.
+	 */
+	static void store(Solace::byte* dest, Fields const&... values) noexcept {
+		storeImpl(dest, std::index_sequence_for<Fields...>{}, values...);
+	}
+
+	/**
+	 * Load field values from a memory location of at least kSize bytes.
+	 * @param src Memory location to load fields from.
+	 * @param values Fields to load values into.
+	 */
+	static void load(Solace::byte const* src, Fields&... values) noexcept {
+		loadImpl(src, std::index_sequence_for<Fields...>{}, values...);
+	}
+
+private:
+	template<size_t... Index>
+	static void storeImpl(Solace::byte* dest, std::index_sequence<Index...>, Fields const&... values) noexcept {
+		(WireField<Fields>::store(dest + offset(Index), values), ...);
+	}
+
+	template<size_t... Index>
+	static void loadImpl(Solace::byte const* src, std::index_sequence<Index...>, Fields&... values) noexcept {
+		(WireField<Fields>::load(src + offset(Index), values), ...);
+	}
+};
+
+
+/// Layout of the message header.
+using HeaderLayout = PackedLayout<decltype(MessageHeader::messageSize), MessageType, decltype(MessageHeader::tag)>;
+
+static_assert(HeaderLayout::kSize == headerSize(), "Header layout must match the protocol header size");
+
+
+/**
+ * Layout descriptor of a protocol message.
+ * Primary template is used for messages with variable size payload, such as strings or data, that have no fixed layout.
+ * Messages with fixed size payload specialize it, @see FixedMessageLayout.
+ */
+template<typename Msg>
+struct MessageLayout {
+	/// True if the message has a fixed wire size.
+	static constexpr bool kFixedSize = false;
+};
+
+
+/**
+ * Base of a layout descriptor of a message with fixed size payload.
+ * A specialization of MessageLayout for a message type derives from this and provides:
+ *  - kType - type of the message;
+ *  - fields(msg) - a tuple of references to members of the message in the order they appear on the wire.
+ *
+ * @tparam Fields Types of the payload fields in wire order.
+ */
+template<typename... Fields>
+struct FixedMessageLayout : public PackedLayout<Fields...> {
+	/// True if the message has a fixed wire size.
+	static constexpr bool kFixedSize = true;
+
+	/// Size of the message payload in bytes.
+	static constexpr size_type kPayloadSize = PackedLayout<Fields...>::kSize;
+
+	/// Size of the whole message frame, including the header.
+	static constexpr size_type kFrameSize = HeaderLayout::kSize + kPayloadSize;
+};
+
+
+template<> struct MessageLayout<Request::Flush> : public FixedMessageLayout<Tag> {
+	static constexpr MessageType kType = MessageType::TFlush;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M& msg) noexcept { return std::tie(msg.oldtag); }
+};
+
+template<> struct MessageLayout<Request::Open> : public FixedMessageLayout<Fid, OpenMode> {
+	static constexpr MessageType kType = MessageType::TOpen;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M& msg) noexcept { return std::tie(msg.fid, msg.mode); }
+};
+
+template<> struct MessageLayout<Request::Read> : public FixedMessageLayout<Fid, Solace::uint64, Solace::uint32> {
+	static constexpr MessageType kType = MessageType::TRead;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M& msg) noexcept {
+		return std::tie(msg.fid, msg.offset, msg.count);
+	}
+};
+
+template<> struct MessageLayout<Request::Clunk> : public FixedMessageLayout<Fid> {
+	static constexpr MessageType kType = MessageType::TClunk;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M& msg) noexcept { return std::tie(msg.fid); }
+};
+
+template<> struct MessageLayout<Request::Remove> : public FixedMessageLayout<Fid> {
+	static constexpr MessageType kType = MessageType::TRemove;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M& msg) noexcept { return std::tie(msg.fid); }
+};
+
+template<> struct MessageLayout<Request::StatRequest> : public FixedMessageLayout<Fid> {
+	static constexpr MessageType kType = MessageType::TStat;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M& msg) noexcept { return std::tie(msg.fid); }
+};
+
+
+template<> struct MessageLayout<Response::Auth> : public FixedMessageLayout<Qid> {
+	static constexpr MessageType kType = MessageType::RAuth;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M& msg) noexcept { return std::tie(msg.qid); }
+};
+
+template<> struct MessageLayout<Response::Attach> : public FixedMessageLayout<Qid> {
+	static constexpr MessageType kType = MessageType::RAttach;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M& msg) noexcept { return std::tie(msg.qid); }
+};
+
+template<> struct MessageLayout<Response::Flush> : public FixedMessageLayout<> {
+	static constexpr MessageType kType = MessageType::RFlush;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M&) noexcept { return std::tie(); }
+};
+
+template<> struct MessageLayout<Response::Open> : public FixedMessageLayout<Qid, size_type> {
+	static constexpr MessageType kType = MessageType::ROpen;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M& msg) noexcept { return std::tie(msg.qid, msg.iounit); }
+};
+
+template<> struct MessageLayout<Response::Create> : public FixedMessageLayout<Qid, size_type> {
+	static constexpr MessageType kType = MessageType::RCreate;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M& msg) noexcept { return std::tie(msg.qid, msg.iounit); }
+};
+
+template<> struct MessageLayout<Response::Write> : public FixedMessageLayout<size_type> {
+	static constexpr MessageType kType = MessageType::RWrite;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M& msg) noexcept { return std::tie(msg.count); }
+};
+
+template<> struct MessageLayout<Response::Clunk> : public FixedMessageLayout<> {
+	static constexpr MessageType kType = MessageType::RClunk;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M&) noexcept { return std::tie(); }
+};
+
+template<> struct MessageLayout<Response::Remove> : public FixedMessageLayout<> {
+	static constexpr MessageType kType = MessageType::RRemove;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M&) noexcept { return std::tie(); }
+};
+
+template<> struct MessageLayout<Response::WStat> : public FixedMessageLayout<> {
+	static constexpr MessageType kType = MessageType::RWStat;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M&) noexcept { return std::tie(); }
+};
+
+template<> struct MessageLayout<Response_9P2000E::Session> : public FixedMessageLayout<> {
+	static constexpr MessageType kType = MessageType::RSession;  //!< Type of the message.
+	/// @return Members of the message in wire order.
+	template<typename M> static constexpr auto fields(M&) noexcept { return std::tie(); }
+};
+
+
+/**
+ * Encode a fixed layout message, including its header, with a single bounds check.
+ * The whole frame is assembled as a packed little-endian image and written to the destination in one go.
+ *
+ * @param dest Byte writer to write the message to.
+ * @param tag Tag of the message.
+ * @param msg Message to encode.
+ * @return Header of the encoded message.
+ */
+template<typename Msg>
+MessageHeader encodeFixed(Solace::ByteWriter& dest, Tag tag, Msg const& msg) {
+	using Layout = MessageLayout<Msg>;
+	static_assert(Layout::kFixedSize, "Message does not have a fixed layout");
+
+	auto const header = makeHeaderWithPayload(Layout::kType, tag, Layout::kPayloadSize);
+
+	Solace::byte image[Layout::kFrameSize];
+	HeaderLayout::store(image, header.messageSize, header.type, header.tag);
+	std::apply([&image](auto const&... values) noexcept {
+		Layout::store(image + HeaderLayout::kSize, values...);
+	}, Layout::fields(msg));
+
+	dest.write(Solace::wrapMemory(image));
+
+	return header;
+}
+
+
+/**
+ * Decode payload of a fixed layout message with a single bounds check.
+ * @param data Byte reader positioned at the start of the message payload.
+ * @param dest Message to decode payload into.
+ * @return Void or an error if there is not enough data.
+ */
+template<typename Msg>
+Solace::Result<void, Error> decodeFixed(Solace::ByteReader& data, Msg& dest) {
+	using Layout = MessageLayout<Msg>;
+	static_assert(Layout::kFixedSize, "Message does not have a fixed layout");
+
+	if (data.remaining() < Layout::kPayloadSize) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	if constexpr (Layout::kPayloadSize > 0) {
+		auto const image = data.viewRemaining().dataAs<Solace::byte const>();
+		std::apply([image](auto&... values) noexcept {
+			Layout::load(image, values...);
+		}, Layout::fields(dest));
+	}
+
+	return data.advance(Layout::kPayloadSize);
+}
+
+}  // end of namespace styxe
+#endif  // STYXE_MESSAGELAYOUT_HPP
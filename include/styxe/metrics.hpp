@@ -0,0 +1,114 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_METRICS_HPP
+#define STYXE_METRICS_HPP
+
+#include "9p2000.hpp"
+
+
+namespace styxe {
+
+/// True if the library has been built with protocol metrics collection, @see STYXE_METRICS CMake option.
+constexpr bool kMetricsEnabled = (STYXE_METRICS != 0);
+
+/// Number of distinct kinds of canned errors, @see CannedError.
+constexpr Solace::uint32 kCannedErrorKinds = static_cast<Solace::uint32>(CannedError::IllFormedCompressedData) + 1;
+
+
+/** Counters of messages of one type. */
+struct MessageTypeMetrics {
+	Solace::uint64	decoded{0};         //!< Number of messages decoded by the Parser.
+	Solace::uint64	decodedBytes{0};    //!< Total size of the decoded messages, including headers.
+	Solace::uint64	decodeNanos{0};     //!< Total time spent decoding messages.
+	Solace::uint64	encoded{0};         //!< Number of messages encoded by message writers.
+	Solace::uint64	encodedBytes{0};    //!< Total size of the encoded messages, including headers.
+	Solace::uint64	encodeNanos{0};     //!< Total time spent encoding messages.
+};
+
+
+/**
+ * A snapshot of protocol metrics collected by all threads.
+ *
+ * Each thread collects metrics into its own thread local counters without any synchronization,
+ * so that the overhead of the collection is a few uncontended relaxed stores and two clock reads per message.
+ * Counters of all threads, including the ones that have exited, are summed when a snapshot is taken.
+ * Metrics are only collected if the library is built with STYXE_METRICS option, otherwise all the counters are 0.
+ *
+ * \code{.cpp}
+...
+	auto const metrics = protocolMetrics();
+	for (auto type : {MessageType::TWalk, MessageType::TRead}) {
+		auto const& counters = metrics[type];
+		exporter.report(type, counters.decoded, counters.decodedBytes, counters.decodeNanos);
+	}
+...
+ * \endcode
+ */
+struct MetricsSnapshot {
+	/// Number of slots for message types: a slot for each value of message type code.
+	static constexpr Solace::uint32 kMessageTypeSlots = 256;
+
+	/**
+	 * Number of buckets of the frame size histogram. Bucket i counts received frames that are larger than
+	 * 1/2^(i+1) of the negotiated message size and no larger than 1/2^i of it. The last bucket also counts
+	 * all smaller frames. A frame is counted once, when it has been received complete.
+	 */
+	static constexpr Solace::uint32 kFrameSizeBuckets = 16;
+
+	/// Counters per message type, indexed by message type code.
+	MessageTypeMetrics	messages[kMessageTypeSlots];
+
+	/// Histogram of received frame sizes relative to the negotiated message size.
+	Solace::uint64		frameSizes[kFrameSizeBuckets];
+
+	/// Counters of protocol errors per kind, indexed by CannedError.
+	Solace::uint64		errors[kCannedErrorKinds];
+
+	/**
+	 * Get counters of the given message type.
+	 * @param type Message type.
+	 * @return Counters of the message type.
+	 */
+	MessageTypeMetrics const& operator[] (MessageType type) const noexcept {
+		return messages[static_cast<Solace::byte>(type)];
+	}
+
+	/**
+	 * Get number of errors of the given kind.
+	 * @param errorId Kind of the error.
+	 * @return Number of errors of the kind.
+	 */
+	Solace::uint64 operator[] (CannedError errorId) const noexcept {
+		return errors[static_cast<Solace::uint32>(errorId)];
+	}
+};
+
+
+/**
+ * Take a snapshot of the protocol metrics collected so far by all threads.
+ * @return Sum of metrics collected by all threads.
+ */
+MetricsSnapshot protocolMetrics() noexcept;
+
+/**
+ * Reset all protocol metrics to 0.
+ * @note Counters are not synchronized: increments of other threads that happen concurrently may be lost.
+ */
+void resetProtocolMetrics() noexcept;
+
+}  // end of namespace styxe
+#endif  // STYXE_METRICS_HPP
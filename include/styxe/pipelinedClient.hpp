@@ -0,0 +1,502 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_PIPELINEDCLIENT_HPP
+#define STYXE_PIPELINEDCLIENT_HPP
+
+#include "9p2000.hpp"
+#include "requestWriter.hpp"
+#include "messageBatch.hpp"
+#include "frameAssembler.hpp"
+#include "tagPool.hpp"
+
+#include <algorithm>  // std::min
+
+
+namespace styxe {
+
+/**
+ * Completion of a request: a callback invoked exactly once with the parsed response or an error.
+ * Completion is a plain function pointer and a context pointer, so that pending requests can be kept
+ * without any allocation. @see makeCompletion() to bind a callable object.
+ */
+struct Completion {
+	/// Signature of the completion callback.
+	using Callback = void (*)(void* context, Tag tag, Solace::Result<ResponseMessage, Error>&& response);
+
+	/// Function to call on completion.
+	Callback	callback{nullptr};
+	/// Context passed back to the callback.
+	void*		context{nullptr};
+
+	/// @return True if the completion has a callback to call.
+	explicit operator bool() const noexcept { return (callback != nullptr); }
+
+	/**
+	 * Invoke the completion callback.
+	 * @param tag Tag of the request being completed.
+	 * @param response Parsed response message or an error.
+	 */
+	void operator() (Tag tag, Solace::Result<ResponseMessage, Error>&& response) const {
+		if (callback) {
+			callback(context, tag, Solace::mv(response));
+		}
+	}
+};
+
+
+/**
+ * Bind a callable object to a completion.
+ * @param handler A callable with a signature `void (Tag, Solace::Result<ResponseMessage, Error>&&)`.
+ * The object is referenced, not copied, and must outlive the request.
+ * @return Completion calling the handler.
+ */
+template<typename Handler>
+Completion makeCompletion(Handler& handler) noexcept {
+	return Completion{
+		[](void* context, Tag tag, Solace::Result<ResponseMessage, Error>&& response) {
+			(*static_cast<Handler*>(context))(tag, Solace::mv(response));
+		},
+		&handler
+	};
+}
+
+
+/**
+ * A client that pipelines many requests over a single connection.
+ *
+ * Each request is encoded with RequestWriter straight into a shared outbound buffer under a tag of its own,
+ * and its completion is kept in a TagPool slot. The client does no I/O itself: the transport - a blocking socket,
+ * an epoll or io_uring event loop - sends outbound() data and feeds received data into receive().
+ * Responses are re-assembled from the stream with FrameAssembler, parsed and routed by tag to their completions,
+ * in the order the server responds. Thus any number of requests, up to the capacity, can be in flight
+ * without a thread or a round trip per request.
+ * A client that offers payload compression, e.g. "9P2000.e+lz4", must be given a buffer to decompress data into.
+ *
+ * \code{.cpp}
+...
+	PipelinedClient<> client{parser, wrapMemory(outBuffer), wrapMemory(stagingBuffer)};
+	client.walk(rootFid, fid, pathSegments, makeCompletion(onWalk));
+	client.read(fid, 0, 4096, makeCompletion(onRead));
+	client.send(socketTransport);
+
+	// When the socket is readable:
+	client.receive(wrapMemory(received, bytesReceived));
+...
+ * \endcode
+ *
+ * @tparam Capacity Maximum number of requests in flight.
+ * @note Client is not synchronized and is meant to be owned by a single I/O thread.
+ */
+template<Solace::uint32 Capacity = 64>
+struct PipelinedClient {
+
+	/**
+	 * Construct a new client.
+	 * @param parser Protocol parser of the connection. Negotiated version and message size are updated on RVersion.
+	 * @param outbound Storage to encode requests into. Should be at least the negotiated message size.
+	 * @param staging Storage for incomplete response frames, @see FrameAssembler.
+	 * @param decompression Storage to decompress data of compressed RRead and RSRead responses into,
+	 * @see Parser::parseCompressedResponse. Only required if the client offers payload compression.
+	 * Data of a response is only valid until the next response is received.
+	 */
+	PipelinedClient(Parser& parser, Solace::MutableMemoryView outbound, Solace::MutableMemoryView staging,
+					Solace::MutableMemoryView decompression = {}) noexcept
+		: _parser{parser}
+		, _outbound{outbound}
+		, _assembler{parser, staging}
+		, _decompression{decompression}
+	{}
+
+	PipelinedClient(PipelinedClient const&) = delete;
+	PipelinedClient& operator= (PipelinedClient const&) = delete;
+
+	/**
+	 * Enqueue a request.
+	 * @param done Completion to call with the response.
+	 * @param build A callable with a signature `TypedWriter (RequestWriter&)` that writes the request message.
+	 * @return Tag of the request or Parser::NO_TAG if no tags are available or the message does not fit
+	 * into the outbound buffer.
+	 */
+	template<typename Build>
+	Tag request(Completion done, Build&& build) {
+		return enqueueRequest(PendingRequest{done, Parser::NO_TAG, 0}, build);
+	}
+
+
+	/**
+	 * Enqueue a version request. Version request is always sent with Parser::NO_TAG and
+	 * only one can be in flight. Negotiated version and message size of the parser are updated once the response arrives.
+	 * @param version Suggested protocol version.
+	 * @param maxMessageSize Suggested maximum message size.
+	 * @param done Completion to call with the response.
+	 * @return True if the request has been enqueued.
+	 */
+	bool version(Solace::StringView version, size_type maxMessageSize, Completion done) {
+		// Compressed responses can only be decoded into the decompression buffer.
+		Solace::assertTrue(parsePayloadCompression(version) == PayloadCompression::None || _decompression.size() > 0,
+						   "Payload compression offered without a decompression buffer");
+
+		if (_versionPending) {
+			return false;
+		}
+
+		if (!enqueue(Parser::NO_TAG, [&](RequestWriter& writer) { return writer.version(version, maxMessageSize); })) {
+			return false;
+		}
+
+		_versionPending = done;
+		return true;
+	}
+
+	/// Enqueue Auth request, @see RequestWriter::auth().
+	Tag auth(Fid afid, Solace::StringView userName, Solace::StringView attachName, Completion done) {
+		return request(done, [&](RequestWriter& writer) { return writer.auth(afid, userName, attachName); });
+	}
+
+	/// Enqueue Attach request, @see RequestWriter::attach().
+	Tag attach(Fid fid, Fid afid, Solace::StringView userName, Solace::StringView attachName, Completion done) {
+		return request(done, [&](RequestWriter& writer) { return writer.attach(fid, afid, userName, attachName); });
+	}
+
+	/**
+	 * Enqueue Walk request, @see RequestWriter::walk().
+	 * @param fid Fid to walk from.
+	 * @param nfid Fid to assign to the result of the walk.
+	 * @param segments A range of path segments convertible to Solace::StringView.
+	 * @param done Completion to call with the response.
+	 * @return Tag of the request or Parser::NO_TAG.
+	 */
+	template<typename Segments>
+	Tag walk(Fid fid, Fid nfid, Segments const& segments, Completion done) {
+		size_type messageSize = headerSize() + 2*sizeof(Fid) + sizeof(WalkPath::size_type);
+		for (auto const& segment : segments) {
+			messageSize += sizeof(var_datum_size_type) + Solace::StringView{segment}.size();
+		}
+
+		if (!fits(messageSize)) {
+			return Parser::NO_TAG;
+		}
+
+		return request(done, [&](RequestWriter& writer) -> TypedWriter {
+			auto pathWriter = writer.walk(fid, nfid);
+			for (auto const& segment : segments) {
+				pathWriter.path(segment);
+			}
+
+			return pathWriter.done();
+		});
+	}
+
+	/// Enqueue Open request, @see RequestWriter::open().
+	Tag open(Fid fid, OpenMode mode, Completion done) {
+		return request(done, [&](RequestWriter& writer) { return writer.open(fid, mode); });
+	}
+
+	/// Enqueue Create request, @see RequestWriter::create().
+	Tag create(Fid fid, Solace::StringView name, Solace::uint32 permissions, OpenMode mode, Completion done) {
+		return request(done, [&](RequestWriter& writer) { return writer.create(fid, name, permissions, mode); });
+	}
+
+	/// Enqueue Read request, @see RequestWriter::read().
+	Tag read(Fid fid, Solace::uint64 offset, size_type count, Completion done) {
+		return request(done, [&](RequestWriter& writer) { return writer.read(fid, offset, count); });
+	}
+
+	/// Enqueue Write request, @see RequestWriter::write(). Data is copied into the outbound buffer.
+	Tag write(Fid fid, Solace::uint64 offset, Solace::MemoryView data, Completion done) {
+		if (!fits(headerSize() + sizeof(Fid) + sizeof(offset) + sizeof(size_type) + data.size())) {
+			return Parser::NO_TAG;
+		}
+
+		return request(done, [&](RequestWriter& writer) { return writer.write(fid, offset).data(data); });
+	}
+
+	/// Enqueue Clunk request, @see RequestWriter::clunk().
+	Tag clunk(Fid fid, Completion done) {
+		return request(done, [&](RequestWriter& writer) { return writer.clunk(fid); });
+	}
+
+	/// Enqueue Remove request, @see RequestWriter::remove().
+	Tag remove(Fid fid, Completion done) {
+		return request(done, [&](RequestWriter& writer) { return writer.remove(fid); });
+	}
+
+	/// Enqueue Stat request, @see RequestWriter::stat().
+	Tag stat(Fid fid, Completion done) {
+		return request(done, [&](RequestWriter& writer) { return writer.stat(fid); });
+	}
+
+	/// Enqueue WStat request, @see RequestWriter::writeStat().
+	Tag writeStat(Fid fid, Stat const& stat, Completion done) {
+		return request(done, [&](RequestWriter& writer) { return writer.writeStat(fid, stat); });
+	}
+
+	/**
+	 * Enqueue Flush request for a request in flight.
+	 * Completion of the flushed request is still called if its response arrives before RFlush,
+	 * otherwise it is called with an error once RFlush is received.
+	 * Tag of the flushed request is not reused until RFlush is received, even if its response arrives first.
+	 * @param oldTag Tag of the request to flush.
+	 * @param done Completion to call with the RFlush response.
+	 * @return Tag of the flush request or Parser::NO_TAG.
+	 */
+	Tag flush(Tag oldTag, Completion done) {
+		auto const tag = enqueueRequest(PendingRequest{done, oldTag, 0},
+										[&](RequestWriter& writer) { return writer.flush(oldTag); });
+		if (tag != Parser::NO_TAG) {
+			if (auto flushed = _pending.find(oldTag)) {
+				flushed->flushesInFlight += 1;
+			}
+		}
+
+		return tag;
+	}
+
+	/**
+	 * Get encoded requests not yet sent.
+	 * @return View of the outbound data to send.
+	 */
+	Solace::MemoryView outbound() const noexcept {
+		return _outbound.viewWritten().slice(_sentPosition, _outbound.position());
+	}
+
+	/**
+	 * Account for outbound data sent by the transport.
+	 * Outbound buffer is reused from the start once all the data has been sent.
+	 * @param bytesSent Number of bytes from the start of outbound() that have been sent.
+	 */
+	void consumed(Solace::ByteWriter::size_type bytesSent) noexcept {
+		_sentPosition = std::min(_sentPosition + bytesSent, _outbound.position());
+		if (_sentPosition == _outbound.position()) {
+			_outbound.rewind();
+			_sentPosition = 0;
+		}
+	}
+
+	/**
+	 * Send outbound data with a transport until all is sent or the transport can not take any more.
+	 * @param transport An object with a method `Solace::Result<Solace::ByteWriter::size_type, Error>
+	 * send(Solace::MemoryView)` returning number of bytes sent, 0 if it would block.
+	 * @return Error of the transport or void.
+	 */
+	template<typename Transport>
+	Solace::Result<void, Error> send(Transport& transport) {
+		while (outbound().size() > 0) {
+			auto maybeSent = transport.send(outbound());
+			if (!maybeSent) {
+				return maybeSent.getError();
+			}
+
+			auto const bytesSent = maybeSent.unwrap();
+			if (bytesSent == 0) {
+				break;
+			}
+
+			consumed(bytesSent);
+		}
+
+		return Solace::Result<void, Error>{Solace::types::okTag};
+	}
+
+	/**
+	 * Feed data received from the connection. Completions of all the responses completed by the data are called.
+	 * A completion may enqueue new requests.
+	 * @param chunk Data received.
+	 * @return Error if the stream is ill-formed, void otherwise.
+	 */
+	Solace::Result<void, Error> receive(Solace::MemoryView chunk) {
+		return _assembler.feed(chunk, [this](MessageHeader const& header, Solace::ByteReader& payload) {
+			dispatch(header, _parser.parseCompressedResponse(header, payload, _decompression));
+		});
+	}
+
+	/**
+	 * Complete all the requests in flight with an error, when the connection is closed for example.
+	 * @param error Error to complete the requests with.
+	 */
+	void abort(Error const& error) {
+		if (_versionPending) {
+			complete(_versionPending, Parser::NO_TAG, Solace::Result<ResponseMessage, Error>{Solace::types::errTag, error});
+		}
+
+		for (Solace::uint32 i = 0; i < Capacity && !_pending.empty(); ++i) {
+			completePending(static_cast<Tag>(_pending.firstId() + i),
+							Solace::Result<ResponseMessage, Error>{Solace::types::errTag, error});
+		}
+
+		_assembler.reset();
+	}
+
+	/// @return Number of requests in flight, not including a version request.
+	/// Flushed requests are counted until RFlush is received.
+	Solace::uint32 inFlight() const noexcept { return _pending.size(); }
+
+	/// @return True if a request with a given tag is in flight.
+	bool isPending(Tag tag) const noexcept { return _pending.contains(tag); }
+
+	/// @return Number of responses received with a tag of no request in flight.
+	Solace::uint64 unexpectedResponses() const noexcept { return _unexpected; }
+
+	/// @return Maximum number of requests in flight.
+	static constexpr Solace::uint32 capacity() noexcept { return Capacity; }
+
+private:
+
+	/// A request in flight.
+	struct PendingRequest {
+		Completion	done;						//!< Completion to call with the response.
+		Tag			flushes{Parser::NO_TAG};	//!< Tag of the request being flushed if this is a flush request.
+		/// Number of flush requests of this request in flight. Tag is kept reserved until all are answered.
+		Solace::uint32	flushesInFlight{0};
+	};
+
+	/// Allocate a tag for a request and write the request into the outbound buffer.
+	template<typename Build>
+	Tag enqueueRequest(PendingRequest pending, Build&& build) {
+		auto const tag = _pending.allocate(pending);
+		if (tag == TagPool<PendingRequest, Capacity>::kInvalidId) {
+			return Parser::NO_TAG;
+		}
+
+		if (!enqueue(tag, build)) {
+			_pending.release(tag);
+			return Parser::NO_TAG;
+		}
+
+		return tag;
+	}
+
+	/**
+	 * Check if a message fits into the outbound buffer.
+	 * Messages with data or path segments are written piecewise and must be checked up front,
+	 * as a piece that did not fit can not be detected once the message is complete.
+	 */
+	bool fits(Solace::uint64 messageSize) const noexcept {
+		return messageSize <= _outbound.remaining() && messageSize <= _parser.maxNegotiatedMessageSize();
+	}
+
+	/// Write a message into the outbound buffer, rolling it back if doesn't fit.
+	template<typename Build>
+	bool enqueue(Tag tag, Build&& build) {
+		MessageBatch batch{_outbound, _parser.maxNegotiatedMessageSize()};
+		auto writer = batch.request(tag);
+
+		return batch.add(build(writer));
+	}
+
+	/// Call a completion, clearing the slot first so that the completion may enqueue new requests.
+	static void complete(Completion& slot, Tag tag, Solace::Result<ResponseMessage, Error>&& response) {
+		auto const completion = slot;
+		slot = Completion{};
+		completion(tag, Solace::mv(response));
+	}
+
+	/// Route a response to the completion of its request.
+	void dispatch(MessageHeader const& header, Solace::Result<ResponseMessage, Error>&& response) {
+		if (header.tag == Parser::NO_TAG) {
+			if (!_versionPending) {
+				_unexpected += 1;
+				return;
+			}
+
+			if (response && std::holds_alternative<Response::Version>(response.unwrap())) {
+				auto const& version = std::get<Response::Version>(response.unwrap());
+				_parser.setNegotiatedVersion(version.version);
+				_parser.maxNegotiatedMessageSize(std::min(version.msize, _parser.maxPossibleMessageSize()));
+			}
+
+			complete(_versionPending, header.tag, Solace::mv(response));
+			return;
+		}
+
+		auto const pending = _pending.find(header.tag);
+		if (!pending) {
+			_unexpected += 1;
+			return;
+		}
+
+		if (pending->flushesInFlight > 0) {
+			// Response to a flushed request: the tag stays reserved until the flush is answered,
+			// so that RFlush can not be confused with a new request reusing the tag.
+			if (!pending->done) {
+				_unexpected += 1;
+				return;
+			}
+
+			complete(pending->done, header.tag, Solace::mv(response));
+			return;
+		}
+
+		// Once the flush is answered the server will not respond to the flushed request.
+		auto const flushed = pending->flushes;
+		completePending(header.tag, Solace::mv(response));
+
+		if (flushed != Parser::NO_TAG) {
+			completeFlushed(flushed);
+		}
+	}
+
+	/// Account for an answered flush of a request, releasing its tag once all its flushes are answered.
+	void completeFlushed(Tag tag) {
+		auto const pending = _pending.find(tag);
+		if (!pending || pending->flushesInFlight == 0) {
+			return;
+		}
+
+		pending->flushesInFlight -= 1;
+		if (pending->flushesInFlight == 0) {
+			completePending(tag,
+							Solace::Result<ResponseMessage, Error>{Solace::types::errTag,
+																   getCannedError(CannedError::RequestFlushed)});
+		}
+	}
+
+	/// Release the tag of a request in flight and call its completion, unless it has already been called.
+	void completePending(Tag tag, Solace::Result<ResponseMessage, Error>&& response) {
+		auto const pending = _pending.find(tag);
+		if (!pending) {
+			return;
+		}
+
+		auto const completion = pending->done;
+		_pending.release(tag);
+		if (completion) {
+			completion(tag, Solace::mv(response));
+		}
+	}
+
+private:
+	/// Parser of the connection.
+	Parser&									_parser;
+	/// Buffer requests are encoded into.
+	Solace::ByteWriter						_outbound;
+	/// Position in the outbound buffer up to which data has been sent.
+	Solace::ByteWriter::size_type			_sentPosition{0};
+	/// Assembler of response frames.
+	FrameAssembler							_assembler;
+	/// Buffer compressed response data is decompressed into.
+	Solace::MutableMemoryView				_decompression;
+	/// Requests in flight by tag.
+	TagPool<PendingRequest, Capacity>		_pending;
+	/// Completion of a version request in flight.
+	Completion								_versionPending;
+	/// Number of responses that matched no request.
+	Solace::uint64							_unexpected{0};
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_PIPELINEDCLIENT_HPP
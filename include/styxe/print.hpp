@@ -25,5 +25,9 @@ namespace styxe {
 
     std::ostream& operator<< (std::ostream& ostr, MessageType t);
 
+    std::ostream& operator<< (std::ostream& ostr, ShortBatchOp op);
+
+    std::ostream& operator<< (std::ostream& ostr, ShortBatchStatus status);
+
 }  // end of namespace styxe
 #endif  // STYXE_PRINT_HPP
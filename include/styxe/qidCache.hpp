@@ -0,0 +1,396 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_QIDCACHE_HPP
+#define STYXE_QIDCACHE_HPP
+
+#include "9p2000.hpp"
+#include "dirListingReader.hpp"  // StatView
+#include "encoder.hpp"
+
+#include <cstring>  // std::memcpy, std::memcmp
+
+
+namespace styxe {
+
+/**
+ * Fixed capacity open-addressing index shared by the caches of walk and stat results.
+ * Keeps a compact array of 32 bit key hashes, so that probing touches as few cache lines as possible
+ * and entries themselves are only compared when their hash matches.
+ *
+ * Probing is linear and bounded by kProbeLimit slots. If no free slot is found within the probe window
+ * the entry at the home slot of the key is evicted. Since the table never grows it is never rehashed.
+ *
+ * @tparam Capacity Number of slots in the table, must be a power of 2.
+ */
+template<Solace::uint32 Capacity>
+struct ProbingIndex {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+	/// Maximum number of slots inspected by a lookup.
+	static constexpr Solace::uint32 kProbeLimit = (Capacity < 8) ? Capacity : 8;
+
+	/// Slot index value for a missing key.
+	static constexpr Solace::uint32 kNoSlot = Capacity;
+
+	/**
+	 * Find a slot holding a key.
+	 * @param hash Hash of the key, @see hashKey.
+	 * @param match Predicate checking if the entry in the given slot is equal to the key.
+	 * @return Slot index or kNoSlot if the key is not in the table.
+	 */
+	template<typename Match>
+	Solace::uint32 find(Solace::uint32 hash, Match&& match) const noexcept {
+		for (Solace::uint32 i = 0; i < kProbeLimit; ++i) {
+			auto const slot = (hash + i) & (Capacity - 1);
+			if (_hashes[slot] == hash && match(slot)) {
+				return slot;
+			}
+		}
+
+		return kNoSlot;
+	}
+
+	/**
+	 * Claim a slot for a new key. Key must not already be in the table.
+	 * @param hash Hash of the key, @see hashKey.
+	 * @return Index of a free slot or of the evicted one.
+	 */
+	Solace::uint32 claim(Solace::uint32 hash) noexcept {
+		for (Solace::uint32 i = 0; i < kProbeLimit; ++i) {
+			auto const slot = (hash + i) & (Capacity - 1);
+			if (_hashes[slot] == kEmpty) {
+				_hashes[slot] = hash;
+				_size += 1;
+				return slot;
+			}
+		}
+
+		auto const slot = hash & (Capacity - 1);
+		_hashes[slot] = hash;
+		return slot;
+	}
+
+	/**
+	 * Free a slot.
+	 * @param slot Index of an occupied slot.
+	 */
+	void release(Solace::uint32 slot) noexcept {
+		_hashes[slot] = kEmpty;
+		_size -= 1;
+	}
+
+	/// Free all the slots.
+	void clear() noexcept {
+		for (auto& hash : _hashes) {
+			hash = kEmpty;
+		}
+		_size = 0;
+	}
+
+	/// @return Number of occupied slots.
+	Solace::uint32 size() const noexcept { return _size; }
+
+	/**
+	 * Mix a key into a non-zero hash value used by the index.
+	 * @param id Id part of the key, such as Qid.path.
+	 * @param salt Additional part of the key, such as a hash of a name.
+	 * @return Hash value of the key.
+	 */
+	static constexpr Solace::uint32 hashKey(Solace::uint64 id, Solace::uint32 salt) noexcept {
+		Solace::uint32 hash = static_cast<Solace::uint32>(id ^ (id >> 32)) * 0x9E3779B1u;
+		hash ^= salt;
+		hash ^= hash >> 16;
+		hash *= 0x85EBCA6Bu;
+		hash ^= hash >> 13;
+
+		return (hash != kEmpty) ? hash : 1;
+	}
+
+private:
+	/// Hash value of a free slot.
+	static constexpr Solace::uint32 kEmpty = 0;
+
+	/// Hashes of the keys by slot.
+	Solace::uint32	_hashes[Capacity] = {};
+	/// Number of occupied slots.
+	Solace::uint32	_size{0};
+};
+
+
+/**
+ * A bounded cache of walk results, mapping a (directory, name) pair to the qid of the file it resolves to.
+ * Entries are tagged with the version of the directory qid they have been resolved in: once the directory
+ * changes and reports a new qid version, its cached entries are missed and evicted on lookup.
+ *
+ * The cache never allocates memory and is not synchronized: it is meant to be owned by a single worker thread.
+ *
+ * \code{.cpp}
+...
+	IndexedWalkPath const path{request.path};
+	Qid qid = fidState.qid;
+	for (IndexedWalkPath::size_type i = 0; i < path.size(); ++i) {
+		auto const parent = qid;
+		if (auto cached = walkCache.find(parent, path, i)) {
+			qid = *cached;
+		} else {
+			qid = backend.resolve(parent, path[i]);
+			walkCache.insert(parent, path, i, qid);
+		}
+		qids[i] = qid;
+	}
+...
+ * \endcode
+ *
+ * @tparam Capacity Number of entries in the cache, must be a power of 2.
+ * @tparam MaxNameSize Maximum length of a name that can be cached, longer names are never cached.
+ */
+template<Solace::uint32 Capacity, Solace::uint16 MaxNameSize = 64>
+struct WalkCache {
+
+	/**
+	 * Find a cached result of a walk.
+	 * @param parent Qid of the directory the name is resolved in.
+	 * @param name Name of the entry in the directory.
+	 * @param nameHash Hash of the name, @see IndexedWalkPath::hashOf.
+	 * @return Pointer to the cached qid or nullptr if the result is not in the cache.
+	 */
+	Qid const* find(Qid parent, Solace::StringView name, Solace::uint32 nameHash) noexcept {
+		auto const hash = Index::hashKey(parent.path, nameHash);
+		auto const slot = _index.find(hash, [&](Solace::uint32 i) noexcept {
+			return _entries[i].matches(parent.path, name);
+		});
+
+		if (slot == Index::kNoSlot) {
+			return nullptr;
+		}
+
+		auto const& entry = _entries[slot];
+		if (entry.parentVersion != parent.version) {  // The directory has changed since
+			_index.release(slot);
+			return nullptr;
+		}
+
+		return &entry.qid;
+	}
+
+	/**
+	 * Find a cached result of a walk for a segment of the walk path.
+	 * @param parent Qid of the directory the segment is resolved in.
+	 * @param path Walk path.
+	 * @param index Index of the segment in the path.
+	 * @return Pointer to the cached qid or nullptr if the result is not in the cache.
+	 */
+	Qid const* find(Qid parent, IndexedWalkPath const& path, IndexedWalkPath::size_type index) noexcept {
+		return find(parent, path[index], path.hash(index));
+	}
+
+	/**
+	 * Cache a result of a walk.
+	 * @param parent Qid of the directory the name has been resolved in.
+	 * @param name Name of the entry in the directory.
+	 * @param nameHash Hash of the name, @see IndexedWalkPath::hashOf.
+	 * @param qid Qid of the file the name resolves to.
+	 * @return True if the result has been cached, false if the name is too long to be cached.
+	 */
+	bool insert(Qid parent, Solace::StringView name, Solace::uint32 nameHash, Qid qid) noexcept {
+		if (name.size() > MaxNameSize) {
+			return false;
+		}
+
+		auto const hash = Index::hashKey(parent.path, nameHash);
+		auto slot = _index.find(hash, [&](Solace::uint32 i) noexcept {
+			return _entries[i].matches(parent.path, name);
+		});
+		if (slot == Index::kNoSlot) {
+			slot = _index.claim(hash);
+		}
+
+		auto& entry = _entries[slot];
+		entry.parentPath = parent.path;
+		entry.parentVersion = parent.version;
+		entry.qid = qid;
+		entry.nameSize = static_cast<Solace::uint16>(name.size());
+		std::memcpy(entry.name, name.data(), name.size());
+
+		return true;
+	}
+
+	/**
+	 * Cache a result of a walk of a segment of the walk path.
+	 * @param parent Qid of the directory the segment has been resolved in.
+	 * @param path Walk path.
+	 * @param index Index of the segment in the path.
+	 * @param qid Qid of the file the segment resolves to.
+	 * @return True if the result has been cached, false if the segment is too long to be cached.
+	 */
+	bool insert(Qid parent, IndexedWalkPath const& path, IndexedWalkPath::size_type index, Qid qid) noexcept {
+		return insert(parent, path[index], path.hash(index), qid);
+	}
+
+	/// Remove all entries from the cache.
+	void clear() noexcept { _index.clear(); }
+
+	/// @return Number of entries in the cache.
+	Solace::uint32 size() const noexcept { return _index.size(); }
+
+	/// @return Maximum number of entries the cache can hold.
+	static constexpr Solace::uint32 capacity() noexcept { return Capacity; }
+
+private:
+	using Index = ProbingIndex<Capacity>;
+
+	/// Cached walk result.
+	struct Entry {
+		Solace::uint64		parentPath;         //!< Qid.path of the directory.
+		Solace::uint32		parentVersion;      //!< Qid.version of the directory.
+		Qid					qid;                //!< Qid of the resolved file.
+		Solace::uint16		nameSize;           //!< Length of the name.
+		char				name[MaxNameSize];  //!< Name resolved.
+
+		bool matches(Solace::uint64 path, Solace::StringView value) const noexcept {
+			return (parentPath == path &&
+					nameSize == value.size() &&
+					std::memcmp(name, value.data(), nameSize) == 0);
+		}
+	};
+
+	/// Index of the cache entries.
+	Index		_index;
+	/// Entries by slot.
+	Entry		_entries[Capacity];
+};
+
+
+/**
+ * A bounded cache of encoded Stat structures, keyed by the Qid of the file.
+ * Stats are stored in wire format, so that a stat response can be written with a single copy of cached bytes,
+ * @see ResponseWriter::stat(StatView const&). Cached stat is valid only for the qid version it has been
+ * encoded for: lookup with a newer version misses and evicts the entry.
+ *
+ * The cache never allocates memory and is not synchronized: it is meant to be owned by a single worker thread.
+ *
+ * @tparam Capacity Number of entries in the cache, must be a power of 2.
+ * @tparam MaxStatSize Maximum size of an encoded stat that can be cached, larger stats are never cached.
+ */
+template<Solace::uint32 Capacity, Solace::uint16 MaxStatSize = 256>
+struct StatCache {
+
+	/**
+	 * Find a cached stat of a file.
+	 * @param qid Qid of the file.
+	 * @return View of the cached encoded stat. View has no data if the stat is not in the cache.
+	 */
+	StatView find(Qid qid) noexcept {
+		auto const slot = _index.find(Index::hashKey(qid.path, 0), [&](Solace::uint32 i) noexcept {
+			return _entries[i].path == qid.path;
+		});
+
+		if (slot == Index::kNoSlot) {
+			return StatView{};
+		}
+
+		auto const& entry = _entries[slot];
+		if (entry.version != qid.version) {  // The file has changed since
+			_index.release(slot);
+			return StatView{};
+		}
+
+		return StatView{Solace::wrapMemory(entry.data, entry.size)};
+	}
+
+	/**
+	 * Encode and cache a stat of a file. Stat is cached for the qid recorded in the stat.
+	 * @param stat Stat to cache.
+	 * @return True if the stat has been cached, false if its encoding is too large to be cached.
+	 */
+	bool insert(Stat const& stat) {
+		auto const encodedSize = Encoder::protocolSize(stat);
+		if (encodedSize > MaxStatSize) {
+			return false;
+		}
+
+		auto& entry = claim(stat.qid);
+		UncheckedEncoder encoder{Solace::wrapMemory(entry.data, encodedSize)};
+		encoder << stat;
+		entry.size = static_cast<Solace::uint16>(encodedSize);
+
+		return true;
+	}
+
+	/**
+	 * Cache an already encoded stat of a file. Stat is cached for the qid recorded in the stat.
+	 * @param stat Encoded stat to cache.
+	 * @return True if the stat has been cached, false if it is too large to be cached.
+	 */
+	bool insert(StatView stat) noexcept {
+		auto const data = stat.data();
+		if (data.size() > MaxStatSize) {
+			return false;
+		}
+
+		auto& entry = claim(stat.qid());
+		std::memcpy(entry.data, data.begin(), data.size());
+		entry.size = static_cast<Solace::uint16>(data.size());
+
+		return true;
+	}
+
+	/// Remove all entries from the cache.
+	void clear() noexcept { _index.clear(); }
+
+	/// @return Number of entries in the cache.
+	Solace::uint32 size() const noexcept { return _index.size(); }
+
+	/// @return Maximum number of entries the cache can hold.
+	static constexpr Solace::uint32 capacity() noexcept { return Capacity; }
+
+private:
+	using Index = ProbingIndex<Capacity>;
+
+	/// Cached encoded stat.
+	struct Entry {
+		Solace::uint64		path;               //!< Qid.path of the file.
+		Solace::uint32		version;            //!< Qid.version of the file.
+		Solace::uint16		size;               //!< Size of the encoded stat.
+		Solace::byte		data[MaxStatSize];  //!< Encoded stat.
+	};
+
+	/// Find or allocate an entry for the qid.
+	Entry& claim(Qid qid) noexcept {
+		auto const hash = Index::hashKey(qid.path, 0);
+		auto slot = _index.find(hash, [&](Solace::uint32 i) noexcept {
+			return _entries[i].path == qid.path;
+		});
+		if (slot == Index::kNoSlot) {
+			slot = _index.claim(hash);
+		}
+
+		auto& entry = _entries[slot];
+		entry.path = qid.path;
+		entry.version = qid.version;
+
+		return entry;
+	}
+
+	/// Index of the cache entries.
+	Index		_index;
+	/// Entries by slot.
+	Entry		_entries[Capacity];
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_QIDCACHE_HPP
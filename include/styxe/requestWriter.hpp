@@ -36,17 +36,26 @@ struct RequestWriter {
 		 * @param buffer A byte stream to write the resulting message to.
 		 * @param pos A position in the stream where the message header has been written.
 		 * @param header Message header.
+		 * @param started Time when encoding of the message has started.
+		 * @param compression Compression policy for the data payload.
 		 */
-		DataWriter(Solace::ByteWriter& buffer, Solace::ByteWriter::size_type pos, MessageHeader header) noexcept
-			: TypedWriter{buffer, pos, header}
+		DataWriter(Solace::ByteWriter& buffer, Solace::ByteWriter::size_type pos, MessageHeader header,
+				   metrics::Stopwatch started = {}, CompressionPolicy compression = {}) noexcept
+			: TypedWriter{buffer, pos, header, started}
+			, _compression{compression}
 		{}
 
 		/**
 		 * @brief Write data segement into the message
+		 * Data is compressed if the compression policy allows.
+		 * @note Use TypedWriter::build(Solace::MemoryView) instead to keep the data out of line and avoid a copy.
 		 * @param data Data to be written as a message payload
 		 * @return TypedWriter to continue message building process
 		 */
 		TypedWriter data(Solace::MemoryView data);
+
+	private:
+		CompressionPolicy	_compression;  //!< Compression policy for the data payload.
 	};
 
 	/// Message writer for messages that include repeated path segments.
@@ -58,8 +67,10 @@ struct RequestWriter {
 		 * @param buffer A byte stream to write the resulting message to.
 		 * @param pos A position in the stream where the message header has been written.
 		 * @param header Message header.
+		 * @param started Time when encoding of the message has started.
 		 */
-		PathWriter(Solace::ByteWriter& buffer, Solace::ByteWriter::size_type pos, MessageHeader header) noexcept;
+		PathWriter(Solace::ByteWriter& buffer, Solace::ByteWriter::size_type pos, MessageHeader header,
+				   metrics::Stopwatch started = {}) noexcept;
 
 		/**
 		 * @brief Write path segment into the current message.
@@ -88,8 +99,11 @@ struct RequestWriter {
 		 * @param buffer A byte stream to write the resulting message to.
 		 * @param pos A position in the stream where the message header has been written.
 		 * @param header Message header.
+		 * @param started Time when encoding of the message has started.
+		 * @param compression Compression policy for the data payload.
 		 */
-		PathDataWriter(Solace::ByteWriter& buffer, Solace::ByteWriter::size_type pos, MessageHeader header) noexcept;
+		PathDataWriter(Solace::ByteWriter& buffer, Solace::ByteWriter::size_type pos, MessageHeader header,
+					   metrics::Stopwatch started = {}, CompressionPolicy compression = {}) noexcept;
 
 		/**
 		 * @brief Write path segment into the current message.
@@ -103,6 +117,74 @@ struct RequestWriter {
 		WalkPath::size_type				_nSegments{0};  //!< Number of path segments written
 	};
 
+	/**
+	 * Message writer for batched short read/write request: a sequence of entries, each made of an operation
+	 * followed by the path segments of the file to operate on.
+	 * \code{.cpp}
+	RequestWriter{buffer, tag}
+		.shortBatch(rootFid)
+			.read().path("etc").path("hosts")
+			.write(data).path("var").path("state")
+		.done()
+		.build();
+	 * \endcode
+	 * @note Entries are appended piecewise, thus when writing into a MessageBatch check that the whole message fits
+	 * before building it, @see MessageBatch::fits.
+	 */
+	struct ShortBatchWriter
+			: public TypedWriter
+	{
+		/**
+		 * @brief Construct a new ShortBatchWriter. @see TypedWriter for more details.
+		 * @param buffer A byte stream to write the resulting message to.
+		 * @param pos A position in the stream where the message header has been written.
+		 * @param header Message header.
+		 * @param started Time when encoding of the message has started.
+		 */
+		ShortBatchWriter(Solace::ByteWriter& buffer, Solace::ByteWriter::size_type pos, MessageHeader header,
+						 metrics::Stopwatch started = {}) noexcept;
+
+		/**
+		 * @brief Start a new entry to read entire contents of a file.
+		 * @return A reference to this for fluent interface.
+		 */
+		ShortBatchWriter& read();
+
+		/**
+		 * @brief Start a new entry to overwrite contents of a file.
+		 * @param data Data to be written into the file.
+		 * @return A reference to this for fluent interface.
+		 */
+		ShortBatchWriter& write(Solace::MemoryView data);
+
+		/**
+		 * @brief Write path segment of the file of the current entry.
+		 * @param pathSegment Path segment to write next in the current entry.
+		 * @return A reference to this for fluent interface.
+		 */
+		ShortBatchWriter& path(Solace::StringView pathSegment);
+
+		/**
+		 * @brief Finilize message builder
+		 * @return Typed message writer
+		 */
+		TypedWriter done() noexcept { return *this; }
+
+		/** Get number of entries written.
+		 * @return Number of entries in the message being built.
+		 */
+		constexpr ShortBatchEntries::size_type entriesCount() const noexcept { return _nEntries; }
+
+	private:
+		/// Write an operation code starting a new entry.
+		void beginEntry(ShortBatchOp op);
+
+		Solace::ByteWriter::size_type	_entriesPos;		//!< A position in the output stream where entries start.
+		ShortBatchEntries::size_type	_nEntries{0};		//!< Number of entries written.
+		Solace::ByteWriter::size_type	_segmentsPos{0};	//!< A position where segments of the current entry start.
+		WalkPath::size_type				_nSegments{0};		//!< Number of path segments of the current entry.
+	};
+
 
 public:
 
@@ -110,10 +192,12 @@ public:
 	 * @brief Construct a new RequestWriter.
 	 * @param dest A byte writer stream where data to be written.
 	 * @param tag Tag of the message being created.
+	 * @param compression Compression of data payloads negotiated for the session, @see PayloadCompression.
 	 */
-	constexpr RequestWriter(Solace::ByteWriter& dest, Tag tag = 1) noexcept
+	constexpr RequestWriter(Solace::ByteWriter& dest, Tag tag = 1, CompressionPolicy compression = {}) noexcept
 		: _buffer{dest}
 		, _tag{tag}
+		, _compression{compression}
 	{}
 
 	/**
@@ -246,12 +330,23 @@ public:
 	 */
 	PathDataWriter shortWrite(Fid rootFid);
 
+	/* 9P2000.eb extention */
+	/**
+	 * @brief Create batched short read/write request.
+	 * @param rootFid User provided fid of the directory to walk paths of all the entries from.
+	 * @return Message builder.
+	 */
+	ShortBatchWriter shortBatch(Fid rootFid);
+
 private:
 	/// Byte writer where all data goes
 	Solace::ByteWriter&     _buffer;
 
 	/// Message tag
 	Tag const               _tag;
+
+	/// Compression of data payloads
+	CompressionPolicy const	_compression;
 };
 
 }  // end of namespace styxe
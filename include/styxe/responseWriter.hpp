@@ -21,19 +21,84 @@
 
 namespace styxe {
 
+struct StatView;
+struct EncodedError;
+
 /**
  * Helper class to build response messages.
  */
 struct ResponseWriter {
 
+	/**
+	 * Message writer for batched short read/write response: an outcome for each entry of the request,
+	 * written in the order of the request entries.
+	 * @note Entries are appended piecewise, thus when writing into a MessageBatch check that the whole message fits
+	 * before building it, @see MessageBatch::fits.
+	 */
+	struct ShortBatchWriter
+			: public TypedWriter
+	{
+		/**
+		 * @brief Construct a new ShortBatchWriter. @see TypedWriter for more details.
+		 * @param buffer A byte stream to write the resulting message to.
+		 * @param pos A position in the stream where the message header has been written.
+		 * @param header Message header.
+		 * @param started Time when encoding of the message has started.
+		 */
+		ShortBatchWriter(Solace::ByteWriter& buffer, Solace::ByteWriter::size_type pos, MessageHeader header,
+						 metrics::Stopwatch started = {}) noexcept;
+
+		/**
+		 * @brief Write an outcome of a successful read.
+		 * @param data Contents of the file read.
+		 * @return A reference to this for fluent interface.
+		 */
+		ShortBatchWriter& data(Solace::MemoryView data);
+
+		/**
+		 * @brief Write an outcome of a successful write.
+		 * @param count Number of bytes written into the file.
+		 * @return A reference to this for fluent interface.
+		 */
+		ShortBatchWriter& written(size_type count);
+
+		/**
+		 * @brief Write an outcome of a failed operation.
+		 * @param message Error message to communicate back to the client.
+		 * @return A reference to this for fluent interface.
+		 */
+		ShortBatchWriter& error(Solace::StringView message);
+
+		/**
+		 * @brief Finilize message builder
+		 * @return Typed message writer
+		 */
+		TypedWriter done() noexcept { return *this; }
+
+		/** Get number of entries written.
+		 * @return Number of entries in the message being built.
+		 */
+		constexpr ShortBatchResults::size_type entriesCount() const noexcept { return _nEntries; }
+
+	private:
+		/// Write a status code starting a new entry.
+		void beginEntry(ShortBatchStatus status);
+
+		Solace::ByteWriter::size_type	_entriesPos;	//!< A position in the output stream where entries start.
+		ShortBatchResults::size_type	_nEntries{0};	//!< Number of entries written.
+	};
+
+
 	/**
 	 * @brief Construct a new ResponseWriter.
 	 * @param dest A byte writer stream where data to be written.
 	 * @param tag Tag of the message being created.
+	 * @param compression Compression of data payloads negotiated for the session, @see PayloadCompression.
 	 */
-	constexpr ResponseWriter(Solace::ByteWriter& dest, Tag tag) noexcept
+	constexpr ResponseWriter(Solace::ByteWriter& dest, Tag tag, CompressionPolicy compression = {}) noexcept
 		: _buffer{dest}
 		, _tag{tag}
+		, _compression{compression}
 	{}
 
 	/**
@@ -60,12 +125,28 @@ struct ResponseWriter {
 
 	/**
 	 * @brief Create error response from a Solace::Error type.
+	 * Protocol errors, @see getCannedError, are written without formatting or allocating the message.
+	 * Message of any other error is formatted with Error::toString that allocates:
+	 * use error(EncodedError) with an ErrorTable on the hot path instead.
 	 * @param err System error type to communicate back to the client.
 	 * @return Message builder.
 	 */
-	TypedWriter error(Solace::Error const& err) {
-		return error(err.toString().view());
-	}
+	TypedWriter error(Solace::Error const& err);
+
+	/**
+	 * @brief Create error response from a pre-encoded error, without formatting or allocating the message.
+	 * @see ErrorTable
+	 * @param err Pre-encoded error. Empty error results in a response with an empty message.
+	 * @return Message builder.
+	 */
+	TypedWriter error(EncodedError const& err);
+
+	/**
+	 * @brief Create error response for a canned protocol error, without formatting or allocating the message.
+	 * @param errorId Id of the canned error.
+	 * @return Message builder.
+	 */
+	TypedWriter error(CannedError errorId);
 
 	/**
 	 * @brief Create Flush response.
@@ -105,11 +186,20 @@ struct ResponseWriter {
 
 	/**
 	 * @brief Create Read file respose.
+	 * Data is compressed if the compression policy of the writer allows.
 	 * @param data Data read from the file to be sent back to the client.
 	 * @return Message builder.
 	 */
 	TypedWriter read(Solace::MemoryView data);
 
+	/**
+	 * @brief Create Read file respose with the data kept out of line.
+	 * The message must be finalized with TypedWriter::build(Solace::MemoryView) given the data read from the file,
+	 * so that the data is not copied into the message buffer.
+	 * @return Message builder.
+	 */
+	TypedWriter read();
+
 	/**
 	 * @brief Create Write file response.
 	 * @param iounit Number of bytes written.
@@ -136,6 +226,14 @@ struct ResponseWriter {
 	 */
 	TypedWriter stat(Stat const& value);
 
+	/**
+	 * @brief Create stat response from an already encoded stat, such as one kept in a StatCache.
+	 * Encoded stat is copied as is.
+	 * @param value View of the encoded stat data.
+	 * @return Message builder.
+	 */
+	TypedWriter stat(StatView const& value);
+
 	/**
 	 * @brief Create Write Stats.
 	 * @return Message builder.
@@ -153,11 +251,19 @@ struct ResponseWriter {
 
 	/**
 	 * @brief Create ShortRead respose.
+	 * Data is compressed if the compression policy of the writer allows.
 	 * @param data Data read from the file to be sent back to the client.
 	 * @return Message builder.
 	 */
 	TypedWriter shortRead(Solace::MemoryView data);
 
+	/**
+	 * @brief Create ShortRead respose with the data kept out of line.
+	 * @see read() for details.
+	 * @return Message builder.
+	 */
+	TypedWriter shortRead();
+
 	/**
 	 * @brief Create ShortWrite respose.
 	 * @param iounit Number of bytes actually written.
@@ -165,12 +271,23 @@ struct ResponseWriter {
 	 */
 	TypedWriter shortWrite(size_type iounit);
 
+	/* 9P2000.eb extention */
+
+	/**
+	 * @brief Create batched short read/write response.
+	 * @return Message builder.
+	 */
+	ShortBatchWriter shortBatch();
+
 private:
 	/// Byte writer where all data goes
 	Solace::ByteWriter&     _buffer;
 
 	/// Message tag
 	Tag const               _tag;
+
+	/// Compression of data payloads
+	CompressionPolicy const	_compression;
 };
 
 
@@ -0,0 +1,275 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_SHAREDRING_HPP
+#define STYXE_SHAREDRING_HPP
+
+#include "9p2000.hpp"
+
+#include <atomic>
+
+
+namespace styxe {
+
+/// Alignment of messages in a shared ring. Frames start at aligned offsets, so that a wrap marker always fits.
+constexpr size_type kRingFrameAlignment = 8;
+
+/// Size of a cache line, used to keep positions written by the producer and the consumer apart.
+constexpr Solace::MemoryView::size_type kRingCacheLineSize = 64;
+
+
+/**
+ * Control block at the start of a shared ring memory.
+ * Ring positions are monotonic byte counters, offset in the ring data is the position modulo capacity.
+ * Frames are 9P messages, each starting at an aligned offset. A frame that does not fit before the end of the ring
+ * is preceded by a wrap marker: a zero message size, that is never a valid 9P message size.
+ */
+struct SharedRingControl {
+	static_assert(std::atomic<Solace::uint64>::is_always_lock_free, "Ring positions must be lock free");
+	static_assert(std::atomic<Solace::uint32>::is_always_lock_free, "Ring wait flags must be lock free");
+
+	/// Value of the magic field of an initialized ring.
+	static constexpr Solace::uint32 kMagic = 0x39505247;  // "9PRG"
+
+	Solace::uint32							magic;			//!< Marker of an initialized ring.
+	size_type								capacity;		//!< Size of the ring data in bytes, power of two.
+
+	alignas(kRingCacheLineSize) std::atomic<Solace::uint64>	head;	//!< Position of the end of published frames.
+	alignas(kRingCacheLineSize) std::atomic<Solace::uint64>	tail;	//!< Position of the end of consumed frames.
+
+	alignas(kRingCacheLineSize) std::atomic<Solace::uint32>	consumerWaiting;  //!< Consumer waits for frames.
+	std::atomic<Solace::uint32>								producerWaiting;  //!< Producer waits for space.
+};
+
+
+/**
+ * Get capacity of a shared ring able to hold the given number of messages of the maximum size.
+ * @param maxMessageSize Negotiated maximum message size, @see Parser::maxNegotiatedMessageSize.
+ * @param depth Number of maximum size messages the ring must hold. At least 2 is required for a message
+ * of the maximum size to always fit after a wrap marker.
+ * @return Ring capacity in bytes.
+ */
+constexpr size_type sharedRingCapacity(size_type maxMessageSize, Solace::uint32 depth = 4) noexcept {
+	auto const frameSize = (static_cast<Solace::uint64>(maxMessageSize) + kRingFrameAlignment - 1) &
+			~static_cast<Solace::uint64>(kRingFrameAlignment - 1);
+	auto const minCapacity = frameSize * (depth < 2 ? 2 : depth);
+
+	Solace::uint64 capacity = kRingFrameAlignment;
+	while (capacity < minCapacity) {
+		capacity <<= 1;
+	}
+
+	return static_cast<size_type>(capacity);
+}
+
+/**
+ * Get size of the memory, including the control block, required to hold a shared ring.
+ * @param capacity Capacity of the ring, @see sharedRingCapacity.
+ * @return Size of the memory in bytes.
+ */
+constexpr Solace::MemoryView::size_type sharedRingMemorySize(size_type capacity) noexcept {
+	return sizeof(SharedRingControl) + capacity;
+}
+
+/**
+ * Initialize an empty ring in the memory shared between a producer and a consumer.
+ * Ring must be initialized once, before either of the sides attach to it.
+ * @param memory Shared memory aligned to kRingCacheLineSize. Capacity of the ring is the largest power of two
+ * that fits into the memory after the control block.
+ * @return Capacity of the initialized ring.
+ */
+size_type initializeSharedRing(Solace::MutableMemoryView memory);
+
+
+/**
+ * Producer side of a single-producer/single-consumer ring of 9P messages in shared memory.
+ *
+ * Messages are encoded in place: RequestWriter or ResponseWriter write straight into a slot reserved in the ring
+ * and the consumer parses them from the same memory, so no copy is made in either direction.
+ * Committed messages become visible to the consumer only when published, so that many messages
+ * can be handed over with a single memory barrier and at most one wakeup.
+ *
+ * The ring does no I/O: waking up a sleeping peer, e.g. with a futex or an eventfd, is up to the transport.
+ * \code{.cpp}
+...
+	RingProducer ring{sharedMemory};
+	auto slot = ring.reserve(parser.maxNegotiatedMessageSize());
+	ByteWriter writer{slot};
+	RequestWriter{writer, tag}
+		.walk(fid, newFid)
+		.path("etc")
+		.done()
+		.build();
+	ring.commit(writer.viewRemaining().size());
+	...
+	if (ring.publish()) {
+		eventfd_write(consumerEvent, 1);
+	}
+...
+ * \endcode
+ */
+struct RingProducer {
+
+	/**
+	 * Attach to an initialized shared ring.
+	 * @param memory Shared memory of the ring, @see initializeSharedRing.
+	 */
+	explicit RingProducer(Solace::MutableMemoryView memory);
+
+	RingProducer(RingProducer const&) = delete;
+	RingProducer& operator= (RingProducer const&) = delete;
+
+	/**
+	 * Reserve a contiguous slot in the ring to write a message into.
+	 * @param size Size of the slot, no less then the size of the message to be written.
+	 * @return Slot memory or an empty view if the ring does not have enough free space.
+	 */
+	Solace::MutableMemoryView reserve(size_type size) noexcept;
+
+	/**
+	 * Commit a message written into the slot reserved last. Message is not visible to the consumer until published.
+	 * @param messageSize Size of the message written, as encoded in its header.
+	 */
+	void commit(size_type messageSize);
+
+	/**
+	 * Make all the committed messages visible to the consumer.
+	 * @return True if the consumer is waiting for messages and has to be woken up.
+	 */
+	bool publish() noexcept;
+
+	/**
+	 * Prepare to wait for the consumer to free space in the ring.
+	 * @param size Size of the slot the producer is waiting for.
+	 * @return True if the producer may go to sleep until woken by the consumer,
+	 * false if the space has become available meanwhile.
+	 */
+	bool prepareWait(size_type size) noexcept;
+
+	/// @return Capacity of the ring in bytes.
+	size_type capacity() const noexcept { return _capacity; }
+
+private:
+	/// Check if the ring has at least given number of free bytes, refreshing the consumer position if needed.
+	bool hasSpace(Solace::uint64 size) noexcept;
+
+	SharedRingControl&			_control;
+	Solace::MutableMemoryView	_data;
+	size_type const				_capacity;
+	Solace::uint64				_head;  		//!< Position of the end of committed messages.
+	Solace::uint64				_tailCache;  	//!< Last known position of the consumer.
+	size_type					_reserved{0};	//!< Size of the last reserved slot.
+};
+
+
+/**
+ * Consumer side of a single-producer/single-consumer ring of 9P messages in shared memory.
+ * Messages are handed to the handler as views into the ring memory, to be parsed in place.
+ * Space occupied by the messages is returned to the producer only when consumed messages are published,
+ * thus views remain valid until then.
+ * \code{.cpp}
+...
+	RingConsumer ring{parser, sharedMemory};
+	ring.receive([&](MessageHeader const& header, ByteReader& payload) {
+		parser.parseRequest(header, payload)
+			.then(handleRequest);
+	});
+	if (ring.publish()) {
+		eventfd_write(producerEvent, 1);
+	}
+...
+ * \endcode
+ */
+struct RingConsumer {
+
+	/**
+	 * Attach to an initialized shared ring.
+	 * @param parser Protocol parser used to parse and validate message headers.
+	 * @param memory Shared memory of the ring, @see initializeSharedRing.
+	 */
+	RingConsumer(Parser const& parser, Solace::MutableMemoryView memory);
+
+	RingConsumer(RingConsumer const&) = delete;
+	RingConsumer& operator= (RingConsumer const&) = delete;
+
+	/**
+	 * Receive all the messages published by the producer so far.
+	 * @param handler A callable with a signature `void (MessageHeader const&, Solace::ByteReader&)`
+	 * to be called for each message in the ring.
+	 * @return Number of messages received or an error if an ill-formed frame has been found in the ring.
+	 */
+	template<typename Handler>
+	Solace::Result<Solace::uint32, Error>
+	receive(Handler&& handler) {
+		Solace::uint32 count = 0;
+		while (true) {
+			auto maybeFrame = nextFrame();
+			if (!maybeFrame) {
+				return maybeFrame.getError();
+			}
+
+			auto const frame = *maybeFrame;
+			if (frame.empty()) {
+				break;
+			}
+
+			Solace::ByteReader reader{frame};
+			auto maybeHeader = _parser.parseMessageHeader(reader);
+			if (!maybeHeader) {
+				return maybeHeader.getError();
+			}
+
+			handler(*maybeHeader, reader);
+			consume(frame.size());
+			count += 1;
+		}
+
+		return Solace::Result<Solace::uint32, Error>{Solace::types::okTag, count};
+	}
+
+	/**
+	 * Return space of all the messages received to the producer.
+	 * @return True if the producer is waiting for space and has to be woken up.
+	 */
+	bool publish() noexcept;
+
+	/**
+	 * Prepare to wait for the producer to publish messages.
+	 * @return True if the consumer may go to sleep until woken by the producer,
+	 * false if messages have been published meanwhile.
+	 */
+	bool prepareWait() noexcept;
+
+	/// @return Capacity of the ring in bytes.
+	size_type capacity() const noexcept { return _capacity; }
+
+private:
+	/// Get next frame in the ring or an empty view if there are no published frames.
+	Solace::Result<Solace::MemoryView, Error> nextFrame();
+
+	/// Mark a frame of the given size as consumed.
+	void consume(Solace::MemoryView::size_type frameSize) noexcept;
+
+	Parser const&				_parser;
+	SharedRingControl&			_control;
+	Solace::MutableMemoryView	_data;
+	size_type const				_capacity;
+	Solace::uint64				_tail;			//!< Position of the end of consumed frames.
+	Solace::uint64				_headCache;		//!< Last known position of the producer.
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_SHAREDRING_HPP
@@ -23,5 +23,21 @@
 #include "9p2000.hpp"
 #include "responseWriter.hpp"
 #include "requestWriter.hpp"
+#include "dirListingReader.hpp"
+#include "dirListingSnapshot.hpp"
+#include "errorTable.hpp"
+#include "messageLayout.hpp"
+#include "messageBatch.hpp"
+#include "chunkedIo.hpp"
+#include "compression.hpp"
+#include "ioStream.hpp"
+#include "ioScheduler.hpp"
+#include "metrics.hpp"
+#include "tagPool.hpp"
+#include "qidCache.hpp"
+#include "frameAssembler.hpp"
+#include "pipelinedClient.hpp"
+#include "sharedRing.hpp"
+#include "trace.hpp"
 
 #endif  // STYXE_STYXE_HPP
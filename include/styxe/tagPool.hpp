@@ -0,0 +1,217 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_TAGPOOL_HPP
+#define STYXE_TAGPOOL_HPP
+
+#include "9p2000.hpp"
+
+#include <solace/assert.hpp>
+
+#include <bitset>
+#include <limits>
+
+
+namespace styxe {
+
+/**
+ * A fixed capacity pool of protocol identifiers, such as message tags or fids, with a value slot attached to each.
+ * Allocation, release and lookup of an id are all O(1) and never allocate memory.
+ *
+ * Ids are allocated from a contiguous range [firstId, firstId + Capacity). Released ids are reused first
+ * (LIFO), so that the working set of slots stays small and hot in cache. Slots that have never been used
+ * are not touched until the pool runs out of released ids.
+ *
+ * The pool is not synchronized and is meant to be owned by a single I/O thread.
+ * To share an id space between several threads, each thread can own a shard - a pool with a disjoint id range
+ * carved from a shared base id: shard k is `IdPool{base + k*Capacity}` and the shard of an id is
+ * `(id - base) / Capacity`.
+ *
+ * @tparam Id Type of identifiers. All bits set value is reserved as invalid id, @see Parser::NO_TAG, Parser::NOFID.
+ * @tparam Value Type of a value attached to each allocated id. Must be default constructible.
+ * @tparam Capacity Number of ids managed by the pool.
+ */
+template<typename Id, typename Value, Solace::uint32 Capacity>
+struct IdPool {
+	static_assert(Capacity > 0, "Pool must have a non-zero capacity");
+	static_assert(Capacity <= std::numeric_limits<Id>::max(), "Capacity exceeds the range of the id type");
+
+	/// Id value that is never allocated.
+	static constexpr Id kInvalidId = std::numeric_limits<Id>::max();
+
+	/**
+	 * Construct an empty pool.
+	 * @param firstId First id in the range managed by the pool.
+	 */
+	explicit IdPool(Id firstId = 0)
+		: _firstId{firstId}
+	{
+		Solace::assertTrue(static_cast<Solace::uint64>(firstId) + Capacity <= kInvalidId);
+	}
+
+	IdPool(IdPool const&) = delete;
+	IdPool& operator= (IdPool const&) = delete;
+
+	/**
+	 * Allocate a new id.
+	 * @param value A value to be stored in the slot of the allocated id.
+	 * @return Allocated id or kInvalidId if the pool is exhausted.
+	 */
+	Id allocate(Value value) {
+		Id index = _freeHead;
+		if (index != kInvalidId) {
+			_freeHead = _next[index];
+		} else if (_highWater < Capacity) {
+			index = static_cast<Id>(_highWater++);
+		} else {
+			return kInvalidId;
+		}
+
+		_allocated.set(index);
+		_values[index] = Solace::mv(value);
+		_size += 1;
+
+		return static_cast<Id>(_firstId + index);
+	}
+
+	/**
+	 * Release previously allocated id so it can be re-used.
+	 * @param id Id to release.
+	 * @return True if the id has been allocated and is now released, false otherwise.
+	 */
+	bool release(Id id) noexcept {
+		auto const index = indexOf(id);
+		if (index == kInvalidId) {
+			return false;
+		}
+
+		_allocated.reset(index);
+		_values[index] = Value{};
+		_next[index] = _freeHead;
+		_freeHead = index;
+		_size -= 1;
+
+		return true;
+	}
+
+	/**
+	 * Find a value attached to the allocated id.
+	 * @param id Id to look up.
+	 * @return Pointer to the value slot of the id or nullptr if the id is not allocated.
+	 */
+	Value* find(Id id) noexcept {
+		auto const index = indexOf(id);
+		return (index != kInvalidId) ? &_values[index] : nullptr;
+	}
+
+	/**
+	 * Find a value attached to the allocated id.
+	 * @param id Id to look up.
+	 * @return Pointer to the value slot of the id or nullptr if the id is not allocated.
+	 */
+	Value const* find(Id id) const noexcept {
+		auto const index = indexOf(id);
+		return (index != kInvalidId) ? &_values[index] : nullptr;
+	}
+
+	/**
+	 * Check if the id is currently allocated.
+	 * @param id Id to check.
+	 * @return True if the id is allocated.
+	 */
+	bool contains(Id id) const noexcept { return (indexOf(id) != kInvalidId); }
+
+	/// @return Number of allocated ids.
+	Solace::uint32 size() const noexcept { return _size; }
+
+	/// @return True if no ids are allocated.
+	bool empty() const noexcept { return (_size == 0); }
+
+	/// @return Maximum number of ids that can be allocated at the same time.
+	static constexpr Solace::uint32 capacity() noexcept { return Capacity; }
+
+	/// @return First id managed by the pool.
+	Id firstId() const noexcept { return _firstId; }
+
+private:
+	/// Get a slot index of the allocated id or kInvalidId if the id is not allocated by this pool.
+	Id indexOf(Id id) const noexcept {
+		if (id < _firstId || static_cast<Solace::uint64>(id) >= static_cast<Solace::uint64>(_firstId) + Capacity) {
+			return kInvalidId;
+		}
+
+		auto const index = static_cast<Id>(id - _firstId);
+		return _allocated.test(index) ? index : kInvalidId;
+	}
+
+private:
+	/// First id managed by the pool.
+	Id const					_firstId;
+	/// Head of the list of released slots.
+	Id							_freeHead{kInvalidId};
+	/// Number of slots that have ever been used.
+	Solace::uint32				_highWater{0};
+	/// Number of allocated ids.
+	Solace::uint32				_size{0};
+	/// Mask of allocated slots.
+	std::bitset<Capacity>		_allocated;
+	/// Links of the list of released slots.
+	Id							_next[Capacity];
+	/// Value slots.
+	Value						_values[Capacity];
+};
+
+template<typename Id, typename Value, Solace::uint32 Capacity>
+constexpr Id IdPool<Id, Value, Capacity>::kInvalidId;
+
+
+/** Number of tags a client can have in flight: all the tag space except for the Parser::NO_TAG. */
+constexpr Solace::uint32 kMaxTagsInFlight = std::numeric_limits<Tag>::max();
+
+
+/**
+ * Pool of message tags with a pending request slot for each tag in flight.
+ * Client allocates a tag when sending a request and looks up the pending request by the tag of the response.
+ * Tag is released once the response is received or the request has been flushed.
+ *
+ * \code{.cpp}
+...
+	TagPool<PendingRequest> tags;
+	auto const tag = tags.allocate(PendingRequest{...});
+	RequestWriter{buffer, tag}
+		.read(fid, offset, count)
+		.build();
+...
+	if (auto pending = tags.find(header.tag)) {
+		complete(*pending, response);
+		tags.release(header.tag);
+	}
+...
+ * \endcode
+ */
+template<typename Pending, Solace::uint32 Capacity = kMaxTagsInFlight>
+using TagPool = IdPool<Tag, Pending, Capacity>;
+
+
+/**
+ * Pool of file ids with per-fid state slot.
+ * @note Fid space is 32 bit, thus capacity has to be chosen explicitly.
+ */
+template<typename State, Solace::uint32 Capacity>
+using FidPool = IdPool<Fid, State, Capacity>;
+
+}  // end of namespace styxe
+#endif  // STYXE_TAGPOOL_HPP
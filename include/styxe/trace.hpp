@@ -0,0 +1,232 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+#pragma once
+#ifndef STYXE_TRACE_HPP
+#define STYXE_TRACE_HPP
+
+#include "9p2000.hpp"
+
+
+namespace styxe {
+
+/**
+ * Direction of a traced frame relative to the peer recording the trace.
+ */
+enum class TraceDirection : Solace::byte {
+	Received = 0,	//!< Frame parsed by the Parser.
+	Sent = 1,		//!< Frame encoded by a message writer.
+};
+
+
+/**
+ * A hook called for each frame parsed or encoded by the calling thread.
+ * Frames are reported as up to two segments, the same way FrameSegments are sent with vectored IO.
+ * Received frames are reported once the frame size is validated, before the message is decoded.
+ * Sent frames are reported once a message is completed, or added to a MessageBatch.
+ */
+struct TraceHook {
+	/// Function called with each traced frame.
+	using Callback = void (*)(void* context, TraceDirection direction, FrameSegments const& frame);
+
+	Callback	callback{nullptr};	//!< Function to call, nullptr if tracing is disabled.
+	void*		context{nullptr};	//!< Context passed to the callback.
+
+	/// @return True if the hook is set.
+	constexpr explicit operator bool () const noexcept { return (callback != nullptr); }
+};
+
+
+/**
+ * Set a trace hook of the calling thread.
+ * Hooks are per thread, so that each I/O thread can record its own trace without any synchronization.
+ * When no hook is set, the overhead of tracing is a load of a thread local pointer per message.
+ *
+ * @param hook Hook to call for each frame parsed or encoded by the thread, or an empty hook to disable tracing.
+ * @return Previously set hook.
+ */
+TraceHook setTraceHook(TraceHook hook) noexcept;
+
+/// @return Trace hook of the calling thread.
+TraceHook traceHook() noexcept;
+
+
+/**
+ * Binary trace format.
+ * A trace starts with a fixed size file header, followed by records: one record for each frame.
+ * Record is a 64 bit little-endian word holding a timestamp in nanoseconds since the start of the trace,
+ * shifted left by one bit, and the direction of the frame in the lowest bit. The word is followed by the frame
+ * as it is on the wire: frames are self delimiting, as each frame starts with its size.
+ *
+ * File header:
+ *   magic[4] "9PTR" | version[2] | reserved[2] | start time[8] - wall clock time of the start of the trace,
+ *   in nanoseconds since the Unix epoch.
+ */
+struct TraceFormat {
+	/// Magic of a trace file: "9PTR".
+	static constexpr Solace::uint32 kMagic = 0x52545039;
+
+	/// Version of the trace format.
+	static constexpr Solace::uint16 kVersion = 1;
+
+	/// Size of the trace file header in bytes.
+	static constexpr Solace::MemoryView::size_type kHeaderSize = 16;
+
+	/// Size of the record header preceding each frame.
+	static constexpr Solace::MemoryView::size_type kRecordHeaderSize = sizeof(Solace::uint64);
+};
+
+
+/// A frame recorded in a trace.
+struct TraceRecord {
+	TraceDirection		direction;		//!< Direction of the frame.
+	Solace::uint64		timestamp;		//!< Nanoseconds since the start of the trace.
+	Solace::MemoryView	frame;			//!< Complete message frame, including the header.
+};
+
+
+/**
+ * Writer of a trace into a memory buffer.
+ * Records are accumulated in the buffer and passed to the flush callback once the buffer is full,
+ * so that the writer can be used as a trace hook with no I/O on the message path.
+ * A frame larger than the buffer is passed to the callback in place, without copying.
+ *
+ * \code{.cpp}
+...
+	TraceWriter trace{wrapMemory(traceBuffer), [](void* fd, MemoryView records) {
+			write(*static_cast<int*>(fd), records.dataAs<void const>(), records.size());
+		}, &traceFd};
+	setTraceHook(trace.hook());
+	...  // Serve requests
+	setTraceHook({});
+	trace.flush();
+...
+ * \endcode
+ */
+struct TraceWriter {
+	/// Function called with a block of encoded trace data.
+	using FlushCallback = void (*)(void* context, Solace::MemoryView data);
+
+	/**
+	 * Construct a new trace writer. The trace file header is written into the buffer.
+	 * @param buffer Memory to accumulate records in. Must be large enough for the trace file header.
+	 * @param flushCallback Function to call with a block of the trace data.
+	 * @param context Context passed to the callback.
+	 */
+	TraceWriter(Solace::MutableMemoryView buffer, FlushCallback flushCallback, void* context) noexcept;
+
+	TraceWriter(TraceWriter const&) = delete;
+	TraceWriter& operator= (TraceWriter const&) = delete;
+
+	/**
+	 * Record a frame timestamped with the current time.
+	 * @param direction Direction of the frame.
+	 * @param frame Segments of the frame.
+	 */
+	void record(TraceDirection direction, FrameSegments const& frame) noexcept;
+
+	/**
+	 * Record a frame with a given timestamp.
+	 * @param direction Direction of the frame.
+	 * @param timestamp Nanoseconds since the start of the trace.
+	 * @param frame Segments of the frame.
+	 */
+	void record(TraceDirection direction, Solace::uint64 timestamp, FrameSegments const& frame) noexcept;
+
+	/// Pass all the data accumulated in the buffer to the flush callback.
+	void flush() noexcept;
+
+	/// @return Nanoseconds since the start of the trace.
+	Solace::uint64 elapsedNanos() const noexcept;
+
+	/// @return Number of frames recorded.
+	Solace::uint64 frames() const noexcept { return _frames; }
+
+	/// @return Hook recording all the traced frames of a thread with this writer, @see setTraceHook.
+	TraceHook hook() noexcept;
+
+private:
+	Solace::MutableMemoryView		_buffer;		//!< Memory to accumulate records in.
+	Solace::MemoryView::size_type	_size{0};		//!< Number of bytes accumulated.
+	FlushCallback					_flush;			//!< Function to call with accumulated data.
+	void*							_context;		//!< Context of the callback.
+	Solace::uint64					_started;		//!< Steady clock time of the start of the trace.
+	Solace::uint64					_frames{0};		//!< Number of frames recorded.
+};
+
+
+/**
+ * A view of a trace in memory, such as a memory mapped trace file.
+ * Records are decoded on demand, when iterated over.
+ */
+struct TraceReader {
+
+	/// Forward iterator over records of a trace. Iteration stops at the first incomplete record.
+	struct Iterator {
+		/**
+		 * Construct an iterator.
+		 * @param data Trace data starting with the current record.
+		 */
+		explicit Iterator(Solace::MemoryView data = {}) noexcept;
+
+		/// @return Current record.
+		TraceRecord operator* () const noexcept;
+
+		/// Move to the next record.
+		Iterator& operator++ () noexcept;
+
+		/// @return True if iterators refer to the same record.
+		bool operator== (Iterator const& rhs) const noexcept {
+			return (_data.dataAs<Solace::byte const>() == rhs._data.dataAs<Solace::byte const>() &&
+					_data.size() == rhs._data.size());
+		}
+
+		/// @return True if iterators refer to different records.
+		bool operator!= (Iterator const& rhs) const noexcept { return !(*this == rhs); }
+
+	private:
+		Solace::MemoryView	_data;	//!< Trace data starting with the current record.
+	};
+
+	/**
+	 * Construct a view of a trace.
+	 * @param data Trace data, starting with the trace file header.
+	 */
+	constexpr explicit TraceReader(Solace::MemoryView data) noexcept
+		: _data{data}
+	{}
+
+	/**
+	 * Check that the trace has a valid file header and holds only complete records.
+	 * @param parser Parser to validate frame headers with, such as message type and size.
+	 * @return Void if the trace is well-formed or an error otherwise.
+	 */
+	Solace::Result<void, Error> validate(Parser const& parser) const;
+
+	/// @return Wall clock time of the start of the trace in nanoseconds since the Unix epoch, 0 if the header is invalid.
+	Solace::uint64 startTime() const noexcept;
+
+	/// @return Iterator to the first record.
+	Iterator begin() const noexcept;
+
+	/// @return Iterator past the last record.
+	Iterator end() const noexcept { return Iterator{}; }
+
+private:
+	Solace::MemoryView	_data;	//!< Trace data.
+};
+
+}  // end of namespace styxe
+#endif  // STYXE_TRACE_HPP
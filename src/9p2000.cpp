@@ -16,10 +16,14 @@
 
 #include "styxe/9p2000.hpp"
 #include "styxe/decoder.hpp"
+#include "styxe/errorTable.hpp"
+#include "styxe/messageLayout.hpp"
+#include "styxe/metrics.hpp"  // kCannedErrorKinds
 #include "styxe/version.hpp"
 
 #include <solace/assert.hpp>
 #include <algorithm>  // std::min
+#include <type_traits>
 
 
 using namespace Solace;
@@ -30,7 +34,17 @@ static const Version   kLibVersion{STYXE_VERSION_MAJOR, STYXE_VERSION_MINOR, STY
 
 const size_type         styxe::kMaxMesssageSize = 8*1024;      // 8k should be enough for everyone, am I right?
 
-const StringLiteral     Parser::PROTOCOL_VERSION = "9P2000.e";  // By default we want to talk via 9P2000.e proc
+static const StringLiteral  kProtocolVersion9P2000 = "9P2000";
+static const StringLiteral  kProtocolVersion9P2000E = "9P2000.e";
+static const StringLiteral  kProtocolVersion9P2000EB = "9P2000.eb";
+
+static const StringLiteral  kCompressionSuffixLZ4 = "+lz4";
+static const StringLiteral  kProtocolVersion9P2000LZ4 = "9P2000+lz4";
+static const StringLiteral  kProtocolVersion9P2000ELZ4 = "9P2000.e+lz4";
+static const StringLiteral  kProtocolVersion9P2000EBLZ4 = "9P2000.eb+lz4";
+
+const StringLiteral     Parser::PROTOCOL_VERSION = kProtocolVersion9P2000E;  // By default we want to talk via 9P2000.e
+const StringLiteral     Parser::BATCH_PROTOCOL_VERSION = kProtocolVersion9P2000EB;
 const StringLiteral     Parser::UNKNOWN_PROTOCOL_VERSION = "unknown";
 const Tag               Parser::NO_TAG = static_cast<Tag>(~0);
 const Fid               Parser::NOFID = static_cast<Fid>(~0);
@@ -61,368 +75,483 @@ static Error const kCannedErrors[] = {
 
     CANNE(CannedError::NotEnoughData, "Ill-formed message: Declared frame size larger than message data received"),
     CANNE(CannedError::MoreThenExpectedData, "Ill-formed message: Declared frame size less than message data received"),
+    CANNE(CannedError::WalkPathTooLong, "Ill-formed message: Walk path has more elements than allowed"),
+    CANNE(CannedError::UnexpectedTag, "Response tag does not match any request in flight"),
+    CANNE(CannedError::RequestFlushed, "Request has been flushed before a response was received"),
+    CANNE(CannedError::UnsupportedBatchOperation, "Ill-formed message: Unsupported operation of a batch entry"),
+    CANNE(CannedError::IllFormedCompressedData, "Ill-formed message: Compressed data is corrupted or too large"),
 };
 
+static_assert(sizeof(kCannedErrors) / sizeof(kCannedErrors[0]) == kCannedErrorKinds,
+			  "Each kind of canned error must have a message");
+
 
 Error
 styxe::getCannedError(CannedError errorId) noexcept {
+	metrics::recordError(errorId);
     return kCannedErrors[static_cast<int>(errorId)];
 }
 
+
+EncodedError
+styxe::getEncodedCannedError(CannedError errorId) noexcept {
+	using CannedErrorTable = ErrorTable<kCannedErrorKinds, kCannedErrorKinds * 128>;
+
+	static CannedErrorTable const table = []() noexcept {
+		CannedErrorTable errors;
+		for (uint32 i = 0; i < kCannedErrorKinds; ++i) {
+			errors.add(i, kCannedErrors[i].tag());
+		}
+
+		return errors;
+	}();
+
+	return table.find(static_cast<uint32>(errorId));
+}
+
 Version const& styxe::getVersion() noexcept {
     return kLibVersion;
 }
 
-namespace  {  // Internal imlpementation details
 
-struct OkRespose {
-    Result<ResponseMessage, Error>
-	operator() (Decoder&) { return {types::okTag, std::move(fcall)}; }
+namespace  {
+
+/// Get version string without the payload compression suffix.
+StringView
+baseVersion(StringView version) noexcept {
+    auto const suffixSize = kCompressionSuffixLZ4.size();
+    if (version.size() > suffixSize &&
+        version.substring(version.size() - suffixSize) == kCompressionSuffixLZ4) {
+        return version.substring(0, version.size() - suffixSize);
+    }
 
-    ResponseMessage fcall;
+    return version;
+}
 
-    template<typename T>
-    OkRespose(T&& f)
-        : fcall{std::forward<T>(f)}
-    {}
-};
+}  // namespace
 
-struct OkRequest {
-    Result<RequestMessage, Error>
-	operator() (Decoder&) { return {types::okTag, std::move(fcall)}; }
 
-    RequestMessage fcall;
+ProtocolVersion
+styxe::parseProtocolVersion(StringView fullVersion) noexcept {
+    auto const version = baseVersion(fullVersion);
+    if (version == kProtocolVersion9P2000EB) {
+        return ProtocolVersion::V9P2000EB;
+    }
 
-    template<typename T>
-    OkRequest(T&& f)
-        : fcall{std::forward<T>(f)}
-    {}
-};
+    if (version == kProtocolVersion9P2000E) {
+        return ProtocolVersion::V9P2000E;
+    }
 
+    if (version == kProtocolVersion9P2000) {
+        return ProtocolVersion::V9P2000;
+    }
 
-template<typename T>
-Result<ResponseMessage, Error>
-parseNoDataResponse() {
-	return Result<ResponseMessage, Error>{types::okTag, T{}};
+    return ProtocolVersion::Unknown;
 }
 
 
-Result<ResponseMessage, Error>
-parseErrorResponse(ByteReader& data) {
-    Response::Error fcall;
+StringView
+styxe::protocolVersionString(ProtocolVersion version) noexcept {
+    switch (version) {
+    case ProtocolVersion::V9P2000:  return kProtocolVersion9P2000;
+    case ProtocolVersion::V9P2000E: return kProtocolVersion9P2000E;
+    case ProtocolVersion::V9P2000EB: return kProtocolVersion9P2000EB;
+    default:
+        return Parser::UNKNOWN_PROTOCOL_VERSION;
+    }
+}
 
-	Decoder decoder{data};
-	auto result = (decoder >> fcall.ename);
 
-	return result
-			.then(OkRespose{std::move(fcall)});
+PayloadCompression
+styxe::parsePayloadCompression(StringView version) noexcept {
+    auto const base = baseVersion(version);
+    return (base.size() != version.size() && parseProtocolVersion(base) != ProtocolVersion::Unknown)
+            ? PayloadCompression::LZ4
+            : PayloadCompression::None;
 }
 
 
-Result<ResponseMessage, Error>
-parseVersionResponse(ByteReader& data) {
-    Response::Version fcall;
+StringView
+styxe::protocolVersionString(ProtocolVersion version, PayloadCompression compression) noexcept {
+    if (compression != PayloadCompression::LZ4) {
+        return protocolVersionString(version);
+    }
 
-	Decoder decoder{data};
+    switch (version) {
+    case ProtocolVersion::V9P2000:  return kProtocolVersion9P2000LZ4;
+    case ProtocolVersion::V9P2000E: return kProtocolVersion9P2000ELZ4;
+    case ProtocolVersion::V9P2000EB: return kProtocolVersion9P2000EBLZ4;
+    default:
+        return Parser::UNKNOWN_PROTOCOL_VERSION;
+    }
+}
 
-	Solace::Result<Decoder&, Error> result = (decoder >> fcall.msize);
-	result = std::move(result) >> fcall.version;
 
-	return result
-			.then(OkRespose{std::move(fcall)});
-}
+static_assert(std::is_trivially_copyable<Parser>::value, "Parser is expected to be cheap to copy per connection");
 
+constexpr MemoryView::size_type QidList::kEncodedQidSize;
 
-Result<ResponseMessage, Error>
-parseAuthResponse(ByteReader& data) {
-    Response::Auth fcall;
 
-	Decoder decoder{data};
-	auto result = decoder >> fcall.qid;
-	return result
-			.then(OkRespose{std::move(fcall)});
+Qid
+QidList::operator[] (size_type index) const noexcept {
+	assertIndexInRange(index, 0, _size);
+
+	Qid qid;
+	ByteReader reader{_data.slice(index * kEncodedQidSize, (index + 1) * kEncodedQidSize)};
+	Decoder decoder{reader};
+	decoder >> qid;
+
+	return qid;
 }
 
 
-Result<ResponseMessage, Error>
-parseAttachResponse(ByteReader& data) {
-    Response::Attach fcall;
+constexpr IndexedWalkPath::size_type IndexedWalkPath::kMaxSegments;
+
 
-	Decoder decoder{data};
-	auto result = decoder >> fcall.qid;
+uint32
+IndexedWalkPath::hashOf(StringView segment) noexcept {
+	uint32 hash = 2166136261u;
+	auto const chars = segment.data();
+	for (StringView::size_type i = 0; i < segment.size(); ++i) {
+		hash ^= static_cast<byte>(chars[i]);
+		hash *= 16777619u;
+	}
 
-	return result
-			.then(OkRespose{std::move(fcall)});
+	return hash;
 }
 
 
-Result<ResponseMessage, Error>
-parseOpenResponse(ByteReader& data) {
-    Response::Open fcall;
+MemoryView::size_type
+IndexedWalkPath::assign(size_type count, MemoryView data) noexcept {
+	assertIndexInRange(count, 0, kMaxSegments + 1);
+
+	auto const bytes = data.dataAs<char const>();
+	MemoryView::size_type pathSize = 0;
+	for (size_type i = 0; i < count; ++i) {
+		if (pathSize + sizeof(var_datum_size_type) > data.size()) {
+			_size = 0;
+			return 0;
+		}
 
-	Decoder decoder{data};
-	Solace::Result<Decoder&, Error> result = (decoder >> fcall.qid >> fcall.iounit);
+		var_datum_size_type segmentSize;
+		WireField<var_datum_size_type>::load(data.begin() + pathSize, segmentSize);
+		pathSize += sizeof(var_datum_size_type);
+		if (pathSize + segmentSize > data.size()) {
+			_size = 0;
+			return 0;
+		}
 
-	return result
-			.then(OkRespose{std::move(fcall)});
+		_offsets[i] = pathSize;
+		_lengths[i] = segmentSize;
+		_hashes[i] = hashOf(StringView{bytes + pathSize, segmentSize});
+		pathSize += segmentSize;
+	}
+
+	_size = count;
+	_data = data.slice(0, pathSize);
+
+	return pathSize;
 }
 
 
-Result<ResponseMessage, Error>
-parseCreateResponse(ByteReader& data) {
-    Response::Create fcall;
+namespace  {  // Internal imlpementation details
+
+/// Complete decoding of a frame: consume decoded data if all the fields have been decoded successfully.
+Result<void, Error>
+decoded(Result<UncheckedDecoder&, Error>&& result) {
+	if (!result) {
+		return result.getError();
+	}
 
-	Decoder decoder{data};
-	auto result = decoder >> fcall.qid
-						  >> fcall.iounit;
-	return result.then(OkRespose{std::move(fcall)});
+	return result.unwrap().commit();
 }
 
+}  // namespace
 
-Result<ResponseMessage, Error>
-parseReadResponse(ByteReader& data) {
-    Response::Read fcall;
 
-	Decoder decoder{data};
-	auto result = decoder >> fcall.data;
-	return result.then(OkRespose{std::move(fcall)});
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Response decoders
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Error& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> dest.ename);
 }
 
 
-Result<ResponseMessage, Error>
-parseWriteResponse(ByteReader& data) {
-    Response::Write fcall;
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Version& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.msize)}
+						   >> dest.msize
+						   >> dest.version);
+}
+
 
-	Decoder decoder{data};
-	auto result = decoder >> fcall.count;
-	return result.then(OkRespose{std::move(fcall)});
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Auth& dest) {
+	return decodeFixed(data, dest);
 }
 
 
-Result<ResponseMessage, Error>
-parseStatResponse(ByteReader& data) {
-    Response::Stat fcall;
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Attach& dest) {
+	return decodeFixed(data, dest);
+}
 
-	Decoder decoder{data};
-	auto result = decoder >> fcall.dummySize
-						  >> fcall.data;
-	return result
-			.then(OkRespose{std::move(fcall)});
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Open& dest) {
+	return decodeFixed(data, dest);
 }
 
 
-Result<ResponseMessage, Error>
-parseWalkResponse(ByteReader& data) {
-    Response::Walk fcall;
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Create& dest) {
+	return decodeFixed(data, dest);
+}
 
-    Decoder decoder{data};
 
-    // FIXME: Non-sense!
-	auto result = decoder >> fcall.nqids;
-	for (decltype(fcall.nqids) i = 0; i < fcall.nqids && result; ++i) {
-		result = decoder >> fcall.qids[i];
-	}
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Read& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> dest.data);
+}
+
 
-	return result
-			.then(OkRespose{std::move(fcall)});
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Read& dest, MutableMemoryView buffer) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> CompressedData{dest.data, buffer});
 }
 
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/// Request parser
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Write& dest) {
+	return decodeFixed(data, dest);
+}
 
-Result<RequestMessage, Error>
-parseVersionRequest(ByteReader& data) {
-    auto msg = Request::Version{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.msize
-						  >> msg.version;
-	return result
-			.then(OkRequest(std::move(msg)));
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Stat& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.dummySize)}
+						   >> dest.dummySize
+						   >> dest.data);
 }
 
 
-Result<RequestMessage, Error>
-parseAuthRequest(ByteReader& data) {
-    auto msg = Request::Auth{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.afid
-						  >> msg.uname
-						  >> msg.aname;
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Walk& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> dest.qids);
+}
+
+
+// Responses with no data are trivial to decode:
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Flush& dest) { return decodeFixed(data, dest); }
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Clunk& dest) { return decodeFixed(data, dest); }
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::Remove& dest) { return decodeFixed(data, dest); }
 
-	return result
-			.then(OkRequest(std::move(msg)));
+Result<void, Error>
+styxe::decode(ByteReader& data, Response::WStat& dest) { return decodeFixed(data, dest); }
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Response_9P2000E::Session& dest) { return decodeFixed(data, dest); }
+
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Response_9P2000E::SBatch& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> dest.results);
 }
 
 
-Result<RequestMessage, Error>
-parseFlushRequest(ByteReader& data) {
-    auto msg = Request::Flush{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.oldtag;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Request decoders
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	return result
-			.then(OkRequest(std::move(msg)));
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Version& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.msize)}
+						   >> dest.msize
+						   >> dest.version);
 }
 
 
-Result<RequestMessage, Error>
-parseAttachRequest(ByteReader& data) {
-    auto msg = Request::Attach{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.fid
-						  >> msg.afid
-						  >> msg.uname
-						  >> msg.aname;
-	return result
-            .then(OkRequest(std::move(msg)));
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Auth& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.afid)}
+						   >> dest.afid
+						   >> dest.uname
+						   >> dest.aname);
 }
 
 
-Result<RequestMessage, Error>
-parseWalkRequest(ByteReader& data) {
-    auto msg = Request::Walk{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.fid
-						  >> msg.newfid
-						  >> msg.path;
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Flush& dest) {
+	return decodeFixed(data, dest);
+}
+
 
-	return result
-			.then(OkRequest(std::move(msg)));
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Attach& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.fid) + sizeof(dest.afid)}
+						   >> dest.fid
+						   >> dest.afid
+						   >> dest.uname
+						   >> dest.aname);
 }
 
 
-Result<RequestMessage, Error>
-parseOpenRequest(ByteReader& data) {
-    auto msg = Request::Open{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.fid
-						  >> msg.mode.mode;
-	return result
-            .then(OkRequest(std::move(msg)));
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Walk& dest) {
+	UncheckedDecoder decoder{data};
+	auto result = decoder >> FixedSize{sizeof(dest.fid) + sizeof(dest.newfid)}
+						  >> dest.fid
+						  >> dest.newfid
+						  >> dest.path;
+
+	// Protocol limit of the walk path, so that the path can always be indexed.
+	if (result && dest.path.size() > IndexedWalkPath::kMaxSegments) {
+		return getCannedError(CannedError::WalkPathTooLong);
+	}
+
+	return decoded(mv(result));
 }
 
 
-Result<RequestMessage, Error>
-parseCreateRequest(ByteReader& data) {
-    auto msg = Request::Create{};
-	Decoder decoder{data};
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Open& dest) {
+	return decodeFixed(data, dest);
+}
 
-	auto result = decoder >> msg.fid
-						  >> msg.name
-						  >> msg.perm
-						  >> msg.mode.mode;
-	return result
-            .then(OkRequest(std::move(msg)));
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Create& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.fid)}
+						   >> dest.fid
+						   >> dest.name
+						   >> FixedSize{sizeof(dest.perm) + sizeof(dest.mode.mode)}
+						   >> dest.perm
+						   >> dest.mode.mode);
 }
 
 
-Result<RequestMessage, Error>
-parseReadRequest(ByteReader& data) {
-    auto msg = Request::Read{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.fid
-						  >> msg.offset
-						  >> msg.count;
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Read& dest) {
+	return decodeFixed(data, dest);
+}
 
-	return result
-			.then(OkRequest(std::move(msg)));
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Write& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.fid) + sizeof(dest.offset)}
+						   >> dest.fid
+						   >> dest.offset
+						   >> dest.data);
 }
 
 
-Result<RequestMessage, Error>
-parseWriteRequest(ByteReader& data) {
-    auto msg = Request::Write{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.fid
-						  >> msg.offset
-						  >> msg.data;
-	return result
-			.then(OkRequest(std::move(msg)));
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Write& dest, MutableMemoryView buffer) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.fid) + sizeof(dest.offset)}
+						   >> dest.fid
+						   >> dest.offset
+						   >> CompressedData{dest.data, buffer});
 }
 
 
-Result<RequestMessage, Error>
-parseClunkRequest(ByteReader& data) {
-    auto msg = Request::Clunk{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.fid;
-	return result
-			.then(OkRequest(std::move(msg)));
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Clunk& dest) {
+	return decodeFixed(data, dest);
 }
 
 
-Result<RequestMessage, Error>
-parseRemoveRequest(ByteReader& data) {
-    auto msg = Request::Remove{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.fid;
-	return result
-			.then(OkRequest(std::move(msg)));
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::Remove& dest) {
+	return decodeFixed(data, dest);
 }
 
 
-Result<RequestMessage, Error>
-parseStatRequest(ByteReader& data) {
-    auto msg = Request::StatRequest{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.fid;
-	return result
-			.then(OkRequest(std::move(msg)));
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::StatRequest& dest) {
+	return decodeFixed(data, dest);
 }
 
 
-Result<RequestMessage, Error>
-parseWStatRequest(ByteReader& data) {
-    auto msg = Request::WStat{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.fid
-						  >> msg.stat;
-	return result
-			.then(OkRequest(std::move(msg)));
+Result<void, Error>
+styxe::decode(ByteReader& data, Request::WStat& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.fid)}
+						   >> dest.fid
+						   >> dest.stat);
 }
 
 
+Result<void, Error>
+styxe::decode(ByteReader& data, Request_9P2000E::Session& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.key)}
+						   >> dest.key[0]
+						   >> dest.key[1]
+						   >> dest.key[2]
+						   >> dest.key[3]
+						   >> dest.key[4]
+						   >> dest.key[5]
+						   >> dest.key[6]
+						   >> dest.key[7]);
+}
 
-Result<RequestMessage, Error>
-parseSessionRequest(ByteReader& data) {
-    auto msg = Request_9P2000E::Session{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.key[0]
-			>> msg.key[1]
-			>> msg.key[2]
-			>> msg.key[3]
-			>> msg.key[4]
-			>> msg.key[5]
-			>> msg.key[6]
-			>> msg.key[7];
-	return result
-			.then(OkRequest(std::move(msg)));
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Request_9P2000E::SRead& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.fid)}
+						   >> dest.fid
+						   >> dest.path);
 }
 
-Result<RequestMessage, Error>
-parseShortReadRequest(ByteReader& data) {
-    auto msg = Request_9P2000E::SRead{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.fid
-						  >> msg.path;
-	return result
-			.then(OkRequest(std::move(msg)));
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Request_9P2000E::SWrite& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.fid)}
+						   >> dest.fid
+						   >> dest.path
+						   >> dest.data);
 }
 
-Result<RequestMessage, Error>
-parseShortWriteRequest(ByteReader& data) {
-    auto msg = Request_9P2000E::SWrite{};
-	Decoder decoder{data};
-	auto result = decoder >> msg.fid
-						  >> msg.path
-						  >> msg.data;
-	return result
-            .then(OkRequest(std::move(msg)));
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Request_9P2000E::SWrite& dest, MutableMemoryView buffer) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.fid)}
+						   >> dest.fid
+						   >> dest.path
+						   >> CompressedData{dest.data, buffer});
 }
 
-}  // namespace
+
+Result<void, Error>
+styxe::decode(ByteReader& data, Request_9P2000E::SBatch& dest) {
+	UncheckedDecoder decoder{data};
+	return decoded(decoder >> FixedSize{sizeof(dest.fid)}
+						   >> dest.fid
+						   >> dest.entries);
+}
 
 
 
@@ -436,7 +565,7 @@ Parser::parseMessageHeader(ByteReader& src) const {
 		return getCannedError(CannedError::IllFormedHeader);
     }
 
-    Decoder decoder{src};
+    UncheckedDecoder decoder{src};
     MessageHeader header;
 
 	decoder >> header.messageSize;
@@ -465,12 +594,17 @@ Parser::parseMessageHeader(ByteReader& src) const {
     // Unless we are provided with the expected tag...
 	decoder >> header.tag;
 
+	auto consumed = decoder.commit();
+	if (!consumed) {
+		return consumed.getError();
+	}
+
 	return Ok(header);
 }
 
 
-Result<ResponseMessage, Error>
-Parser::parseResponse(MessageHeader const& header, ByteReader& data) const {
+Result<void, Error>
+Parser::checkFrame(MessageHeader const& header, ByteReader const& data) const {
     auto const expectedData = header.payloadSize();
 
     // Message data sanity check
@@ -485,87 +619,126 @@ Parser::parseResponse(MessageHeader const& header, ByteReader& data) const {
 		return getCannedError(CannedError::NotEnoughData);
     }
 
-    // Make sure there is no extra data in the buffer.
+    // Make sure there is no extra unexpected data in the buffer.
 	if (expectedData < bytesRemaining) {
 		return getCannedError(CannedError::MoreThenExpectedData);
     }
 
-    switch (header.type) {
-    case MessageType::RError:   return parseErrorResponse(data);
-    case MessageType::RVersion: return parseVersionResponse(data);
-    case MessageType::RAuth:    return parseAuthResponse(data);
-    case MessageType::RAttach:  return parseAttachResponse(data);
-    case MessageType::RWalk:    return parseWalkResponse(data);
-    case MessageType::ROpen:    return parseOpenResponse(data);
-    case MessageType::RCreate:  return parseCreateResponse(data);
-    case MessageType::RSRead:  // Note: RRead is re-used here for RSRead
-    case MessageType::RRead:    return parseReadResponse(data);
-    case MessageType::RSWrite:  // Note: RWrite is re-used here for RSWrite
-    case MessageType::RWrite:   return parseWriteResponse(data);
-    case MessageType::RStat:    return parseStatResponse(data);
-
-    // Responses with no data use common procedure:
-    case MessageType::RFlush:   return parseNoDataResponse<Response::Flush>();
-    case MessageType::RClunk:   return parseNoDataResponse<Response::Clunk>();
-    case MessageType::RRemove:  return parseNoDataResponse<Response::Remove>();
-    case MessageType::RWStat:   return parseNoDataResponse<Response::WStat>();
-    case MessageType::RSession: return parseNoDataResponse<Response_9P2000E::Session>();
+	metrics::recordFrame(header.messageSize, maxNegotiatedMessageSize());
+	trace::recordReceived(header, data.viewRemaining());
 
-    default:
-		return getCannedError(CannedError::UnsupportedMessageType);
-    }
+	return Result<void, Error>{types::okTag};
+}
+
+
+Result<ResponseMessage, Error>
+Parser::parseResponse(MessageHeader const& header, ByteReader& data) const {
+	auto frameCheck = checkFrame(header, data);
+	if (!frameCheck) {
+		return frameCheck.getError();
+	}
+
+	return parseResponsePayload(header, data);
 }
 
+
+Result<ResponseMessage, Error>
+Parser::parseResponsePayload(MessageHeader const& header, ByteReader& data) const {
+	ResponseMessage message;
+	auto assign = [&message](auto& msg) { message = mv(msg); };
+	auto result = visitResponsePayload(header, data, assign);
+	if (!result) {
+		return result.getError();
+	}
+
+	return Result<ResponseMessage, Error>{types::okTag, mv(message)};
+}
+
+
+namespace  {
+
+/// Decode a message which data payload may be compressed.
+template<typename Message, typename Variant>
+Result<Variant, Error>
+decodeCompressed(MessageHeader const& header, ByteReader& data, MutableMemoryView buffer) {
+	metrics::Stopwatch const started;
+	Message msg;
+	auto result = decode(data, msg, buffer);
+	if (!result) {
+		return result.getError();
+	}
+
+	metrics::recordDecode(header, started);
+	return Result<Variant, Error>{types::okTag, mv(msg)};
+}
+
+}  // namespace
+
+
+Result<ResponseMessage, Error>
+Parser::parseCompressedResponse(MessageHeader const& header, ByteReader& data, MutableMemoryView buffer) const {
+	auto frameCheck = checkFrame(header, data);
+	if (!frameCheck) {
+		return frameCheck.getError();
+	}
+
+	if (_session.compression != PayloadCompression::None &&
+		(header.type == MessageType::RRead || header.type == MessageType::RSRead)) {
+		return decodeCompressed<Response::Read, ResponseMessage>(header, data, buffer);
+	}
+
+	return parseResponsePayload(header, data);
+}
+
+
 Result<RequestMessage, Error>
-Parser::parseRequest(MessageHeader const& header, ByteReader& data) const {
-	auto const expectedData = header.payloadSize();
+Parser::parseCompressedRequest(MessageHeader const& header, ByteReader& data, MutableMemoryView buffer) const {
+	auto frameCheck = checkFrame(header, data);
+	if (!frameCheck) {
+		return frameCheck.getError();
+	}
 
-    // Message data sanity check
-    // Just paranoid about huge messages exciding frame size getting through.
-    if (header.messageSize > maxNegotiatedMessageSize()) {
-		return getCannedError(CannedError::IllFormedHeader_TooBig);
-    }
+	if (_session.compression != PayloadCompression::None) {
+		switch (header.type) {
+		case MessageType::TWrite:	return decodeCompressed<Request::Write, RequestMessage>(header, data, buffer);
+		case MessageType::TSWrite:	return decodeCompressed<Request_9P2000E::SWrite, RequestMessage>(header, data, buffer);
+		default:
+			break;
+		}
+	}
 
-    // Make sure we have been given enough data to read a message as requested in the message size.
-	auto const bytesRemaining = data.remaining();
-	if (expectedData > bytesRemaining) {
-		return getCannedError(CannedError::NotEnoughData);
-    }
+	return parseRequestPayload(header, data);
+}
 
-    // Make sure there is no extra unexpected data in the buffer.
-	if (expectedData < bytesRemaining) {
-		return getCannedError(CannedError::MoreThenExpectedData);
-    }
 
-    switch (header.type) {
-    case MessageType::TVersion: return parseVersionRequest(data);
-    case MessageType::TAuth:    return parseAuthRequest(data);
-    case MessageType::TFlush:   return parseFlushRequest(data);
-    case MessageType::TAttach:  return parseAttachRequest(data);
-    case MessageType::TWalk:    return parseWalkRequest(data);
-    case MessageType::TOpen:    return parseOpenRequest(data);
-    case MessageType::TCreate:  return parseCreateRequest(data);
-    case MessageType::TRead:    return parseReadRequest(data);
-    case MessageType::TWrite:   return parseWriteRequest(data);
-    case MessageType::TClunk:   return parseClunkRequest(data);
-    case MessageType::TRemove:  return parseRemoveRequest(data);
-    case MessageType::TStat:    return parseStatRequest(data);
-    case MessageType::TWStat:   return parseWStatRequest(data);
-    /* 9P2000.e extension messages */
-    case MessageType::TSession: return parseSessionRequest(data);
-    case MessageType::TSRead:   return parseShortReadRequest(data);
-    case MessageType::TSWrite:  return parseShortWriteRequest(data);
+Result<RequestMessage, Error>
+Parser::parseRequest(MessageHeader const& header, ByteReader& data) const {
+	auto frameCheck = checkFrame(header, data);
+	if (!frameCheck) {
+		return frameCheck.getError();
+	}
 
-    default:
-		return getCannedError(CannedError::UnsupportedMessageType);
-    }
+	return parseRequestPayload(header, data);
+}
+
+
+Result<RequestMessage, Error>
+Parser::parseRequestPayload(MessageHeader const& header, ByteReader& data) const {
+	RequestMessage message;
+	auto assign = [&message](auto& msg) { message = mv(msg); };
+	auto result = visitRequestPayload(header, data, assign);
+	if (!result) {
+		return result.getError();
+	}
+
+	return Result<RequestMessage, Error>{types::okTag, mv(message)};
 }
 
 
 size_type
 Parser::maxNegotiatedMessageSize(size_type newMessageSize) {
-    assertIndexInRange(newMessageSize, 0, maxPossibleMessageSize() + 1);
-    _maxNegotiatedMessageSize = std::min(newMessageSize, maxPossibleMessageSize());
+    assertIndexInRange(static_cast<uint64>(newMessageSize), 0, static_cast<uint64>(maxPossibleMessageSize()) + 1);
+    _session.maxNegotiatedMessageSize = std::min(newMessageSize, maxPossibleMessageSize());
 
-    return _maxNegotiatedMessageSize;
+    return _session.maxNegotiatedMessageSize;
 }
@@ -0,0 +1,184 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+
+#include "styxe/chunkedIo.hpp"
+#include "styxe/requestWriter.hpp"
+
+#include <algorithm>  // std::min
+#include <cstring>  // std::memcpy
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+ChunkedIo::ChunkedIo(Fid fid, uint64 offset, uint64 length, size_type chunkSize, Tag firstTag) noexcept
+	: _fid{fid}
+	, _firstTag{firstTag}
+	, _chunkSize{chunkSize}
+	, _offset{offset}
+	, _length{0}
+	, _chunkCount{0}
+{
+	if (chunkSize == 0) {
+		return;
+	}
+
+	// Each chunk needs a tag of its own: tags from the first one up to, but excluding, NO_TAG are available.
+	auto const maxChunks = static_cast<uint64>(Parser::NO_TAG - std::min(firstTag, Parser::NO_TAG));
+	_length = std::min(length, maxChunks * chunkSize);
+	_chunkCount = static_cast<uint32>((_length + chunkSize - 1) / chunkSize);
+}
+
+
+size_type
+ChunkedIo::chunkLength(uint32 chunk) const noexcept {
+	auto const start = static_cast<uint64>(chunk) * _chunkSize;
+	if (start >= _length) {
+		return 0;
+	}
+
+	return static_cast<size_type>(std::min<uint64>(_length - start, _chunkSize));
+}
+
+
+uint64
+ChunkedIo::bytesTransferred() const noexcept {
+	return isShort()
+			? static_cast<uint64>(_shortChunk) * _chunkSize + _shortLength
+			: _transferred;
+}
+
+
+Result<uint32, Error>
+ChunkedIo::complete(Tag tag, size_type transferred) {
+	if (!owns(tag)) {
+		return getCannedError(CannedError::UnexpectedTag);
+	}
+
+	auto const chunk = static_cast<uint32>(tag - _firstTag);
+	if (_responded.test(chunk)) {  // Only one response is expected for a chunk.
+		return getCannedError(CannedError::UnexpectedTag);
+	}
+
+	auto const expected = chunkLength(chunk);
+	if (transferred > expected) {
+		return getCannedError(CannedError::MoreThenExpectedData);
+	}
+
+	_responded.set(chunk);
+	_completed += 1;
+	_transferred += transferred;
+	if (transferred < expected && chunk < _shortChunk) {
+		_shortChunk = chunk;
+		_shortLength = transferred;
+	}
+
+	return Result<uint32, Error>{types::okTag, chunk};
+}
+
+
+Result<void, Error>
+ChunkedIo::fail(Tag tag) {
+	auto result = complete(tag, 0);
+	if (!result) {
+		return result.getError();
+	}
+
+	return Result<void, Error>{types::okTag};
+}
+
+
+uint32
+ChunkedRead::writeRequests(MessageBatch& batch) {
+	uint32 added = 0;
+	while (!allSent()) {
+		auto const chunk = issue();
+		auto message = batch.request(tagOf(chunk))
+				.read(fid(), chunkOffset(chunk), chunkLength(chunk));
+		if (!batch.add(message)) {
+			unissue();
+			break;
+		}
+
+		added += 1;
+	}
+
+	return added;
+}
+
+
+Result<void, Error>
+ChunkedRead::onResponse(Tag tag, Response::Read const& response) {
+	auto const dataSize = response.data.size();
+	if (dataSize > chunkSize()) {
+		return getCannedError(CannedError::MoreThenExpectedData);
+	}
+
+	auto maybeChunk = complete(tag, static_cast<size_type>(dataSize));
+	if (!maybeChunk) {
+		return maybeChunk.getError();
+	}
+
+	if (dataSize > 0) {
+		auto const destOffset = static_cast<MutableMemoryView::size_type>(maybeChunk.unwrap()) * chunkSize();
+		std::memcpy(_dest.dataAs<byte>(destOffset), response.data.begin(), dataSize);
+	}
+
+	return Result<void, Error>{types::okTag};
+}
+
+
+uint32
+ChunkedWrite::writeRequests(MessageBatch& batch) {
+	uint32 added = 0;
+	while (!allSent()) {
+		// Data is appended to the message piecewise, so make sure it fits up front.
+		auto const chunk = issue();
+		if (!batch.fits(headerSize() + sizeof(Fid) + sizeof(uint64) + sizeof(size_type) + chunkLength(chunk))) {
+			unissue();
+			break;
+		}
+
+		auto const start = static_cast<MemoryView::size_type>(chunk) * chunkSize();
+		auto message = batch.request(tagOf(chunk))
+				.write(fid(), chunkOffset(chunk))
+				.data(_data.slice(start, start + chunkLength(chunk)));
+		if (!batch.add(message)) {
+			unissue();
+			break;
+		}
+
+		added += 1;
+	}
+
+	return added;
+}
+
+
+FrameSegments
+ChunkedWrite::writeNext(ByteWriter& dest) {
+	if (allSent()) {
+		return FrameSegments{};
+	}
+
+	auto const chunk = issue();
+	auto const start = static_cast<MemoryView::size_type>(chunk) * chunkSize();
+
+	return RequestWriter{dest, tagOf(chunk)}
+			.write(fid(), chunkOffset(chunk))
+			.build(_data.slice(start, start + chunkLength(chunk)));
+}
@@ -0,0 +1,270 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+
+#include "styxe/compression.hpp"
+#include "styxe/encoder.hpp"
+
+#include <algorithm>  // std::min
+#include <cstring>  // std::memcpy
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace  {
+
+using size_t = MemoryView::size_type;
+
+/// Minimal length of a match.
+constexpr size_t kMinMatch = 4;
+/// Number of bytes at the end of a block that are always literals.
+constexpr size_t kLastLiterals = 5;
+/// A match must start at least this many bytes before the end of a block.
+constexpr size_t kMatchSearchLimit = 12;
+/// Maximum distance of a match.
+constexpr size_t kMaxOffset = 65535;
+/// Length value of a token that signals extra length bytes.
+constexpr size_t kRunMask = 15;
+/// Number of bits of the match search hash table index.
+constexpr uint32 kHashLog = 12;
+/// Number of positions kept in the match search hash table.
+constexpr uint32 kHashTableSize = 1u << kHashLog;
+
+
+inline uint32 read32(byte const* p) noexcept {
+	uint32 value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+
+inline uint32 hashOf(uint32 sequence) noexcept {
+	return (sequence * 2654435761u) >> (32 - kHashLog);
+}
+
+
+/// Number of extra bytes to encode a length that does not fit into a token.
+constexpr size_t extraLengthSize(size_t length) noexcept {
+	return (length >= kRunMask) ? (length - kRunMask) / 255 + 1 : 0;
+}
+
+
+byte* writeExtraLength(byte* op, size_t length) noexcept {
+	length -= kRunMask;
+	for (; length >= 255; length -= 255) {
+		*op++ = 255;
+	}
+	*op++ = static_cast<byte>(length);
+
+	return op;
+}
+
+
+bool readExtraLength(byte const*& ip, byte const* iend, size_t& length) noexcept {
+	byte value;
+	do {
+		if (ip == iend) {
+			return false;
+		}
+
+		value = *ip++;
+		length += value;
+	} while (value == 255);
+
+	return true;
+}
+
+
+/**
+ * Write a sequence of literals followed by a match. Last sequence of a block has no match: matchLength is 0.
+ * @return Position past the sequence written or nullptr if the sequence does not fit into the output.
+ */
+byte* writeSequence(byte* op, byte const* oend,
+					byte const* literals, size_t literalsLength,
+					size_t offset, size_t matchLength) noexcept {
+	bool const hasMatch = (matchLength != 0);
+	size_t const matchCode = hasMatch ? matchLength - kMinMatch : 0;
+	size_t const sequenceSize = 1 + extraLengthSize(literalsLength) + literalsLength +
+			(hasMatch ? sizeof(uint16) + extraLengthSize(matchCode) : 0);
+	if (sequenceSize > static_cast<size_t>(oend - op)) {
+		return nullptr;
+	}
+
+	byte* const token = op++;
+	*token = static_cast<byte>(std::min(literalsLength, kRunMask) << 4);
+	if (literalsLength >= kRunMask) {
+		op = writeExtraLength(op, literalsLength);
+	}
+
+	std::memcpy(op, literals, literalsLength);
+	op += literalsLength;
+
+	if (hasMatch) {
+		*op++ = static_cast<byte>(offset & 0xFF);
+		*op++ = static_cast<byte>(offset >> 8);
+
+		*token |= static_cast<byte>(std::min(matchCode, kRunMask));
+		if (matchCode >= kRunMask) {
+			op = writeExtraLength(op, matchCode);
+		}
+	}
+
+	return op;
+}
+
+}  // namespace
+
+
+MemoryView::size_type
+styxe::lz4Compress(MemoryView src, MutableMemoryView dest) noexcept {
+	byte const* const base = src.dataAs<byte const>();
+	size_t const srcSize = src.size();
+	byte* const out = dest.dataAs<byte>();
+	byte const* const oend = out + dest.size();
+	byte* op = out;
+	size_t anchor = 0;
+
+	if (srcSize > kMatchSearchLimit) {
+		uint32 positions[kHashTableSize] = {};
+		size_t const matchLimit = srcSize - kLastLiterals;
+		size_t const searchLimit = srcSize - kMatchSearchLimit;
+
+		size_t ip = 1;
+		while (ip < searchLimit) {
+			auto const sequence = read32(base + ip);
+			auto const h = hashOf(sequence);
+			size_t const candidate = positions[h];
+			positions[h] = static_cast<uint32>(ip);
+
+			if (ip - candidate > kMaxOffset || read32(base + candidate) != sequence) {
+				// Skip faster through data that does not compress.
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+
+			size_t length = kMinMatch;
+			while (ip + length < matchLimit && base[candidate + length] == base[ip + length]) {
+				++length;
+			}
+
+			op = writeSequence(op, oend, base + anchor, ip - anchor, ip - candidate, length);
+			if (!op) {
+				return 0;
+			}
+
+			ip += length;
+			anchor = ip;
+		}
+	}
+
+	op = writeSequence(op, oend, base + anchor, srcSize - anchor, 0, 0);
+
+	return op ? static_cast<size_t>(op - out) : 0;
+}
+
+
+Result<MemoryView, Error>
+styxe::lz4Decompress(MemoryView src, MutableMemoryView dest) {
+	byte const* ip = src.dataAs<byte const>();
+	byte const* const iend = ip + src.size();
+	byte* const out = dest.dataAs<byte>();
+	byte* op = out;
+	byte const* const oend = out + dest.size();
+
+	while (ip < iend) {
+		auto const token = *ip++;
+
+		size_t literalsLength = token >> 4;
+		if (literalsLength == kRunMask && !readExtraLength(ip, iend, literalsLength)) {
+			return getCannedError(CannedError::IllFormedCompressedData);
+		}
+
+		if (literalsLength > static_cast<size_t>(iend - ip) || literalsLength > static_cast<size_t>(oend - op)) {
+			return getCannedError(CannedError::IllFormedCompressedData);
+		}
+
+		std::memcpy(op, ip, literalsLength);
+		ip += literalsLength;
+		op += literalsLength;
+
+		if (ip == iend) {  // Last sequence of the block has no match
+			break;
+		}
+
+		if (static_cast<size_t>(iend - ip) < sizeof(uint16)) {
+			return getCannedError(CannedError::IllFormedCompressedData);
+		}
+
+		size_t const offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+		ip += sizeof(uint16);
+		if (offset == 0 || offset > static_cast<size_t>(op - out)) {
+			return getCannedError(CannedError::IllFormedCompressedData);
+		}
+
+		size_t matchLength = token & kRunMask;
+		if (matchLength == kRunMask && !readExtraLength(ip, iend, matchLength)) {
+			return getCannedError(CannedError::IllFormedCompressedData);
+		}
+
+		matchLength += kMinMatch;
+		if (matchLength > static_cast<size_t>(oend - op)) {
+			return getCannedError(CannedError::IllFormedCompressedData);
+		}
+
+		byte const* match = op - offset;
+		if (offset >= matchLength) {
+			std::memcpy(op, match, matchLength);
+			op += matchLength;
+		} else {  // Overlapping match repeats the last offset bytes
+			for (size_t i = 0; i < matchLength; ++i) {
+				*op++ = *match++;
+			}
+		}
+	}
+
+	return Result<MemoryView, Error>{types::okTag, dest.slice(0, static_cast<size_t>(op - out))};
+}
+
+
+size_type
+styxe::encodeCompressed(ByteWriter& dest, MemoryView data, CompressionPolicy compression) {
+	constexpr size_t kFieldHeaderSize = 2 * sizeof(size_type);  // Encoded size and size of the data
+	if (compression.method != PayloadCompression::LZ4 ||
+		data.size() < compression.threshold ||
+		data.size() <= kFieldHeaderSize ||
+		data.size() >= kCompressedDataFlag ||
+		dest.remaining() <= kFieldHeaderSize) {
+		return 0;
+	}
+
+	// Compressed field is only worth sending if it is smaller than the field without compression
+	auto const maxCompressedSize = std::min(dest.remaining() - kFieldHeaderSize,
+											data.size() - kFieldHeaderSize + sizeof(size_type) - 1);
+	auto const compressedSize = lz4Compress(data,
+											dest.viewRemaining().slice(kFieldHeaderSize,
+																	   kFieldHeaderSize + maxCompressedSize));
+	if (compressedSize == 0) {
+		return 0;
+	}
+
+	Encoder encoder{dest};
+	encoder << static_cast<size_type>(kCompressedDataFlag | (sizeof(size_type) + compressedSize))
+			<< static_cast<size_type>(data.size());
+	dest.advance(compressedSize);
+
+	return narrow_cast<size_type>(kFieldHeaderSize + compressedSize);
+}
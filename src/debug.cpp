@@ -60,10 +60,36 @@ namespace styxe {
         case MessageType::RSRead:   ostr << "RSRead"; break;
         case MessageType::TSWrite:  ostr << "TSWrite"; break;
         case MessageType::RSWrite:  ostr << "RSWrite"; break;
+
+        case MessageType::TSBatch:  ostr << "TSBatch"; break;
+        case MessageType::RSBatch:  ostr << "RSBatch"; break;
         default:
             ostr << "[Unknown value '" << static_cast<Solace::byte>(t) << "']";
         }
 
         return ostr;
     }
+
+    std::ostream& operator<< (std::ostream& ostr, ShortBatchOp op) {
+        switch (op) {
+        case ShortBatchOp::Read:    ostr << "READ"; break;
+        case ShortBatchOp::Write:   ostr << "WRITE"; break;
+        default:
+            ostr << "[Unknown value '" << static_cast<Solace::byte>(op) << "']";
+        }
+
+        return ostr;
+    }
+
+    std::ostream& operator<< (std::ostream& ostr, ShortBatchStatus status) {
+        switch (status) {
+        case ShortBatchStatus::Data:    ostr << "DATA"; break;
+        case ShortBatchStatus::Written: ostr << "WRITTEN"; break;
+        case ShortBatchStatus::Failed:  ostr << "FAILED"; break;
+        default:
+            ostr << "[Unknown value '" << static_cast<Solace::byte>(status) << "']";
+        }
+
+        return ostr;
+    }
 }  // end of namespace styxe
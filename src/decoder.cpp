@@ -15,39 +15,104 @@
 */
 
 #include <styxe/decoder.hpp>
+#include <styxe/compression.hpp>  // lz4Decompress
+#include <styxe/messageLayout.hpp>  // WireField
 
 
 using namespace Solace;
 
 using styxe::Decoder;
+using styxe::UncheckedDecoder;
+using styxe::FixedSize;
 using styxe::Qid;
+using styxe::QidList;
 using styxe::WalkPath;
+using styxe::IndexedWalkPath;
 using styxe::Stat;
 
 
+namespace  {
+
+template<typename T>
 Result<Decoder&, Error>
-styxe::operator>> (Decoder& decoder, uint8& dest) {
-	decoder.buffer().readLE(dest);
+readValue(Decoder& decoder, T& dest) {
+	auto result = decoder.buffer().readLE(dest);
+	if (!result) {
+		return result.getError();
+	}
+
 	return Result<Decoder&, Error>{types::okTag, decoder};
 }
 
+template<typename T>
+UncheckedDecoder&
+loadValue(UncheckedDecoder& decoder, T& dest) noexcept {
+	styxe::WireField<T>::load(decoder.cursor(), dest);
+	decoder.skip(styxe::WireField<T>::kSize);
+
+	return decoder;
+}
+
+
+/// Get size of the walk path encoded as the given number of segments or 0 if it exceeds the data given.
+ByteReader::size_type
+walkPathSize(WalkPath::size_type componentsCount, MemoryView data) noexcept {
+	ByteReader::size_type pathSize = 0;
+	for (WalkPath::size_type i = 0; i < componentsCount; ++i) {
+		if (pathSize + sizeof(styxe::var_datum_size_type) > data.size()) {
+			return 0;
+		}
+
+		styxe::var_datum_size_type segmentSize;
+		styxe::WireField<styxe::var_datum_size_type>::load(data.begin() + pathSize, segmentSize);
+		pathSize += sizeof(styxe::var_datum_size_type) + segmentSize;
+	}
+
+	return (pathSize <= data.size()) ? pathSize : 0;
+}
+
+/// Read a size prefixed datum from the frame, checking it against the end of the frame.
+template<typename SizeType>
+Result<UncheckedDecoder&, Error>
+readSized(UncheckedDecoder& decoder, MemoryView& dest) {
+	if (decoder.remaining() < sizeof(SizeType)) {
+		return styxe::getCannedError(styxe::CannedError::NotEnoughData);
+	}
+
+	SizeType dataSize;
+	loadValue(decoder, dataSize);
+	if (dataSize > decoder.remaining()) {
+		return styxe::getCannedError(styxe::CannedError::NotEnoughData);
+	}
+
+	dest = decoder.view().slice(0, dataSize);
+	decoder.skip(dataSize);
+
+	return Result<UncheckedDecoder&, Error>{types::okTag, decoder};
+}
+
+}  // namespace
+
+
+Result<Decoder&, Error>
+styxe::operator>> (Decoder& decoder, uint8& dest) {
+	return readValue(decoder, dest);
+}
+
 
 Result<Decoder&, Error>
 styxe::operator>> (Decoder& decoder, uint16& dest) {
-	decoder.buffer().readLE(dest);
-	return Result<Decoder&, Error>{types::okTag, decoder};
+	return readValue(decoder, dest);
 }
 
 Result<Decoder&, Error>
 styxe::operator>> (Decoder& decoder, uint32& dest) {
-	decoder.buffer().readLE(dest);
-	return Result<Decoder&, Error>{types::okTag, decoder};
+	return readValue(decoder, dest);
 }
 
 Result<Decoder&, Error>
 styxe::operator>> (Decoder& decoder, uint64& dest) {
-	decoder.buffer().readLE(dest);
-	return Result<Decoder&, Error>{types::okTag, decoder};
+	return readValue(decoder, dest);
 }
 
 Result<Decoder&, Error>
@@ -55,7 +120,7 @@ styxe::operator>> (Decoder& decoder, StringView& dest) {
 	auto& buffer = decoder.buffer();
 
 	uint16 dataSize = 0;
-	buffer.readLE(dataSize)
+	auto result = buffer.readLE(dataSize)
 			.then([&]() {
 				StringView view{buffer.viewRemaining().dataAs<char const>(), dataSize};
 				return buffer.advance(dataSize)
@@ -64,6 +129,10 @@ styxe::operator>> (Decoder& decoder, StringView& dest) {
                         });
             });
 
+	if (!result) {
+		return result.getError();
+	}
+
 	return Result<Decoder&, Error>{types::okTag, decoder};
 }
 
@@ -74,12 +143,19 @@ styxe::operator>> (Decoder& decoder, MemoryView& data) {
 	styxe::size_type dataSize = 0;
 
     // Read size of the following data.
-	buffer.readLE(dataSize)
+	auto result = buffer.readLE(dataSize)
 			.then([&]() {
-				data = buffer.viewRemaining().slice(0, dataSize);
-				return buffer.advance(dataSize);
+				auto const view = buffer.viewRemaining().slice(0, dataSize);
+				return buffer.advance(dataSize)
+						.then([&data, &view]() {
+							data = view;
+						});
             });
 
+	if (!result) {
+		return result.getError();
+	}
+
 	return Result<Decoder&, Error>{types::okTag, decoder};
 }
 
@@ -89,18 +165,73 @@ styxe::operator>> (Decoder& decoder, WalkPath& path) {
 	auto& buffer = decoder.buffer();
 	WalkPath::size_type componentsCount = 0;
 
-	buffer.readLE(componentsCount)
-			.then([&]() {
-				path = WalkPath{componentsCount, buffer.viewRemaining()};
-				// Advance the byteReader:
-				ByteReader::size_type skip = 0;
-				for (auto segment : path) {
-					skip += sizeof(styxe::var_datum_size_type) + segment.size();
+	auto result = buffer.readLE(componentsCount)
+			.then([&]() -> Result<void, Error> {
+				auto const data = buffer.viewRemaining();
+				auto const pathSize = walkPathSize(componentsCount, data);
+				if (componentsCount > 0 && pathSize == 0) {
+					return getCannedError(CannedError::NotEnoughData);
+				}
+
+				path = WalkPath{componentsCount, data.slice(0, pathSize)};
+				return buffer.advance(pathSize);
+			});
+
+	if (!result) {
+		return result.getError();
+	}
+
+	return Result<Decoder&, Error>{types::okTag, decoder};
+}
+
+
+Result<Decoder&, Error>
+styxe::operator>> (Decoder& decoder, IndexedWalkPath& path) {
+	auto& buffer = decoder.buffer();
+	IndexedWalkPath::size_type componentsCount = 0;
+
+	auto result = buffer.readLE(componentsCount)
+			.then([&]() -> Result<void, Error> {
+				if (componentsCount > IndexedWalkPath::kMaxSegments) {
+					return getCannedError(CannedError::WalkPathTooLong);
 				}
 
-				return buffer.advance(skip);
+				auto const pathSize = path.assign(componentsCount, buffer.viewRemaining());
+				if (componentsCount > 0 && pathSize == 0) {
+					return getCannedError(CannedError::NotEnoughData);
+				}
+
+				return buffer.advance(pathSize);
 			});
 
+	if (!result) {
+		return result.getError();
+	}
+
+	return Result<Decoder&, Error>{types::okTag, decoder};
+}
+
+
+Result<Decoder&, Error>
+styxe::operator>> (Decoder& decoder, QidList& qids) {
+	auto& buffer = decoder.buffer();
+	QidList::size_type qidsCount = 0;
+
+	auto result = buffer.readLE(qidsCount)
+			.then([&]() {
+				auto const dataSize = qidsCount * QidList::kEncodedQidSize;
+				auto const data = buffer.viewRemaining();
+
+				return buffer.advance(dataSize)
+						.then([&]() {
+							qids = QidList{qidsCount, data.slice(0, dataSize)};
+						});
+			});
+
+	if (!result) {
+		return result.getError();
+	}
+
 	return Result<Decoder&, Error>{types::okTag, decoder};
 }
 
@@ -129,3 +260,303 @@ styxe::operator>> (Decoder& decoder, Stat& stat) {
 				   >> stat.muid;
 }
 
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, CompressedData dest) {
+	if (decoder.remaining() < sizeof(size_type)) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	size_type fieldSize;
+	loadValue(decoder, fieldSize);
+	if ((fieldSize & kCompressedDataFlag) == 0) {
+		if (fieldSize > decoder.remaining()) {
+			return getCannedError(CannedError::NotEnoughData);
+		}
+
+		dest.data = decoder.view().slice(0, fieldSize);
+		decoder.skip(fieldSize);
+
+		return Result<UncheckedDecoder&, Error>{types::okTag, decoder};
+	}
+
+	auto const encodedSize = fieldSize & ~kCompressedDataFlag;
+	if (encodedSize < sizeof(size_type) || encodedSize > decoder.remaining()) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	size_type rawSize;
+	loadValue(decoder, rawSize);
+	if (rawSize > dest.buffer.size()) {
+		return getCannedError(CannedError::IllFormedCompressedData);
+	}
+
+	auto const block = decoder.view().slice(0, encodedSize - sizeof(size_type));
+	auto decompressed = lz4Decompress(block, dest.buffer.slice(0, rawSize));
+	if (!decompressed) {
+		return decompressed.getError();
+	}
+
+	if (decompressed.unwrap().size() != rawSize) {
+		return getCannedError(CannedError::IllFormedCompressedData);
+	}
+
+	dest.data = decompressed.unwrap();
+	decoder.skip(encodedSize - sizeof(size_type));
+
+	return Result<UncheckedDecoder&, Error>{types::okTag, decoder};
+}
+
+
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, FixedSize fixed) {
+	if (fixed.size > decoder.remaining()) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	return Result<UncheckedDecoder&, Error>{types::okTag, decoder};
+}
+
+
+UncheckedDecoder&
+styxe::operator>> (UncheckedDecoder& decoder, uint8& dest) noexcept {
+	return loadValue(decoder, dest);
+}
+
+UncheckedDecoder&
+styxe::operator>> (UncheckedDecoder& decoder, uint16& dest) noexcept {
+	return loadValue(decoder, dest);
+}
+
+UncheckedDecoder&
+styxe::operator>> (UncheckedDecoder& decoder, uint32& dest) noexcept {
+	return loadValue(decoder, dest);
+}
+
+UncheckedDecoder&
+styxe::operator>> (UncheckedDecoder& decoder, uint64& dest) noexcept {
+	return loadValue(decoder, dest);
+}
+
+UncheckedDecoder&
+styxe::operator>> (UncheckedDecoder& decoder, Qid& dest) noexcept {
+	return loadValue(decoder, dest);
+}
+
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, StringView& dest) {
+	MemoryView data;
+	auto result = readSized<var_datum_size_type>(decoder, data);
+	if (result) {
+		dest = StringView{data.dataAs<char const>(), static_cast<StringView::size_type>(data.size())};
+	}
+
+	return result;
+}
+
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, MemoryView& dest) {
+	return readSized<styxe::size_type>(decoder, dest);
+}
+
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, WalkPath& dest) {
+	if (decoder.remaining() < sizeof(WalkPath::size_type)) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	WalkPath::size_type componentsCount;
+	decoder >> componentsCount;
+
+	auto const data = decoder.view();
+	auto const pathSize = walkPathSize(componentsCount, data);
+	if (componentsCount > 0 && pathSize == 0) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	dest = WalkPath{componentsCount, data.slice(0, pathSize)};
+	decoder.skip(pathSize);
+
+	return Result<UncheckedDecoder&, Error>{types::okTag, decoder};
+}
+
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, IndexedWalkPath& dest) {
+	if (decoder.remaining() < sizeof(IndexedWalkPath::size_type)) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	IndexedWalkPath::size_type componentsCount;
+	decoder >> componentsCount;
+	if (componentsCount > IndexedWalkPath::kMaxSegments) {
+		return getCannedError(CannedError::WalkPathTooLong);
+	}
+
+	auto const pathSize = dest.assign(componentsCount, decoder.view());
+	if (componentsCount > 0 && pathSize == 0) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	decoder.skip(pathSize);
+
+	return Result<UncheckedDecoder&, Error>{types::okTag, decoder};
+}
+
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, QidList& dest) {
+	if (decoder.remaining() < sizeof(QidList::size_type)) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	QidList::size_type qidsCount;
+	decoder >> qidsCount;
+
+	auto const dataSize = qidsCount * QidList::kEncodedQidSize;
+	if (dataSize > decoder.remaining()) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	dest = QidList{qidsCount, decoder.view().slice(0, dataSize)};
+	decoder.skip(dataSize);
+
+	return Result<UncheckedDecoder&, Error>{types::okTag, decoder};
+}
+
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, Stat& stat) {
+	return decoder >> FixedSize{sizeof(stat.size) + sizeof(stat.type) + sizeof(stat.dev) +
+								styxe::WireField<Qid>::kSize +
+								sizeof(stat.mode) + sizeof(stat.atime) + sizeof(stat.mtime) + sizeof(stat.length)}
+				   >> stat.size
+				   >> stat.type
+				   >> stat.dev
+				   >> stat.qid
+				   >> stat.mode
+				   >> stat.atime
+				   >> stat.mtime
+				   >> stat.length
+				   >> stat.name
+				   >> stat.uid
+				   >> stat.gid
+				   >> stat.muid;
+}
+
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, ShortBatchEntry& dest) {
+	if (decoder.remaining() < sizeof(byte)) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	byte op;
+	decoder >> op;
+	dest.op = static_cast<ShortBatchOp>(op);
+	dest.data = MemoryView{};
+
+	switch (dest.op) {
+	case ShortBatchOp::Read:	return decoder >> dest.path;
+	case ShortBatchOp::Write:	return decoder >> dest.data
+											   >> dest.path;
+	}
+
+	return getCannedError(CannedError::UnsupportedBatchOperation);
+}
+
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, ShortBatchResult& dest) {
+	if (decoder.remaining() < sizeof(byte)) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	byte status;
+	decoder >> status;
+	dest = ShortBatchResult{static_cast<ShortBatchStatus>(status), MemoryView{}, 0, StringView{}};
+
+	switch (dest.status) {
+	case ShortBatchStatus::Data:	return decoder >> dest.data;
+	case ShortBatchStatus::Written:	return decoder >> FixedSize{sizeof(dest.count)}
+												   >> dest.count;
+	case ShortBatchStatus::Failed:	return decoder >> dest.ename;
+	}
+
+	return getCannedError(CannedError::UnsupportedBatchOperation);
+}
+
+
+namespace  {
+
+/// Decode a single entry of a batch from the start of the data.
+template<typename Entry>
+MemoryView::size_type
+decodeEntry(MemoryView data, Entry& dest) {
+	ByteReader reader{data};
+	UncheckedDecoder decoder{reader};
+
+	return (decoder >> dest)
+			? decoder.consumed()
+			: 0;
+}
+
+
+/// Decode number of entries of a batch and check that all the entries are well-formed.
+template<typename Entry>
+Result<UncheckedDecoder&, Error>
+readBatch(UncheckedDecoder& decoder, styxe::ShortBatchView<Entry>& dest) {
+	using size_type = typename styxe::ShortBatchView<Entry>::size_type;
+	if (decoder.remaining() < sizeof(size_type)) {
+		return styxe::getCannedError(styxe::CannedError::NotEnoughData);
+	}
+
+	size_type entriesCount;
+	decoder >> entriesCount;
+
+	auto const data = decoder.view();
+	ByteReader reader{data};
+	UncheckedDecoder entries{reader};
+	Entry entry{};
+	for (size_type i = 0; i < entriesCount; ++i) {
+		auto result = entries >> entry;
+		if (!result) {
+			return result.getError();
+		}
+	}
+
+	dest = styxe::ShortBatchView<Entry>{entriesCount, data.slice(0, entries.consumed())};
+	decoder.skip(entries.consumed());
+
+	return Result<UncheckedDecoder&, Error>{types::okTag, decoder};
+}
+
+}  // namespace
+
+
+MemoryView::size_type
+styxe::decodeBatchEntry(MemoryView data, ShortBatchEntry& dest) {
+	return decodeEntry(data, dest);
+}
+
+
+MemoryView::size_type
+styxe::decodeBatchEntry(MemoryView data, ShortBatchResult& dest) {
+	return decodeEntry(data, dest);
+}
+
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, ShortBatchEntries& dest) {
+	return readBatch(decoder, dest);
+}
+
+
+Result<UncheckedDecoder&, Error>
+styxe::operator>> (UncheckedDecoder& decoder, ShortBatchResults& dest) {
+	return readBatch(decoder, dest);
+}
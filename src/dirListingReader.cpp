@@ -0,0 +1,180 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+
+#include "styxe/dirListingReader.hpp"
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace  {
+
+// Offsets of the fixed size fields of the encoded Stat structure.
+constexpr MemoryView::size_type kSizeOffset = 0;
+constexpr MemoryView::size_type kTypeOffset = kSizeOffset + sizeof(uint16);
+constexpr MemoryView::size_type kDevOffset = kTypeOffset + sizeof(uint16);
+constexpr MemoryView::size_type kQidTypeOffset = kDevOffset + sizeof(uint32);
+constexpr MemoryView::size_type kQidVersionOffset = kQidTypeOffset + sizeof(byte);
+constexpr MemoryView::size_type kQidPathOffset = kQidVersionOffset + sizeof(uint32);
+constexpr MemoryView::size_type kModeOffset = kQidPathOffset + sizeof(uint64);
+constexpr MemoryView::size_type kATimeOffset = kModeOffset + sizeof(uint32);
+constexpr MemoryView::size_type kMTimeOffset = kATimeOffset + sizeof(uint32);
+constexpr MemoryView::size_type kLengthOffset = kMTimeOffset + sizeof(uint32);
+constexpr MemoryView::size_type kStringsOffset = kLengthOffset + sizeof(uint64);
+
+constexpr unsigned kNameIndex = 0;
+constexpr unsigned kUidIndex = 1;
+constexpr unsigned kGidIndex = 2;
+constexpr unsigned kMUidIndex = 3;
+
+
+/// Read a fixed size value at the given offset. Zero is returned if there is not enough data.
+template<typename T>
+T readAt(MemoryView data, MemoryView::size_type offset) noexcept {
+	T value{0};
+	if (offset + sizeof(T) <= data.size()) {
+		ByteReader reader{data.slice(offset, offset + sizeof(T))};
+		reader.readLE(value);
+	}
+
+	return value;
+}
+
+
+/// Get number of bytes occupied by the leading entry of the listing or 0 if the entry is incomplete.
+MemoryView::size_type
+entrySize(MemoryView data) noexcept {
+	if (data.size() < StatView::kMinEncodedSize) {
+		return 0;
+	}
+
+	auto const size = sizeof(uint16) + readAt<uint16>(data, kSizeOffset);
+	return (StatView::kMinEncodedSize <= size && size <= data.size())
+			? size
+			: 0;
+}
+
+}  // namespace
+
+
+const uint16 StatView::kMinEncodedSize = kStringsOffset + 4*sizeof(var_datum_size_type);
+
+
+uint16 StatView::size() const noexcept { return readAt<uint16>(_data, kSizeOffset); }
+uint16 StatView::type() const noexcept { return readAt<uint16>(_data, kTypeOffset); }
+uint32 StatView::dev() const noexcept { return readAt<uint32>(_data, kDevOffset); }
+uint32 StatView::mode() const noexcept { return readAt<uint32>(_data, kModeOffset); }
+uint32 StatView::atime() const noexcept { return readAt<uint32>(_data, kATimeOffset); }
+uint32 StatView::mtime() const noexcept { return readAt<uint32>(_data, kMTimeOffset); }
+uint64 StatView::length() const noexcept { return readAt<uint64>(_data, kLengthOffset); }
+
+StringView StatView::name() const noexcept { return stringField(kNameIndex); }
+StringView StatView::uid() const noexcept { return stringField(kUidIndex); }
+StringView StatView::gid() const noexcept { return stringField(kGidIndex); }
+StringView StatView::muid() const noexcept { return stringField(kMUidIndex); }
+
+
+Qid
+StatView::qid() const noexcept {
+	Qid result;
+	result.type = readAt<byte>(_data, kQidTypeOffset);
+	result.version = readAt<uint32>(_data, kQidVersionOffset);
+	result.path = readAt<uint64>(_data, kQidPathOffset);
+
+	return result;
+}
+
+
+StringView
+StatView::stringField(unsigned index) const noexcept {
+	auto offset = kStringsOffset;
+	for (unsigned i = 0; i <= index; ++i) {
+		if (offset + sizeof(var_datum_size_type) > _data.size()) {
+			return {};
+		}
+
+		auto const stringSize = readAt<var_datum_size_type>(_data, offset);
+		offset += sizeof(var_datum_size_type);
+		if (offset + stringSize > _data.size()) {
+			return {};
+		}
+
+		if (i == index) {
+			return StringView{_data.dataAs<char const>() + offset, stringSize};
+		}
+
+		offset += stringSize;
+	}
+
+	return {};
+}
+
+
+Stat
+StatView::decode() const noexcept {
+	Stat stat;
+	stat.size = size();
+	stat.type = type();
+	stat.dev = dev();
+	stat.qid = qid();
+	stat.mode = mode();
+	stat.atime = atime();
+	stat.mtime = mtime();
+	stat.length = length();
+	stat.name = name();
+	stat.uid = uid();
+	stat.gid = gid();
+	stat.muid = muid();
+
+	return stat;
+}
+
+
+DirListingReader::Iterator::Iterator(MemoryView data) noexcept
+	: _data{(entrySize(data) > 0) ? data : MemoryView{}}
+{}
+
+
+StatView
+DirListingReader::Iterator::operator* () const noexcept {
+	return StatView{_data.slice(0, entrySize(_data))};
+}
+
+
+DirListingReader::Iterator&
+DirListingReader::Iterator::operator++ () noexcept {
+	auto const rest = _data.slice(entrySize(_data), _data.size());
+	_data = (entrySize(rest) > 0) ? rest : MemoryView{};
+
+	return *this;
+}
+
+
+Result<void, Error>
+DirListingReader::validate() const {
+	auto data = _data;
+	while (data.size() > 0) {
+		auto const size = entrySize(data);
+		if (size == 0) {
+			return getCannedError(CannedError::NotEnoughData);
+		}
+
+		data = data.slice(size, data.size());
+	}
+
+	return Result<void, Error>{types::okTag};
+}
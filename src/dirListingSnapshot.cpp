@@ -0,0 +1,93 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+
+#include "styxe/dirListingSnapshot.hpp"
+#include "styxe/encoder.hpp"
+
+#include <algorithm>  // std::upper_bound
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+bool
+DirListingSnapshot::add(Stat const& stat) {
+	if (_size >= _index.size()) {
+		return false;
+	}
+
+	auto const start = endOf(_size);
+	auto const entrySize = Encoder::protocolSize(stat);
+	if (entrySize > _storage.size() - start) {
+		return false;
+	}
+
+	UncheckedEncoder encoder{_storage.slice(start, start + entrySize)};
+	encoder << stat;
+
+	return commit(entrySize);
+}
+
+
+bool
+DirListingSnapshot::add(StatView entry) noexcept {
+	if (_size >= _index.size()) {
+		return false;
+	}
+
+	auto const start = endOf(_size);
+	auto const data = entry.data();
+	if (data.size() > _storage.size() - start) {
+		return false;
+	}
+
+	UncheckedEncoder encoder{_storage.slice(start, start + data.size())};
+	storeBytes(encoder, data);
+
+	return commit(data.size());
+}
+
+
+bool
+DirListingSnapshot::commit(MemoryView::size_type entrySize) noexcept {
+	_index[_size] = narrow_cast<uint32>(endOf(_size) + entrySize);
+	_size += 1;
+
+	return true;
+}
+
+
+MemoryView
+DirListingSnapshot::read(uint64 offset, uint32 count) const noexcept {
+	auto const first = _index.begin();
+	auto const last = first + _size;
+
+	// First entry that ends past the offset
+	auto const startEntry = std::upper_bound(first, last, offset);
+	if (startEntry == last) {
+		return MemoryView{};
+	}
+
+	auto const start = endOf(static_cast<size_type>(startEntry - first));
+	// First entry that ends past the count
+	auto const endEntry = std::upper_bound(startEntry, last, static_cast<uint64>(start) + count);
+	if (endEntry == startEntry) {
+		return MemoryView{};
+	}
+
+	return _storage.slice(start, *(endEntry - 1));
+}
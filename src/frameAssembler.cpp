@@ -0,0 +1,117 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+
+#include "styxe/frameAssembler.hpp"
+
+#include <algorithm>  // std::min
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace  {
+
+/// Move up to `count` bytes from the chunk into the staging buffer.
+/// @return True if all requested bytes have been moved.
+bool stage(ByteWriter& staging, ByteReader& chunk, ByteReader::size_type count) {
+	auto const available = std::min(count, chunk.remaining());
+
+	staging.write(chunk.viewRemaining().slice(0, available));
+	chunk.advance(available);
+
+	return (available == count);
+}
+
+}  // namespace
+
+
+void
+FrameAssembler::reset() noexcept {
+	_staging.rewind();
+}
+
+
+Result<bool, Error>
+FrameAssembler::nextFrame(ByteReader& chunk, MessageHeader& header, MemoryView& payload) {
+	auto const mandatoryHeaderSize = headerSize();
+
+	// Complete the frame left over from the previous chunk first.
+	if (_staging.position() > 0) {
+		if (_staging.position() < mandatoryHeaderSize) {
+			if (!stage(_staging, chunk, mandatoryHeaderSize - _staging.position())) {
+				return Result<bool, Error>{types::okTag, false};
+			}
+
+			// Header is complete now: parse it once and keep for the subsequent chunks.
+			ByteReader headerReader{_staging.viewWritten()};
+			auto maybeHeader = _parser.parseMessageHeader(headerReader);
+			if (!maybeHeader) {
+				reset();
+				return maybeHeader.getError();
+			}
+
+			_stagedHeader = maybeHeader.unwrap();
+			if (_stagedHeader.messageSize > _staging.capacity()) {
+				reset();
+				return getCannedError(CannedError::IllFormedHeader_TooBig);
+			}
+		}
+
+		if (!stage(_staging, chunk, _stagedHeader.messageSize - _staging.position())) {
+			return Result<bool, Error>{types::okTag, false};
+		}
+
+		header = _stagedHeader;
+		payload = _staging.viewWritten().slice(mandatoryHeaderSize, header.messageSize);
+		reset();
+
+		return Result<bool, Error>{types::okTag, true};
+	}
+
+	// Not enough data for even a header: keep what is left for the next chunk.
+	if (chunk.remaining() < mandatoryHeaderSize) {
+		stage(_staging, chunk, chunk.remaining());
+		return Result<bool, Error>{types::okTag, false};
+	}
+
+	auto const frameStart = chunk.viewRemaining();
+	auto maybeHeader = _parser.parseMessageHeader(chunk);
+	if (!maybeHeader) {
+		return maybeHeader.getError();
+	}
+
+	header = maybeHeader.unwrap();
+	auto const expectedData = header.payloadSize();
+	if (expectedData > chunk.remaining()) {
+		// Incomplete frame: stash header and all the data we have got so far.
+		if (header.messageSize > _staging.capacity()) {
+			return getCannedError(CannedError::IllFormedHeader_TooBig);
+		}
+
+		_stagedHeader = header;
+		_staging.write(frameStart);
+		chunk.advance(chunk.remaining());
+
+		return Result<bool, Error>{types::okTag, false};
+	}
+
+	// Complete frame in the chunk: no need to copy anything.
+	payload = chunk.viewRemaining().slice(0, expectedData);
+	chunk.advance(expectedData);
+
+	return Result<bool, Error>{types::okTag, true};
+}
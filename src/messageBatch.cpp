@@ -0,0 +1,61 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+
+#include "styxe/messageBatch.hpp"
+
+#include <algorithm>  // std::min
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+MessageBatch::MessageBatch(ByteWriter& dest, size_type maxMessageSize, ByteWriter::size_type budget) noexcept
+	: _dest{dest}
+	, _maxMessageSize{maxMessageSize}
+	, _start{dest.position()}
+	, _end{dest.position()}
+	, _budget{std::min(budget, dest.remaining())}
+{}
+
+
+bool
+MessageBatch::add(TypedWriter message) {
+	// Message must start where the previous one ended.
+	if (message.startPosition() != _end) {
+		_dest.position(_end);
+		return false;
+	}
+
+	auto const expectedSize = headerSize() + message.payloadSize();
+	auto const messageEnd = message.finish().position();
+	auto const messageSize = messageEnd - _end;
+
+	// A message shorter then its header says or the one that ran into the end of the stream could have been truncated.
+	bool const truncated = (messageSize < expectedSize) ||
+			(_dest.remaining() == 0 && messageSize != expectedSize);
+
+	if (truncated || !fits(messageSize)) {
+		_dest.position(_end);
+		return false;
+	}
+
+	trace::recordSent(FrameSegments{_dest.viewWritten().slice(_end, messageEnd), MemoryView{}});
+	_end = messageEnd;
+	_count += 1;
+
+	return true;
+}
@@ -0,0 +1,259 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+
+#include "styxe/metrics.hpp"
+
+#if STYXE_METRICS
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#endif
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+#if STYXE_METRICS
+
+namespace  {
+
+/// Counter updated by a single thread and read by any.
+struct Counter {
+	void add(uint64 value) noexcept {
+		_value.store(_value.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	uint64 load() const noexcept { return _value.load(std::memory_order_relaxed); }
+
+	void reset() noexcept { _value.store(0, std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64>	_value{0};
+};
+
+
+/// Metrics collected by a thread.
+struct ThreadMetrics {
+	/// Counters of a message type.
+	struct TypeCounters {
+		Counter	decoded;
+		Counter	decodedBytes;
+		Counter	decodeNanos;
+		Counter	encoded;
+		Counter	encodedBytes;
+		Counter	encodeNanos;
+	};
+
+	ThreadMetrics() noexcept;
+	~ThreadMetrics();
+
+	ThreadMetrics(ThreadMetrics const&) = delete;
+	ThreadMetrics& operator= (ThreadMetrics const&) = delete;
+
+	void addTo(MetricsSnapshot& dest) const noexcept {
+		for (uint32 i = 0; i < MetricsSnapshot::kMessageTypeSlots; ++i) {
+			auto const& src = messages[i];
+			auto& counters = dest.messages[i];
+			counters.decoded += src.decoded.load();
+			counters.decodedBytes += src.decodedBytes.load();
+			counters.decodeNanos += src.decodeNanos.load();
+			counters.encoded += src.encoded.load();
+			counters.encodedBytes += src.encodedBytes.load();
+			counters.encodeNanos += src.encodeNanos.load();
+		}
+
+		for (uint32 i = 0; i < MetricsSnapshot::kFrameSizeBuckets; ++i) {
+			dest.frameSizes[i] += frameSizes[i].load();
+		}
+
+		for (uint32 i = 0; i < kCannedErrorKinds; ++i) {
+			dest.errors[i] += errors[i].load();
+		}
+	}
+
+	void reset() noexcept {
+		for (auto& counters : messages) {
+			counters.decoded.reset();
+			counters.decodedBytes.reset();
+			counters.decodeNanos.reset();
+			counters.encoded.reset();
+			counters.encodedBytes.reset();
+			counters.encodeNanos.reset();
+		}
+
+		for (auto& counter : frameSizes) {
+			counter.reset();
+		}
+
+		for (auto& counter : errors) {
+			counter.reset();
+		}
+	}
+
+	TypeCounters	messages[MetricsSnapshot::kMessageTypeSlots];
+	Counter			frameSizes[MetricsSnapshot::kFrameSizeBuckets];
+	Counter			errors[kCannedErrorKinds];
+
+	ThreadMetrics*	prev{nullptr};  //!< Previous registered thread.
+	ThreadMetrics*	next{nullptr};  //!< Next registered thread.
+};
+
+
+/// Registry of metrics of all threads.
+struct Registry {
+	std::mutex			mutex;
+	ThreadMetrics*		head{nullptr};  //!< Metrics of running threads.
+	MetricsSnapshot		retired{};      //!< Metrics of threads that have exited.
+};
+
+
+Registry& registry() noexcept {
+	static Registry instance;
+	return instance;
+}
+
+
+ThreadMetrics::ThreadMetrics() noexcept {
+	auto& reg = registry();
+	std::lock_guard<std::mutex> lock{reg.mutex};
+
+	next = reg.head;
+	if (next) {
+		next->prev = this;
+	}
+	reg.head = this;
+}
+
+
+ThreadMetrics::~ThreadMetrics() {
+	auto& reg = registry();
+	std::lock_guard<std::mutex> lock{reg.mutex};
+
+	addTo(reg.retired);
+	if (prev) {
+		prev->next = next;
+	} else {
+		reg.head = next;
+	}
+
+	if (next) {
+		next->prev = prev;
+	}
+}
+
+
+ThreadMetrics& threadMetrics() noexcept {
+	thread_local ThreadMetrics instance;
+	return instance;
+}
+
+
+uint64 nowNanos() noexcept {
+	auto const now = std::chrono::steady_clock::now().time_since_epoch();
+	return static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+}  // namespace
+
+
+metrics::Stopwatch::Stopwatch() noexcept
+	: _started{nowNanos()}
+{}
+
+
+uint64
+metrics::Stopwatch::elapsedNanos() const noexcept {
+	return nowNanos() - _started;
+}
+
+
+void
+metrics::recordDecode(MessageHeader const& header, Stopwatch const& started) noexcept {
+	auto& counters = threadMetrics().messages[static_cast<byte>(header.type)];
+	counters.decoded.add(1);
+	counters.decodedBytes.add(header.messageSize);
+	counters.decodeNanos.add(started.elapsedNanos());
+}
+
+
+void
+metrics::recordEncode(MessageHeader const& header, Stopwatch const& started) noexcept {
+	auto& counters = threadMetrics().messages[static_cast<byte>(header.type)];
+	counters.encoded.add(1);
+	counters.encodedBytes.add(header.messageSize);
+	counters.encodeNanos.add(started.elapsedNanos());
+}
+
+
+void
+metrics::recordFrame(size_type frameSize, size_type maxMessageSize) noexcept {
+	uint32 bucket = 0;
+	while (bucket + 1 < MetricsSnapshot::kFrameSizeBuckets && frameSize <= (maxMessageSize >> (bucket + 1))) {
+		bucket += 1;
+	}
+
+	threadMetrics().frameSizes[bucket].add(1);
+}
+
+
+void
+metrics::recordError(CannedError errorId) noexcept {
+	auto const index = static_cast<uint32>(errorId);
+	if (index < kCannedErrorKinds) {
+		threadMetrics().errors[index].add(1);
+	}
+}
+
+
+MetricsSnapshot
+styxe::protocolMetrics() noexcept {
+	MetricsSnapshot snapshot{};
+
+	auto& reg = registry();
+	std::lock_guard<std::mutex> lock{reg.mutex};
+	snapshot = reg.retired;
+	for (auto thread = reg.head; thread; thread = thread->next) {
+		thread->addTo(snapshot);
+	}
+
+	return snapshot;
+}
+
+
+void
+styxe::resetProtocolMetrics() noexcept {
+	auto& reg = registry();
+	std::lock_guard<std::mutex> lock{reg.mutex};
+	reg.retired = MetricsSnapshot{};
+	for (auto thread = reg.head; thread; thread = thread->next) {
+		thread->reset();
+	}
+}
+
+#else
+
+MetricsSnapshot
+styxe::protocolMetrics() noexcept {
+	return MetricsSnapshot{};
+}
+
+
+void
+styxe::resetProtocolMetrics() noexcept {
+}
+
+#endif  // STYXE_METRICS
@@ -15,7 +15,11 @@
 */
 
 #include "styxe/requestWriter.hpp"
+#include "styxe/compression.hpp"
 #include "styxe/encoder.hpp"
+#include "styxe/messageLayout.hpp"
+
+#include <limits>
 
 
 using namespace Solace;
@@ -23,6 +27,10 @@ using namespace styxe;
 
 TypedWriter
 RequestWriter::DataWriter::data(MemoryView data) {
+	if (encodeCompressed(buffer(), data, _compression) > 0) {
+		return *this;
+	}
+
 	Encoder encoder{buffer()};
 	encoder << data;
 
@@ -32,8 +40,9 @@ RequestWriter::DataWriter::data(MemoryView data) {
 
 RequestWriter::PathWriter::PathWriter(ByteWriter& writer,
 									  ByteWriter::size_type pos,
-									  MessageHeader header) noexcept
-	: TypedWriter{writer, pos, header}
+									  MessageHeader header,
+									  metrics::Stopwatch started) noexcept
+	: TypedWriter{writer, pos, header, started}
 	, _segmentsPos{writer.position()}
 {
 	Encoder encoder{writer};
@@ -59,8 +68,10 @@ RequestWriter::PathWriter::path(StringView pathSegment) {
 
 RequestWriter::PathDataWriter::PathDataWriter(ByteWriter& writer,
 											  ByteWriter::size_type pos,
-											  MessageHeader head) noexcept
-	: DataWriter{writer, pos, head}
+											  MessageHeader head,
+											  metrics::Stopwatch started,
+											  CompressionPolicy compression) noexcept
+	: DataWriter{writer, pos, head, started, compression}
 	, _segmentsPos{writer.position()}
 {
 	Encoder encoder{writer};
@@ -86,182 +97,216 @@ RequestWriter::PathDataWriter::path(StringView pathSegment) {
 }
 
 
+RequestWriter::ShortBatchWriter::ShortBatchWriter(ByteWriter& writer,
+												  ByteWriter::size_type pos,
+												  MessageHeader header,
+												  metrics::Stopwatch started) noexcept
+	: TypedWriter{writer, pos, header, started}
+	, _entriesPos{writer.position()}
+{
+	Encoder encoder{writer};
+	encoder << _nEntries;
+}
+
+
+void
+RequestWriter::ShortBatchWriter::beginEntry(ShortBatchOp op) {
+	assertTrue(_nEntries < std::numeric_limits<ShortBatchEntries::size_type>::max());
+	_nEntries += 1;
+
+	auto& writer = buffer();
+	Encoder encoder{writer};
+
+	auto const currentPos = writer.position();
+	writer.position(_entriesPos);
+	encoder << _nEntries;
+	writer.position(currentPos);
+
+	encoder << static_cast<byte>(op);
+}
+
+
+RequestWriter::ShortBatchWriter&
+RequestWriter::ShortBatchWriter::read() {
+	beginEntry(ShortBatchOp::Read);
+
+	_nSegments = 0;
+	_segmentsPos = buffer().position();
+	Encoder encoder{buffer()};
+	encoder << _nSegments;
+
+	return *this;
+}
+
+
+RequestWriter::ShortBatchWriter&
+RequestWriter::ShortBatchWriter::write(MemoryView data) {
+	beginEntry(ShortBatchOp::Write);
+
+	Encoder encoder{buffer()};
+	encoder << data;
+
+	_nSegments = 0;
+	_segmentsPos = buffer().position();
+	encoder << _nSegments;
+
+	return *this;
+}
+
+
+RequestWriter::ShortBatchWriter&
+RequestWriter::ShortBatchWriter::path(StringView pathSegment) {
+	assertTrue(_nEntries > 0);  // Path segments belong to an entry: read() or write() must be called first.
+	_nSegments += 1;
+
+	auto& writer = buffer();
+	Encoder encoder{writer};
+
+	auto const currentPos = writer.position();
+	writer.position(_segmentsPos);
+	encoder << _nSegments;
+	writer.position(currentPos);
+
+	encoder << pathSegment;
+
+	return *this;
+}
+
 
 
 TypedWriter
 RequestWriter::version(StringView version, size_type maxMessageSize) {
-	Encoder encoder{_buffer};
-
     // Compute message size first:
     auto const payloadSize =
-			encoder.protocolSize(maxMessageSize) +                // Negotiated message size field
-			encoder.protocolSize(version);   // Version string data
+			Encoder::protocolSize(maxMessageSize) +                // Negotiated message size field
+			Encoder::protocolSize(version);   // Version string data
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::TVersion, Parser::NO_TAG, payloadSize);
-	encoder << header
-			<< maxMessageSize
-			<< version;
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		encoder << maxMessageSize
+				<< version;
+	});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 RequestWriter::auth(Fid afid, StringView userName, StringView attachName) {
-	Encoder encoder{_buffer};
-
     // Compute message size first:
     auto const payloadSize =
-			encoder.protocolSize(afid) +                  // Proposed fid for authentication mechanism
-			encoder.protocolSize(userName) +       // User name
-			encoder.protocolSize(attachName);     // Root name where we want to attach to
+			Encoder::protocolSize(afid) +                  // Proposed fid for authentication mechanism
+			Encoder::protocolSize(userName) +       // User name
+			Encoder::protocolSize(attachName);     // Root name where we want to attach to
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::TAuth, _tag, payloadSize);
-	encoder << header
-			<< afid
-			<< userName
-			<< attachName;
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		encoder << afid
+				<< userName
+				<< attachName;
+	});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 RequestWriter::attach(Fid fid, Fid afid, StringView userName, StringView attachName) {
-	Encoder encoder{_buffer};
-
     // Compute message size first:
     auto const payloadSize =
-			encoder.protocolSize(fid) +                  // Proposed fid for the attached root
-			encoder.protocolSize(afid) +                  // Fid of the passed authentication
-			encoder.protocolSize(userName) +      // User name
-			encoder.protocolSize(attachName);     // Root name where we want to attach to
+			Encoder::protocolSize(fid) +                  // Proposed fid for the attached root
+			Encoder::protocolSize(afid) +                  // Fid of the passed authentication
+			Encoder::protocolSize(userName) +      // User name
+			Encoder::protocolSize(attachName);     // Root name where we want to attach to
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::TAttach, _tag, payloadSize);
-	encoder << header
-			<< fid
-			<< afid
-			<< userName
-			<< attachName;
-
-    return TypedWriter{_buffer, pos, header};
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		encoder << fid
+				<< afid
+				<< userName
+				<< attachName;
+	});
+
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 RequestWriter::clunk(Fid fid) {
-	Encoder encoder{_buffer};
-
-    // Compute message size first:
-    auto const payloadSize =
-			encoder.protocolSize(fid);               // Fid to forget
+	metrics::Stopwatch const started;
+	auto const pos = _buffer.position();
+	auto const header = encodeFixed(_buffer, _tag, Request::Clunk{fid});
 
-    auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::TClunk, _tag, payloadSize);
-	encoder << header
-			<< fid;
-
-    return TypedWriter{_buffer, pos, header};
+	return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 RequestWriter::flush(Tag oldTransation) {
-	Encoder encoder{_buffer};
+	metrics::Stopwatch const started;
+	auto const pos = _buffer.position();
+	auto const header = encodeFixed(_buffer, _tag, Request::Flush{oldTransation});
 
-    // Compute message size first:
-    auto const payloadSize =
-			encoder.protocolSize(oldTransation);               // Transaction to forget
-
-    auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::TFlush, _tag, payloadSize);
-	encoder << header
-			<< oldTransation;
-
-    return TypedWriter{_buffer, pos, header};
+	return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 RequestWriter::remove(Fid fid) {
-	Encoder encoder{_buffer};
-
-    // Compute message size first:
-    auto const payloadSize =
-			encoder.protocolSize(fid);               // Fid to remove
-
-    auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::TRemove, _tag, payloadSize);
-	encoder << header
-			<< fid;
+	metrics::Stopwatch const started;
+	auto const pos = _buffer.position();
+	auto const header = encodeFixed(_buffer, _tag, Request::Remove{fid});
 
-    return TypedWriter{_buffer, pos, header};
+	return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 RequestWriter::open(Fid fid, OpenMode mode) {
-	Encoder encoder{_buffer};
-
-    // Compute message size first:
-    auto const payloadSize =
-			encoder.protocolSize(fid) +                // Fid of the file to open
-			encoder.protocolSize(mode.mode);                // Mode of the file to open
-
-    auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::TOpen, _tag, payloadSize);
-	encoder << header
-			<< fid
-			<< mode.mode;
+	metrics::Stopwatch const started;
+	auto const pos = _buffer.position();
+	auto const header = encodeFixed(_buffer, _tag, Request::Open{fid, mode});
 
-    return TypedWriter{_buffer, pos, header};
+	return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 RequestWriter::create(Fid fid, StringView name, uint32 permissions, OpenMode mode) {
-	Encoder encoder{_buffer};
-
     // Compute message size first:
     auto const payloadSize =
-			encoder.protocolSize(fid) +
-			encoder.protocolSize(name) +
-			encoder.protocolSize(permissions) +
-			encoder.protocolSize(mode.mode);
+			Encoder::protocolSize(fid) +
+			Encoder::protocolSize(name) +
+			Encoder::protocolSize(permissions) +
+			Encoder::protocolSize(mode.mode);
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::TCreate, _tag, payloadSize);
-	encoder << header
-			<< fid
-			<< name
-			<< permissions
-			<< mode.mode;
-
-    return TypedWriter{_buffer, pos, header};
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		encoder << fid
+				<< name
+				<< permissions
+				<< mode.mode;
+	});
+
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 RequestWriter::read(Fid fid, uint64 offset, size_type count) {
-	Encoder encoder{_buffer};
+	metrics::Stopwatch const started;
+	auto const pos = _buffer.position();
+	auto const header = encodeFixed(_buffer, _tag, Request::Read{fid, offset, count});
 
-    // Compute message size first:
-    auto const payloadSize =
-			encoder.protocolSize(fid) +
-			encoder.protocolSize(offset) +
-			encoder.protocolSize(count);
-
-    auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::TRead, _tag, payloadSize);
-	encoder << header
-			<< fid
-			<< offset
-			<< count;
-
-    return TypedWriter{_buffer, pos, header};
+	return TypedWriter{_buffer, pos, header, started};
 }
 
 
@@ -275,13 +320,14 @@ RequestWriter::write(Fid fid, uint64 offset) {
 			encoder.protocolSize(offset) +
 			encoder.protocolSize(MemoryView{});
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::TWrite, _tag, payloadSize);
 	encoder << header
 			<< fid
 			<< offset;
 
-	return DataWriter{_buffer, pos, header};
+	return DataWriter{_buffer, pos, header, started, _compression};
 }
 
 
@@ -295,49 +341,43 @@ RequestWriter::walk(Fid fid, Fid nfid) {
 			encoder.protocolSize(nfid) +
 			encoder.protocolSize(WalkPath::size_type{0});
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::TWalk, _tag, payloadSize);
 	encoder << header
 			<< fid
 			<< nfid;
 
-	return PathWriter{_buffer, pos, header};
+	return PathWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 RequestWriter::stat(Fid fid) {
-	Encoder encoder{_buffer};
-
-    // Compute message size first:
-    auto const payloadSize =
-			encoder.protocolSize(fid);
+	metrics::Stopwatch const started;
+	auto const pos = _buffer.position();
+	auto const header = encodeFixed(_buffer, _tag, Request::StatRequest{fid});
 
-    auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::TStat, _tag, payloadSize);
-	encoder << header
-			<< fid;
-
-    return TypedWriter{_buffer, pos, header};
+	return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 RequestWriter::writeStat(Fid fid, Stat const& stat) {
-	Encoder encoder{_buffer};
-
     // Compute message size first:
     auto const payloadSize =
-			encoder.protocolSize(fid) +
-			encoder.protocolSize(stat);
+			Encoder::protocolSize(fid) +
+			Encoder::protocolSize(stat);
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::TWStat, _tag, payloadSize);
-	encoder << header
-			<< fid
-			<< stat;
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		encoder << fid
+				<< stat;
+	});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
@@ -350,6 +390,7 @@ RequestWriter::session(Solace::ArrayView<byte> key) {
 			8;  // Key size is fixed to be 8 bytes.
 //            protocolSize(key);
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::TSession, _tag, payloadSize);
 	Encoder encoder{_buffer};
@@ -360,7 +401,7 @@ RequestWriter::session(Solace::ArrayView<byte> key) {
 	// in size of the buffer written before the data. In case of Session message - we know key size to be 8 bytes.
 	_buffer.write(key.view());
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 RequestWriter::PathWriter
@@ -372,12 +413,13 @@ RequestWriter::shortRead(Fid rootFid) {
 			encoder.protocolSize(rootFid) +
 			encoder.protocolSize(WalkPath::size_type{0});
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::TSRead, _tag, payloadSize);
 	encoder << header
 			<< rootFid;
 
-	return PathWriter{_buffer, pos, header};
+	return PathWriter{_buffer, pos, header, started};
 }
 
 RequestWriter::PathDataWriter
@@ -390,11 +432,30 @@ RequestWriter::shortWrite(Fid rootFid) {
 			encoder.protocolSize(WalkPath::size_type{0}) +
 			encoder.protocolSize(MemoryView{});
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::TSWrite, _tag, payloadSize);
 	encoder << header
 			<< rootFid;
 
-	return PathDataWriter{_buffer, pos, header};
+	return PathDataWriter{_buffer, pos, header, started, _compression};
 }
 
+
+RequestWriter::ShortBatchWriter
+RequestWriter::shortBatch(Fid rootFid) {
+	Encoder encoder{_buffer};
+
+    // Compute message size first:
+    auto const payloadSize =
+			encoder.protocolSize(rootFid) +
+			encoder.protocolSize(ShortBatchEntries::size_type{0});
+
+    metrics::Stopwatch const started;
+    auto const pos = _buffer.position();
+    auto header = makeHeaderWithPayload(MessageType::TSBatch, _tag, payloadSize);
+	encoder << header
+			<< rootFid;
+
+	return ShortBatchWriter{_buffer, pos, header, started};
+}
@@ -15,7 +15,14 @@
 */
 
 #include "styxe/responseWriter.hpp"
+#include "styxe/compression.hpp"
+#include "styxe/dirListingReader.hpp"
+#include "styxe/errorTable.hpp"
 #include "styxe/encoder.hpp"
+#include "styxe/messageLayout.hpp"
+#include "styxe/metrics.hpp"  // kCannedErrorKinds
+
+#include <limits>
 
 
 using namespace Solace;
@@ -25,250 +32,384 @@ using namespace styxe;
 
 auto noPayloadMessage(ByteWriter& buffer,
                       MessageType type, Tag tag) {
+	metrics::Stopwatch const started;
     auto header = makeHeaderWithPayload(type, tag, 0);
     auto const pos = buffer.position();
 
 	Encoder encoder{buffer};
 	encoder << header;
 
-    return TypedWriter{buffer, pos, header};
+    return TypedWriter{buffer, pos, header, started};
 }
 
 
+/// Write a message with a data payload, compressing the data if the policy allows.
 TypedWriter
-ResponseWriter::version(StringView version, size_type maxMessageSize) {
-    Encoder encoder{_buffer};
+dataMessage(ByteWriter& buffer, MessageType type, Tag tag, MemoryView data, CompressionPolicy compression) {
+    metrics::Stopwatch const started;
+    auto const pos = buffer.position();
+    auto header = makeHeaderWithPayload(type, tag, Encoder::protocolSize(data));
+
+	Encoder encoder{buffer};
+	encoder << header;
+	auto const fieldSize = encodeCompressed(buffer, data, compression);
+	if (fieldSize > 0) {
+		// Header is re-written with the actual size, so that complete() leaves compressed data field intact
+		auto const finalPos = buffer.position();
+		header.messageSize = headerSize() + fieldSize;
+		buffer.position(pos);
+		encoder << header;
+		buffer.position(finalPos);
+
+		return TypedWriter{buffer, pos, header, started};
+	}
+
+	buffer.position(pos);
+	encodeMessage(buffer, header, header.messageSize, [&](auto& fields) {
+		fields << data;
+	});
+
+    return TypedWriter{buffer, pos, header, started};
+}
 
+
+TypedWriter
+ResponseWriter::version(StringView version, size_type maxMessageSize) {
     // Compute message size first:
     auto const payloadSize =
-            encoder.protocolSize(maxMessageSize) +
-            encoder.protocolSize(version);
+            Encoder::protocolSize(maxMessageSize) +
+            Encoder::protocolSize(version);
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::RVersion, Parser::NO_TAG, payloadSize);
-	encoder << header
-			<< maxMessageSize
-			<< version;
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		encoder << maxMessageSize
+				<< version;
+	});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 TypedWriter
 ResponseWriter::auth(Qid qid) {
-    Encoder encoder{_buffer};
-
-    // Compute message size first:
-    auto const payloadSize =
-            encoder.protocolSize(qid);
-
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::RAuth, _tag, payloadSize);
-	encoder << header
-			<< qid;
+    auto const header = encodeFixed(_buffer, _tag, Response::Auth{qid});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 TypedWriter
 ResponseWriter::error(StringView message) {
-    Encoder encoder{_buffer};
-
     // Compute message size first:
     auto const payloadSize =
-            encoder.protocolSize(message);
+            Encoder::protocolSize(message);
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::RError, _tag, payloadSize);
-	encoder << header
-			<< message;
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		encoder << message;
+	});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 TypedWriter
-ResponseWriter::flush() {
-    return noPayloadMessage(_buffer, MessageType::RFlush, _tag);
+ResponseWriter::error(EncodedError const& err) {
+	if (err.empty()) {
+		return error(StringView{});
+	}
+
+	auto const body = err.frame.slice(headerSize(), err.frame.size());
+
+	metrics::Stopwatch const started;
+	auto const pos = _buffer.position();
+	auto header = makeHeaderWithPayload(MessageType::RError, _tag, narrow_cast<size_type>(body.size()));
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		storeBytes(encoder, body);
+	});
+
+	return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
-ResponseWriter::attach(Qid qid) {
-    Encoder encoder{_buffer};
+ResponseWriter::error(CannedError errorId) {
+	return error(getEncodedCannedError(errorId));
+}
 
-    // Compute message size first:
-    auto const payloadSize =
-            encoder.protocolSize(qid);
 
+TypedWriter
+ResponseWriter::error(Error const& err) {
+	auto const code = err.value();
+	if (err.domain() == kProtocolErrorCatergory && code >= 0 && static_cast<uint32>(code) < kCannedErrorKinds) {
+		return error(static_cast<CannedError>(code));
+	}
+
+	return error(err.toString().view());
+}
+
+
+TypedWriter
+ResponseWriter::flush() {
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::RAttach, _tag, payloadSize);
-	encoder << header
-			<< qid;
+    auto const header = encodeFixed(_buffer, _tag, Response::Flush{});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
+
 TypedWriter
-ResponseWriter::walk(Solace::ArrayView<Qid> qids) {
-    Encoder encoder{_buffer};
+ResponseWriter::attach(Qid qid) {
+    metrics::Stopwatch const started;
+    auto const pos = _buffer.position();
+    auto const header = encodeFixed(_buffer, _tag, Response::Attach{qid});
+
+    return TypedWriter{_buffer, pos, header, started};
+}
 
+TypedWriter
+ResponseWriter::walk(Solace::ArrayView<Qid> qids) {
     // Compute message size first:
     auto const payloadSize =
-            encoder.protocolSize(qids);
+            Encoder::protocolSize(qids);
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::RWalk, _tag, payloadSize);
-	encoder << header
-			<< qids;
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		encoder << qids;
+	});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 TypedWriter
 ResponseWriter::open(Qid qid, size_type iounit) {
-    Encoder encoder{_buffer};
-
-    // Compute message size first:
-    auto const payloadSize =
-            encoder.protocolSize(qid) +
-            encoder.protocolSize(iounit);
-
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::ROpen, _tag, payloadSize);
-	encoder << header
-			<< qid
-			<< iounit;
+    auto const header = encodeFixed(_buffer, _tag, Response::Open{qid, iounit});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 ResponseWriter::create(Qid qid, size_type iounit) {
-    Encoder encoder{_buffer};
-
-    // Compute message size first:
-    auto const payloadSize =
-            encoder.protocolSize(qid) +
-            encoder.protocolSize(iounit);
-
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::RCreate, _tag, payloadSize);
-	encoder << header
-			<< qid
-			<< iounit;
+    auto const header = encodeFixed(_buffer, _tag, Response::Create{qid, iounit});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 ResponseWriter::read(MemoryView data) {
-    Encoder encoder{_buffer};
-
-    // Compute message size first:
-    auto const payloadSize =
-            encoder.protocolSize(data);
+    return dataMessage(_buffer, MessageType::RRead, _tag, data, _compression);
+}
 
-    auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::RRead, _tag, payloadSize);
-	encoder << header
-			<< data;
 
-    return TypedWriter{_buffer, pos, header};
+TypedWriter
+ResponseWriter::read() {
+    return noPayloadMessage(_buffer, MessageType::RRead, _tag);
 }
 
 
 TypedWriter
 ResponseWriter::write(size_type count) {
-    Encoder encoder{_buffer};
-
-    // Compute message size first:
-    auto const payloadSize =
-            encoder.protocolSize(count);
-
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::RWrite, _tag, payloadSize);
-	encoder << header
-			<< count;
+    auto const header = encodeFixed(_buffer, _tag, Response::Write{count});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 ResponseWriter::clunk() {
-    return noPayloadMessage(_buffer, MessageType::RClunk, _tag);
+    metrics::Stopwatch const started;
+    auto const pos = _buffer.position();
+    auto const header = encodeFixed(_buffer, _tag, Response::Clunk{});
+
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 ResponseWriter::remove() {
-    return noPayloadMessage(_buffer, MessageType::RRemove, _tag);
+    metrics::Stopwatch const started;
+    auto const pos = _buffer.position();
+    auto const header = encodeFixed(_buffer, _tag, Response::Remove{});
+
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 ResponseWriter::stat(Stat const& data) {
-    Encoder encoder{_buffer};
-
     // Compute message size first:
-    var_datum_size_type const statSize = encoder.protocolSize(data);  // FIXME: Deal with stat data size over 64k
+    var_datum_size_type const statSize = Encoder::protocolSize(data);  // FIXME: Deal with stat data size over 64k
     auto const payloadSize = narrow_cast<size_type>(sizeof(var_datum_size_type) + statSize);
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
     auto header = makeHeaderWithPayload(MessageType::RStat, _tag, payloadSize);
-	encoder << header
-			<< statSize
-			<< data;
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		encoder << statSize
+				<< data;
+	});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
+}
+
+
+TypedWriter
+ResponseWriter::stat(StatView const& value) {
+	auto const data = value.data();
+	var_datum_size_type const statSize = narrow_cast<var_datum_size_type>(data.size());
+	auto const payloadSize = narrow_cast<size_type>(sizeof(var_datum_size_type) + statSize);
+
+	metrics::Stopwatch const started;
+	auto const pos = _buffer.position();
+	auto header = makeHeaderWithPayload(MessageType::RStat, _tag, payloadSize);
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		encoder << statSize;
+		storeBytes(encoder, data);
+	});
+
+	return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 ResponseWriter::wstat() {
-    return noPayloadMessage(_buffer, MessageType::RWStat, _tag);
+    metrics::Stopwatch const started;
+    auto const pos = _buffer.position();
+    auto const header = encodeFixed(_buffer, _tag, Response::WStat{});
+
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
 TypedWriter
 ResponseWriter::session() {
-    return noPayloadMessage(_buffer, MessageType::RSession, _tag);
+    metrics::Stopwatch const started;
+    auto const pos = _buffer.position();
+    auto const header = encodeFixed(_buffer, _tag, Response_9P2000E::Session{});
+
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
 
 TypedWriter
 ResponseWriter::shortRead(MemoryView data) {
-    Encoder encoder{_buffer};
+    return dataMessage(_buffer, MessageType::RSRead, _tag, data, _compression);
+}
+
+
+TypedWriter
+ResponseWriter::shortRead() {
+    return noPayloadMessage(_buffer, MessageType::RSRead, _tag);
+}
 
+
+TypedWriter
+ResponseWriter::shortWrite(size_type count) {
     // Compute message size first:
     auto const payloadSize =
-            encoder.protocolSize(data);
+            Encoder::protocolSize(count);
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::RSRead, _tag, payloadSize);
-	encoder << header
-			<< data;
+    auto header = makeHeaderWithPayload(MessageType::RSWrite, _tag, payloadSize);
+	encodeMessage(_buffer, header, header.messageSize, [&](auto& encoder) {
+		encoder << count;
+	});
 
-    return TypedWriter{_buffer, pos, header};
+    return TypedWriter{_buffer, pos, header, started};
 }
 
 
-TypedWriter
-ResponseWriter::shortWrite(size_type count) {
-    Encoder encoder{_buffer};
-
+ResponseWriter::ShortBatchWriter
+ResponseWriter::shortBatch() {
     // Compute message size first:
     auto const payloadSize =
-            encoder.protocolSize(count);
+            Encoder::protocolSize(ShortBatchResults::size_type{0});
 
+    metrics::Stopwatch const started;
     auto const pos = _buffer.position();
-    auto header = makeHeaderWithPayload(MessageType::RSWrite, _tag, payloadSize);
-	encoder << header
-			<< count;
+    auto header = makeHeaderWithPayload(MessageType::RSBatch, _tag, payloadSize);
+	Encoder encoder{_buffer};
+	encoder << header;
+
+    return ShortBatchWriter{_buffer, pos, header, started};
+}
+
+
+ResponseWriter::ShortBatchWriter::ShortBatchWriter(ByteWriter& writer,
+													ByteWriter::size_type pos,
+													MessageHeader header,
+													metrics::Stopwatch started) noexcept
+	: TypedWriter{writer, pos, header, started}
+	, _entriesPos{writer.position()}
+{
+	Encoder encoder{writer};
+	encoder << _nEntries;
+}
+
+
+void
+ResponseWriter::ShortBatchWriter::beginEntry(ShortBatchStatus status) {
+	assertTrue(_nEntries < std::numeric_limits<ShortBatchResults::size_type>::max());
+	_nEntries += 1;
+
+	auto& writer = buffer();
+	Encoder encoder{writer};
+
+	auto const currentPos = writer.position();
+	writer.position(_entriesPos);
+	encoder << _nEntries;
+	writer.position(currentPos);
+
+	encoder << static_cast<byte>(status);
+}
+
+
+ResponseWriter::ShortBatchWriter&
+ResponseWriter::ShortBatchWriter::data(MemoryView data) {
+	beginEntry(ShortBatchStatus::Data);
+
+	Encoder encoder{buffer()};
+	encoder << data;
+
+	return *this;
+}
+
 
-    return TypedWriter{_buffer, pos, header};
+ResponseWriter::ShortBatchWriter&
+ResponseWriter::ShortBatchWriter::written(size_type count) {
+	beginEntry(ShortBatchStatus::Written);
+
+	Encoder encoder{buffer()};
+	encoder << count;
+
+	return *this;
+}
+
+
+ResponseWriter::ShortBatchWriter&
+ResponseWriter::ShortBatchWriter::error(StringView message) {
+	beginEntry(ShortBatchStatus::Failed);
+
+	Encoder encoder{buffer()};
+	encoder << message;
+
+	return *this;
 }
 
 
@@ -280,19 +421,24 @@ DirListingWriter::sizeStat(Stat const& stat) {
 
 bool DirListingWriter::encode(Stat const& stat) {
 	auto const protoSize = Encoder::protocolSize(stat);
-    // Keep count of how many data we have traversed.
-    _bytesTraversed += protoSize;
-    if (_bytesTraversed <= offset) {  // Client is only interested in data pass the offset.
+    // Client is only interested in data pass the offset.
+    if (_bytesTraversed + protoSize <= offset) {
+        // Keep count of how many data we have traversed.
+        _bytesTraversed += protoSize;
+        _entryIndex += 1;
         return true;
     }
 
     // Keep track of much data will end up in a buffer to prevent overflow.
-    _bytesEncoded += protoSize;
-    if (_bytesEncoded > count) {
+    if (_bytesEncoded + protoSize > count) {
         return false;
     }
 
     // Only encode the data if we have some room left, as specified by 'count' arg.
+    _bytesTraversed += protoSize;
+    _bytesEncoded += protoSize;
+    _entryIndex += 1;
+
 	Encoder encoder{_dest};
 	encoder << stat;
 
@@ -303,8 +449,30 @@ bool DirListingWriter::encode(Stat const& stat) {
 
 ByteWriter&
 TypedWriter::build() {
+    return complete().flip();
+}
+
+
+ByteWriter&
+TypedWriter::complete() {
+    auto& buffer = finish();
+    trace::recordSent(FrameSegments{buffer.viewWritten().slice(_pos, buffer.position()), MemoryView{}});
+
+    return buffer;
+}
+
+
+ByteWriter&
+TypedWriter::finish() {
     auto const finalPos = _buffer.position();
     auto const messageSize = finalPos - _pos;  // Re-compute actual message size
+
+    // Messages encoded in one go already have correct header: no need to seek back and re-write it.
+    if (messageSize == _header.messageSize) {
+		metrics::recordEncode(_header, _started);
+        return _buffer;
+    }
+
     _buffer.position(_pos);  // Reset to the start position
 
     _header.messageSize = narrow_cast<size_type>(messageSize);
@@ -317,6 +485,36 @@ TypedWriter::build() {
     }
 
     _buffer.position(finalPos);
+	metrics::recordEncode(_header, _started);
+
+    return _buffer;
+}
+
+
+FrameSegments
+TypedWriter::build(MemoryView payload) {
+	// Only a trailing data field can be left out of line.
+	assertTrue(_header.type == MessageType::RRead || _header.type == MessageType::RSRead ||
+			   _header.type == MessageType::TWrite || _header.type == MessageType::TSWrite,
+			   "Payload can only be left out of line for RRead, RSRead, TWrite and TSWrite messages");
+
+    auto const dataSize = narrow_cast<size_type>(payload.size());
+
+    Encoder encoder{_buffer};
+    encoder << dataSize;
+
+    auto const finalPos = _buffer.position();
+    _header.messageSize = narrow_cast<size_type>(finalPos - _pos + dataSize);  // Payload is accounted for but not written
+    _buffer.position(_pos);  // Reset to the start position
+    encoder << _header;
+    _buffer.position(finalPos);
+
+    auto const frameHeader = _buffer.viewWritten().slice(_pos, finalPos);
+    _buffer.flip();
+	metrics::recordEncode(_header, _started);
+
+    auto const segments = FrameSegments{frameHeader, payload};
+    trace::recordSent(segments);
 
-    return _buffer.flip();
+    return segments;
 }
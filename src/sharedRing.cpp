@@ -0,0 +1,257 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+
+#include "styxe/sharedRing.hpp"
+#include "styxe/messageLayout.hpp"  // WireField
+
+#include <solace/assert.hpp>
+
+#include <cstdint>  // std::uintptr_t
+#include <limits>
+#include <new>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace  {
+
+/// Get number of bytes occupied by a frame of the given size, including alignment padding.
+constexpr uint64 frameSpan(uint64 size) noexcept {
+	return (size + kRingFrameAlignment - 1) & ~static_cast<uint64>(kRingFrameAlignment - 1);
+}
+
+constexpr bool isPowerOfTwo(uint64 value) noexcept {
+	return (value != 0) && ((value & (value - 1)) == 0);
+}
+
+
+SharedRingControl&
+attachControl(MutableMemoryView memory) {
+	assertTrue(memory.size() >= sizeof(SharedRingControl), "Memory is too small for a shared ring");
+
+	auto& control = *memory.dataAs<SharedRingControl>();
+	assertTrue(control.magic == SharedRingControl::kMagic, "Shared ring is not initialized");
+	assertTrue(isPowerOfTwo(control.capacity) && control.capacity >= kRingFrameAlignment &&
+			   sharedRingMemorySize(control.capacity) <= memory.size(), "Shared ring capacity is invalid");
+
+	return control;
+}
+
+
+MutableMemoryView
+ringData(MutableMemoryView memory, SharedRingControl const& control) {
+	return memory.slice(sizeof(SharedRingControl), sharedRingMemorySize(control.capacity));
+}
+
+
+/// Store a value and check if the peer waits for it. Paired with a peer setting the wait flag and loading the value.
+bool publishPosition(std::atomic<uint64>& position, uint64 value, std::atomic<uint32>& peerWaiting) noexcept {
+	position.store(value, std::memory_order_release);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	return (peerWaiting.load(std::memory_order_relaxed) != 0) &&
+			(peerWaiting.exchange(0, std::memory_order_relaxed) != 0);
+}
+
+}  // namespace
+
+
+constexpr uint32 SharedRingControl::kMagic;
+
+
+size_type
+styxe::initializeSharedRing(MutableMemoryView memory) {
+	assertTrue(reinterpret_cast<std::uintptr_t>(memory.dataAs<byte>()) % kRingCacheLineSize == 0,
+			   "Shared ring memory is not aligned");
+	assertTrue(memory.size() >= sharedRingMemorySize(kRingFrameAlignment), "Memory is too small for a shared ring");
+
+	uint64 capacity = kRingFrameAlignment;
+	while (sharedRingMemorySize(static_cast<size_type>(capacity << 1)) <= memory.size() &&
+		   (capacity << 1) <= std::numeric_limits<size_type>::max()) {
+		capacity <<= 1;
+	}
+
+	auto control = new (memory.dataAs<void>()) SharedRingControl{};
+	control->capacity = static_cast<size_type>(capacity);
+	control->head.store(0, std::memory_order_relaxed);
+	control->tail.store(0, std::memory_order_relaxed);
+	control->consumerWaiting.store(0, std::memory_order_relaxed);
+	control->producerWaiting.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	control->magic = SharedRingControl::kMagic;
+
+	return control->capacity;
+}
+
+
+RingProducer::RingProducer(MutableMemoryView memory)
+	: _control{attachControl(memory)}
+	, _data{ringData(memory, _control)}
+	, _capacity{_control.capacity}
+	, _head{_control.head.load(std::memory_order_relaxed)}
+	, _tailCache{_control.tail.load(std::memory_order_acquire)}
+{
+}
+
+
+bool
+RingProducer::hasSpace(uint64 size) noexcept {
+	if (_capacity - (_head - _tailCache) >= size) {
+		return true;
+	}
+
+	_tailCache = _control.tail.load(std::memory_order_acquire);
+	return (_capacity - (_head - _tailCache) >= size);
+}
+
+
+MutableMemoryView
+RingProducer::reserve(size_type size) noexcept {
+	auto const span = frameSpan(size);
+	if (size == 0 || span > _capacity) {
+		return {};
+	}
+
+	auto offset = _head & (_capacity - 1);
+	auto const contiguous = _capacity - offset;
+	auto const padding = (contiguous < span) ? contiguous : 0;
+	if (!hasSpace(padding + span)) {
+		return {};
+	}
+
+	if (padding > 0) {  // Message does not fit before the end of the ring: mark the rest as skipped.
+		WireField<size_type>::store(_data.dataAs<byte>(offset), 0);
+		_head += padding;
+		offset = 0;
+	}
+
+	_reserved = size;
+	return _data.slice(offset, offset + size);
+}
+
+
+void
+RingProducer::commit(size_type messageSize) {
+	assertTrue(headerSize() <= messageSize && messageSize <= _reserved, "Message does not match the slot reserved");
+
+	_head += frameSpan(messageSize);
+	_reserved = 0;
+}
+
+
+bool
+RingProducer::publish() noexcept {
+	return publishPosition(_control.head, _head, _control.consumerWaiting);
+}
+
+
+bool
+RingProducer::prepareWait(size_type size) noexcept {
+	_control.producerWaiting.store(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	auto const span = frameSpan(size);
+	auto const contiguous = _capacity - (_head & (_capacity - 1));
+	_tailCache = _control.tail.load(std::memory_order_acquire);
+	if (hasSpace(span + ((contiguous < span) ? contiguous : 0))) {
+		_control.producerWaiting.store(0, std::memory_order_relaxed);
+		return false;
+	}
+
+	return true;
+}
+
+
+RingConsumer::RingConsumer(Parser const& parser, MutableMemoryView memory)
+	: _parser{parser}
+	, _control{attachControl(memory)}
+	, _data{ringData(memory, _control)}
+	, _capacity{_control.capacity}
+	, _tail{_control.tail.load(std::memory_order_relaxed)}
+	, _headCache{_control.head.load(std::memory_order_acquire)}
+{
+}
+
+
+Result<MemoryView, Error>
+RingConsumer::nextFrame() {
+	while (true) {
+		if (_tail == _headCache) {
+			_headCache = _control.head.load(std::memory_order_acquire);
+			if (_tail == _headCache) {
+				return Result<MemoryView, Error>{types::okTag, MemoryView{}};
+			}
+		}
+
+		// Positions are written by the peer, thus are not trusted.
+		auto const available = _headCache - _tail;
+		if (available < sizeof(size_type) || available > _capacity) {
+			return getCannedError(CannedError::IllFormedHeader);
+		}
+
+		auto const offset = _tail & (_capacity - 1);
+		auto const contiguous = _capacity - offset;
+		size_type frameSize;
+		WireField<size_type>::load(_data.dataAs<byte const>(offset), frameSize);
+		if (frameSize == 0) {  // Wrap marker: next frame starts at the beginning of the ring
+			if (contiguous > available) {
+				return getCannedError(CannedError::IllFormedHeader);
+			}
+
+			_tail += contiguous;
+			continue;
+		}
+
+		if (frameSize < headerSize()) {
+			return getCannedError(CannedError::IllFormedHeader_FrameTooShort);
+		}
+
+		if (frameSize > contiguous || frameSpan(frameSize) > available) {
+			return getCannedError(CannedError::IllFormedHeader_TooBig);
+		}
+
+		return Result<MemoryView, Error>{types::okTag, _data.slice(offset, offset + frameSize)};
+	}
+}
+
+
+void
+RingConsumer::consume(MemoryView::size_type frameSize) noexcept {
+	_tail += frameSpan(frameSize);
+}
+
+
+bool
+RingConsumer::publish() noexcept {
+	return publishPosition(_control.tail, _tail, _control.producerWaiting);
+}
+
+
+bool
+RingConsumer::prepareWait() noexcept {
+	_control.consumerWaiting.store(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	_headCache = _control.head.load(std::memory_order_acquire);
+	if (_headCache != _tail) {
+		_control.consumerWaiting.store(0, std::memory_order_relaxed);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,270 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+
+#include "styxe/trace.hpp"
+
+#include <chrono>
+#include <cstring>  // memcpy
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace  {
+
+/// Trace hook of the thread.
+thread_local TraceHook currentHook;
+
+
+uint64 steadyNanos() noexcept {
+	auto const now = std::chrono::steady_clock::now().time_since_epoch();
+	return static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+uint64 wallClockNanos() noexcept {
+	auto const now = std::chrono::system_clock::now().time_since_epoch();
+	return static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+
+/// Read a little-endian value at the given offset. Zero is returned if there is not enough data.
+template<typename T>
+T readAt(MemoryView data, MemoryView::size_type offset) noexcept {
+	T value{0};
+	if (offset + sizeof(T) <= data.size()) {
+		ByteReader reader{data.slice(offset, offset + sizeof(T))};
+		reader.readLE(value);
+	}
+
+	return value;
+}
+
+
+/// Get number of bytes occupied by the leading record of the trace or 0 if the record is incomplete.
+MemoryView::size_type
+recordSize(MemoryView data) noexcept {
+	auto const frameOffset = TraceFormat::kRecordHeaderSize;
+	if (data.size() < frameOffset + headerSize()) {
+		return 0;
+	}
+
+	auto const frameSize = readAt<size_type>(data, frameOffset);
+	auto const size = frameOffset + frameSize;
+	return (headerSize() <= frameSize && size <= data.size())
+			? size
+			: 0;
+}
+
+
+void traceToWriter(void* context, TraceDirection direction, FrameSegments const& frame) {
+	static_cast<TraceWriter*>(context)->record(direction, frame);
+}
+
+}  // namespace
+
+
+TraceHook
+styxe::setTraceHook(TraceHook hook) noexcept {
+	auto const previous = currentHook;
+	currentHook = hook;
+
+	return previous;
+}
+
+
+TraceHook
+styxe::traceHook() noexcept {
+	return currentHook;
+}
+
+
+void
+trace::recordReceived(MessageHeader const& header, MemoryView payload) noexcept {
+	auto const hook = currentHook;
+	if (!hook) {
+		return;
+	}
+
+	// Header has already been decoded from a buffer that may be gone: it is re-encoded.
+	byte encodedHeader[sizeof(size_type) + sizeof(MessageType) + sizeof(Tag)];
+	ByteWriter writer{wrapMemory(encodedHeader)};
+	writer.writeLE(header.messageSize);
+	writer.writeLE(static_cast<byte>(header.type));
+	writer.writeLE(header.tag);
+
+	hook.callback(hook.context, TraceDirection::Received, FrameSegments{wrapMemory(encodedHeader), payload});
+}
+
+
+void
+trace::recordSent(FrameSegments const& frame) noexcept {
+	auto const hook = currentHook;
+	if (hook) {
+		hook.callback(hook.context, TraceDirection::Sent, frame);
+	}
+}
+
+
+TraceWriter::TraceWriter(MutableMemoryView buffer, FlushCallback flushCallback, void* context) noexcept
+	: _buffer{buffer}
+	, _flush{flushCallback}
+	, _context{context}
+	, _started{steadyNanos()}
+{
+	assertTrue(buffer.size() >= TraceFormat::kHeaderSize);
+
+	ByteWriter writer{_buffer};
+	writer.writeLE(TraceFormat::kMagic);
+	writer.writeLE(TraceFormat::kVersion);
+	writer.writeLE(uint16{0});
+	writer.writeLE(wallClockNanos());
+	_size = writer.position();
+}
+
+
+uint64
+TraceWriter::elapsedNanos() const noexcept {
+	return steadyNanos() - _started;
+}
+
+
+void
+TraceWriter::record(TraceDirection direction, FrameSegments const& frame) noexcept {
+	record(direction, elapsedNanos(), frame);
+}
+
+
+void
+TraceWriter::record(TraceDirection direction, uint64 timestamp, FrameSegments const& frame) noexcept {
+	byte recordHeader[TraceFormat::kRecordHeaderSize];
+	ByteWriter writer{wrapMemory(recordHeader)};
+	writer.writeLE((timestamp << 1) | static_cast<uint64>(direction));
+
+	auto const recordSize = sizeof(recordHeader) + frame.size();
+	if (_size + recordSize > _buffer.size()) {
+		flush();
+	}
+
+	_frames += 1;
+	if (recordSize > _buffer.size()) {  // Frame that does not fit into an empty buffer is passed on in place.
+		_flush(_context, wrapMemory(recordHeader));
+		_flush(_context, frame.header);
+		if (frame.payload.size() > 0) {
+			_flush(_context, frame.payload);
+		}
+		return;
+	}
+
+	MemoryView const segments[] = {wrapMemory(recordHeader), frame.header, frame.payload};
+	auto dest = _buffer.dataAs<byte>() + _size;
+	for (auto const& segment : segments) {
+		if (segment.size() > 0) {
+			std::memcpy(dest, segment.dataAs<byte const>(), segment.size());
+			dest += segment.size();
+		}
+	}
+	_size += recordSize;
+}
+
+
+void
+TraceWriter::flush() noexcept {
+	if (_size > 0) {
+		_flush(_context, _buffer.slice(0, _size));
+		_size = 0;
+	}
+}
+
+
+TraceHook
+TraceWriter::hook() noexcept {
+	return TraceHook{traceToWriter, this};
+}
+
+
+TraceReader::Iterator::Iterator(MemoryView data) noexcept
+	: _data{(recordSize(data) > 0) ? data : MemoryView{}}
+{}
+
+
+TraceRecord
+TraceReader::Iterator::operator* () const noexcept {
+	auto const word = readAt<uint64>(_data, 0);
+
+	TraceRecord record;
+	record.direction = static_cast<TraceDirection>(word & 1);
+	record.timestamp = word >> 1;
+	record.frame = _data.slice(TraceFormat::kRecordHeaderSize, recordSize(_data));
+
+	return record;
+}
+
+
+TraceReader::Iterator&
+TraceReader::Iterator::operator++ () noexcept {
+	auto const rest = _data.slice(recordSize(_data), _data.size());
+	_data = (recordSize(rest) > 0) ? rest : MemoryView{};
+
+	return *this;
+}
+
+
+Result<void, Error>
+TraceReader::validate(Parser const& parser) const {
+	if (_data.size() < TraceFormat::kHeaderSize) {
+		return getCannedError(CannedError::NotEnoughData);
+	}
+
+	if (readAt<uint32>(_data, 0) != TraceFormat::kMagic ||
+		readAt<uint16>(_data, sizeof(uint32)) != TraceFormat::kVersion) {
+		return getCannedError(CannedError::IllFormedHeader);
+	}
+
+	auto data = _data.slice(TraceFormat::kHeaderSize, _data.size());
+	while (data.size() > 0) {
+		auto const size = recordSize(data);
+		if (size == 0) {
+			return getCannedError(CannedError::NotEnoughData);
+		}
+
+		ByteReader reader{data.slice(TraceFormat::kRecordHeaderSize, size)};
+		auto header = parser.parseMessageHeader(reader);
+		if (!header) {
+			return header.getError();
+		}
+
+		data = data.slice(size, data.size());
+	}
+
+	return Result<void, Error>{types::okTag};
+}
+
+
+uint64
+TraceReader::startTime() const noexcept {
+	return (readAt<uint32>(_data, 0) == TraceFormat::kMagic)
+			? readAt<uint64>(_data, sizeof(uint32) + 2 * sizeof(uint16))
+			: 0;
+}
+
+
+TraceReader::Iterator
+TraceReader::begin() const noexcept {
+	return (_data.size() >= TraceFormat::kHeaderSize)
+			? Iterator{_data.slice(TraceFormat::kHeaderSize, _data.size())}
+			: Iterator{};
+}
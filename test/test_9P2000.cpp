@@ -23,12 +23,16 @@
 #include "styxe/requestWriter.hpp"
 #include "styxe/responseWriter.hpp"
 #include "styxe/encoder.hpp"
+#include "styxe/decoder.hpp"
 
 #include <solace/exception.hpp>
 #include <solace/output_utils.hpp>
 
 #include <gtest/gtest.h>
 
+#include <type_traits>
+#include <vector>
+
 
 using namespace Solace;
 using namespace styxe;
@@ -97,6 +101,52 @@ TEST(P9_2000, testSettingFrameSize) {
     ASSERT_ANY_THROW(proc.maxNegotiatedMessageSize(300));
 }
 
+TEST(P9_2000, protocolVersions) {
+    EXPECT_EQ(ProtocolVersion::V9P2000, parseProtocolVersion("9P2000"));
+    EXPECT_EQ(ProtocolVersion::V9P2000E, parseProtocolVersion(Parser::PROTOCOL_VERSION));
+    EXPECT_EQ(ProtocolVersion::Unknown, parseProtocolVersion("9P2000.u"));
+
+    EXPECT_EQ(StringView{"9P2000"}, protocolVersionString(ProtocolVersion::V9P2000));
+    EXPECT_EQ(Parser::PROTOCOL_VERSION, protocolVersionString(ProtocolVersion::V9P2000E));
+    EXPECT_EQ(Parser::UNKNOWN_PROTOCOL_VERSION, protocolVersionString(ProtocolVersion::Unknown));
+
+    EXPECT_EQ(ProtocolVersion::V9P2000EB, parseProtocolVersion(Parser::BATCH_PROTOCOL_VERSION));
+    EXPECT_EQ(Parser::BATCH_PROTOCOL_VERSION, protocolVersionString(ProtocolVersion::V9P2000EB));
+}
+
+
+TEST(P9_2000, negotiateProtocolVersion) {
+    EXPECT_EQ(ProtocolVersion::V9P2000E, negotiateProtocolVersion(ProtocolVersion::V9P2000EB, ProtocolVersion::V9P2000E));
+    EXPECT_EQ(ProtocolVersion::V9P2000E, negotiateProtocolVersion(ProtocolVersion::V9P2000E, ProtocolVersion::V9P2000EB));
+    EXPECT_EQ(ProtocolVersion::V9P2000EB, negotiateProtocolVersion(ProtocolVersion::V9P2000EB, ProtocolVersion::V9P2000EB));
+    EXPECT_EQ(ProtocolVersion::V9P2000, negotiateProtocolVersion(ProtocolVersion::V9P2000, ProtocolVersion::V9P2000EB));
+    EXPECT_EQ(ProtocolVersion::Unknown, negotiateProtocolVersion(ProtocolVersion::Unknown, ProtocolVersion::V9P2000EB));
+}
+
+
+TEST(P9_2000, testSessionStateIsPerParser) {
+    ProtocolConfig const config{1024, ProtocolVersion::V9P2000E};
+    Parser connection1{config};
+    Parser connection2{config};
+
+    connection1.maxNegotiatedMessageSize(256);
+    connection1.setNegotiatedVersion("9P2000");
+
+    EXPECT_EQ(256u, connection1.session().maxNegotiatedMessageSize);
+    EXPECT_EQ(ProtocolVersion::V9P2000, connection1.negotiatedVersion());
+    EXPECT_EQ(StringView{"9P2000"}, connection1.getNegotiatedVersion());
+
+    EXPECT_EQ(1024u, connection2.maxNegotiatedMessageSize());
+    EXPECT_EQ(ProtocolVersion::V9P2000E, connection2.negotiatedVersion());
+
+    // Session can be restored from saved state
+    Parser restored{config, connection1.session()};
+    EXPECT_EQ(256u, restored.maxNegotiatedMessageSize());
+    EXPECT_EQ(1024u, restored.maxPossibleMessageSize());
+    EXPECT_EQ(ProtocolVersion::V9P2000, restored.negotiatedVersion());
+}
+
+
 TEST(P9_2000, testParsingMessageHeader) {
     // Form a normal message with no data:
 	byte buffer[16];
@@ -199,6 +249,85 @@ TEST(P9_2000, parseIncorrectlySizedLargerResponse) {
 }
 
 
+TEST(P9_2000, parseResponseWithStringExceedingFrame) {
+	byte buffer[32];
+	auto writer = ByteWriter{wrapMemory(buffer)};
+
+	// String size is larger then the rest of the frame
+	writeHeader(writer, headerSize() + sizeof(var_datum_size_type) + 3, MessageType::RError, 1);
+	writer.writeLE(var_datum_size_type(20));
+	writer.write(StringView{"Bad"}.view());
+
+	Parser proc;
+	auto reader = ByteReader{writer.viewWritten()};
+	auto header = proc.parseMessageHeader(reader);
+	ASSERT_TRUE(header.isOk());
+	EXPECT_TRUE(proc.parseResponse(header.unwrap(), reader).isError());
+}
+
+TEST(P9_2000, parseWalkResponseWithQidsExceedingFrame) {
+	byte buffer[64];
+	auto writer = ByteWriter{wrapMemory(buffer)};
+
+	// Claim 3 qids but only provide one
+	writeHeader(writer, headerSize() + sizeof(var_datum_size_type) + 13, MessageType::RWalk, 1);
+	writer.writeLE(var_datum_size_type(3));
+	writer.writeLE(byte(1));
+	writer.writeLE(uint32(2));
+	writer.writeLE(uint64(3));
+
+	Parser proc;
+	auto reader = ByteReader{writer.viewWritten()};
+	auto header = proc.parseMessageHeader(reader);
+	ASSERT_TRUE(header.isOk());
+	EXPECT_TRUE(proc.parseResponse(header.unwrap(), reader).isError());
+}
+
+TEST(P9_2000, parseCreateRequestTruncatedAfterName) {
+	byte buffer[64];
+	auto writer = ByteWriter{wrapMemory(buffer)};
+
+	// Fixed size fields following the name are missing
+	writeHeader(writer, headerSize() + sizeof(Fid) + sizeof(var_datum_size_type) + 4, MessageType::TCreate, 1);
+	writer.writeLE(Fid(7));
+	writer.writeLE(var_datum_size_type(4));
+	writer.write(StringView{"file"}.view());
+
+	Parser proc;
+	auto reader = ByteReader{writer.viewWritten()};
+	auto header = proc.parseMessageHeader(reader);
+	ASSERT_TRUE(header.isOk());
+	EXPECT_TRUE(proc.parseRequest(header.unwrap(), reader).isError());
+}
+
+TEST(P9_2000, failedDecodingDoesNotConsumeData) {
+	byte buffer[64];
+	auto writer = ByteWriter{wrapMemory(buffer)};
+	writer.writeLE(Fid(7));
+	writer.writeLE(var_datum_size_type(32));
+
+	auto reader = ByteReader{writer.viewWritten()};
+	Request::Walk walk;
+	EXPECT_TRUE(decode(reader, walk).isError());  // Not enough data for the newfid
+	EXPECT_EQ(0u, reader.position());
+
+	Request::Auth auth;
+	EXPECT_TRUE(decode(reader, auth).isError());  // User name is longer then the data
+	EXPECT_EQ(0u, reader.position());
+}
+
+TEST(P9_2000, decoderPropagatesReadErrors) {
+	byte buffer[2] = {1, 2};
+	auto reader = ByteReader{wrapMemory(buffer)};
+
+	Decoder decoder{reader};
+	uint32 value;
+	EXPECT_TRUE((decoder >> value).isError());
+
+	StringView str;
+	EXPECT_TRUE((decoder >> str).isError());
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// 9P2000 Message parsing test suit
@@ -874,6 +1003,40 @@ TEST_F(P9Messages, createWalkRequest) {
 			});
 }
 
+TEST_F(P9Messages, walkRequestPathIsIndexed) {
+	RequestWriter{_writer}
+			.walk(1, 2)
+			.path("usr")
+			.path("local")
+			.path("bin")
+			.build();
+
+	getRequestOrFail<Request::Walk>(MessageType::TWalk)
+			.then([](Request::Walk&& request) {
+				IndexedWalkPath const path{request.path};
+				ASSERT_EQ(3, path.size());
+				EXPECT_EQ("usr", path[0]);
+				EXPECT_EQ("bin", path[2]);
+				EXPECT_EQ("local", path[1]);
+				EXPECT_EQ(IndexedWalkPath::hashOf("local"), path.hash(1));
+				EXPECT_NE(path.hash(0), path.hash(2));
+				EXPECT_EQ(request.path.data(), path.walkPath().data());
+			});
+}
+
+TEST_F(P9Messages, walkRequestWithTooManySegmentsIsRejected) {
+	auto walk = RequestWriter{_writer}.walk(1, 2);
+	for (IndexedWalkPath::size_type i = 0; i <= IndexedWalkPath::kMaxSegments; ++i) {
+		walk.path("a");
+	}
+	walk.done().build();
+
+	_reader.limit(_writer.limit());
+	auto header = proc.parseMessageHeader(_reader);
+	ASSERT_TRUE(header.isOk());
+	EXPECT_TRUE(proc.parseRequest(header.unwrap(), _reader).isError());
+}
+
 TEST_F(P9Messages, createWalkEmptyPathRequest) {
 	RequestWriter{_writer}
 			.walk(7374, 542)
@@ -902,8 +1065,14 @@ TEST_F(P9Messages, createWalkRespose) {
 
     getResponseOrFail<Response::Walk>(MessageType::RWalk)
             .then([&qids](Response::Walk&& response) {
-				ASSERT_EQ(qids.size(), response.nqids);
+				ASSERT_EQ(qids.size(), response.qids.size());
                 ASSERT_EQ(qids[2], response.qids[2]);
+
+				size_t i = 0;
+				for (auto qid : response.qids) {
+					EXPECT_EQ(qids[i++], qid);
+				}
+				EXPECT_EQ(qids.size(), i);
             });
 }
 
@@ -929,9 +1098,208 @@ TEST_F(P9Messages, parseWalkRespose) {
 
     getResponseOrFail<Response::Walk>(MessageType::RWalk)
             .then([](Response::Walk&& response) {
-				EXPECT_EQ(1, response.nqids);
+				EXPECT_EQ(1, response.qids.size());
                 EXPECT_EQ(87, response.qids[0].type);
                 EXPECT_EQ(5481, response.qids[0].version);
                 EXPECT_EQ(17, response.qids[0].path);
             });
 }
+
+
+TEST_F(P9Messages, parsePipelinedRequests) {
+	RequestWriter{_writer, 1}.clunk(17).build();
+	_writer.position(_writer.limit());
+	_writer.limit(_writer.capacity());
+
+	RequestWriter{_writer, 2}.read(31, 64, 4096).build();
+	_writer.position(_writer.limit());
+	_writer.limit(_writer.capacity());
+
+	RequestWriter{_writer, 3}.walk(1, 2).path("some").path("file").build();
+	_reader.limit(_writer.limit());
+
+	std::vector<MessageType> types;
+	auto result = proc.parseRequests(_reader, [&types](MessageHeader const& header, RequestMessage&& msg) {
+		types.push_back(header.type);
+		if (header.type == MessageType::TRead) {
+			ASSERT_TRUE(std::holds_alternative<Request::Read>(msg));
+			EXPECT_EQ(4096, std::get<Request::Read>(msg).count);
+		}
+	});
+
+	ASSERT_TRUE(result.isOk());
+	EXPECT_EQ(0, _reader.remaining());
+	ASSERT_EQ(3, types.size());
+	EXPECT_EQ(MessageType::TClunk, types[0]);
+	EXPECT_EQ(MessageType::TRead, types[1]);
+	EXPECT_EQ(MessageType::TWalk, types[2]);
+}
+
+
+TEST_F(P9Messages, parsePipelinedRequestsLeavesIncompleteFrame) {
+	RequestWriter{_writer, 1}.clunk(17).build();
+	auto const firstFrameSize = _writer.limit();
+	_writer.position(_writer.limit());
+	_writer.limit(_writer.capacity());
+
+	RequestWriter{_writer, 2}.read(31, 64, 4096).build();
+	_reader.limit(_writer.limit() - 3);
+
+	size_t count = 0;
+	auto result = proc.parseRequests(_reader, [&count](MessageHeader const&, RequestMessage&&) { ++count; });
+
+	ASSERT_TRUE(result.isOk());
+	EXPECT_EQ(1, count);
+	EXPECT_EQ(firstFrameSize, _reader.position());
+}
+
+
+TEST_F(P9Messages, parsePipelinedRequestsStopsAtBadFrame) {
+	RequestWriter{_writer, 1}.clunk(17).build();
+	auto const firstFrameSize = _writer.limit();
+	_writer.position(_writer.limit());
+	_writer.limit(_writer.capacity());
+
+	// A frame with an unsupported message type
+	writeHeader(_writer, headerSize(), MessageType::TError, 1);
+	_writer.flip();
+	_reader.limit(_writer.limit());
+
+	size_t count = 0;
+	auto result = proc.parseRequests(_reader, [&count](MessageHeader const&, RequestMessage&&) { ++count; });
+
+	ASSERT_TRUE(result.isError());
+	EXPECT_EQ(1, count);
+	EXPECT_EQ(firstFrameSize, _reader.position());
+}
+
+
+TEST_F(P9Messages, parsePipelinedResponses) {
+	ResponseWriter{_writer, 1}.clunk().build();
+	_writer.position(_writer.limit());
+	_writer.limit(_writer.capacity());
+
+	ResponseWriter{_writer, 2}.write(718).build();
+	_reader.limit(_writer.limit());
+
+	std::vector<Tag> tags;
+	auto result = proc.parseResponses(_reader, [&tags](MessageHeader const& header, ResponseMessage&& msg) {
+		tags.push_back(header.tag);
+		if (header.type == MessageType::RWrite) {
+			ASSERT_TRUE(std::holds_alternative<Response::Write>(msg));
+			EXPECT_EQ(718, std::get<Response::Write>(msg).count);
+		}
+	});
+
+	ASSERT_TRUE(result.isOk());
+	EXPECT_EQ(0, _reader.remaining());
+	ASSERT_EQ(2, tags.size());
+	EXPECT_EQ(1, tags[0]);
+	EXPECT_EQ(2, tags[1]);
+}
+
+
+TEST_F(P9Messages, parseRequestWithHandler) {
+	RequestWriter{_writer, 1}.read(31, 64, 4096).build();
+	_reader.limit(_writer.limit());
+
+	bool called = false;
+	auto handler = [&called](auto& msg) {
+		if constexpr (std::is_same_v<std::decay_t<decltype(msg)>, Request::Read>) {
+			called = true;
+			EXPECT_EQ(31, msg.fid);
+			EXPECT_EQ(64, msg.offset);
+			EXPECT_EQ(4096, msg.count);
+		} else {
+			FAIL() << "Unexpected message type";
+		}
+	};
+
+	auto header = proc.parseMessageHeader(_reader);
+	ASSERT_TRUE(header.isOk());
+	ASSERT_TRUE(proc.parseRequest(header.unwrap(), _reader, handler).isOk());
+	EXPECT_TRUE(called);
+}
+
+
+TEST_F(P9Messages, parseResponseWithHandler) {
+	ResponseWriter{_writer, 1}.write(718).build();
+	_reader.limit(_writer.limit());
+
+	bool called = false;
+	auto handler = [&called](auto& msg) {
+		if constexpr (std::is_same_v<std::decay_t<decltype(msg)>, Response::Write>) {
+			called = true;
+			EXPECT_EQ(718, msg.count);
+		} else {
+			FAIL() << "Unexpected message type";
+		}
+	};
+
+	auto header = proc.parseMessageHeader(_reader);
+	ASSERT_TRUE(header.isOk());
+	ASSERT_TRUE(proc.parseResponse(header.unwrap(), _reader, handler).isOk());
+	EXPECT_TRUE(called);
+}
+
+
+TEST_F(P9Messages, parseRequestWithHandlerChecksFrameSize) {
+	RequestWriter{_writer, 1}.read(31, 64, 4096).build();
+	_reader.limit(_writer.limit() - 1);
+
+	size_t count = 0;
+	auto header = proc.parseMessageHeader(_reader);
+	ASSERT_TRUE(header.isOk());
+	ASSERT_TRUE(proc.parseRequest(header.unwrap(), _reader, [&count](auto&) { ++count; }).isError());
+	EXPECT_EQ(0, count);
+}
+
+
+TEST_F(P9Messages, createReadResposeWithDataOutOfLine) {
+	char const content[] = "Good news everyone!";
+	auto data = wrapMemory(content);
+	auto segments = ResponseWriter{_writer, 1}
+			.read()
+			.build(data);
+
+	ASSERT_EQ(data, segments.payload);
+	ASSERT_EQ(headerSize() + sizeof(size_type), segments.header.size());
+	ASSERT_EQ(headerSize() + sizeof(size_type) + data.size(), segments.size());
+
+	// Gather the segments as writev would
+	_writer.clear();
+	_writer.write(segments.header);
+	_writer.write(segments.payload);
+	_writer.flip();
+
+	getResponseOrFail<Response::Read>(MessageType::RRead)
+			.then([data](Response::Read&& response) {
+				ASSERT_EQ(data, response.data);
+			});
+}
+
+
+TEST_F(P9Messages, createWriteRequestWithDataOutOfLine) {
+	char const messageData[] = "This is a very important data d-_^b";
+	auto data = wrapMemory(messageData);
+
+	auto segments = RequestWriter{_writer}
+			.write(15927, 98)
+			.build(data);
+
+	ASSERT_EQ(data, segments.payload);
+
+	// Gather the segments as writev would
+	_writer.clear();
+	_writer.write(segments.header);
+	_writer.write(segments.payload);
+	_writer.flip();
+
+	getRequestOrFail<Request::Write>(MessageType::TWrite)
+			.then([data](Request::Write&& request) {
+				ASSERT_EQ(15927, request.fid);
+				ASSERT_EQ(98, request.offset);
+				ASSERT_EQ(data, request.data);
+			});
+}
+
@@ -278,3 +278,142 @@ TEST_F(P9E_Messages, parseShortWriteRespose) {
                 EXPECT_EQ(81177, response.count);
             });
 }
+
+
+TEST_F(P9E_Messages, createShortBatchRequest) {
+	char const messageData[] = "This is a very important data d-_^b";
+    auto data = wrapMemory(messageData);
+
+	RequestWriter{_writer}
+			.shortBatch(32)
+				.read().path("etc").path("hosts")
+				.write(data).path("var").path("lib").path("state")
+				.read()
+			.done()
+			.build();
+
+    getRequestOrFail<Request_9P2000E::SBatch>(MessageType::TSBatch)
+		.then([data](Request_9P2000E::SBatch&& request) {
+            ASSERT_EQ(32, request.fid);
+			ASSERT_EQ(3, request.entries.size());
+
+			auto it = request.entries.begin();
+			EXPECT_EQ(ShortBatchOp::Read, it->op);
+			EXPECT_EQ(2, it->path.size());
+			EXPECT_EQ("etc", *it->path.begin());
+			EXPECT_TRUE(it->data.empty());
+
+			++it;
+			EXPECT_EQ(ShortBatchOp::Write, it->op);
+			EXPECT_EQ(3, it->path.size());
+			EXPECT_EQ("var", *it->path.begin());
+			EXPECT_EQ(data, it->data);
+
+			++it;
+			EXPECT_EQ(ShortBatchOp::Read, it->op);
+			EXPECT_TRUE(it->path.empty());
+
+			++it;
+			EXPECT_TRUE(it == request.entries.end());
+		});
+}
+
+
+TEST_F(P9E_Messages, createEmptyShortBatchRequest) {
+	RequestWriter{_writer}
+			.shortBatch(7)
+			.done()
+			.build();
+
+    getRequestOrFail<Request_9P2000E::SBatch>(MessageType::TSBatch)
+		.then([](Request_9P2000E::SBatch&& request) {
+            EXPECT_EQ(7, request.fid);
+			EXPECT_TRUE(request.entries.empty());
+			EXPECT_TRUE(request.entries.begin() == request.entries.end());
+		});
+}
+
+
+TEST_F(P9E_Messages, parseShortBatchRequest_UnsupportedOperation) {
+	styxe::Encoder encoder{_writer};
+	encoder << makeHeaderWithPayload(MessageType::TSBatch, 1, sizeof(Fid) + sizeof(uint16) + sizeof(byte))
+			<< static_cast<Fid>(32)
+			<< static_cast<uint16>(1)
+			<< static_cast<byte>(17);
+    _writer.flip();
+    _reader.limit(_writer.limit());
+
+    auto header = proc.parseMessageHeader(_reader);
+    ASSERT_TRUE(header.isOk());
+
+    auto message = proc.parseRequest(header.unwrap(), _reader);
+    ASSERT_TRUE(message.isError());
+    EXPECT_EQ(getCannedError(CannedError::UnsupportedBatchOperation), message.getError());
+}
+
+
+TEST_F(P9E_Messages, parseShortBatchRequest_NotEnoughEntries) {
+	styxe::Encoder encoder{_writer};
+	encoder << makeHeaderWithPayload(MessageType::TSBatch, 1,
+									 sizeof(Fid) + sizeof(uint16) + sizeof(byte) + sizeof(uint16))
+			<< static_cast<Fid>(32)
+			<< static_cast<uint16>(2)  // Declared 2 entries but only one is encoded
+			<< static_cast<byte>(ShortBatchOp::Read)
+			<< static_cast<uint16>(0);
+    _writer.flip();
+    _reader.limit(_writer.limit());
+
+    auto header = proc.parseMessageHeader(_reader);
+    ASSERT_TRUE(header.isOk());
+
+    auto message = proc.parseRequest(header.unwrap(), _reader);
+    ASSERT_TRUE(message.isError());
+    EXPECT_EQ(getCannedError(CannedError::NotEnoughData), message.getError());
+}
+
+
+TEST_F(P9E_Messages, createShortBatchRespose) {
+	char const messageData[] = "This was somewhat important data d^_-b";
+    auto data = wrapMemory(messageData);
+
+	auto writer = ResponseWriter{_writer, 1}.shortBatch();
+	writer.data(data)
+			.written(100500)
+			.error("No such file");
+	EXPECT_EQ(3, writer.entriesCount());
+	writer.build();
+
+    getResponseOrFail<Response_9P2000E::SBatch>(MessageType::RSBatch)
+            .then([data](Response_9P2000E::SBatch&& response) {
+				ASSERT_EQ(3, response.results.size());
+
+				auto it = response.results.begin();
+				EXPECT_EQ(ShortBatchStatus::Data, it->status);
+				EXPECT_EQ(data, it->data);
+
+				++it;
+				EXPECT_EQ(ShortBatchStatus::Written, it->status);
+				EXPECT_EQ(100500, it->count);
+
+				++it;
+				EXPECT_EQ(ShortBatchStatus::Failed, it->status);
+				EXPECT_EQ("No such file", it->ename);
+            });
+}
+
+
+TEST_F(P9E_Messages, parseShortBatchRespose_NotEnoughData) {
+	styxe::Encoder encoder{_writer};
+	encoder << makeHeaderWithPayload(MessageType::RSBatch, 1, sizeof(uint16) + sizeof(byte) + sizeof(uint16))
+			<< static_cast<uint16>(1)
+			<< static_cast<byte>(ShortBatchStatus::Written)
+			<< static_cast<uint16>(1);  // Count field is truncated
+    _writer.flip();
+    _reader.limit(_writer.limit());
+
+    auto header = proc.parseMessageHeader(_reader);
+    ASSERT_TRUE(header.isOk());
+
+    auto message = proc.parseResponse(header.unwrap(), _reader);
+    ASSERT_TRUE(message.isError());
+}
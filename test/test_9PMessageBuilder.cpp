@@ -19,6 +19,7 @@
  *
  *******************************************************************************/
 #include "styxe/responseWriter.hpp"  // Class being tested
+#include "styxe/encoder.hpp"
 
 #include <solace/exception.hpp>
 
@@ -98,3 +99,111 @@ TEST_F(P9MessageBuilder, dirListingMessage) {
 
     ASSERT_EQ(writer.bytesEncoded(), read.data.size());
 }
+
+
+TEST_F(P9MessageBuilder, dirListingResumesFromCursor) {
+	Stat testStats[40];
+	for (size_t i = 0; i < 40; ++i) {
+		testStats[i] = Stat{0, 1, 2, {0, 0, i}, 0644, 0, 0, 4096,
+				StringLiteral{"file"}, StringLiteral{"User"}, StringLiteral{"Glanda"}, StringLiteral{"User"}};
+		testStats[i].size = DirListingWriter::sizeStat(testStats[i]);
+	}
+
+	byte expectedBuffer[256];
+	byte resumedBuffer[256];
+	uint32 const count = sizeof(expectedBuffer);
+
+	DirListingCursor cursor;
+	uint64 offset = 0;
+	uint64 entriesSeen = 0;
+	while (true) {
+		// Listing from the very start is the reference
+		ByteWriter expectedWriter{wrapMemory(expectedBuffer)};
+		DirListingWriter expected{expectedWriter, count, offset};
+		for (auto const& stat : testStats) {
+			if (!expected.encode(stat))
+				break;
+		}
+
+		ByteWriter resumedWriter{wrapMemory(resumedBuffer)};
+		DirListingWriter resumed{resumedWriter, count, offset, cursor};
+		ASSERT_EQ(entriesSeen, resumed.firstEntryIndex());
+		for (auto i = resumed.firstEntryIndex(); i < 40; ++i) {
+			if (!resumed.encode(testStats[i]))
+				break;
+		}
+
+		ASSERT_EQ(expected.bytesEncoded(), resumed.bytesEncoded());
+		ASSERT_EQ(expectedWriter.viewWritten(), resumedWriter.viewWritten());
+		if (resumed.bytesEncoded() == 0)
+			break;
+
+		cursor = resumed.cursor();
+		offset += resumed.bytesEncoded();
+		entriesSeen = cursor.index;
+		ASSERT_EQ(offset, cursor.offset);
+	}
+
+	EXPECT_EQ(40u, entriesSeen);
+}
+
+
+TEST_F(P9MessageBuilder, dirListingCursorMismatchRestarts) {
+	DirListingCursor cursor{128, 2};
+	DirListingWriter writer{_buffer, 4096, 0, cursor};
+
+	EXPECT_EQ(0u, writer.firstEntryIndex());
+	EXPECT_EQ(0u, writer.cursor().offset);
+	EXPECT_EQ(0u, writer.cursor().index);
+}
+
+
+TEST_F(P9MessageBuilder, uncheckedEncodingMatchesEncoder) {
+	Stat stat{0, 1, 2, {2, 0, 64}, 01000644, 0, 0, 4096,
+			StringLiteral{"Root"}, StringLiteral{"User"}, StringLiteral{"Glanda"}, StringLiteral{"User"}};
+	stat.size = DirListingWriter::sizeStat(stat);
+	Qid qids[] = {{1, 2, 3}, {4, 5, 6}};
+	char const bytes[] = "data";
+	auto const header = makeHeaderWithPayload(MessageType::RStat, 1, 0);
+
+	byte expectedBuffer[256];
+	ByteWriter expected{wrapMemory(expectedBuffer)};
+	Encoder encoder{expected};
+	encoder << header << stat << arrayView(qids) << wrapMemory(bytes) << StringView{"tail"};
+
+	byte buffer[256];
+	UncheckedEncoder unchecked{wrapMemory(buffer)};
+	unchecked << header << stat << arrayView(qids) << wrapMemory(bytes) << StringView{"tail"};
+
+	ASSERT_EQ(expected.position(), unchecked.size());
+	EXPECT_EQ(expected.viewWritten(), wrapMemory(buffer).slice(0, unchecked.size()));
+}
+
+
+TEST_F(P9MessageBuilder, knownSizeMessageIsNotPatched) {
+	char const content[] = "Good news everyone!";
+	ResponseWriter{_buffer, 3}
+			.read(wrapMemory(content))
+			.build();
+
+	ByteReader reader{_buffer.viewRemaining()};
+	Parser parser;
+	auto header = parser.parseMessageHeader(reader);
+	ASSERT_TRUE(header.isOk());
+	EXPECT_EQ(_buffer.limit(), header.unwrap().messageSize);
+
+	auto message = parser.parseResponse(header.unwrap(), reader);
+	ASSERT_TRUE(message.isOk());
+	ASSERT_TRUE(std::holds_alternative<Response::Read>(message.unwrap()));
+	EXPECT_EQ(wrapMemory(content), std::get<Response::Read>(message.unwrap()).data);
+}
+
+
+TEST_F(P9MessageBuilder, messageLargerThanBufferDoesNotOverflow) {
+	byte buffer[16];
+	ByteWriter writer{wrapMemory(buffer)};
+
+	ResponseWriter{writer, 1}.error("An error message that does not fit");
+
+	EXPECT_LE(writer.position(), sizeof(buffer));
+}
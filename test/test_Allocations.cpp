@@ -0,0 +1,441 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_Allocations.cpp
+ *
+ * Global allocator of the test binary is replaced to count allocations made by each thread,
+ * checking that hot path APIs never allocate on the success path:
+ *
+ *  - Parser: construction with a version string, version negotiation (setNegotiatedVersion,
+ *    maxNegotiatedMessageSize, getNegotiatedVersion), parseMessageHeader, parseRequest and parseResponse both into
+ *    a variant and with a handler, parseRequests / parseResponses, parseCompressedRequest / parseCompressedResponse.
+ *    Parse errors, reported with canned errors, are checked as well.
+ *  - RequestWriter: every message, including the walk path, data and batch writers, with and without compression.
+ *  - ResponseWriter: every message, including error(StringView), error(EncodedError), error(CannedError)
+ *    and error(Error const&) of protocol errors.
+ *  - TypedWriter::build, TypedWriter::complete and TypedWriter::build(payload), MessageBatch, FrameAssembler::feed
+ *    and DirListingWriter.
+ *
+ * ResponseWriter::error(Error const&) of errors other than protocol errors formats the message and does allocate:
+ * ErrorTable gives an allocation free alternative.
+ *******************************************************************************/
+#include "styxe/styxe.hpp"
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace {
+
+/// Number of allocations made by the thread.
+thread_local uint64 tAllocations = 0;
+
+void* countedAllocation(std::size_t size) noexcept {
+	tAllocations += 1;
+	return std::malloc(size ? size : 1);
+}
+
+}  // namespace
+
+
+void* operator new(std::size_t size) {
+	if (auto ptr = countedAllocation(size)) {
+		return ptr;
+	}
+
+	throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept {
+	return countedAllocation(size);
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept {
+	return countedAllocation(size);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::nothrow_t const&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::nothrow_t const&) noexcept { std::free(ptr); }
+
+
+namespace {
+
+/// Count allocations made by the calling thread since construction.
+struct AllocationCount {
+	uint64 allocations() const noexcept { return tAllocations - _started; }
+
+private:
+	uint64 const	_started{tAllocations};
+};
+
+
+Qid const kQid{0, 12, 81723};
+byte const kData[] = {1, 2, 3, 4, 5, 6, 7, 8};
+constexpr char kText[] =
+		"All resources are files, all files are served over 9P. "
+		"All resources are files, all files are served over 9P. "
+		"All resources are files, all files are served over 9P. "
+		"All resources are files, all files are served over 9P.";
+
+MemoryView textData() noexcept {
+	return wrapMemory(kText, sizeof(kText) - 1);
+}
+
+Stat testStat() noexcept {
+	Stat stat{0, 1, 2, kQid, 0644, 1553, 1554, 4096,
+			StringLiteral{"file.txt"}, StringLiteral{"user"}, StringLiteral{"group"}, StringLiteral{"user"}};
+	stat.size = DirListingWriter::sizeStat(stat);
+	return stat;
+}
+
+
+/// Message encoded by a writer under test.
+struct Message {
+	char const*		name;
+	void			(*encode)(ByteWriter& dest);
+};
+
+Message const kRequests[] = {
+	{"TVersion", [](ByteWriter& w) { RequestWriter{w}.version(Parser::BATCH_PROTOCOL_VERSION, 8192).build(); }},
+	{"TAuth", [](ByteWriter& w) { RequestWriter{w}.auth(1, StringLiteral{"user"}, StringLiteral{"tree"}).build(); }},
+	{"TFlush", [](ByteWriter& w) { RequestWriter{w}.flush(7).build(); }},
+	{"TAttach", [](ByteWriter& w) {
+		RequestWriter{w}.attach(1, Parser::NOFID, StringLiteral{"user"}, StringLiteral{"tree"}).build();
+	}},
+	{"TWalk", [](ByteWriter& w) { RequestWriter{w}.walk(1, 2).path("var").path("log").done().build(); }},
+	{"TOpen", [](ByteWriter& w) { RequestWriter{w}.open(2, OpenMode::READ).build(); }},
+	{"TCreate", [](ByteWriter& w) { RequestWriter{w}.create(2, StringLiteral{"file"}, 0644, OpenMode::RDWR).build(); }},
+	{"TRead", [](ByteWriter& w) { RequestWriter{w}.read(2, 4096, 512).build(); }},
+	{"TWrite", [](ByteWriter& w) { RequestWriter{w}.write(2, 4096).data(wrapMemory(kData)).build(); }},
+	{"TClunk", [](ByteWriter& w) { RequestWriter{w}.clunk(2).build(); }},
+	{"TRemove", [](ByteWriter& w) { RequestWriter{w}.remove(2).build(); }},
+	{"TStat", [](ByteWriter& w) { RequestWriter{w}.stat(2).build(); }},
+	{"TWStat", [](ByteWriter& w) { RequestWriter{w}.writeStat(2, testStat()).build(); }},
+	{"TSession", [](ByteWriter& w) {
+		byte key[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+		RequestWriter{w}.session(wrapMemory(key)).build();
+	}},
+	{"TSRead", [](ByteWriter& w) { RequestWriter{w}.shortRead(1).path("etc").path("hosts").done().build(); }},
+	{"TSWrite", [](ByteWriter& w) { RequestWriter{w}.shortWrite(1).path("var").path("state").data(wrapMemory(kData)).build(); }},
+	{"TSBatch", [](ByteWriter& w) {
+		RequestWriter{w}.shortBatch(1)
+				.read().path("etc").path("hosts")
+				.write(wrapMemory(kData)).path("var").path("state")
+				.done()
+				.build();
+	}},
+};
+
+Message const kResponses[] = {
+	{"RVersion", [](ByteWriter& w) { ResponseWriter{w, 1}.version(Parser::BATCH_PROTOCOL_VERSION, 8192).build(); }},
+	{"RAuth", [](ByteWriter& w) { ResponseWriter{w, 1}.auth(kQid).build(); }},
+	{"RError", [](ByteWriter& w) { ResponseWriter{w, 1}.error(StringLiteral{"No such file or directory"}).build(); }},
+	{"RError(CannedError)", [](ByteWriter& w) { ResponseWriter{w, 1}.error(CannedError::NotEnoughData).build(); }},
+	{"RError(Error)", [](ByteWriter& w) {
+		ResponseWriter{w, 1}.error(getCannedError(CannedError::UnsupportedMessageType)).build();
+	}},
+	{"RError(EncodedError)", [](ByteWriter& w) {
+		ResponseWriter{w, 1}.error(getEncodedCannedError(CannedError::WalkPathTooLong)).build();
+	}},
+	{"RFlush", [](ByteWriter& w) { ResponseWriter{w, 1}.flush().build(); }},
+	{"RAttach", [](ByteWriter& w) { ResponseWriter{w, 1}.attach(kQid).build(); }},
+	{"RWalk", [](ByteWriter& w) {
+		Qid qids[] = {kQid, kQid};
+		ResponseWriter{w, 1}.walk(arrayView(qids, 2)).build();
+	}},
+	{"ROpen", [](ByteWriter& w) { ResponseWriter{w, 1}.open(kQid, 8192).build(); }},
+	{"RCreate", [](ByteWriter& w) { ResponseWriter{w, 1}.create(kQid, 8192).build(); }},
+	{"RRead", [](ByteWriter& w) { ResponseWriter{w, 1}.read(wrapMemory(kData)).build(); }},
+	{"RWrite", [](ByteWriter& w) { ResponseWriter{w, 1}.write(512).build(); }},
+	{"RClunk", [](ByteWriter& w) { ResponseWriter{w, 1}.clunk().build(); }},
+	{"RRemove", [](ByteWriter& w) { ResponseWriter{w, 1}.remove().build(); }},
+	{"RStat", [](ByteWriter& w) { ResponseWriter{w, 1}.stat(testStat()).build(); }},
+	{"RWStat", [](ByteWriter& w) { ResponseWriter{w, 1}.wstat().build(); }},
+	{"RSession", [](ByteWriter& w) { ResponseWriter{w, 1}.session().build(); }},
+	{"RSRead", [](ByteWriter& w) { ResponseWriter{w, 1}.shortRead(wrapMemory(kData)).build(); }},
+	{"RSWrite", [](ByteWriter& w) { ResponseWriter{w, 1}.shortWrite(512).build(); }},
+	{"RSBatch", [](ByteWriter& w) {
+		ResponseWriter{w, 1}.shortBatch()
+				.data(wrapMemory(kData))
+				.written(8)
+				.error(StringLiteral{"Permission denied"})
+				.done()
+				.build();
+	}},
+};
+
+/// Messages with a compressed data payload, as written by sessions that negotiated LZ4 compression.
+Message const kCompressedRequests[] = {
+	{"TWrite+lz4", [](ByteWriter& w) {
+		RequestWriter{w, 1, CompressionPolicy{PayloadCompression::LZ4, 16}}.write(2, 0).data(textData()).build();
+	}},
+	{"TSWrite+lz4", [](ByteWriter& w) {
+		RequestWriter{w, 1, CompressionPolicy{PayloadCompression::LZ4, 16}}.shortWrite(1).path("log").data(textData()).build();
+	}},
+};
+
+Message const kCompressedResponses[] = {
+	{"RRead+lz4", [](ByteWriter& w) {
+		ResponseWriter{w, 1, CompressionPolicy{PayloadCompression::LZ4, 16}}.read(textData()).build();
+	}},
+	{"RSRead+lz4", [](ByteWriter& w) {
+		ResponseWriter{w, 1, CompressionPolicy{PayloadCompression::LZ4, 16}}.shortRead(textData()).build();
+	}},
+};
+
+}  // namespace
+
+
+class ZeroAllocations : public ::testing::Test {
+protected:
+
+	void SetUp() override {
+		_writer.clear();
+	}
+
+	/// Encode a message outside of the allocation counting.
+	MemoryView encode(Message const& message) {
+		_writer.clear();
+		message.encode(_writer);
+		return _writer.viewRemaining();
+	}
+
+protected:
+	Parser			_parser{kMaxMesssageSize, Parser::BATCH_PROTOCOL_VERSION};
+	byte			_buffer[1024];
+	byte			_decompressBuffer[1024];
+	ByteWriter		_writer{wrapMemory(_buffer)};
+};
+
+
+TEST_F(ZeroAllocations, allocationsAreCounted) {
+	AllocationCount count;
+	auto value = std::make_unique<int>(42);
+	EXPECT_EQ(1u, count.allocations());
+}
+
+
+TEST_F(ZeroAllocations, versionNegotiation) {
+	AllocationCount count;
+	Parser parser{8192, Parser::BATCH_PROTOCOL_VERSION};
+	parser.setNegotiatedVersion(StringLiteral{"9P2000.e+lz4"});
+	parser.maxNegotiatedMessageSize(4096);
+	auto const version = parser.getNegotiatedVersion();
+	auto const allocations = count.allocations();
+
+	EXPECT_EQ(0u, allocations);
+	EXPECT_EQ(StringLiteral{"9P2000.e+lz4"}, version);
+}
+
+
+TEST_F(ZeroAllocations, requestWriters) {
+	for (auto const& message : kRequests) {
+		_writer.clear();
+		AllocationCount count;
+		message.encode(_writer);
+		EXPECT_EQ(0u, count.allocations()) << message.name;
+	}
+}
+
+
+TEST_F(ZeroAllocations, compressingWriters) {
+	for (auto const& messages : {arrayView(kCompressedRequests), arrayView(kCompressedResponses)}) {
+		for (auto const& message : messages) {
+			_writer.clear();
+			AllocationCount count;
+			message.encode(_writer);
+			EXPECT_EQ(0u, count.allocations()) << message.name;
+		}
+	}
+}
+
+
+TEST_F(ZeroAllocations, responseWriters) {
+	for (auto const& message : kResponses) {
+		_writer.clear();
+		AllocationCount count;
+		message.encode(_writer);
+		EXPECT_EQ(0u, count.allocations()) << message.name;
+	}
+}
+
+
+TEST_F(ZeroAllocations, outOfLinePayloadWriters) {
+	AllocationCount count;
+	auto const response = ResponseWriter{_writer, 1}.read().build(textData());
+	_writer.clear();
+	auto const request = RequestWriter{_writer, 1}.shortWrite(1).path("var").path("state").build(textData());
+	auto const allocations = count.allocations();
+
+	EXPECT_EQ(0u, allocations);
+	EXPECT_EQ(textData(), response.payload);
+	EXPECT_EQ(textData(), request.payload);
+}
+
+
+TEST_F(ZeroAllocations, parseRequests) {
+	for (auto const& message : kRequests) {
+		auto const frame = encode(message);
+
+		AllocationCount count;
+		ByteReader reader{frame};
+		auto header = _parser.parseMessageHeader(reader);
+		bool parsed = header && _parser.parseRequest(*header, reader).isOk();
+
+		ByteReader visitReader{frame};
+		auto visitHeader = _parser.parseMessageHeader(visitReader);
+		parsed = parsed && visitHeader && _parser.parseRequest(*visitHeader, visitReader, [](auto const&) {}).isOk();
+		auto const allocations = count.allocations();
+
+		EXPECT_TRUE(parsed) << message.name;
+		EXPECT_EQ(0u, allocations) << message.name;
+	}
+}
+
+
+TEST_F(ZeroAllocations, parseResponses) {
+	for (auto const& message : kResponses) {
+		auto const frame = encode(message);
+
+		AllocationCount count;
+		ByteReader reader{frame};
+		auto header = _parser.parseMessageHeader(reader);
+		bool parsed = header && _parser.parseResponse(*header, reader).isOk();
+
+		ByteReader visitReader{frame};
+		auto visitHeader = _parser.parseMessageHeader(visitReader);
+		parsed = parsed && visitHeader && _parser.parseResponse(*visitHeader, visitReader, [](auto const&) {}).isOk();
+		auto const allocations = count.allocations();
+
+		EXPECT_TRUE(parsed) << message.name;
+		EXPECT_EQ(0u, allocations) << message.name;
+	}
+}
+
+
+TEST_F(ZeroAllocations, parseCompressedMessages) {
+	Parser parser{kMaxMesssageSize, "9P2000.eb+lz4"};
+	auto const decompressBuffer = wrapMemory(_decompressBuffer);
+
+	for (auto const& message : kCompressedRequests) {
+		auto const frame = encode(message);
+
+		AllocationCount count;
+		ByteReader reader{frame};
+		auto header = parser.parseMessageHeader(reader);
+		bool const parsed = header && parser.parseCompressedRequest(*header, reader, decompressBuffer).isOk();
+		auto const allocations = count.allocations();
+
+		EXPECT_TRUE(parsed) << message.name;
+		EXPECT_EQ(0u, allocations) << message.name;
+	}
+
+	for (auto const& message : kCompressedResponses) {
+		auto const frame = encode(message);
+
+		AllocationCount count;
+		ByteReader reader{frame};
+		auto header = parser.parseMessageHeader(reader);
+		bool const parsed = header && parser.parseCompressedResponse(*header, reader, decompressBuffer).isOk();
+		auto const allocations = count.allocations();
+
+		EXPECT_TRUE(parsed) << message.name;
+		EXPECT_EQ(0u, allocations) << message.name;
+	}
+}
+
+
+TEST_F(ZeroAllocations, parseErrors) {
+	byte const truncated[] = {42, 0, 0, 0, static_cast<byte>(MessageType::TClunk), 1, 0, 2, 0};
+
+	AllocationCount count;
+	ByteReader reader{wrapMemory(truncated)};
+	auto header = _parser.parseMessageHeader(reader);
+	bool const headerOk = header.isOk();
+	bool const rejected = headerOk && _parser.parseRequest(*header, reader).isError();
+
+	ByteReader shortReader{wrapMemory(truncated, 3)};
+	bool const shortRejected = _parser.parseMessageHeader(shortReader).isError();
+	auto const allocations = count.allocations();
+
+	EXPECT_TRUE(headerOk);
+	EXPECT_TRUE(rejected);
+	EXPECT_TRUE(shortRejected);
+	EXPECT_EQ(0u, allocations);
+}
+
+
+TEST_F(ZeroAllocations, batchesAndStreams) {
+	byte stagingBuffer[256];
+	FrameAssembler assembler{_parser, wrapMemory(stagingBuffer)};
+	uint32 received = 0;
+
+	AllocationCount count;
+	MessageBatch batch{_writer, _parser.maxNegotiatedMessageSize()};
+	for (Tag tag = 0; tag < 8; ++tag) {
+		batch.add(batch.request(tag).read(2, tag * 512u, 512));
+	}
+	auto const frames = batch.seal().viewRemaining();
+
+	ByteReader pipelined{frames};
+	bool parsed = _parser.parseRequests(pipelined, [&received](MessageHeader const&, RequestMessage&&) {
+		received += 1;
+	}).isOk();
+
+	// Frames are fed in chunks that split them, so that the assembler has to stage partial frames.
+	for (MemoryView::size_type offset = 0; offset < frames.size(); offset += 5) {
+		parsed = parsed && assembler.feed(frames.slice(offset, offset + 5), [&](MessageHeader const& header, ByteReader& payload) {
+			received += _parser.parseRequest(header, payload).isOk() ? 1 : 0;
+		}).isOk();
+	}
+	auto const allocations = count.allocations();
+
+	EXPECT_TRUE(parsed);
+	EXPECT_EQ(16u, received);
+	EXPECT_EQ(0u, allocations);
+}
+
+
+TEST_F(ZeroAllocations, directoryListing) {
+	auto const stat = testStat();
+
+	AllocationCount count;
+	auto response = ResponseWriter{_writer, 1}.read();
+	DirListingWriter listing{response.buffer(), 512, 0};
+	bool const encoded = listing.encode(stat) && listing.encode(stat);
+	response.build();
+	auto const allocations = count.allocations();
+
+	EXPECT_TRUE(encoded);
+	EXPECT_EQ(0u, allocations);
+}
@@ -0,0 +1,378 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_ChunkedIo.cpp
+ *
+ *******************************************************************************/
+#include "styxe/chunkedIo.hpp"  // Class being tested
+#include "styxe/frameAssembler.hpp"
+#include "styxe/requestWriter.hpp"
+#include "styxe/responseWriter.hpp"
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace {
+
+std::vector<Request::Read>
+parseReads(Parser const& parser, ByteWriter& writer, std::vector<Tag>& tags) {
+	std::vector<Request::Read> reads;
+	ByteReader reader{writer.viewRemaining()};
+	auto result = parser.parseRequests(reader, [&](MessageHeader const& header, RequestMessage&& message) {
+		tags.push_back(header.tag);
+		reads.push_back(std::get<Request::Read>(message));
+	});
+	EXPECT_TRUE(result.isOk());
+
+	return reads;
+}
+
+}  // namespace
+
+
+TEST(ChunkedIo, chunkSize) {
+	EXPECT_EQ(8*1024u - kIoHeaderSize, ioChunkSize(8*1024));
+	EXPECT_EQ(kLargeMessageSize - kIoHeaderSize, ioChunkSize(kLargeMessageSize));
+	EXPECT_EQ(4096u, ioChunkSize(kLargeMessageSize, 4096));
+	EXPECT_EQ(100u - kIoHeaderSize, ioChunkSize(100, 4096));
+	EXPECT_EQ(0u, ioChunkSize(kIoHeaderSize));
+}
+
+
+TEST(ChunkedIo, emptyOperationIsDone) {
+	byte buffer[16];
+	ChunkedRead read{1, 0, wrapMemory(buffer).slice(0, 0), 1024, 1};
+	EXPECT_EQ(0u, read.chunkCount());
+	EXPECT_TRUE(read.done());
+
+	ChunkedRead noChunks{1, 0, wrapMemory(buffer), 0, 1};
+	EXPECT_EQ(0u, noChunks.chunkCount());
+	EXPECT_TRUE(noChunks.done());
+}
+
+
+TEST(ChunkedIo, lengthIsCappedByTagSpace) {
+	byte buffer[64];
+	ChunkedRead read{1, 0, wrapMemory(buffer), 1, static_cast<Tag>(Parser::NO_TAG - 10)};
+
+	EXPECT_EQ(10u, read.chunkCount());
+	EXPECT_EQ(10u, read.length());
+	EXPECT_EQ(static_cast<Tag>(Parser::NO_TAG - 1), read.tagOf(read.chunkCount() - 1));
+}
+
+
+TEST(ChunkedIo, largeMessageSizeNegotiation) {
+	Parser parser{kLargeMessageSize * 4};
+	EXPECT_EQ(kLargeMessageSize, parser.maxNegotiatedMessageSize(kLargeMessageSize));
+
+	Parser unlimited{std::numeric_limits<size_type>::max()};
+	EXPECT_EQ(std::numeric_limits<size_type>::max(),
+			  unlimited.maxNegotiatedMessageSize(std::numeric_limits<size_type>::max()));
+
+	std::vector<byte> buffer(128);
+	ByteWriter writer{wrapMemory(buffer.data(), buffer.size())};
+	ResponseWriter{writer, 1}.version(Parser::PROTOCOL_VERSION, kLargeMessageSize).build();
+
+	ByteReader reader{writer.viewRemaining()};
+	auto header = parser.parseMessageHeader(reader);
+	ASSERT_TRUE(header.isOk());
+
+	auto response = parser.parseResponse(header.unwrap(), reader);
+	ASSERT_TRUE(response.isOk());
+	EXPECT_EQ(kLargeMessageSize, std::get<Response::Version>(response.unwrap()).msize);
+}
+
+
+TEST(ChunkedIo, largeFramesRoundTrip) {
+	Parser parser{kLargeMessageSize};
+	auto const chunk = ioChunkSize(parser.maxNegotiatedMessageSize());
+
+	std::vector<byte> data(chunk);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<byte>(i * 7);
+	}
+
+	std::vector<byte> buffer(kLargeMessageSize);
+	ByteWriter writer{wrapMemory(buffer.data(), buffer.size())};
+	ResponseWriter{writer, 3}.read(wrapMemory(data.data(), data.size())).build();
+	EXPECT_GE(kLargeMessageSize, writer.remaining());
+
+	// Feed the frame through the assembler in socket sized pieces
+	std::vector<byte> staging(parser.maxPossibleMessageSize());
+	FrameAssembler assembler{parser, wrapMemory(staging.data(), staging.size())};
+
+	auto const frame = writer.viewRemaining();
+	uint32 frames = 0;
+	for (MemoryView::size_type from = 0; from < frame.size(); from += 64*1024) {
+		auto result = assembler.feed(frame.slice(from, from + 64*1024), [&](MessageHeader const& header, ByteReader& payload) {
+			auto response = parser.parseResponse(header, payload);
+			ASSERT_TRUE(response.isOk());
+			EXPECT_EQ(wrapMemory(data.data(), data.size()), std::get<Response::Read>(response.unwrap()).data);
+			frames += 1;
+		});
+		ASSERT_TRUE(result.isOk());
+	}
+
+	EXPECT_EQ(1u, frames);
+}
+
+
+TEST(ChunkedIo, chunkedReadRequests) {
+	Parser parser{kLargeMessageSize};
+	auto const chunk = ioChunkSize(parser.maxNegotiatedMessageSize());
+
+	std::vector<byte> dest(3 * chunk + 100);
+	ChunkedRead read{17, 4096, wrapMemory(dest.data(), dest.size()), chunk, 10};
+	ASSERT_EQ(4u, read.chunkCount());
+
+	byte buffer[512];
+	ByteWriter writer{wrapMemory(buffer)};
+	MessageBatch batch{writer, parser.maxNegotiatedMessageSize()};
+	EXPECT_EQ(4u, read.writeRequests(batch));
+	EXPECT_TRUE(read.allSent());
+	EXPECT_FALSE(read.done());
+	EXPECT_EQ(4u, read.inFlight());
+
+	batch.seal();
+	std::vector<Tag> tags;
+	auto const reads = parseReads(parser, writer, tags);
+	ASSERT_EQ(4u, reads.size());
+	for (uint32 i = 0; i < reads.size(); ++i) {
+		EXPECT_EQ(10 + i, tags[i]);
+		EXPECT_EQ(17u, reads[i].fid);
+		EXPECT_EQ(4096 + static_cast<uint64>(i) * chunk, reads[i].offset);
+		EXPECT_EQ((i < 3) ? chunk : 100u, reads[i].count);
+	}
+}
+
+
+TEST(ChunkedIo, chunkedReadWithinBudget) {
+	byte dest[1000];
+	ChunkedRead read{1, 0, wrapMemory(dest), 100, 1};
+	auto const requestSize = headerSize() + sizeof(Fid) + sizeof(uint64) + sizeof(uint32);
+
+	byte buffer[512];
+	ByteWriter writer{wrapMemory(buffer)};
+	{
+		MessageBatch batch{writer, kMaxMesssageSize, 3 * requestSize};
+		EXPECT_EQ(3u, read.writeRequests(batch));
+		EXPECT_FALSE(read.allSent());
+	}
+
+	writer.clear();
+	MessageBatch batch{writer, kMaxMesssageSize};
+	EXPECT_EQ(7u, read.writeRequests(batch));
+	EXPECT_TRUE(read.allSent());
+
+	batch.seal();
+	std::vector<Tag> tags;
+	auto const reads = parseReads(Parser{}, writer, tags);
+	ASSERT_EQ(7u, reads.size());
+	EXPECT_EQ(4u, tags.front());
+	EXPECT_EQ(300u, reads.front().offset);
+}
+
+
+TEST(ChunkedIo, chunkedReadReassemblesOutOfOrder) {
+	byte source[250];
+	for (size_t i = 0; i < sizeof(source); ++i) {
+		source[i] = static_cast<byte>(i);
+	}
+
+	byte dest[250];
+	ChunkedRead read{1, 0, wrapMemory(dest), 100, 5};
+	byte buffer[256];
+	ByteWriter writer{wrapMemory(buffer)};
+	MessageBatch batch{writer, kMaxMesssageSize};
+	ASSERT_EQ(3u, read.writeRequests(batch));
+
+	auto const sourceData = wrapMemory(source);
+	EXPECT_TRUE(read.onResponse(7, Response::Read{sourceData.slice(200, 250)}).isOk());
+	EXPECT_TRUE(read.onResponse(5, Response::Read{sourceData.slice(0, 100)}).isOk());
+	EXPECT_FALSE(read.done());
+	EXPECT_TRUE(read.onResponse(6, Response::Read{sourceData.slice(100, 200)}).isOk());
+
+	EXPECT_TRUE(read.done());
+	EXPECT_FALSE(read.isShort());
+	EXPECT_EQ(250u, read.bytesTransferred());
+	EXPECT_EQ(sourceData, read.data());
+}
+
+
+TEST(ChunkedIo, shortReadEndsTheRead) {
+	byte source[100] = {1, 2, 3};
+	byte dest[1000];
+	ChunkedRead read{1, 0, wrapMemory(dest), 100, 1};
+
+	byte buffer[128];
+	ByteWriter writer{wrapMemory(buffer)};
+	MessageBatch batch{writer, kMaxMesssageSize, 64};
+	ASSERT_EQ(2u, read.writeRequests(batch));
+
+	// End of file is in the middle of the second chunk.
+	EXPECT_TRUE(read.onResponse(2, Response::Read{wrapMemory(source).slice(0, 30)}).isOk());
+	EXPECT_TRUE(read.allSent());
+	EXPECT_FALSE(read.done());
+
+	EXPECT_TRUE(read.onResponse(1, Response::Read{wrapMemory(source)}).isOk());
+	EXPECT_TRUE(read.done());
+	EXPECT_TRUE(read.isShort());
+	EXPECT_EQ(130u, read.bytesTransferred());
+	EXPECT_EQ(130u, read.data().size());
+
+	writer.clear();
+	MessageBatch nextBatch{writer, kMaxMesssageSize};
+	EXPECT_EQ(0u, read.writeRequests(nextBatch));
+}
+
+
+TEST(ChunkedIo, failedChunkEndsTheRead) {
+	byte source[100] = {};
+	byte dest[300];
+	ChunkedRead read{1, 0, wrapMemory(dest), 100, 1};
+
+	byte buffer[128];
+	ByteWriter writer{wrapMemory(buffer)};
+	MessageBatch batch{writer, kMaxMesssageSize};
+	ASSERT_EQ(3u, read.writeRequests(batch));
+
+	EXPECT_TRUE(read.onResponse(1, Response::Read{wrapMemory(source)}).isOk());
+	EXPECT_TRUE(read.fail(2).isOk());
+	EXPECT_TRUE(read.onResponse(3, Response::Read{wrapMemory(source)}).isOk());
+
+	EXPECT_TRUE(read.done());
+	EXPECT_EQ(100u, read.bytesTransferred());
+}
+
+
+TEST(ChunkedIo, unexpectedResponsesAreErrors) {
+	byte source[200] = {};
+	byte dest[300];
+	ChunkedRead read{1, 0, wrapMemory(dest), 100, 1};
+
+	// Nothing has been sent yet
+	EXPECT_TRUE(read.onResponse(1, Response::Read{wrapMemory(source).slice(0, 10)}).isError());
+
+	byte buffer[128];
+	ByteWriter writer{wrapMemory(buffer)};
+	MessageBatch batch{writer, kMaxMesssageSize};
+	ASSERT_EQ(3u, read.writeRequests(batch));
+
+	EXPECT_FALSE(read.owns(0));
+	EXPECT_FALSE(read.owns(4));
+	EXPECT_TRUE(read.onResponse(4, Response::Read{wrapMemory(source).slice(0, 10)}).isError());
+	EXPECT_TRUE(read.onResponse(1, Response::Read{wrapMemory(source)}).isError());
+	EXPECT_EQ(0u, read.chunksCompleted());
+}
+
+
+TEST(ChunkedIo, repeatedResponsesAreErrors) {
+	byte source[100] = {};
+	byte dest[200];
+	ChunkedRead read{1, 0, wrapMemory(dest), 100, 1};
+
+	byte buffer[128];
+	ByteWriter writer{wrapMemory(buffer)};
+	MessageBatch batch{writer, kMaxMesssageSize};
+	ASSERT_EQ(2u, read.writeRequests(batch));
+
+	ASSERT_TRUE(read.onResponse(1, Response::Read{wrapMemory(source)}).isOk());
+	EXPECT_TRUE(read.onResponse(1, Response::Read{wrapMemory(source)}).isError());
+	EXPECT_TRUE(read.fail(1).isError());
+	EXPECT_EQ(1u, read.chunksCompleted());
+	EXPECT_EQ(1u, read.inFlight());
+	EXPECT_FALSE(read.done());
+
+	ASSERT_TRUE(read.onResponse(2, Response::Read{wrapMemory(source)}).isOk());
+	EXPECT_TRUE(read.done());
+	EXPECT_EQ(0u, read.inFlight());
+	EXPECT_EQ(200u, read.bytesTransferred());
+}
+
+
+TEST(ChunkedIo, chunkedWriteCopiesData) {
+	Parser parser{kLargeMessageSize};
+	std::vector<byte> source(2 * kLargeMessageSize);
+	for (size_t i = 0; i < source.size(); ++i) {
+		source[i] = static_cast<byte>(i % 251);
+	}
+
+	auto const data = wrapMemory(source.data(), source.size());
+	ChunkedWrite write{3, 0, data, ioChunkSize(parser.maxNegotiatedMessageSize()), 1};
+	ASSERT_EQ(3u, write.chunkCount());
+
+	std::vector<byte> buffer(3 * kLargeMessageSize);
+	ByteWriter writer{wrapMemory(buffer.data(), buffer.size())};
+	MessageBatch batch{writer, parser.maxNegotiatedMessageSize()};
+	EXPECT_EQ(3u, write.writeRequests(batch));
+
+	ByteReader reader{batch.seal().viewRemaining()};
+	uint32 messages = 0;
+	auto result = parser.parseRequests(reader, [&](MessageHeader const& header, RequestMessage&& message) {
+		auto const& request = std::get<Request::Write>(message);
+		auto const chunk = static_cast<uint32>(header.tag - 1);
+		EXPECT_EQ(write.chunkOffset(chunk), request.offset);
+		EXPECT_EQ(data.slice(request.offset, request.offset + write.chunkLength(chunk)), request.data);
+		EXPECT_TRUE(write.onResponse(header.tag, Response::Write{static_cast<size_type>(request.data.size())}).isOk());
+		messages += 1;
+	});
+
+	ASSERT_TRUE(result.isOk());
+	EXPECT_EQ(3u, messages);
+	EXPECT_TRUE(write.done());
+	EXPECT_EQ(data.size(), write.bytesTransferred());
+}
+
+
+TEST(ChunkedIo, chunkedWriteOutOfLine) {
+	byte source[250];
+	for (size_t i = 0; i < sizeof(source); ++i) {
+		source[i] = static_cast<byte>(i);
+	}
+
+	ChunkedWrite write{3, 1024, wrapMemory(source), 100, 1};
+
+	byte buffer[64];
+	ByteWriter writer{wrapMemory(buffer)};
+	for (uint32 i = 0; i < write.chunkCount(); ++i) {
+		writer.clear();
+		auto const segments = write.writeNext(writer);
+		EXPECT_EQ(wrapMemory(source).slice(i * 100, i * 100 + write.chunkLength(i)), segments.payload);
+		EXPECT_EQ(headerSize() + sizeof(Fid) + sizeof(uint64) + sizeof(size_type) + segments.payload.size(),
+				  segments.size());
+	}
+
+	writer.clear();
+	EXPECT_EQ(0u, write.writeNext(writer).size());
+
+	// Short write of the second chunk
+	EXPECT_TRUE(write.onResponse(1, Response::Write{100}).isOk());
+	EXPECT_TRUE(write.onResponse(2, Response::Write{60}).isOk());
+	EXPECT_TRUE(write.onResponse(3, Response::Write{50}).isOk());
+	EXPECT_TRUE(write.onResponse(4, Response::Write{10}).isError());
+
+	EXPECT_TRUE(write.done());
+	EXPECT_TRUE(write.isShort());
+	EXPECT_EQ(160u, write.bytesTransferred());
+}
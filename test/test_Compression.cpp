@@ -0,0 +1,214 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_Compression.cpp
+ *
+ *******************************************************************************/
+#include "styxe/compression.hpp"  // Class being tested
+#include "styxe/requestWriter.hpp"
+#include "styxe/responseWriter.hpp"
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace {
+
+constexpr char kText[] =
+		"Plan 9 from Bell Labs is a distributed operating system. "
+		"All resources are files, all files are served over 9P. "
+		"All resources are files, all files are served over 9P. "
+		"All resources are files, all files are served over 9P. "
+		"All resources are files, all files are served over 9P. "
+		"All resources are files, all files are served over 9P. "
+		"All resources are files, all files are served over 9P.";
+
+MemoryView textData() noexcept {
+	return wrapMemory(kText, sizeof(kText) - 1);
+}
+
+}  // namespace
+
+
+class Compression : public ::testing::Test {
+protected:
+
+	void SetUp() override {
+		_writer.rewind();
+	}
+
+	template<typename T, typename ParserFn>
+	T parseMessage(ParserFn&& parse) {
+		ByteReader reader{_writer.viewRemaining()};
+
+		T message;
+		auto result = _parser.parseMessageHeader(reader)
+				.then([&](MessageHeader&& header) {
+					return parse(header, reader);
+				});
+		[&result]() { ASSERT_TRUE(result.isOk()) << result.getError(); }();
+		if (result) {
+			[&]() { ASSERT_TRUE(std::holds_alternative<T>(*result)); }();
+			if (std::holds_alternative<T>(*result)) {
+				message = std::get<T>(*result);
+			}
+		}
+
+		return message;
+	}
+
+protected:
+	Parser			_parser{kMaxMesssageSize, "9P2000.e+lz4"};
+	byte			_buffer[1024];
+	byte			_decompressed[1024];
+	ByteWriter		_writer{wrapMemory(_buffer)};
+};
+
+
+TEST_F(Compression, roundtrip) {
+	byte compressed[lz4CompressBound(sizeof(kText))];
+	auto const compressedSize = lz4Compress(textData(), wrapMemory(compressed));
+	ASSERT_GT(compressedSize, 0u);
+	EXPECT_LT(compressedSize, textData().size());
+
+	auto result = lz4Decompress(wrapMemory(compressed).slice(0, compressedSize), wrapMemory(_decompressed));
+	ASSERT_TRUE(result.isOk());
+	EXPECT_EQ(textData(), *result);
+}
+
+
+TEST_F(Compression, decompressReferenceBlock) {
+	// Literal 'a', match of 4 bytes at offset 1, then last literals "hello"
+	byte const block[] = {0x10, 'a', 0x01, 0x00, 0x50, 'h', 'e', 'l', 'l', 'o'};
+
+	auto result = lz4Decompress(wrapMemory(block), wrapMemory(_decompressed));
+	ASSERT_TRUE(result.isOk());
+	EXPECT_EQ(wrapMemory("aaaaahello", 10), *result);
+}
+
+
+TEST_F(Compression, corruptedBlockIsRejected) {
+	byte const badOffset[] = {0x10, 'a', 0x02, 0x00, 0x50, 'h', 'e', 'l', 'l', 'o'};
+	EXPECT_TRUE(lz4Decompress(wrapMemory(badOffset), wrapMemory(_decompressed)).isError());
+
+	byte const zeroOffset[] = {0x10, 'a', 0x00, 0x00, 0x50, 'h', 'e', 'l', 'l', 'o'};
+	EXPECT_TRUE(lz4Decompress(wrapMemory(zeroOffset), wrapMemory(_decompressed)).isError());
+
+	byte const truncated[] = {0xF0, 0xFF};
+	EXPECT_TRUE(lz4Decompress(wrapMemory(truncated), wrapMemory(_decompressed)).isError());
+
+	byte const block[] = {0x10, 'a', 0x01, 0x00, 0x50, 'h', 'e', 'l', 'l', 'o'};
+	EXPECT_TRUE(lz4Decompress(wrapMemory(block), wrapMemory(_decompressed).slice(0, 9)).isError());
+}
+
+
+TEST_F(Compression, incompressibleDataDoesNotFit) {
+	byte data[64];
+	for (size_t i = 0; i < sizeof(data); ++i) {
+		data[i] = static_cast<byte>(i * 7);
+	}
+
+	byte compressed[sizeof(data)];
+	EXPECT_EQ(0u, lz4Compress(wrapMemory(data), wrapMemory(compressed)));
+	EXPECT_EQ(0u, encodeCompressed(_writer, wrapMemory(data), CompressionPolicy{PayloadCompression::LZ4, 0}));
+	EXPECT_EQ(0u, _writer.position());
+}
+
+
+TEST_F(Compression, negotiation) {
+	EXPECT_EQ(PayloadCompression::LZ4, parsePayloadCompression("9P2000.e+lz4"));
+	EXPECT_EQ(PayloadCompression::None, parsePayloadCompression("9P2000.e"));
+	EXPECT_EQ(ProtocolVersion::V9P2000E, parseProtocolVersion("9P2000.e+lz4"));
+	EXPECT_EQ(StringView{"9P2000.eb+lz4"}, protocolVersionString(ProtocolVersion::V9P2000EB, PayloadCompression::LZ4));
+	EXPECT_EQ(StringView{"9P2000"}, protocolVersionString(ProtocolVersion::V9P2000, PayloadCompression::None));
+
+	EXPECT_EQ(PayloadCompression::LZ4, negotiatePayloadCompression(PayloadCompression::LZ4, PayloadCompression::LZ4));
+	EXPECT_EQ(PayloadCompression::None, negotiatePayloadCompression(PayloadCompression::LZ4, PayloadCompression::None));
+
+	EXPECT_EQ(PayloadCompression::LZ4, _parser.negotiatedCompression());
+	EXPECT_EQ(StringView{"9P2000.e+lz4"}, _parser.getNegotiatedVersion());
+
+	// Setting the version alone renegotiates the session without compression
+	_parser.setNegotiatedVersion(ProtocolVersion::V9P2000E);
+	EXPECT_EQ(PayloadCompression::None, _parser.negotiatedCompression());
+	EXPECT_EQ(StringView{"9P2000.e"}, _parser.getNegotiatedVersion());
+
+	_parser.setNegotiatedVersion(ProtocolVersion::V9P2000EB, PayloadCompression::LZ4);
+	EXPECT_EQ(PayloadCompression::LZ4, _parser.negotiatedCompression());
+	EXPECT_EQ(StringView{"9P2000.eb+lz4"}, _parser.getNegotiatedVersion());
+}
+
+
+TEST_F(Compression, compressedReadResponse) {
+	ResponseWriter{_writer, 7, CompressionPolicy{PayloadCompression::LZ4}}
+			.read(textData())
+			.build();
+	EXPECT_LT(_writer.remaining(), headerSize() + sizeof(size_type) + textData().size());
+
+	auto const read = parseMessage<Response::Read>([&](MessageHeader const& header, ByteReader& reader) {
+		return _parser.parseCompressedResponse(header, reader, wrapMemory(_decompressed));
+	});
+	EXPECT_EQ(textData(), read.data);
+}
+
+
+TEST_F(Compression, compressedWriteRequest) {
+	RequestWriter{_writer, 3, CompressionPolicy{PayloadCompression::LZ4}}
+			.write(42, 100)
+			.data(textData())
+			.build();
+	EXPECT_LT(_writer.remaining(), headerSize() + 16 + textData().size());
+
+	auto const write = parseMessage<Request::Write>([&](MessageHeader const& header, ByteReader& reader) {
+		return _parser.parseCompressedRequest(header, reader, wrapMemory(_decompressed));
+	});
+	EXPECT_EQ(42u, write.fid);
+	EXPECT_EQ(100u, write.offset);
+	EXPECT_EQ(textData(), write.data);
+}
+
+
+TEST_F(Compression, smallPayloadIsNotCompressed) {
+	auto const data = textData().slice(0, 32);
+	ResponseWriter{_writer, 7, CompressionPolicy{PayloadCompression::LZ4}}
+			.read(data)
+			.build();
+	EXPECT_EQ(headerSize() + sizeof(size_type) + data.size(), _writer.remaining());
+
+	auto const read = parseMessage<Response::Read>([&](MessageHeader const& header, ByteReader& reader) {
+		return _parser.parseResponse(header, reader);
+	});
+	EXPECT_EQ(data, read.data);
+}
+
+
+TEST_F(Compression, decompressedDataMustFitBuffer) {
+	ResponseWriter{_writer, 7, CompressionPolicy{PayloadCompression::LZ4}}
+			.read(textData())
+			.build();
+
+	ByteReader reader{_writer.viewRemaining()};
+	auto header = _parser.parseMessageHeader(reader);
+	ASSERT_TRUE(header.isOk());
+	EXPECT_TRUE(_parser.parseCompressedResponse(*header, reader, wrapMemory(_decompressed).slice(0, 16)).isError());
+}
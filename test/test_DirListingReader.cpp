@@ -0,0 +1,119 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_DirListingReader.cpp
+ *
+ *******************************************************************************/
+#include "styxe/dirListingReader.hpp"  // Class being tested
+#include "styxe/encoder.hpp"
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+class DirListingReaderTest : public ::testing::Test {
+protected:
+
+	void SetUp() override {
+		_stats[0] = Stat{0, 1, 2, {2, 0, 64}, 01000644, 0, 0, 4096,
+				StringLiteral{"Root"}, StringLiteral{"User"}, StringLiteral{"Glanda"}, StringLiteral{"User"}};
+		_stats[1] = Stat{0, 3, 7, {0, 17, 1298}, 0644, 11, 12, 1024,
+				StringLiteral{"File McFileface"}, StringLiteral{"User McUserface"}, StringLiteral{""}, StringLiteral{"Some"}};
+		_stats[2] = Stat{0, 1, 2, {0, 1, 65}, 0600, 21, 22, 0,
+				StringLiteral{"empty"}, StringLiteral{"nobody"}, StringLiteral{"nogroup"}, StringLiteral{"nobody"}};
+
+		_writer.clear();
+		DirListingWriter writer{_writer, 4096, 0};
+		for (auto& stat : _stats) {
+			stat.size = DirListingWriter::sizeStat(stat);
+			ASSERT_TRUE(writer.encode(stat));
+		}
+		_writer.flip();
+	}
+
+	MemoryView listing() const { return _writer.viewRemaining(); }
+
+protected:
+	Stat			_stats[3];
+	byte			_buffer[512];
+	ByteWriter		_writer{wrapMemory(_buffer)};
+};
+
+
+TEST_F(DirListingReaderTest, emptyListing) {
+	DirListingReader reader{MemoryView{}};
+
+	EXPECT_TRUE(reader.begin() == reader.end());
+	EXPECT_TRUE(reader.validate().isOk());
+}
+
+
+TEST_F(DirListingReaderTest, iterateEntries) {
+	DirListingReader reader{listing()};
+	ASSERT_TRUE(reader.validate().isOk());
+
+	size_t i = 0;
+	for (auto entry : reader) {
+		ASSERT_LT(i, 3u);
+		EXPECT_EQ(_stats[i], entry.decode());
+		EXPECT_EQ(Encoder::protocolSize(_stats[i]), entry.data().size());
+		++i;
+	}
+
+	EXPECT_EQ(3u, i);
+}
+
+
+TEST_F(DirListingReaderTest, lazyFieldAccess) {
+	DirListingReader reader{listing()};
+	auto it = reader.begin();
+	++it;
+
+	auto const entry = *it;
+	EXPECT_EQ(_stats[1].size, entry.size());
+	EXPECT_EQ(_stats[1].type, entry.type());
+	EXPECT_EQ(_stats[1].dev, entry.dev());
+	EXPECT_EQ(_stats[1].qid, entry.qid());
+	EXPECT_EQ(_stats[1].mode, entry.mode());
+	EXPECT_EQ(_stats[1].atime, entry.atime());
+	EXPECT_EQ(_stats[1].mtime, entry.mtime());
+	EXPECT_EQ(_stats[1].length, entry.length());
+	EXPECT_EQ(_stats[1].name, entry.name());
+	EXPECT_EQ(_stats[1].uid, entry.uid());
+	EXPECT_EQ(_stats[1].gid, entry.gid());
+	EXPECT_EQ(_stats[1].muid, entry.muid());
+}
+
+
+TEST_F(DirListingReaderTest, truncatedEntryStopsIteration) {
+	auto const data = listing();
+	DirListingReader reader{data.slice(0, data.size() - 3)};
+
+	EXPECT_TRUE(reader.validate().isError());
+
+	size_t count = 0;
+	for (auto entry : reader) {
+		EXPECT_EQ(_stats[count].name, entry.name());
+		++count;
+	}
+
+	EXPECT_EQ(2u, count);
+}
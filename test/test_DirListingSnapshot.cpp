@@ -0,0 +1,137 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_DirListingSnapshot.cpp
+ *
+ *******************************************************************************/
+#include "styxe/dirListingSnapshot.hpp"  // Class being tested
+#include "styxe/encoder.hpp"
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+class DirListingSnapshotTest : public ::testing::Test {
+protected:
+
+	void SetUp() override {
+		_stats[0] = Stat{0, 1, 2, {2, 0, 64}, 01000644, 0, 0, 4096,
+				StringLiteral{"Root"}, StringLiteral{"User"}, StringLiteral{"Glanda"}, StringLiteral{"User"}};
+		_stats[1] = Stat{0, 3, 7, {0, 17, 1298}, 0644, 11, 12, 1024,
+				StringLiteral{"File McFileface"}, StringLiteral{"User McUserface"}, StringLiteral{""}, StringLiteral{"Some"}};
+		_stats[2] = Stat{0, 1, 2, {0, 1, 65}, 0600, 21, 22, 0,
+				StringLiteral{"empty"}, StringLiteral{"nobody"}, StringLiteral{"nogroup"}, StringLiteral{"nobody"}};
+
+		for (auto& stat : _stats) {
+			stat.size = DirListingWriter::sizeStat(stat);
+			ASSERT_TRUE(_snapshot.add(stat));
+		}
+	}
+
+	/// Encode a listing the classic way for comparison.
+	MemoryView encodeListing(uint64 offset, uint32 count) {
+		_writer.clear();
+		DirListingWriter writer{_writer, count, offset};
+		for (auto const& stat : _stats) {
+			if (!writer.encode(stat)) {
+				break;
+			}
+		}
+
+		return _writer.viewWritten();
+	}
+
+	static uint32 entrySize(Stat const& stat) { return Encoder::protocolSize(stat); }
+
+protected:
+	Stat				_stats[3];
+	byte				_buffer[512];
+	ByteWriter			_writer{wrapMemory(_buffer)};
+
+	byte				_storage[512];
+	uint32				_index[4];
+	DirListingSnapshot	_snapshot{wrapMemory(_storage), arrayView(_index)};
+};
+
+
+TEST_F(DirListingSnapshotTest, emptySnapshot) {
+	DirListingSnapshot snapshot{MutableMemoryView{}, ArrayView<uint32>{}};
+
+	EXPECT_TRUE(snapshot.empty());
+	EXPECT_TRUE(snapshot.read(0, 4096).empty());
+	EXPECT_FALSE(snapshot.add(_stats[0]));
+}
+
+
+TEST_F(DirListingSnapshotTest, entriesAreEncodedOnce) {
+	ASSERT_EQ(3u, _snapshot.size());
+	EXPECT_EQ(encodeListing(0, 4096), _snapshot.data());
+
+	for (uint32 i = 0; i < _snapshot.size(); ++i) {
+		EXPECT_EQ(_stats[i], _snapshot[i].decode());
+	}
+}
+
+
+TEST_F(DirListingSnapshotTest, readMatchesDirListingWriter) {
+	auto const first = entrySize(_stats[0]);
+	auto const second = entrySize(_stats[1]);
+
+	uint64 const offsets[] = {0, first, first + second, first + 3, first + second + entrySize(_stats[2])};
+	uint32 const counts[] = {4096, first, first + second - 1, first + second, 7};
+	for (auto offset : offsets) {
+		for (auto count : counts) {
+			EXPECT_EQ(encodeListing(offset, count), _snapshot.read(offset, count))
+					<< "offset: " << offset << ", count: " << count;
+		}
+	}
+}
+
+
+TEST_F(DirListingSnapshotTest, readPastTheEnd) {
+	EXPECT_TRUE(_snapshot.read(_snapshot.data().size(), 4096).empty());
+	EXPECT_TRUE(_snapshot.read(100500, 4096).empty());
+}
+
+
+TEST_F(DirListingSnapshotTest, addEncodedEntry) {
+	byte storage[512];
+	uint32 index[3];
+	DirListingSnapshot copy{wrapMemory(storage), arrayView(index)};
+	for (uint32 i = 0; i < _snapshot.size(); ++i) {
+		ASSERT_TRUE(copy.add(_snapshot[i]));
+	}
+
+	EXPECT_EQ(_snapshot.data(), copy.data());
+	EXPECT_FALSE(copy.add(_stats[0]));  // Index exhausted
+}
+
+
+TEST_F(DirListingSnapshotTest, storageExhausted) {
+	byte storage[96];
+	uint32 index[4];
+	DirListingSnapshot snapshot{wrapMemory(storage), arrayView(index)};
+
+	ASSERT_TRUE(snapshot.add(_stats[0]));
+	EXPECT_FALSE(snapshot.add(_stats[1]));
+	EXPECT_EQ(1u, snapshot.size());
+	EXPECT_EQ(entrySize(_stats[0]), snapshot.data().size());
+}
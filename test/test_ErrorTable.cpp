@@ -0,0 +1,148 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_ErrorTable.cpp
+ *
+ *******************************************************************************/
+#include "styxe/errorTable.hpp"  // Class being tested
+#include "styxe/responseWriter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace {
+
+/// Encode an error response the classic way for comparison.
+MemoryView encodeErrorMessage(ByteWriter& writer, Tag tag, StringView message) {
+	writer.clear();
+	ResponseWriter{writer, tag}.error(message).build();
+
+	return writer.viewRemaining();
+}
+
+}  // namespace
+
+
+TEST(ErrorTable, emptyTable) {
+	ErrorTable<16> errors;
+
+	EXPECT_EQ(0u, errors.size());
+	EXPECT_FALSE(errors.contains(ENOENT));
+	EXPECT_TRUE(errors.find(ENOENT).empty());
+}
+
+
+TEST(ErrorTable, findRegisteredMessage) {
+	ErrorTable<64> errors;
+	ASSERT_TRUE(errors.add(ENOENT, "No such file or directory"));
+	ASSERT_TRUE(errors.add(EACCES, "Permission denied"));
+
+	EXPECT_EQ(2u, errors.size());
+	EXPECT_TRUE(errors.contains(ENOENT));
+	EXPECT_EQ(StringView{"Permission denied"}, errors.find(EACCES).message());
+	EXPECT_EQ(StringView{"No such file or directory"}, errors.find(ENOENT).message());
+	EXPECT_TRUE(errors.find(EIO).empty());
+}
+
+
+TEST(ErrorTable, rejectInvalidCodes) {
+	ErrorTable<8> errors;
+	EXPECT_FALSE(errors.add(8, "Out of range"));
+	ASSERT_TRUE(errors.add(2, "Registered"));
+	EXPECT_FALSE(errors.add(2, "Registered again"));
+	EXPECT_EQ(StringView{"Registered"}, errors.find(2).message());
+}
+
+
+TEST(ErrorTable, storageExhausted) {
+	ErrorTable<8, 32> errors;
+	ASSERT_TRUE(errors.add(1, "Short"));
+	EXPECT_FALSE(errors.add(2, "A message that is too long to fit"));
+	EXPECT_EQ(1u, errors.size());
+}
+
+
+TEST(ErrorTable, encodedErrorResponseMatchesMessage) {
+	ErrorTable<64> errors;
+	ASSERT_TRUE(errors.add(ENOENT, "No such file or directory"));
+
+	byte expectedBuffer[128];
+	ByteWriter expectedWriter{wrapMemory(expectedBuffer)};
+	auto const expected = encodeErrorMessage(expectedWriter, 42, "No such file or directory");
+
+	byte buffer[128];
+	ByteWriter writer{wrapMemory(buffer)};
+	ResponseWriter{writer, 42}.error(errors.find(ENOENT)).build();
+
+	EXPECT_EQ(expected, writer.viewRemaining());
+}
+
+
+TEST(ErrorTable, cannedErrorResponse) {
+	byte expectedBuffer[128];
+	ByteWriter expectedWriter{wrapMemory(expectedBuffer)};
+	byte buffer[128];
+	ByteWriter writer{wrapMemory(buffer)};
+
+	for (auto errorId : {CannedError::IllFormedHeader, CannedError::UnsupportedMessageType,
+						 CannedError::MoreThenExpectedData, CannedError::WalkPathTooLong}) {
+		auto const expected = encodeErrorMessage(expectedWriter, 3, getCannedError(errorId).tag());
+
+		writer.clear();
+		ResponseWriter{writer, 3}.error(errorId).build();
+		EXPECT_EQ(expected, writer.viewRemaining());
+	}
+}
+
+
+TEST(ErrorTable, protocolErrorIsSentAsCannedMessage) {
+	// Protocol errors are sent with the canned message alone, not the formatted error
+	byte const expected[] = {
+		69, 0, 0, 0,  // size[4]
+		107,          // type[1]: RError
+		3, 0,         // tag[2]
+		60, 0,        // ename[s]
+		'I', 'l', 'l', '-', 'f', 'o', 'r', 'm', 'e', 'd', ' ', 'm', 'e', 's', 's', 'a', 'g', 'e', ':', ' ',
+		'W', 'a', 'l', 'k', ' ', 'p', 'a', 't', 'h', ' ', 'h', 'a', 's', ' ', 'm', 'o', 'r', 'e', ' ',
+		'e', 'l', 'e', 'm', 'e', 'n', 't', 's', ' ', 't', 'h', 'a', 'n', ' ', 'a', 'l', 'l', 'o', 'w', 'e', 'd'
+	};
+
+	byte buffer[128];
+	ByteWriter writer{wrapMemory(buffer)};
+	ResponseWriter{writer, 3}.error(getCannedError(CannedError::WalkPathTooLong)).build();
+
+	EXPECT_EQ(wrapMemory(expected), writer.viewRemaining());
+}
+
+
+TEST(ErrorTable, emptyEncodedErrorResponse) {
+	byte expectedBuffer[128];
+	ByteWriter expectedWriter{wrapMemory(expectedBuffer)};
+	auto const expected = encodeErrorMessage(expectedWriter, 5, StringView{});
+
+	byte buffer[128];
+	ByteWriter writer{wrapMemory(buffer)};
+	ResponseWriter{writer, 5}.error(EncodedError{}).build();
+
+	EXPECT_EQ(expected, writer.viewRemaining());
+}
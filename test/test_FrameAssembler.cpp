@@ -0,0 +1,174 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_FrameAssembler.cpp
+ *
+ *******************************************************************************/
+#include "styxe/frameAssembler.hpp"  // Class being tested
+#include "styxe/requestWriter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+class FrameAssemblerTest : public ::testing::Test {
+protected:
+
+	void SetUp() override {
+		_writer.clear();
+
+		// Stream of 3 messages back to back
+		RequestWriter{_writer, 1}.clunk(17).build();
+		_stream[0] = _writer.limit();
+		_writer.position(_writer.limit());
+		_writer.limit(_writer.capacity());
+
+		RequestWriter{_writer, 2}.read(31, 64, 4096).build();
+		_stream[1] = _writer.limit();
+		_writer.position(_writer.limit());
+		_writer.limit(_writer.capacity());
+
+		RequestWriter{_writer, 3}.walk(1, 2).path("some").path("file").build();
+		_stream[2] = _writer.limit();
+	}
+
+	MemoryView streamData() const { return _writer.viewRemaining().slice(0, _stream[2]); }
+
+	struct Collector {
+		void operator() (MessageHeader const& header, ByteReader& payload) {
+			EXPECT_EQ(header.payloadSize(), payload.remaining());
+
+			tags.push_back(header.tag);
+			EXPECT_TRUE(parser.parseRequest(header, payload).isOk());
+		}
+
+		Parser const& parser;
+		std::vector<Tag> tags;
+	};
+
+protected:
+	Parser			_parser;
+	byte			_buffer[128];
+	ByteWriter		_writer{wrapMemory(_buffer)};
+	ByteWriter::size_type _stream[3];
+
+	MemoryManager   _memManager{kMaxMesssageSize};
+	MemoryResource  _staging{_memManager.allocate(kMaxMesssageSize).unwrap()};
+};
+
+
+TEST_F(FrameAssemblerTest, completeFramesInOneChunk) {
+	FrameAssembler assembler{_parser, _staging.view()};
+	Collector collector{_parser, {}};
+
+	ASSERT_TRUE(assembler.feed(streamData(), collector).isOk());
+	ASSERT_EQ(0u, assembler.bytesPending());
+
+	ASSERT_EQ(3u, collector.tags.size());
+	EXPECT_EQ(1, collector.tags[0]);
+	EXPECT_EQ(2, collector.tags[1]);
+	EXPECT_EQ(3, collector.tags[2]);
+}
+
+
+TEST_F(FrameAssemblerTest, completeFramesAreNotCopied) {
+	FrameAssembler assembler{_parser, _staging.view()};
+	auto const data = streamData();
+
+	auto r = assembler.feed(data, [&data](MessageHeader const&, ByteReader& payload) {
+		auto const view = payload.viewRemaining();
+		EXPECT_GE(view.dataAs<byte const>(), data.dataAs<byte const>());
+		EXPECT_LE(view.dataAs<byte const>() + view.size(), data.dataAs<byte const>() + data.size());
+	});
+	ASSERT_TRUE(r.isOk());
+}
+
+
+TEST_F(FrameAssemblerTest, byteByByte) {
+	FrameAssembler assembler{_parser, _staging.view()};
+	Collector collector{_parser, {}};
+
+	auto const data = streamData();
+	for (MemoryView::size_type i = 0; i < data.size(); ++i) {
+		ASSERT_TRUE(assembler.feed(data.slice(i, i + 1), collector).isOk());
+	}
+
+	ASSERT_EQ(0u, assembler.bytesPending());
+	ASSERT_EQ(3u, collector.tags.size());
+	EXPECT_EQ(1, collector.tags[0]);
+	EXPECT_EQ(2, collector.tags[1]);
+	EXPECT_EQ(3, collector.tags[2]);
+}
+
+
+TEST_F(FrameAssemblerTest, splitAcrossFrameBoundaries) {
+	auto const data = streamData();
+
+	// Try every possible split of the stream into 2 chunks
+	for (MemoryView::size_type split = 0; split <= data.size(); ++split) {
+		FrameAssembler assembler{_parser, _staging.view()};
+		Collector collector{_parser, {}};
+
+		ASSERT_TRUE(assembler.feed(data.slice(0, split), collector).isOk());
+		ASSERT_TRUE(assembler.feed(data.slice(split, data.size()), collector).isOk());
+
+		ASSERT_EQ(0u, assembler.bytesPending());
+		ASSERT_EQ(3u, collector.tags.size());
+		EXPECT_EQ(3, collector.tags[2]);
+	}
+}
+
+
+TEST_F(FrameAssemblerTest, partialFrameIsBuffered) {
+	FrameAssembler assembler{_parser, _staging.view()};
+	Collector collector{_parser, {}};
+
+	auto const data = streamData();
+	ASSERT_TRUE(assembler.feed(data.slice(0, _stream[0] + 3), collector).isOk());
+	EXPECT_EQ(3u, assembler.bytesPending());
+	ASSERT_EQ(1u, collector.tags.size());
+
+	assembler.reset();
+	EXPECT_EQ(0u, assembler.bytesPending());
+}
+
+
+TEST_F(FrameAssemblerTest, illFormedHeaderIsAnError) {
+	FrameAssembler assembler{_parser, _staging.view()};
+	Collector collector{_parser, {}};
+
+	byte garbage[16];
+	wrapMemory(garbage).fill(0xFF);
+
+	ASSERT_TRUE(assembler.feed(wrapMemory(garbage), collector).isError());
+	EXPECT_TRUE(collector.tags.empty());
+}
+
+
+TEST_F(FrameAssemblerTest, frameLargerThanStagingIsAnError) {
+	byte smallStaging[16];
+	FrameAssembler assembler{_parser, wrapMemory(smallStaging)};
+	Collector collector{_parser, {}};
+
+	auto const data = streamData();
+	ASSERT_TRUE(assembler.feed(data.slice(_stream[1], _stream[1] + 10), collector).isError());
+}
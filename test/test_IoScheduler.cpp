@@ -0,0 +1,276 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_IoScheduler.cpp
+ *
+ *******************************************************************************/
+#include "styxe/ioScheduler.hpp"  // Class being tested
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+class IoSchedulerTest : public ::testing::Test {
+protected:
+
+	void SetUp() override {
+		for (size_t i = 0; i < sizeof(_file); ++i) {
+			_file[i] = static_cast<byte>(i % 251);
+		}
+
+		_writer.clear();
+	}
+
+	/// Parse responses written into the buffer.
+	std::vector<std::pair<Tag, ResponseMessage>> responses() {
+		std::vector<std::pair<Tag, ResponseMessage>> messages;
+		ByteReader reader{_writer.viewWritten()};
+		auto result = _parser.parseResponses(reader, [&](MessageHeader const& header, ResponseMessage&& message) {
+			messages.emplace_back(header.tag, mv(message));
+		});
+		EXPECT_TRUE(result.isOk());
+		_writer.clear();
+
+		return messages;
+	}
+
+	MemoryView file(uint64 offset, uint64 count) const { return wrapMemory(_file).slice(offset, offset + count); }
+
+protected:
+	Parser			_parser;
+	byte			_file[1024];
+	byte			_buffer[4096];
+	ByteWriter		_writer{wrapMemory(_buffer)};
+};
+
+
+TEST_F(IoSchedulerTest, coalescesContiguousReads) {
+	IoScheduler<16> scheduler{8192};
+	EXPECT_TRUE(scheduler.enqueue(1, Request::Read{7, 0, 100}));
+	EXPECT_TRUE(scheduler.enqueue(2, Request::Read{7, 100, 100}));
+	EXPECT_TRUE(scheduler.enqueue(3, Request::Read{7, 200, 100}));
+	EXPECT_EQ(3u, scheduler.size());
+
+	CoalescedIo io;
+	ASSERT_TRUE(scheduler.next(io));
+	EXPECT_EQ(MessageType::TRead, io.type);
+	EXPECT_EQ(7u, io.fid);
+	EXPECT_EQ(0u, io.offset);
+	EXPECT_EQ(300u, io.count);
+	EXPECT_EQ(3u, io.requests);
+	EXPECT_FALSE(scheduler.next(io));
+
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	EXPECT_TRUE(scheduler.respond(io, file(io.offset, io.count), batch));
+	EXPECT_TRUE(scheduler.empty());
+
+	auto const messages = responses();
+	ASSERT_EQ(3u, messages.size());
+	for (uint32 i = 0; i < messages.size(); ++i) {
+		EXPECT_EQ(1 + i, messages[i].first);
+		EXPECT_EQ(file(i * 100, 100), std::get<Response::Read>(messages[i].second).data);
+	}
+}
+
+
+TEST_F(IoSchedulerTest, shortReadIsSplitInOrder) {
+	IoScheduler<16> scheduler{8192};
+	scheduler.enqueue(1, Request::Read{7, 0, 100});
+	scheduler.enqueue(2, Request::Read{7, 100, 100});
+	scheduler.enqueue(3, Request::Read{7, 200, 100});
+
+	CoalescedIo io;
+	ASSERT_TRUE(scheduler.next(io));
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	EXPECT_TRUE(scheduler.respond(io, file(0, 150), batch));
+
+	auto const messages = responses();
+	ASSERT_EQ(3u, messages.size());
+	EXPECT_EQ(100u, std::get<Response::Read>(messages[0].second).data.size());
+	EXPECT_EQ(file(100, 50), std::get<Response::Read>(messages[1].second).data);
+	EXPECT_EQ(0u, std::get<Response::Read>(messages[2].second).data.size());
+}
+
+
+TEST_F(IoSchedulerTest, onlyCompatibleRequestsAreMerged) {
+	IoScheduler<16> scheduler{250};
+	byte data[100] = {};
+	scheduler.enqueue(1, Request::Read{7, 0, 100});
+	scheduler.enqueue(2, Request::Read{7, 200, 100});     // Gap
+	scheduler.enqueue(3, Request::Write{7, 300, wrapMemory(data)});  // Different type
+	scheduler.enqueue(4, Request::Write{7, 400, wrapMemory(data)});
+	scheduler.enqueue(5, Request::Write{7, 500, wrapMemory(data)});  // Exceeds max I/O size
+
+	CoalescedIo io;
+	uint32 expected[] = {1, 1, 2, 1};
+	for (auto requests : expected) {
+		ASSERT_TRUE(scheduler.next(io));
+		EXPECT_EQ(requests, io.requests);
+	}
+	EXPECT_FALSE(scheduler.next(io));
+	EXPECT_EQ(5u, scheduler.size());
+}
+
+
+TEST_F(IoSchedulerTest, fidsAreServedRoundRobin) {
+	IoScheduler<16> scheduler{8192};
+	scheduler.enqueue(1, Request::Read{1, 0, 10});
+	scheduler.enqueue(2, Request::Read{1, 100, 10});
+	scheduler.enqueue(3, Request::Read{2, 0, 10});
+	scheduler.enqueue(4, Request::Read{2, 100, 10});
+	scheduler.enqueue(5, Request::Read{3, 0, 10});
+
+	std::vector<Fid> order;
+	CoalescedIo io;
+	while (scheduler.next(io)) {
+		order.push_back(io.fid);
+	}
+
+	EXPECT_EQ((std::vector<Fid>{1, 2, 3, 1, 2}), order);
+}
+
+
+TEST_F(IoSchedulerTest, cancelQueuedRequest) {
+	IoScheduler<16> scheduler{8192};
+	scheduler.enqueue(1, Request::Read{7, 0, 100});
+	scheduler.enqueue(2, Request::Read{7, 100, 100});
+	scheduler.enqueue(3, Request::Read{7, 200, 100});
+
+	EXPECT_TRUE(scheduler.cancel(2));
+	EXPECT_FALSE(scheduler.cancel(2));
+	EXPECT_FALSE(scheduler.cancel(17));
+	EXPECT_FALSE(scheduler.contains(2));
+
+	CoalescedIo io;
+	ASSERT_TRUE(scheduler.next(io));
+	EXPECT_EQ(1u, io.requests);
+	EXPECT_EQ(100u, io.count);
+	EXPECT_FALSE(scheduler.cancel(1));  // Being served already
+
+	CoalescedIo second;
+	ASSERT_TRUE(scheduler.next(second));
+	EXPECT_EQ(200u, second.offset);
+	EXPECT_FALSE(scheduler.cancel(3));
+	EXPECT_FALSE(scheduler.next(second));
+
+	// Cancelling the only request of a fid removes the fid from the schedule.
+	scheduler.enqueue(4, Request::Read{8, 0, 100});
+	EXPECT_TRUE(scheduler.cancel(4));
+	CoalescedIo none;
+	EXPECT_FALSE(scheduler.next(none));
+}
+
+
+TEST_F(IoSchedulerTest, coalescedWrite) {
+	IoScheduler<16> scheduler{8192};
+	scheduler.enqueue(1, Request::Write{7, 1000, file(0, 100)});
+	scheduler.enqueue(2, Request::Write{7, 1100, file(100, 50)});
+	scheduler.enqueue(3, Request::Write{7, 1150, file(150, 100)});
+
+	CoalescedIo io;
+	ASSERT_TRUE(scheduler.next(io));
+	EXPECT_EQ(MessageType::TWrite, io.type);
+	EXPECT_EQ(1000u, io.offset);
+	EXPECT_EQ(250u, io.count);
+
+	byte gathered[250];
+	EXPECT_EQ(250u, scheduler.gather(io, wrapMemory(gathered)));
+	EXPECT_EQ(file(0, 250), wrapMemory(gathered));
+
+	// Backend has written only a part of the data
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	EXPECT_TRUE(scheduler.respond(io, size_type{120}, batch));
+
+	auto const messages = responses();
+	ASSERT_EQ(3u, messages.size());
+	EXPECT_EQ(100u, std::get<Response::Write>(messages[0].second).count);
+	EXPECT_EQ(20u, std::get<Response::Write>(messages[1].second).count);
+	EXPECT_EQ(0u, std::get<Response::Write>(messages[2].second).count);
+}
+
+
+TEST_F(IoSchedulerTest, respondAcrossBatches) {
+	IoScheduler<16> scheduler{8192};
+	scheduler.enqueue(1, Request::Read{7, 0, 100});
+	scheduler.enqueue(2, Request::Read{7, 100, 100});
+	scheduler.enqueue(3, Request::Read{7, 200, 100});
+
+	CoalescedIo io;
+	ASSERT_TRUE(scheduler.next(io));
+	{
+		MessageBatch batch{_writer, kMaxMesssageSize, 250};
+		EXPECT_FALSE(scheduler.respond(io, file(0, 300), batch));
+		EXPECT_EQ(1u, io.requests);
+	}
+
+	auto const first = responses();
+	ASSERT_EQ(2u, first.size());
+
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	EXPECT_TRUE(scheduler.respond(io, file(0, 300), batch));
+	auto const rest = responses();
+	ASSERT_EQ(1u, rest.size());
+	EXPECT_EQ(3u, rest[0].first);
+	EXPECT_EQ(file(200, 100), std::get<Response::Read>(rest[0].second).data);
+	EXPECT_TRUE(scheduler.empty());
+}
+
+
+TEST_F(IoSchedulerTest, capacityAndDuplicateTags) {
+	IoScheduler<2> scheduler{8192};
+	EXPECT_TRUE(scheduler.enqueue(1, Request::Read{7, 0, 100}));
+	EXPECT_FALSE(scheduler.enqueue(1, Request::Read{8, 0, 100}));
+	EXPECT_TRUE(scheduler.enqueue(2, Request::Read{8, 0, 100}));
+	EXPECT_FALSE(scheduler.enqueue(3, Request::Read{9, 0, 100}));
+
+	EXPECT_TRUE(scheduler.cancel(1));
+	EXPECT_TRUE(scheduler.enqueue(3, Request::Read{9, 0, 100}));
+}
+
+
+TEST_F(IoSchedulerTest, tagIndexStaysConsistent) {
+	IoScheduler<64> scheduler{8192};
+	std::set<Tag> queued;
+
+	// Tags are chosen so that many of them collide in the index.
+	uint32 seed = 17;
+	for (uint32 i = 0; i < 5000; ++i) {
+		seed = seed * 1103515245u + 12345u;
+		auto const tag = static_cast<Tag>((seed >> 16) % 200);
+		if (queued.count(tag)) {
+			EXPECT_TRUE(scheduler.cancel(tag));
+			queued.erase(tag);
+		} else if (scheduler.enqueue(tag, Request::Read{tag % 5u, tag * 100u, 10})) {
+			queued.insert(tag);
+		} else {
+			EXPECT_EQ(scheduler.capacity(), scheduler.size());
+		}
+
+		ASSERT_EQ(queued.size(), scheduler.size());
+	}
+
+	for (Tag tag = 0; tag < 200; ++tag) {
+		EXPECT_EQ(queued.count(tag) > 0, scheduler.contains(tag));
+	}
+}
@@ -0,0 +1,277 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_IoStream.cpp
+ *
+ *******************************************************************************/
+#include "styxe/ioStream.hpp"  // Class being tested
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+class IoStreamTest : public ::testing::Test {
+protected:
+
+	void SetUp() override {
+		for (size_t i = 0; i < sizeof(_file); ++i) {
+			_file[i] = static_cast<byte>(i % 253);
+		}
+
+		_writer.clear();
+	}
+
+	/// Parse requests of the batch in the order they have been written.
+	std::vector<std::pair<Tag, RequestMessage>> sent() {
+		std::vector<std::pair<Tag, RequestMessage>> messages;
+		ByteReader reader{_writer.viewWritten()};
+		auto result = _parser.parseRequests(reader, [&](MessageHeader const& header, RequestMessage&& message) {
+			messages.emplace_back(header.tag, mv(message));
+		});
+		EXPECT_TRUE(result.isOk());
+		_writer.clear();
+
+		return messages;
+	}
+
+	/// Respond to a read request with the content of the file.
+	Response::Read fileData(uint64 offset, uint32 count) const {
+		auto const data = wrapMemory(_file);
+		return Response::Read{data.slice(offset, offset + count)};
+	}
+
+protected:
+	Parser			_parser;
+	byte			_file[1000];
+	byte			_storage[4 * 100];
+	byte			_buffer[2048];
+	ByteWriter		_writer{wrapMemory(_buffer)};
+};
+
+
+TEST_F(IoStreamTest, readAheadFillsTheWindow) {
+	ReadAheadStream<4> stream{1, 64, wrapMemory(_storage), 100, 10};
+
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	EXPECT_EQ(4u, stream.writeRequests(batch));
+	EXPECT_EQ(0u, stream.writeRequests(batch));
+	EXPECT_EQ(4u, stream.inFlight());
+
+	auto const messages = sent();
+	ASSERT_EQ(4u, messages.size());
+	for (uint32 i = 0; i < messages.size(); ++i) {
+		auto const& read = std::get<Request::Read>(messages[i].second);
+		EXPECT_EQ(10 + i, messages[i].first);
+		EXPECT_EQ(64 + i * 100u, read.offset);
+		EXPECT_EQ(100u, read.count);
+	}
+}
+
+
+TEST_F(IoStreamTest, readAheadReordersResponses) {
+	ReadAheadStream<4> stream{1, 0, wrapMemory(_storage), 100, 1};
+	{
+		MessageBatch batch{_writer, kMaxMesssageSize};
+		ASSERT_EQ(4u, stream.writeRequests(batch));
+		sent();
+	}
+
+	ASSERT_TRUE(stream.onResponse(3, fileData(200, 100)).isOk());
+	EXPECT_EQ(0u, stream.peek().size());
+
+	ASSERT_TRUE(stream.onResponse(1, fileData(0, 100)).isOk());
+	EXPECT_EQ(fileData(0, 100).data, stream.peek());
+	stream.consume(40);
+	EXPECT_EQ(40u, stream.position());
+	EXPECT_EQ(fileData(40, 60).data, stream.peek());
+	stream.consume(60);
+	EXPECT_EQ(0u, stream.peek().size());
+
+	ASSERT_TRUE(stream.onResponse(2, fileData(100, 100)).isOk());
+	EXPECT_EQ(fileData(100, 100).data, stream.peek());
+	stream.consume(100);
+	EXPECT_EQ(fileData(200, 100).data, stream.peek());
+
+	// Two slots have been consumed: window is topped up with the next two chunks reusing their tags.
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	EXPECT_EQ(2u, stream.writeRequests(batch));
+	auto const messages = sent();
+	ASSERT_EQ(2u, messages.size());
+	EXPECT_EQ(1u, messages[0].first);
+	EXPECT_EQ(400u, std::get<Request::Read>(messages[0].second).offset);
+	EXPECT_EQ(2u, messages[1].first);
+	EXPECT_EQ(500u, std::get<Request::Read>(messages[1].second).offset);
+}
+
+
+TEST_F(IoStreamTest, readAheadStopsAtEndOfFile) {
+	ReadAheadStream<4> stream{1, 0, wrapMemory(_storage), 100, 1};
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	ASSERT_EQ(4u, stream.writeRequests(batch));
+
+	// File is 150 bytes long
+	ASSERT_TRUE(stream.onResponse(4, Response::Read{}).isOk());
+	ASSERT_TRUE(stream.onResponse(2, fileData(100, 50)).isOk());
+	ASSERT_TRUE(stream.onResponse(1, fileData(0, 100)).isOk());
+	ASSERT_TRUE(stream.onResponse(3, Response::Read{}).isOk());
+	EXPECT_EQ(0u, stream.inFlight());
+	EXPECT_EQ(0u, stream.writeRequests(batch));
+
+	std::vector<byte> received;
+	while (!stream.atEnd()) {
+		auto const data = stream.peek();
+		ASSERT_LT(0u, data.size());
+		received.insert(received.end(), data.begin(), data.end());
+		stream.consume(data.size());
+	}
+
+	EXPECT_FALSE(stream.failed());
+	EXPECT_EQ(150u, stream.position());
+	EXPECT_EQ(std::vector<byte>(_file, _file + 150), received);
+}
+
+
+TEST_F(IoStreamTest, readAheadStopsOnError) {
+	ReadAheadStream<4> stream{1, 0, wrapMemory(_storage), 100, 1};
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	ASSERT_EQ(4u, stream.writeRequests(batch));
+
+	ASSERT_TRUE(stream.onError(2).isOk());
+	ASSERT_TRUE(stream.onResponse(1, fileData(0, 100)).isOk());
+	EXPECT_FALSE(stream.atEnd());
+	stream.consume(stream.peek().size());
+
+	EXPECT_TRUE(stream.atEnd());
+	EXPECT_TRUE(stream.failed());
+	EXPECT_EQ(100u, stream.position());
+	EXPECT_EQ(2u, stream.inFlight());
+	EXPECT_EQ(0u, stream.writeRequests(batch));
+}
+
+
+TEST_F(IoStreamTest, readAheadRejectsUnexpectedResponses) {
+	ReadAheadStream<2> stream{1, 0, wrapMemory(_storage), 100, 1};
+	EXPECT_TRUE(stream.onResponse(1, fileData(0, 100)).isError());
+
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	ASSERT_EQ(2u, stream.writeRequests(batch));
+	EXPECT_TRUE(stream.owns(2));
+	EXPECT_FALSE(stream.owns(3));
+	EXPECT_TRUE(stream.onResponse(3, fileData(0, 100)).isError());
+	EXPECT_TRUE(stream.onResponse(1, fileData(0, 101)).isError());
+
+	ASSERT_TRUE(stream.onResponse(1, fileData(0, 100)).isOk());
+	EXPECT_TRUE(stream.onResponse(1, fileData(0, 100)).isError());
+}
+
+
+TEST_F(IoStreamTest, writeBehindSendsFullChunks) {
+	WriteBehindStream<4> stream{1, 1000, wrapMemory(_storage), 100, 1};
+
+	EXPECT_EQ(250u, stream.write(wrapMemory(_file).slice(0, 250)));
+	EXPECT_EQ(1250u, stream.position());
+
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	EXPECT_EQ(2u, stream.writeRequests(batch));
+
+	stream.flush();
+	EXPECT_EQ(1u, stream.writeRequests(batch));
+	EXPECT_EQ(3u, stream.inFlight());
+
+	auto const messages = sent();
+	ASSERT_EQ(3u, messages.size());
+	for (uint32 i = 0; i < messages.size(); ++i) {
+		auto const& write = std::get<Request::Write>(messages[i].second);
+		EXPECT_EQ(1 + i, messages[i].first);
+		EXPECT_EQ(1000 + i * 100u, write.offset);
+		EXPECT_EQ(wrapMemory(_file).slice(i * 100, std::min(i * 100 + 100, 250u)), write.data);
+	}
+
+	// Next chunk starts after the partial one.
+	EXPECT_EQ(10u, stream.write(wrapMemory(_file).slice(250, 260)));
+	stream.flush();
+	MessageBatch nextBatch{_writer, kMaxMesssageSize};
+	EXPECT_EQ(1u, stream.writeRequests(nextBatch));
+	auto const next = sent();
+	ASSERT_EQ(1u, next.size());
+	EXPECT_EQ(1250u, std::get<Request::Write>(next[0].second).offset);
+}
+
+
+TEST_F(IoStreamTest, writeBehindWindowIsLimited) {
+	WriteBehindStream<2> stream{1, 0, wrapMemory(_storage), 100, 1};
+
+	EXPECT_EQ(200u, stream.write(wrapMemory(_file)));
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	EXPECT_EQ(2u, stream.writeRequests(batch));
+	EXPECT_EQ(0u, stream.write(wrapMemory(_file).slice(200, 300)));
+
+	// Acknowledgements out of order: the second slot can not be re-used before the first one.
+	ASSERT_TRUE(stream.onResponse(2, Response::Write{100}).isOk());
+	EXPECT_EQ(0u, stream.bytesCommitted());
+	EXPECT_EQ(0u, stream.write(wrapMemory(_file).slice(200, 300)));
+
+	ASSERT_TRUE(stream.onResponse(1, Response::Write{100}).isOk());
+	EXPECT_EQ(200u, stream.bytesCommitted());
+	EXPECT_TRUE(stream.idle());
+	EXPECT_EQ(100u, stream.write(wrapMemory(_file).slice(200, 300)));
+	EXPECT_FALSE(stream.idle());
+}
+
+
+TEST_F(IoStreamTest, writeBehindFailsOnShortWrite) {
+	WriteBehindStream<4> stream{1, 0, wrapMemory(_storage), 100, 1};
+
+	EXPECT_EQ(300u, stream.write(wrapMemory(_file).slice(0, 300)));
+	MessageBatch batch{_writer, kMaxMesssageSize};
+	EXPECT_EQ(3u, stream.writeRequests(batch));
+
+	ASSERT_TRUE(stream.onResponse(2, Response::Write{30}).isOk());
+	EXPECT_TRUE(stream.failed());
+	EXPECT_EQ(0u, stream.write(wrapMemory(_file).slice(300, 310)));
+
+	ASSERT_TRUE(stream.onResponse(1, Response::Write{100}).isOk());
+	ASSERT_TRUE(stream.onError(3).isOk());
+
+	EXPECT_TRUE(stream.idle());
+	EXPECT_EQ(130u, stream.bytesCommitted());
+	EXPECT_TRUE(stream.onResponse(3, Response::Write{100}).isError());
+}
+
+
+TEST_F(IoStreamTest, writeBehindOutOfLine) {
+	WriteBehindStream<4> stream{1, 0, wrapMemory(_storage), 100, 1};
+	EXPECT_EQ(150u, stream.write(wrapMemory(_file).slice(0, 150)));
+	stream.flush();
+
+	auto const first = stream.writeNext(_writer);
+	EXPECT_EQ(wrapMemory(_file).slice(0, 100), first.payload);
+	_writer.clear();
+
+	auto const second = stream.writeNext(_writer);
+	EXPECT_EQ(wrapMemory(_file).slice(100, 150), second.payload);
+	_writer.clear();
+
+	EXPECT_EQ(0u, stream.writeNext(_writer).size());
+	EXPECT_EQ(2u, stream.inFlight());
+}
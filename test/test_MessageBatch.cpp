@@ -0,0 +1,131 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_MessageBatch.cpp
+ *
+ *******************************************************************************/
+#include "styxe/messageBatch.hpp"  // Class being tested
+#include "styxe/messageLayout.hpp"
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+class MessageBatchTest : public ::testing::Test {
+protected:
+
+	void SetUp() override {
+		_writer.clear();
+	}
+
+	/// Parse all the requests in the sealed buffer and collect their tags.
+	std::vector<Tag> parseTags(ByteWriter& sealed) const {
+		std::vector<Tag> tags;
+		ByteReader reader{sealed.viewRemaining()};
+		auto result = _parser.parseRequests(reader, [&tags](MessageHeader const& header, RequestMessage&&) {
+			tags.push_back(header.tag);
+		});
+		EXPECT_TRUE(result.isOk());
+		EXPECT_EQ(0u, reader.remaining());
+
+		return tags;
+	}
+
+protected:
+	Parser			_parser;
+	byte			_buffer[4096];
+	ByteWriter		_writer{wrapMemory(_buffer)};
+};
+
+
+TEST_F(MessageBatchTest, pipelineRequests) {
+	MessageBatch batch{_writer, _parser.maxNegotiatedMessageSize()};
+	EXPECT_TRUE(batch.empty());
+
+	for (Tag tag = 0; tag < 64; ++tag) {
+		ASSERT_TRUE(batch.add(batch.request(tag).read(42, tag * 4096, 4096)));
+	}
+
+	EXPECT_EQ(64u, batch.size());
+	EXPECT_EQ(64 * MessageLayout<Request::Read>::kFrameSize, batch.bytes());
+
+	auto const tags = parseTags(batch.seal());
+	ASSERT_EQ(64u, tags.size());
+	for (Tag tag = 0; tag < 64; ++tag) {
+		EXPECT_EQ(tag, tags[tag]);
+	}
+}
+
+
+TEST_F(MessageBatchTest, mixedMessagesAreCompletedInPlace) {
+	MessageBatch batch{_writer, _parser.maxNegotiatedMessageSize()};
+
+	ASSERT_TRUE(batch.add(batch.request(1).walk(1, 2).path("some").path("where").done()));
+	ASSERT_TRUE(batch.add(batch.request(2).write(2, 0).data(wrapMemory(_buffer).slice(0, 100))));
+	ASSERT_TRUE(batch.add(batch.request(3).clunk(2)));
+
+	auto const tags = parseTags(batch.seal());
+	EXPECT_EQ((std::vector<Tag>{1, 2, 3}), tags);
+}
+
+
+TEST_F(MessageBatchTest, stopsAtBudget) {
+	auto const frameSize = MessageLayout<Request::Read>::kFrameSize;
+	MessageBatch batch{_writer, _parser.maxNegotiatedMessageSize(), 3 * frameSize + frameSize / 2};
+
+	for (Tag tag = 0; tag < 3; ++tag) {
+		ASSERT_TRUE(batch.fits(frameSize));
+		ASSERT_TRUE(batch.add(batch.request(tag).read(42, 0, 128)));
+	}
+
+	EXPECT_FALSE(batch.fits(frameSize));
+	EXPECT_FALSE(batch.add(batch.request(3).read(42, 0, 128)));
+	EXPECT_EQ(3u, batch.size());
+	EXPECT_EQ(3 * frameSize, _writer.position());
+
+	EXPECT_EQ(3u, parseTags(batch.seal()).size());
+}
+
+
+TEST_F(MessageBatchTest, oversizedMessageIsRolledBack) {
+	MessageBatch batch{_writer, 64};
+
+	ASSERT_TRUE(batch.add(batch.request(1).clunk(1)));
+	EXPECT_FALSE(batch.add(batch.request(2).write(1, 0).data(wrapMemory(_buffer).slice(0, 128))));
+	ASSERT_TRUE(batch.add(batch.request(3).clunk(3)));
+
+	auto const tags = parseTags(batch.seal());
+	EXPECT_EQ((std::vector<Tag>{1, 3}), tags);
+}
+
+
+TEST_F(MessageBatchTest, truncatedMessageIsRolledBack) {
+	byte buffer[32];
+	ByteWriter writer{wrapMemory(buffer)};
+	MessageBatch batch{writer, _parser.maxNegotiatedMessageSize()};
+
+	ASSERT_TRUE(batch.add(batch.request(1).clunk(1)));
+	EXPECT_FALSE(batch.add(batch.request(2).version("9P2000.long-version-string-that-does-not-fit", 8192)));
+	EXPECT_EQ(1u, batch.size());
+	EXPECT_EQ(MessageLayout<Request::Clunk>::kFrameSize, writer.position());
+}
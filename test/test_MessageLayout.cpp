@@ -0,0 +1,87 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_MessageLayout.cpp
+ *
+ *******************************************************************************/
+#include "styxe/messageLayout.hpp"  // Class being tested
+#include "styxe/encoder.hpp"
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+static_assert(MessageLayout<Request::Read>::kFixedSize, "TRead has a fixed layout");
+static_assert(!MessageLayout<Request::Write>::kFixedSize, "TWrite has a variable size payload");
+static_assert(MessageLayout<Request::Read>::kPayloadSize == sizeof(Fid) + sizeof(uint64) + sizeof(uint32),
+			  "TRead payload size");
+static_assert(MessageLayout<Request::Read>::offset(2) == sizeof(Fid) + sizeof(uint64), "TRead count offset");
+static_assert(MessageLayout<Response::Open>::kPayloadSize == 13 + sizeof(size_type), "ROpen payload size");
+static_assert(MessageLayout<Response::Clunk>::kFrameSize == headerSize(), "RClunk has no payload");
+
+
+TEST(MessageLayout, fixedEncodingMatchesEncoder) {
+	byte expectedBuffer[64];
+	ByteWriter expected{wrapMemory(expectedBuffer)};
+	Encoder encoder{expected};
+	encoder << makeHeaderWithPayload(MessageType::TRead, 17, 16)
+			<< Fid{42}
+			<< uint64{0x0102030405060708}
+			<< uint32{4096};
+
+	byte buffer[64];
+	ByteWriter writer{wrapMemory(buffer)};
+	auto const header = encodeFixed(writer, 17, Request::Read{42, 0x0102030405060708, 4096});
+
+	EXPECT_EQ(MessageType::TRead, header.type);
+	EXPECT_EQ(Tag{17}, header.tag);
+	EXPECT_EQ(headerSize() + 16, header.messageSize);
+	ASSERT_EQ(expected.position(), writer.position());
+	EXPECT_EQ(expected.viewWritten(), writer.viewWritten());
+}
+
+
+TEST(MessageLayout, qidRoundTrip) {
+	byte buffer[64];
+	ByteWriter writer{wrapMemory(buffer)};
+	Response::Open const message{Qid{0xAB, 0x1234, 0xFEDCBA9876543210}, 8192};
+	encodeFixed(writer, 1, message);
+	writer.flip();
+
+	ByteReader reader{writer.viewRemaining()};
+	ASSERT_TRUE(reader.advance(headerSize()));
+
+	Response::Open decoded{};
+	ASSERT_TRUE(decodeFixed(reader, decoded));
+	EXPECT_EQ(message.qid, decoded.qid);
+	EXPECT_EQ(message.iounit, decoded.iounit);
+	EXPECT_EQ(0u, reader.remaining());
+}
+
+
+TEST(MessageLayout, decodeNotEnoughData) {
+	byte buffer[3] = {1, 2, 3};
+	ByteReader reader{wrapMemory(buffer)};
+
+	Request::Clunk message{};
+	EXPECT_TRUE(decodeFixed(reader, message).isError());
+	EXPECT_EQ(0u, reader.position());
+}
@@ -0,0 +1,159 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_Metrics.cpp
+ *
+ *******************************************************************************/
+#include "styxe/metrics.hpp"  // Class being tested
+#include "styxe/requestWriter.hpp"
+#include "styxe/responseWriter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+class ProtocolMetrics : public ::testing::Test {
+protected:
+
+	void SetUp() override {
+		resetProtocolMetrics();
+		_writer.clear();
+	}
+
+	void parseAll() {
+		_writer.flip();
+		ByteReader reader{_writer.viewRemaining()};
+		auto result = _parser.parseRequests(reader, [](MessageHeader const&, RequestMessage&&) {});
+		ASSERT_TRUE(result.isOk());
+	}
+
+protected:
+	byte		_buffer[1024];
+	ByteWriter	_writer{wrapMemory(_buffer)};
+	Parser		_parser;
+};
+
+
+#if STYXE_METRICS
+
+TEST_F(ProtocolMetrics, countEncodedAndDecodedMessages) {
+	RequestWriter{_writer, 1}.clunk(3).complete();
+	RequestWriter{_writer, 2}.clunk(4).complete();
+	RequestWriter{_writer, 3}.walk(1, 2).path("some").path("where").done().complete();
+	auto const walkSize = _writer.position() - 2*(headerSize() + sizeof(Fid));
+	parseAll();
+
+	auto const metrics = protocolMetrics();
+	EXPECT_EQ(2u, metrics[MessageType::TClunk].encoded);
+	EXPECT_EQ(2u, metrics[MessageType::TClunk].decoded);
+	EXPECT_EQ(2*(headerSize() + sizeof(Fid)), metrics[MessageType::TClunk].decodedBytes);
+	EXPECT_EQ(1u, metrics[MessageType::TWalk].encoded);
+	EXPECT_EQ(walkSize, metrics[MessageType::TWalk].encodedBytes);
+	EXPECT_EQ(walkSize, metrics[MessageType::TWalk].decodedBytes);
+	EXPECT_EQ(0u, metrics[MessageType::TRead].decoded);
+}
+
+
+TEST_F(ProtocolMetrics, frameSizeHistogram) {
+	RequestWriter{_writer, 1}.clunk(3).complete();
+	parseAll();
+
+	auto const frameSize = headerSize() + sizeof(Fid);
+	auto const maxSize = _parser.maxNegotiatedMessageSize();
+	auto const metrics = protocolMetrics();
+	uint64 frames = 0;
+	for (uint32 i = 0; i < MetricsSnapshot::kFrameSizeBuckets; ++i) {
+		if (metrics.frameSizes[i] > 0) {
+			EXPECT_LE(frameSize, maxSize >> i);
+			EXPECT_GT(frameSize, maxSize >> (i + 1));
+		}
+		frames += metrics.frameSizes[i];
+	}
+	EXPECT_EQ(1u, frames);
+}
+
+
+TEST_F(ProtocolMetrics, framesAreCountedOnceComplete) {
+	RequestWriter{_writer, 1}.clunk(3).complete();
+	RequestWriter{_writer, 2}.clunk(4).complete();
+	auto const data = _writer.viewWritten();
+
+	// Second frame is incomplete: its header is parsed but the frame is left for the next call.
+	ByteReader partial{data.slice(0, data.size() - 1)};
+	EXPECT_TRUE(_parser.parseRequests(partial, [](MessageHeader const&, RequestMessage&&) {}).isOk());
+
+	ByteReader rest{data.slice(partial.position(), data.size())};
+	EXPECT_TRUE(_parser.parseRequests(rest, [](MessageHeader const&, RequestMessage&&) {}).isOk());
+
+	// Header parsed on its own does not count as a frame received.
+	ByteReader headerOnly{data};
+	EXPECT_TRUE(_parser.parseMessageHeader(headerOnly).isOk());
+
+	auto const metrics = protocolMetrics();
+	uint64 frames = 0;
+	for (auto count : metrics.frameSizes) {
+		frames += count;
+	}
+	EXPECT_EQ(2u, frames);
+}
+
+
+TEST_F(ProtocolMetrics, countErrors) {
+	byte data[2] = {1, 2};
+	ByteReader reader{wrapMemory(data)};
+	EXPECT_TRUE(_parser.parseMessageHeader(reader).isError());
+
+	auto const metrics = protocolMetrics();
+	EXPECT_EQ(1u, metrics[CannedError::IllFormedHeader]);
+	EXPECT_EQ(0u, metrics[CannedError::NotEnoughData]);
+}
+
+
+TEST_F(ProtocolMetrics, metricsOfExitedThreadsAreKept) {
+	std::thread worker{[]() {
+		byte buffer[64];
+		ByteWriter writer{wrapMemory(buffer)};
+		ResponseWriter{writer, 1}.clunk().build();
+	}};
+	worker.join();
+
+	RequestWriter{_writer, 1}.clunk(3).build();
+	EXPECT_EQ(1u, protocolMetrics()[MessageType::RClunk].encoded);
+	EXPECT_EQ(1u, protocolMetrics()[MessageType::TClunk].encoded);
+
+	resetProtocolMetrics();
+	EXPECT_EQ(0u, protocolMetrics()[MessageType::RClunk].encoded);
+}
+
+#else
+
+TEST_F(ProtocolMetrics, disabledMetricsAreZero) {
+	RequestWriter{_writer, 1}.clunk(3).complete();
+	parseAll();
+
+	EXPECT_FALSE(kMetricsEnabled);
+	auto const metrics = protocolMetrics();
+	EXPECT_EQ(0u, metrics[MessageType::TClunk].encoded);
+	EXPECT_EQ(0u, metrics[MessageType::TClunk].decoded);
+}
+
+#endif  // STYXE_METRICS
@@ -0,0 +1,412 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_PipelinedClient.cpp
+ *
+ *******************************************************************************/
+#include "styxe/pipelinedClient.hpp"  // Class being tested
+#include "styxe/responseWriter.hpp"
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace {
+
+struct Completed {
+	Tag		tag;
+	bool	isOk;
+	size_t	messageIndex;
+};
+
+
+struct Recorder {
+	void operator() (Tag tag, Result<ResponseMessage, Error>&& response) {
+		completed.push_back(Completed{tag, response.isOk(), response ? response.unwrap().index() : 0});
+	}
+
+	std::vector<Completed> completed;
+};
+
+
+/// Transport that accepts at most a given number of bytes per send.
+struct TrickleTransport {
+	Result<ByteWriter::size_type, Error> send(MemoryView data) {
+		auto const n = std::min<ByteWriter::size_type>(data.size(), maxChunk);
+		sent.insert(sent.end(), data.begin(), data.begin() + n);
+		return Result<ByteWriter::size_type, Error>{types::okTag, n};
+	}
+
+	ByteWriter::size_type maxChunk;
+	std::vector<byte> sent;
+};
+
+}  // namespace
+
+
+class PipelinedClientTest : public ::testing::Test {
+protected:
+
+	void SetUp() override {
+		_responses.clear();
+	}
+
+	/// Parse requests sent by the client.
+	std::vector<MessageHeader> requestsSent(MemoryView data) const {
+		std::vector<MessageHeader> headers;
+		ByteReader reader{data};
+		auto result = _serverParser.parseRequests(reader, [&](MessageHeader const& header, RequestMessage&&) {
+			headers.push_back(header);
+		});
+		EXPECT_TRUE(result.isOk());
+
+		return headers;
+	}
+
+	ResponseWriter respond(Tag tag) { return ResponseWriter{_responses, tag}; }
+
+	void complete(TypedWriter message) {
+		message.complete();
+	}
+
+	MemoryView responses() const { return _responses.viewWritten(); }
+
+protected:
+	Parser				_parser;
+	Parser				_serverParser;
+	byte				_outBuffer[1024];
+	byte				_staging[1024];
+	byte				_responseBuffer[1024];
+	ByteWriter			_responses{wrapMemory(_responseBuffer)};
+	Recorder			_recorder;
+};
+
+
+TEST_F(PipelinedClientTest, requestsArePipelinedWithDistinctTags) {
+	PipelinedClient<> client{_parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+	StringView const path[] = {StringView{"some"}, StringView{"file"}};
+
+	auto const walkTag = client.walk(1, 2, path, makeCompletion(_recorder));
+	auto const readTag = client.read(2, 0, 512, makeCompletion(_recorder));
+	auto const statTag = client.stat(2, makeCompletion(_recorder));
+	EXPECT_EQ(3u, client.inFlight());
+
+	auto const sent = requestsSent(client.outbound());
+	ASSERT_EQ(3u, sent.size());
+	EXPECT_EQ(MessageType::TWalk, sent[0].type);
+	EXPECT_EQ(walkTag, sent[0].tag);
+	EXPECT_EQ(MessageType::TRead, sent[1].type);
+	EXPECT_EQ(readTag, sent[1].tag);
+	EXPECT_EQ(MessageType::TStat, sent[2].type);
+	EXPECT_EQ(statTag, sent[2].tag);
+	EXPECT_NE(walkTag, readTag);
+	EXPECT_NE(readTag, statTag);
+
+	client.consumed(client.outbound().size());
+	EXPECT_EQ(0u, client.outbound().size());
+}
+
+
+TEST_F(PipelinedClientTest, responsesAreRoutedByTag) {
+	PipelinedClient<> client{_parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+	StringView const path[] = {StringView{"file"}};
+
+	auto const walkTag = client.walk(1, 2, path, makeCompletion(_recorder));
+	auto const openTag = client.open(2, OpenMode::READ, makeCompletion(_recorder));
+	auto const readTag = client.read(2, 0, 512, makeCompletion(_recorder));
+
+	// Server responds out of order
+	byte data[] = {1, 2, 3};
+	complete(respond(readTag).read(wrapMemory(data)));
+	complete(respond(walkTag).walk(ArrayView<Qid>{}));
+	complete(respond(openTag).open(Qid{0, 1, 2}, 0));
+
+	ASSERT_TRUE(client.receive(responses()).isOk());
+	ASSERT_EQ(3u, _recorder.completed.size());
+	EXPECT_EQ(readTag, _recorder.completed[0].tag);
+	EXPECT_EQ(walkTag, _recorder.completed[1].tag);
+	EXPECT_EQ(openTag, _recorder.completed[2].tag);
+	for (auto const& completed : _recorder.completed) {
+		EXPECT_TRUE(completed.isOk);
+	}
+
+	EXPECT_EQ(ResponseMessage{Response::Read{}}.index(), _recorder.completed[0].messageIndex);
+	EXPECT_EQ(ResponseMessage{Response::Walk{}}.index(), _recorder.completed[1].messageIndex);
+	EXPECT_EQ(0u, client.inFlight());
+}
+
+
+TEST_F(PipelinedClientTest, responsesSplitAcrossChunks) {
+	PipelinedClient<> client{_parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+	auto const clunkTag = client.clunk(1, makeCompletion(_recorder));
+	auto const removeTag = client.remove(2, makeCompletion(_recorder));
+
+	complete(respond(removeTag).remove());
+	complete(respond(clunkTag).clunk());
+
+	auto const data = responses();
+	for (MemoryView::size_type i = 0; i < data.size(); ++i) {
+		ASSERT_TRUE(client.receive(data.slice(i, i + 1)).isOk());
+	}
+
+	ASSERT_EQ(2u, _recorder.completed.size());
+	EXPECT_EQ(removeTag, _recorder.completed[0].tag);
+	EXPECT_EQ(clunkTag, _recorder.completed[1].tag);
+}
+
+
+TEST_F(PipelinedClientTest, versionNegotiatesMessageSize) {
+	Parser parser{kLargeMessageSize};
+	PipelinedClient<> client{parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+
+	EXPECT_TRUE(client.version(Parser::PROTOCOL_VERSION, kLargeMessageSize, makeCompletion(_recorder)));
+	EXPECT_FALSE(client.version(Parser::PROTOCOL_VERSION, kLargeMessageSize, makeCompletion(_recorder)));
+
+	auto const sent = requestsSent(client.outbound());
+	ASSERT_EQ(1u, sent.size());
+	EXPECT_EQ(Parser::NO_TAG, sent[0].tag);
+
+	complete(respond(Parser::NO_TAG).version(Parser::PROTOCOL_VERSION, 64*1024));
+	ASSERT_TRUE(client.receive(responses()).isOk());
+
+	ASSERT_EQ(1u, _recorder.completed.size());
+	EXPECT_TRUE(_recorder.completed[0].isOk);
+	EXPECT_EQ(64*1024u, parser.maxNegotiatedMessageSize());
+	EXPECT_EQ(ProtocolVersion::V9P2000E, parser.negotiatedVersion());
+	EXPECT_TRUE(client.version(Parser::PROTOCOL_VERSION, kLargeMessageSize, makeCompletion(_recorder)));
+}
+
+
+TEST_F(PipelinedClientTest, compressedResponsesAreDecompressed) {
+	Parser parser{kMaxMesssageSize, "9P2000.e+lz4"};
+	byte decompressed[1024];
+	PipelinedClient<> client{parser, wrapMemory(_outBuffer), wrapMemory(_staging), wrapMemory(decompressed)};
+
+	ASSERT_TRUE(client.version("9P2000.e+lz4", kMaxMesssageSize, makeCompletion(_recorder)));
+	complete(respond(Parser::NO_TAG).version("9P2000.e+lz4", kMaxMesssageSize));
+	ASSERT_TRUE(client.receive(responses()).isOk());
+	EXPECT_EQ(PayloadCompression::LZ4, parser.negotiatedCompression());
+	EXPECT_EQ(StringView{"9P2000.e+lz4"}, parser.getNegotiatedVersion());
+
+	std::vector<byte> data;
+	auto onRead = [&data](Tag, Result<ResponseMessage, Error>&& response) {
+		ASSERT_TRUE(response.isOk());
+		auto const& read = std::get<Response::Read>(response.unwrap());
+		data.assign(read.data.begin(), read.data.end());
+	};
+	auto const tag = client.read(1, 0, 512, makeCompletion(onRead));
+
+	char text[200];
+	for (size_t i = 0; i < sizeof(text); ++i) {
+		text[i] = "9P9P2000"[i % 8];
+	}
+	_responses.clear();
+	ResponseWriter{_responses, tag, CompressionPolicy{PayloadCompression::LZ4, 16}}
+			.read(wrapMemory(text, sizeof(text)))
+			.complete();
+	EXPECT_LT(_responses.position(), sizeof(text));  // Data has been sent compressed
+	ASSERT_TRUE(client.receive(responses()).isOk());
+
+	ASSERT_EQ(sizeof(text), data.size());
+	EXPECT_EQ(0, std::memcmp(text, data.data(), sizeof(text)));
+}
+
+
+TEST_F(PipelinedClientTest, capacityIsLimited) {
+	PipelinedClient<2> client{_parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+
+	auto const first = client.clunk(1, makeCompletion(_recorder));
+	EXPECT_NE(Parser::NO_TAG, first);
+	EXPECT_NE(Parser::NO_TAG, client.clunk(2, makeCompletion(_recorder)));
+
+	auto const outboundSize = client.outbound().size();
+	EXPECT_EQ(Parser::NO_TAG, client.clunk(3, makeCompletion(_recorder)));
+	EXPECT_EQ(outboundSize, client.outbound().size());
+
+	complete(respond(first).clunk());
+	ASSERT_TRUE(client.receive(responses()).isOk());
+	EXPECT_EQ(first, client.clunk(3, makeCompletion(_recorder)));
+}
+
+
+TEST_F(PipelinedClientTest, requestThatDoesNotFitIsRolledBack) {
+	PipelinedClient<> client{_parser, wrapMemory(_outBuffer).slice(0, 64), wrapMemory(_staging)};
+	byte data[64] = {};
+
+	EXPECT_NE(Parser::NO_TAG, client.clunk(1, makeCompletion(_recorder)));
+	EXPECT_EQ(Parser::NO_TAG, client.write(1, 0, wrapMemory(data), makeCompletion(_recorder)));
+	EXPECT_EQ(1u, client.inFlight());
+	EXPECT_EQ(1u, requestsSent(client.outbound()).size());
+
+	StringView const path[] = {StringView{"a-rather-long-path-segment"}, StringView{"another-path-segment"}};
+	EXPECT_EQ(Parser::NO_TAG, client.walk(1, 2, path, makeCompletion(_recorder)));
+	EXPECT_EQ(1u, client.inFlight());
+
+	client.consumed(client.outbound().size());
+	EXPECT_NE(Parser::NO_TAG, client.write(1, 0, wrapMemory(data).slice(0, 32), makeCompletion(_recorder)));
+}
+
+
+TEST_F(PipelinedClientTest, completionMayEnqueueRequests) {
+	PipelinedClient<> client{_parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+
+	struct ReadNext {
+		void operator() (Tag, Result<ResponseMessage, Error>&&) {
+			nextTag = client.read(1, 512, 512, makeCompletion(recorder));
+		}
+
+		PipelinedClient<>& client;
+		Recorder& recorder;
+		Tag nextTag{Parser::NO_TAG};
+	} readNext{client, _recorder};
+
+	auto const tag = client.read(1, 0, 512, makeCompletion(readNext));
+	client.consumed(client.outbound().size());
+
+	complete(respond(tag).read(MemoryView{}));
+	ASSERT_TRUE(client.receive(responses()).isOk());
+
+	EXPECT_EQ(tag, readNext.nextTag);  // Tag is released before the completion is called and is reused
+	EXPECT_EQ(1u, client.inFlight());
+	EXPECT_EQ(1u, requestsSent(client.outbound()).size());
+}
+
+
+TEST_F(PipelinedClientTest, flushCompletesFlushedRequest) {
+	PipelinedClient<> client{_parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+
+	auto const readTag = client.read(1, 0, 512, makeCompletion(_recorder));
+	auto const flushTag = client.flush(readTag, makeCompletion(_recorder));
+	EXPECT_EQ(2u, client.inFlight());
+
+	complete(respond(flushTag).flush());
+	ASSERT_TRUE(client.receive(responses()).isOk());
+
+	ASSERT_EQ(2u, _recorder.completed.size());
+	EXPECT_EQ(flushTag, _recorder.completed[0].tag);
+	EXPECT_TRUE(_recorder.completed[0].isOk);
+	EXPECT_EQ(readTag, _recorder.completed[1].tag);
+	EXPECT_FALSE(_recorder.completed[1].isOk);
+	EXPECT_EQ(0u, client.inFlight());
+}
+
+
+TEST_F(PipelinedClientTest, flushAfterResponse) {
+	PipelinedClient<> client{_parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+
+	auto const readTag = client.read(1, 0, 512, makeCompletion(_recorder));
+	auto const flushTag = client.flush(readTag, makeCompletion(_recorder));
+
+	complete(respond(readTag).read(MemoryView{}));
+	complete(respond(flushTag).flush());
+	ASSERT_TRUE(client.receive(responses()).isOk());
+
+	ASSERT_EQ(2u, _recorder.completed.size());
+	EXPECT_TRUE(_recorder.completed[0].isOk);
+	EXPECT_TRUE(_recorder.completed[1].isOk);
+	EXPECT_EQ(0u, client.inFlight());
+}
+
+
+TEST_F(PipelinedClientTest, flushedTagIsNotReusedBeforeRFlush) {
+	PipelinedClient<> client{_parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+
+	auto const readTag = client.read(1, 0, 512, makeCompletion(_recorder));
+	auto const flushTag = client.flush(readTag, makeCompletion(_recorder));
+
+	complete(respond(readTag).read(MemoryView{}));
+	ASSERT_TRUE(client.receive(responses()).isOk());
+	ASSERT_EQ(1u, _recorder.completed.size());
+	EXPECT_EQ(readTag, _recorder.completed[0].tag);
+	EXPECT_TRUE(_recorder.completed[0].isOk);
+
+	// Tag of the flushed request is still reserved
+	EXPECT_TRUE(client.isPending(readTag));
+	auto const nextTag = client.read(1, 512, 512, makeCompletion(_recorder));
+	EXPECT_NE(Parser::NO_TAG, nextTag);
+	EXPECT_NE(readTag, nextTag);
+
+	_responses.clear();
+	complete(respond(flushTag).flush());
+	ASSERT_TRUE(client.receive(responses()).isOk());
+
+	ASSERT_EQ(2u, _recorder.completed.size());
+	EXPECT_EQ(flushTag, _recorder.completed[1].tag);
+	EXPECT_TRUE(_recorder.completed[1].isOk);
+	EXPECT_FALSE(client.isPending(readTag));
+	EXPECT_TRUE(client.isPending(nextTag));
+	EXPECT_EQ(1u, client.inFlight());
+
+	// Only the new request is completed by its response
+	_responses.clear();
+	complete(respond(nextTag).read(MemoryView{}));
+	ASSERT_TRUE(client.receive(responses()).isOk());
+	ASSERT_EQ(3u, _recorder.completed.size());
+	EXPECT_EQ(nextTag, _recorder.completed[2].tag);
+	EXPECT_TRUE(_recorder.completed[2].isOk);
+	EXPECT_EQ(0u, client.inFlight());
+}
+
+
+TEST_F(PipelinedClientTest, abortCompletesAllWithError) {
+	PipelinedClient<> client{_parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+
+	client.version(Parser::PROTOCOL_VERSION, kMaxMesssageSize, makeCompletion(_recorder));
+	client.clunk(1, makeCompletion(_recorder));
+	client.clunk(2, makeCompletion(_recorder));
+
+	client.abort(getCannedError(CannedError::NotEnoughData));
+	ASSERT_EQ(3u, _recorder.completed.size());
+	for (auto const& completed : _recorder.completed) {
+		EXPECT_FALSE(completed.isOk);
+	}
+
+	EXPECT_EQ(0u, client.inFlight());
+}
+
+
+TEST_F(PipelinedClientTest, unexpectedResponsesAreIgnored) {
+	PipelinedClient<> client{_parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+
+	complete(respond(17).clunk());
+	complete(respond(Parser::NO_TAG).version(Parser::PROTOCOL_VERSION, 1024));
+	ASSERT_TRUE(client.receive(responses()).isOk());
+
+	EXPECT_TRUE(_recorder.completed.empty());
+	EXPECT_EQ(2u, client.unexpectedResponses());
+}
+
+
+TEST_F(PipelinedClientTest, sendThroughTransport) {
+	PipelinedClient<> client{_parser, wrapMemory(_outBuffer), wrapMemory(_staging)};
+	client.read(1, 0, 512, makeCompletion(_recorder));
+	client.stat(1, makeCompletion(_recorder));
+
+	std::vector<byte> expected(client.outbound().begin(), client.outbound().end());
+	TrickleTransport transport{5, {}};
+	ASSERT_TRUE(client.send(transport).isOk());
+
+	EXPECT_EQ(expected, transport.sent);
+	EXPECT_EQ(0u, client.outbound().size());
+}
@@ -0,0 +1,178 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_QidCache.cpp
+ *
+ *******************************************************************************/
+#include "styxe/qidCache.hpp"  // Class being tested
+#include "styxe/responseWriter.hpp"
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace {
+
+Qid const kRoot{0x80, 1, 1};
+
+Stat makeStat(Qid qid, StringView name) {
+	Stat stat{0, 1, 2, qid, 0644, 11, 12, 1024, name, StringLiteral{"user"}, StringLiteral{"group"}, StringLiteral{"user"}};
+	stat.size = DirListingWriter::sizeStat(stat);
+
+	return stat;
+}
+
+}  // namespace
+
+
+TEST(WalkCache, missOnEmptyCache) {
+	WalkCache<16> cache;
+	EXPECT_EQ(nullptr, cache.find(kRoot, "etc", IndexedWalkPath::hashOf("etc")));
+	EXPECT_EQ(0u, cache.size());
+}
+
+
+TEST(WalkCache, findCachedWalk) {
+	WalkCache<16> cache;
+	Qid const etc{0x80, 1, 17};
+	Qid const usr{0x80, 3, 18};
+	ASSERT_TRUE(cache.insert(kRoot, "etc", IndexedWalkPath::hashOf("etc"), etc));
+	ASSERT_TRUE(cache.insert(kRoot, "usr", IndexedWalkPath::hashOf("usr"), usr));
+	EXPECT_EQ(2u, cache.size());
+
+	auto cached = cache.find(kRoot, "usr", IndexedWalkPath::hashOf("usr"));
+	ASSERT_NE(nullptr, cached);
+	EXPECT_EQ(usr, *cached);
+
+	cached = cache.find(kRoot, "etc", IndexedWalkPath::hashOf("etc"));
+	ASSERT_NE(nullptr, cached);
+	EXPECT_EQ(etc, *cached);
+
+	// Same name resolved in a different directory
+	EXPECT_EQ(nullptr, cache.find(etc, "usr", IndexedWalkPath::hashOf("usr")));
+}
+
+
+TEST(WalkCache, directoryVersionChangeInvalidatesEntry) {
+	WalkCache<16> cache;
+	ASSERT_TRUE(cache.insert(kRoot, "etc", IndexedWalkPath::hashOf("etc"), Qid{0x80, 1, 17}));
+
+	Qid changedRoot = kRoot;
+	changedRoot.version += 1;
+	EXPECT_EQ(nullptr, cache.find(changedRoot, "etc", IndexedWalkPath::hashOf("etc")));
+	EXPECT_EQ(0u, cache.size());
+	EXPECT_EQ(nullptr, cache.find(kRoot, "etc", IndexedWalkPath::hashOf("etc")));
+}
+
+
+TEST(WalkCache, longNamesAreNotCached) {
+	WalkCache<16, 4> cache;
+	EXPECT_FALSE(cache.insert(kRoot, "longname", IndexedWalkPath::hashOf("longname"), Qid{0, 1, 17}));
+	EXPECT_EQ(0u, cache.size());
+}
+
+
+TEST(WalkCache, boundedCapacity) {
+	WalkCache<4> cache;
+	char names[32][2];
+	for (uint32 i = 0; i < 32; ++i) {
+		names[i][0] = static_cast<char>('A' + i);
+		names[i][1] = 0;
+		StringView name{names[i], 1};
+		ASSERT_TRUE(cache.insert(kRoot, name, IndexedWalkPath::hashOf(name), Qid{0, 0, i}));
+		EXPECT_LE(cache.size(), cache.capacity());
+	}
+
+	// Most recently inserted entry is always found
+	StringView last{names[31], 1};
+	auto cached = cache.find(kRoot, last, IndexedWalkPath::hashOf(last));
+	ASSERT_NE(nullptr, cached);
+	EXPECT_EQ(31u, cached->path);
+}
+
+
+TEST(WalkCache, findIndexedPathSegment) {
+	byte buffer[128];
+	ByteWriter encoded{wrapMemory(buffer)};
+	for (auto segment : {StringView{"usr"}, StringView{"lib"}}) {
+		encoded.writeLE(narrow_cast<var_datum_size_type>(segment.size()));
+		encoded.write(segment.view());
+	}
+
+	IndexedWalkPath path;
+	ASSERT_EQ(encoded.position(), path.assign(2, encoded.viewWritten()));
+
+	WalkCache<16> cache;
+	Qid const lib{0x80, 1, 31};
+	ASSERT_TRUE(cache.insert(Qid{0x80, 0, 30}, path, 1, lib));
+
+	auto cached = cache.find(Qid{0x80, 0, 30}, "lib", IndexedWalkPath::hashOf("lib"));
+	ASSERT_NE(nullptr, cached);
+	EXPECT_EQ(lib, *cached);
+}
+
+
+TEST(StatCache, findCachedStat) {
+	StatCache<16> cache;
+	auto const stat = makeStat(Qid{0, 4, 99}, StringLiteral{"file"});
+	EXPECT_TRUE(cache.find(stat.qid).data().empty());
+
+	ASSERT_TRUE(cache.insert(stat));
+
+	auto const cached = cache.find(stat.qid);
+	ASSERT_EQ(Encoder::protocolSize(stat), cached.data().size());
+	EXPECT_EQ(stat, cached.decode());
+}
+
+
+TEST(StatCache, versionChangeInvalidatesEntry) {
+	StatCache<16> cache;
+	auto const stat = makeStat(Qid{0, 4, 99}, StringLiteral{"file"});
+	ASSERT_TRUE(cache.insert(stat));
+
+	EXPECT_TRUE(cache.find(Qid{0, 5, 99}).data().empty());
+	EXPECT_EQ(0u, cache.size());
+}
+
+
+TEST(StatCache, largeStatsAreNotCached) {
+	StatCache<16, 48> cache;
+	EXPECT_FALSE(cache.insert(makeStat(Qid{0, 4, 99}, StringLiteral{"file"})));
+	EXPECT_EQ(0u, cache.size());
+}
+
+
+TEST(StatCache, cachedStatResponseMatchesEncoded) {
+	StatCache<16> cache;
+	auto const stat = makeStat(Qid{0, 4, 99}, StringLiteral{"file"});
+	ASSERT_TRUE(cache.insert(stat));
+
+	byte expectedBuffer[256];
+	ByteWriter expected{wrapMemory(expectedBuffer)};
+	ResponseWriter{expected, 7}.stat(stat).build();
+
+	byte cachedBuffer[256];
+	ByteWriter cached{wrapMemory(cachedBuffer)};
+	ResponseWriter{cached, 7}.stat(cache.find(stat.qid)).build();
+
+	ASSERT_EQ(expected.limit(), cached.limit());
+	EXPECT_EQ(0, std::memcmp(expectedBuffer, cachedBuffer, expected.limit()));
+}
@@ -0,0 +1,185 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_SharedRing.cpp
+ *
+ *******************************************************************************/
+#include "styxe/sharedRing.hpp"  // Class being tested
+#include "styxe/requestWriter.hpp"
+#include "styxe/messageLayout.hpp"
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+class SharedRing : public ::testing::Test {
+protected:
+
+	void SetUp() override {
+		ASSERT_EQ(kCapacity, initializeSharedRing(memory()));
+	}
+
+	MutableMemoryView memory() noexcept { return wrapMemory(_memory); }
+
+	/// Write a clunk request into the ring, returning false if the ring is full.
+	bool sendClunk(RingProducer& ring, Tag tag, Fid fid) {
+		auto slot = ring.reserve(64);
+		if (slot.empty()) {
+			return false;
+		}
+
+		ByteWriter writer{slot};
+		RequestWriter{writer, tag}.clunk(fid).build();
+		ring.commit(narrow_cast<size_type>(writer.viewRemaining().size()));
+
+		return true;
+	}
+
+	/// Receive all the clunk requests from the ring, recording fids.
+	uint32 receiveClunks(RingConsumer& ring, std::vector<Fid>& fids) {
+		auto result = ring.receive([&](MessageHeader const& header, ByteReader& payload) {
+			auto request = _parser.parseRequest(header, payload);
+			ASSERT_TRUE(request.isOk());
+			ASSERT_TRUE(std::holds_alternative<Request::Clunk>(*request));
+			fids.push_back(std::get<Request::Clunk>(*request).fid);
+		});
+		EXPECT_TRUE(result.isOk());
+
+		return result ? *result : 0;
+	}
+
+protected:
+	static constexpr size_type kCapacity = 256;
+
+	Parser												_parser;
+	alignas(kRingCacheLineSize) byte					_memory[sharedRingMemorySize(kCapacity) + 32];
+};
+
+constexpr size_type SharedRing::kCapacity;
+
+
+TEST_F(SharedRing, capacity) {
+	EXPECT_EQ(32u*1024, sharedRingCapacity(8*1024));
+	EXPECT_EQ(16u*1024, sharedRingCapacity(8*1024, 2));
+	EXPECT_EQ(64u, sharedRingCapacity(17, 1));
+	EXPECT_EQ(2u*kLargeMessageSize, sharedRingCapacity(kLargeMessageSize, 2));
+}
+
+
+TEST_F(SharedRing, messagesArePublishedInBatch) {
+	RingProducer producer{memory()};
+	RingConsumer consumer{_parser, memory()};
+	std::vector<Fid> fids;
+
+	ASSERT_TRUE(sendClunk(producer, 1, 10));
+	ASSERT_TRUE(sendClunk(producer, 2, 11));
+	EXPECT_EQ(0u, receiveClunks(consumer, fids));
+
+	producer.publish();
+	EXPECT_EQ(2u, receiveClunks(consumer, fids));
+	EXPECT_EQ((std::vector<Fid>{10, 11}), fids);
+	EXPECT_EQ(0u, receiveClunks(consumer, fids));
+}
+
+
+TEST_F(SharedRing, messagesWrapAround) {
+	RingProducer producer{memory()};
+	RingConsumer consumer{_parser, memory()};
+	std::vector<Fid> fids;
+
+	// Clunk is 11 bytes, occupying 16 bytes of the ring: no full number of messages fits a traversal of the ring.
+	Fid nextFid = 0;
+	for (int round = 0; round < 20; ++round) {
+		for (int i = 0; i < 5; ++i) {
+			ASSERT_TRUE(sendClunk(producer, 1, nextFid++));
+		}
+
+		producer.publish();
+		EXPECT_EQ(5u, receiveClunks(consumer, fids));
+		consumer.publish();
+	}
+
+	ASSERT_EQ(nextFid, fids.size());
+	for (Fid i = 0; i < nextFid; ++i) {
+		EXPECT_EQ(i, fids[i]);
+	}
+}
+
+
+TEST_F(SharedRing, fullRingRejectsReservation) {
+	RingProducer producer{memory()};
+	RingConsumer consumer{_parser, memory()};
+	std::vector<Fid> fids;
+
+	uint32 sent = 0;
+	while (sendClunk(producer, 1, sent)) {
+		sent += 1;
+	}
+	EXPECT_EQ((kCapacity - 64) / 16 + 1, sent);
+	EXPECT_TRUE(producer.reserve(64).empty());
+	EXPECT_TRUE(producer.reserve(kCapacity + 1).empty());
+	EXPECT_TRUE(producer.prepareWait(64));
+
+	producer.publish();
+	EXPECT_EQ(sent, receiveClunks(consumer, fids));
+	EXPECT_TRUE(consumer.publish());  // Producer waits for space to be released
+
+	EXPECT_FALSE(producer.reserve(64).empty());
+}
+
+
+TEST_F(SharedRing, wakeupIsRequestedOnlyForWaitingConsumer) {
+	RingProducer producer{memory()};
+	RingConsumer consumer{_parser, memory()};
+
+	ASSERT_TRUE(sendClunk(producer, 1, 1));
+	EXPECT_FALSE(producer.publish());
+
+	EXPECT_FALSE(consumer.prepareWait());  // Message is already available
+
+	std::vector<Fid> fids;
+	EXPECT_EQ(1u, receiveClunks(consumer, fids));
+	EXPECT_TRUE(consumer.prepareWait());
+
+	ASSERT_TRUE(sendClunk(producer, 2, 2));
+	EXPECT_TRUE(producer.publish());
+	EXPECT_FALSE(producer.publish());  // Consumer is only woken once
+}
+
+
+TEST_F(SharedRing, illFormedFrameIsRejected) {
+	RingProducer producer{memory()};
+	RingConsumer consumer{_parser, memory()};
+
+	auto slot = producer.reserve(64);
+	ASSERT_FALSE(slot.empty());
+	WireField<size_type>::store(slot.dataAs<byte>(), 3);
+	WireField<size_type>::store(slot.dataAs<byte>(sizeof(size_type)), 0);
+	producer.commit(headerSize());
+	producer.publish();
+
+	auto result = consumer.receive([](MessageHeader const&, ByteReader&) {
+		FAIL() << "Ill-formed frame must not be handled";
+	});
+	EXPECT_TRUE(result.isError());
+}
@@ -0,0 +1,127 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_TagPool.cpp
+ *
+ *******************************************************************************/
+#include "styxe/tagPool.hpp"  // Class being tested
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+namespace {
+
+struct PendingRequest {
+	MessageType type{MessageType::TVersion};
+	Fid fid{0};
+};
+
+}  // namespace
+
+
+TEST(TagPool, allocateAndFind) {
+	auto pool = std::make_unique<TagPool<PendingRequest>>();
+	EXPECT_TRUE(pool->empty());
+
+	auto const tag = pool->allocate(PendingRequest{MessageType::TRead, 17});
+	ASSERT_NE(Parser::NO_TAG, tag);
+	EXPECT_EQ(1u, pool->size());
+	EXPECT_TRUE(pool->contains(tag));
+
+	auto pending = pool->find(tag);
+	ASSERT_NE(nullptr, pending);
+	EXPECT_EQ(MessageType::TRead, pending->type);
+	EXPECT_EQ(17u, pending->fid);
+
+	EXPECT_EQ(nullptr, pool->find(tag + 1));
+	EXPECT_EQ(nullptr, pool->find(Parser::NO_TAG));
+}
+
+
+TEST(TagPool, releaseRecyclesTags) {
+	auto pool = std::make_unique<TagPool<PendingRequest>>();
+
+	auto const first = pool->allocate({});
+	auto const second = pool->allocate({});
+	EXPECT_NE(first, second);
+
+	EXPECT_TRUE(pool->release(first));
+	EXPECT_FALSE(pool->release(first));
+	EXPECT_FALSE(pool->contains(first));
+	EXPECT_EQ(1u, pool->size());
+
+	// Most recently released tag is re-used first
+	EXPECT_EQ(first, pool->allocate({}));
+}
+
+
+TEST(TagPool, wholeTagSpaceCanBeInFlight) {
+	auto pool = std::make_unique<TagPool<PendingRequest>>();
+
+	for (uint32 i = 0; i < kMaxTagsInFlight; ++i) {
+		ASSERT_NE(Parser::NO_TAG, pool->allocate({}));
+	}
+
+	EXPECT_EQ(kMaxTagsInFlight, pool->size());
+	EXPECT_EQ(Parser::NO_TAG, pool->allocate({}));
+
+	EXPECT_TRUE(pool->release(42));
+	EXPECT_EQ(42, pool->allocate({}));
+}
+
+
+TEST(TagPool, shardsHaveDisjointRanges) {
+	TagPool<PendingRequest, 128> shard0{0};
+	TagPool<PendingRequest, 128> shard1{128};
+
+	auto const tag0 = shard0.allocate({});
+	auto const tag1 = shard1.allocate({});
+
+	EXPECT_EQ(0, (tag0 - shard0.firstId()) / shard0.capacity());
+	EXPECT_EQ(1, tag1 / shard1.capacity());
+
+	EXPECT_TRUE(shard1.contains(tag1));
+	EXPECT_FALSE(shard0.contains(tag1));
+	EXPECT_FALSE(shard1.release(tag0));
+}
+
+
+TEST(FidPool, allocateAndRelease) {
+	FidPool<DirListingCursor, 16> fids{1};
+
+	auto const fid = fids.allocate(DirListingCursor{});
+	ASSERT_NE(Parser::NOFID, fid);
+	EXPECT_EQ(1u, fid);
+
+	auto state = fids.find(fid);
+	ASSERT_NE(nullptr, state);
+	state->offset = 128;
+	EXPECT_EQ(128u, fids.find(fid)->offset);
+
+	EXPECT_TRUE(fids.release(fid));
+	EXPECT_EQ(nullptr, fids.find(fid));
+
+	// Slot is reset when released
+	EXPECT_EQ(fid, fids.allocate(DirListingCursor{}));
+	EXPECT_EQ(0u, fids.find(fid)->offset);
+}
@@ -0,0 +1,210 @@
+/*
+*  Copyright 2018 Ivan Ryabov
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*/
+/*******************************************************************************
+ * libstyxe Unit Test Suit
+ * @file: test/test_Trace.cpp
+ *
+ *******************************************************************************/
+#include "styxe/trace.hpp"  // Class being tested
+#include "styxe/requestWriter.hpp"
+#include "styxe/responseWriter.hpp"
+#include "styxe/messageBatch.hpp"
+
+#include <solace/output_utils.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+
+using namespace Solace;
+using namespace styxe;
+
+
+class Trace : public ::testing::Test {
+protected:
+
+	void TearDown() override {
+		setTraceHook({});
+	}
+
+	/// Flush callback appending trace data to the test trace.
+	static void appendTo(void* context, MemoryView data) {
+		auto& trace = *static_cast<std::vector<byte>*>(context);
+		auto const bytes = data.dataAs<byte const>();
+		trace.insert(trace.end(), bytes, bytes + data.size());
+	}
+
+	MemoryView trace() const noexcept { return wrapMemory(_trace.data(), _trace.size()); }
+
+	std::vector<TraceRecord> records() const {
+		std::vector<TraceRecord> result;
+		for (auto record : TraceReader{trace()}) {
+			result.push_back(record);
+		}
+
+		return result;
+	}
+
+protected:
+	Parser				_parser;
+	std::vector<byte>	_trace;
+	byte				_traceBuffer[512];
+	byte				_buffer[512];
+	ByteWriter			_writer{wrapMemory(_buffer)};
+};
+
+
+TEST_F(Trace, emptyTraceHasOnlyHeader) {
+	TraceWriter writer{wrapMemory(_traceBuffer), appendTo, &_trace};
+	writer.flush();
+
+	ASSERT_EQ(TraceFormat::kHeaderSize, _trace.size());
+	TraceReader reader{trace()};
+	EXPECT_TRUE(reader.validate(_parser).isOk());
+	EXPECT_NE(0u, reader.startTime());
+	EXPECT_TRUE(reader.begin() == reader.end());
+}
+
+
+TEST_F(Trace, recordsFramesParsedAndEncodedByThread) {
+	TraceWriter writer{wrapMemory(_traceBuffer), appendTo, &_trace};
+	EXPECT_FALSE(traceHook());
+	setTraceHook(writer.hook());
+
+	auto const request = RequestWriter{_writer, 1}.clunk(42).build().viewRemaining();
+	ByteReader reader{request};
+	auto header = _parser.parseMessageHeader(reader);
+	ASSERT_TRUE(header.isOk());
+	ASSERT_TRUE(_parser.parseRequest(*header, reader).isOk());
+
+	byte const data[] = {1, 2, 3, 4, 5};
+	byte responseBuffer[64];
+	ByteWriter responseWriter{wrapMemory(responseBuffer)};
+	auto const segments = ResponseWriter{responseWriter, 1}.read().build(wrapMemory(data));
+
+	setTraceHook({});
+	byte untracedBuffer[64];
+	ByteWriter untracedWriter{wrapMemory(untracedBuffer)};
+	RequestWriter{untracedWriter, 2}.clunk(43).build();
+	writer.flush();
+	EXPECT_EQ(3u, writer.frames());
+
+	ASSERT_TRUE(TraceReader{trace()}.validate(_parser).isOk());
+	auto const traced = records();
+	ASSERT_EQ(3u, traced.size());
+
+	EXPECT_EQ(TraceDirection::Sent, traced[0].direction);
+	EXPECT_EQ(request, traced[0].frame);
+	EXPECT_EQ(TraceDirection::Received, traced[1].direction);
+	EXPECT_EQ(request, traced[1].frame);
+
+	EXPECT_EQ(TraceDirection::Sent, traced[2].direction);
+	ASSERT_EQ(segments.size(), traced[2].frame.size());
+	EXPECT_EQ(segments.header, traced[2].frame.slice(0, segments.header.size()));
+	EXPECT_EQ(wrapMemory(data), traced[2].frame.slice(segments.header.size(), traced[2].frame.size()));
+
+	EXPECT_LE(traced[0].timestamp, traced[1].timestamp);
+	EXPECT_LE(traced[1].timestamp, traced[2].timestamp);
+}
+
+
+TEST_F(Trace, recordsEachPipelinedFrame) {
+	RequestWriter{_writer, 1}.clunk(42).complete();
+	RequestWriter{_writer, 2}.stat(43).complete();
+	_writer.flip();
+
+	TraceWriter writer{wrapMemory(_traceBuffer), appendTo, &_trace};
+	setTraceHook(writer.hook());
+
+	ByteReader reader{_writer.viewRemaining()};
+	ASSERT_TRUE(_parser.parseRequests(reader, [](MessageHeader const&, RequestMessage&&) {}).isOk());
+	writer.flush();
+
+	auto const traced = records();
+	ASSERT_EQ(2u, traced.size());
+	auto const frames = _writer.viewRemaining();
+	EXPECT_EQ(frames.slice(0, traced[0].frame.size()), traced[0].frame);
+	EXPECT_EQ(frames.slice(traced[0].frame.size(), frames.size()), traced[1].frame);
+	EXPECT_EQ(TraceDirection::Received, traced[0].direction);
+	EXPECT_EQ(TraceDirection::Received, traced[1].direction);
+}
+
+
+TEST_F(Trace, batchRecordsOnlyAcceptedMessages) {
+	TraceWriter writer{wrapMemory(_traceBuffer), appendTo, &_trace};
+	setTraceHook(writer.hook());
+
+	MessageBatch batch{_writer, _parser.maxNegotiatedMessageSize(), 16};
+	EXPECT_TRUE(batch.add(batch.request(1).clunk(42)));
+	EXPECT_FALSE(batch.add(batch.request(2).clunk(43)));
+	batch.seal();
+	writer.flush();
+
+	auto const traced = records();
+	ASSERT_EQ(1u, traced.size());
+	EXPECT_EQ(_writer.viewRemaining(), traced[0].frame);
+}
+
+
+TEST_F(Trace, framesLargerThenBufferArePassedInPlace) {
+	byte smallBuffer[TraceFormat::kHeaderSize + 24];
+	TraceWriter writer{wrapMemory(smallBuffer), appendTo, &_trace};
+
+	byte const data[64] = {7};
+	auto const small = RequestWriter{_writer, 1}.clunk(42).build().viewRemaining();
+	writer.record(TraceDirection::Sent, 10, FrameSegments{small, MemoryView{}});
+
+	byte responseBuffer[32];
+	ByteWriter responseWriter{wrapMemory(responseBuffer)};
+	auto const large = ResponseWriter{responseWriter, 1}.read().build(wrapMemory(data));
+	writer.record(TraceDirection::Received, 20, large);
+	writer.record(TraceDirection::Sent, 30, FrameSegments{small, MemoryView{}});
+	writer.flush();
+
+	ASSERT_TRUE(TraceReader{trace()}.validate(_parser).isOk());
+	auto const traced = records();
+	ASSERT_EQ(3u, traced.size());
+	EXPECT_EQ(10u, traced[0].timestamp);
+	EXPECT_EQ(small, traced[0].frame);
+	EXPECT_EQ(20u, traced[1].timestamp);
+	EXPECT_EQ(TraceDirection::Received, traced[1].direction);
+	EXPECT_EQ(large.size(), traced[1].frame.size());
+	EXPECT_EQ(30u, traced[2].timestamp);
+	EXPECT_EQ(small, traced[2].frame);
+}
+
+
+TEST_F(Trace, illFormedTraceIsRejected) {
+	TraceWriter writer{wrapMemory(_traceBuffer), appendTo, &_trace};
+	auto const frame = RequestWriter{_writer, 1}.clunk(42).build().viewRemaining();
+	writer.record(TraceDirection::Sent, 1, FrameSegments{frame, MemoryView{}});
+	writer.record(TraceDirection::Sent, 2, FrameSegments{frame, MemoryView{}});
+	writer.flush();
+
+	auto const truncated = trace().slice(0, _trace.size() - 1);
+	EXPECT_TRUE(TraceReader{truncated}.validate(_parser).isError());
+
+	size_t count = 0;
+	for (auto record : TraceReader{truncated}) {
+		EXPECT_EQ(frame, record.frame);
+		++count;
+	}
+	EXPECT_EQ(1u, count);
+
+	_trace[0] ^= 0xFF;
+	EXPECT_TRUE(TraceReader{trace()}.validate(_parser).isError());
+	EXPECT_EQ(0u, TraceReader{trace()}.startTime());
+}